@@ -76,6 +76,7 @@ enum sr_error_code {
 	SR_ERR_CHANNEL_GROUP = -9, /**< A channel group must be specified. */
 	SR_ERR_DATA          =-10, /**< Data is invalid.  */
 	SR_ERR_IO            =-11, /**< Input/output error. */
+	SR_ERR_BUSY          =-12, /**< Resource is busy. */
 
 	/* Update sr_strerror()/sr_strerror_name() (error.c) upon changes! */
 };
@@ -465,6 +466,34 @@ struct sr_context;
  */
 struct sr_session;
 
+/**
+ * @struct sr_session_file
+ * Opaque structure representing an open session file, for random access
+ * to the data in it.
+ *
+ * @see sr_session_file_open(), sr_session_file_close().
+ */
+struct sr_session_file;
+
+/**
+ * Statistics of a session's buffer pool, which drivers and modules take
+ * the memory for sample data from.
+ *
+ * @see sr_session_pool_stats_get().
+ */
+struct sr_pool_stats {
+	/** Number of allocations. */
+	uint64_t allocations;
+	/** Allocations served from a free list. */
+	uint64_t hits;
+	/** Allocations too large to be pooled. */
+	uint64_t oversize;
+	/** Blocks currently in use. */
+	uint64_t outstanding;
+	/** Bytes held on the free lists. */
+	uint64_t cached_bytes;
+};
+
 struct sr_rational {
 	/** Numerator of the rational number. */
 	int64_t p;
@@ -577,6 +606,14 @@ enum sr_output_flag {
 	SR_OUTPUT_INTERNAL_IO_HANDLING = 0x01,
 };
 
+/** What a threaded datafeed callback does when its queue is full. */
+enum sr_datafeed_overflow {
+	/** Wait until the callback has caught up. */
+	SR_DATAFEED_BLOCK,
+	/** Drop SR_DF_LOGIC and SR_DF_ANALOG packets. */
+	SR_DATAFEED_DROP,
+};
+
 struct sr_input;
 struct sr_input_module;
 struct sr_output;
@@ -1031,6 +1068,30 @@ enum sr_configkey {
 	/** Number of powerline cycles for ADC integration time. */
 	SR_CONF_ADC_POWERLINE_CYCLES,
 
+	/** Size of a single USB bulk transfer, in bytes (0 = automatic). */
+	SR_CONF_USB_TRANSFER_SIZE,
+
+	/** Number of USB transfers kept in flight (0 = automatic). */
+	SR_CONF_USB_NUM_TRANSFERS,
+
+	/** Number of USB transfers which returned less data than requested. */
+	SR_CONF_USB_SHORT_PACKETS,
+
+	/** Number of USB transfers which failed or returned no data. */
+	SR_CONF_USB_DROPPED_TRANSFERS,
+
+	/** Worst case time between a USB transfer completing and its
+	 * resubmission, in microseconds. */
+	SR_CONF_USB_RESUBMIT_LATENCY,
+
+	/** Handle USB events on a dedicated thread instead of the session's
+	 * main loop. */
+	SR_CONF_USB_EVENT_THREAD,
+
+	/** Maximum number of SCPI queries sent ahead of reading the
+	 * response to an earlier one (1 = no pipelining). */
+	SR_CONF_SCPI_PIPELINE_DEPTH,
+
 	/* Update sr_key_info_config[] (hwdriver.c) upon changes! */
 
 	/*--- Acquisition modes, sample limiting ----------------------------*/
@@ -1176,6 +1237,23 @@ struct sr_dev_driver {
 	void *context;
 };
 
+/** Opaque structure representing a concurrent device scan. */
+struct sr_scan;
+
+/** Diagnostics of a single probe done by sr_scan_run(). */
+struct sr_scan_probe {
+	/** The driver which did the probe. */
+	const struct sr_dev_driver *driver;
+	/** The probed resource, or NULL for the driver's scan as a whole. */
+	char *resource;
+	/** Number of devices found. */
+	int num_devices;
+	/** Time taken by the probe, in microseconds. */
+	uint64_t duration_us;
+	/** TRUE if the probe didn't start before the scan's deadline. */
+	gboolean skipped;
+};
+
 /** Serial port descriptor. */
 struct sr_serial_port {
 	/** The OS dependent name of the serial port. */
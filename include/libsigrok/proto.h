@@ -57,6 +57,12 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count);
+SR_API int sr_a2l_threshold_packed(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, unsigned int unitsize,
+		unsigned int bit, uint64_t count);
+SR_API int sr_a2l_schmitt_trigger_packed(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		unsigned int unitsize, unsigned int bit, uint64_t count);
 
 /*--- log.c -----------------------------------------------------------------*/
 
@@ -120,6 +126,15 @@ SR_API int sr_config_list(const struct sr_dev_driver *driver,
 SR_API const struct sr_key_info *sr_key_info_get(int keytype, uint32_t key);
 SR_API const struct sr_key_info *sr_key_info_name_get(int keytype, const char *keyid);
 
+/*--- scan.c ----------------------------------------------------------------*/
+
+SR_API struct sr_scan *sr_scan_new(struct sr_context *ctx);
+SR_API void sr_scan_free(struct sr_scan *scan);
+SR_API int sr_scan_add(struct sr_scan *scan, struct sr_dev_driver *driver,
+		GSList *options);
+SR_API GSList *sr_scan_run(struct sr_scan *scan, uint64_t timeout_ms);
+SR_API GSList *sr_scan_probes_get(const struct sr_scan *scan);
+
 /*--- session.c -------------------------------------------------------------*/
 
 typedef void (*sr_session_stopped_callback)(void *data);
@@ -141,22 +156,54 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 SR_API int sr_session_dev_list(struct sr_session *session, GSList **devlist);
 SR_API int sr_session_trigger_set(struct sr_session *session, struct sr_trigger *trig);
 
+/* Random access to session files */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **sfile);
+SR_API void sr_session_file_close(struct sr_session_file *sfile);
+SR_API int sr_session_file_logic_info(const struct sr_session_file *sfile,
+		uint64_t *num_samples, unsigned int *unitsize);
+SR_API int sr_session_file_analog_info(const struct sr_session_file *sfile,
+		int index, uint64_t *num_samples);
+SR_API int sr_session_file_read_logic(struct sr_session_file *sfile,
+		uint64_t start, uint64_t end, uint8_t *buf);
+SR_API int sr_session_file_read_analog(struct sr_session_file *sfile,
+		int index, uint64_t start, uint64_t end, float *buf);
+SR_API int sr_session_file_summary_blocksize(const struct sr_session_file *sfile,
+		uint64_t *blocksize);
+SR_API int sr_session_file_logic_summary(struct sr_session_file *sfile,
+		unsigned int level, uint64_t first, uint64_t count,
+		uint8_t *masks);
+SR_API int sr_session_file_analog_summary(struct sr_session_file *sfile,
+		int index, unsigned int level, uint64_t first, uint64_t count,
+		float *min, float *max);
+SR_API int sr_session_file_logic_next_transition(struct sr_session_file *sfile,
+		uint64_t start, const uint8_t *mask, uint64_t *sample);
+
 /* Datafeed setup */
 SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session);
 SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 		sr_datafeed_callback cb, void *cb_data);
+SR_API int sr_session_datafeed_callback_add_threaded(
+		struct sr_session *session, sr_datafeed_callback cb,
+		void *cb_data, unsigned int queue_size,
+		enum sr_datafeed_overflow overflow);
 
 /* Session control */
 SR_API int sr_session_start(struct sr_session *session);
 SR_API int sr_session_run(struct sr_session *session);
 SR_API int sr_session_stop(struct sr_session *session);
 SR_API int sr_session_is_running(struct sr_session *session);
+SR_API int sr_session_pool_stats_get(struct sr_session *session,
+		struct sr_pool_stats *stats);
 SR_API int sr_session_stopped_callback_set(struct sr_session *session,
 		sr_session_stopped_callback cb, void *cb_data);
 
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy);
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet);
+SR_API struct sr_datafeed_packet *sr_packet_ref(
+		const struct sr_datafeed_packet *packet);
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet);
 
 /*--- input/input.c ---------------------------------------------------------*/
 
@@ -154,6 +154,161 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 	return SR_OK;
 }
 
+/*
+ * Conversion kernels, one per encoding. The byte order is handled by
+ * reading native words and swapping them if needed, which keeps the loops
+ * simple enough for the compiler to vectorize.
+ */
+#define NO_SWAP(x) (x)
+
+#define ANALOG_INT_KERNEL(name, type, utype, swap) \
+static void name(const uint8_t *in, float *out, size_t count, \
+		float scale, float offset) \
+{ \
+	utype u; \
+	size_t i; \
+\
+	for (i = 0; i < count; i++) { \
+		memcpy(&u, in + i * sizeof(u), sizeof(u)); \
+		out[i] = scale * (type)swap(u) + offset; \
+	} \
+}
+
+#define ANALOG_FLOAT_KERNEL(name, type, utype, swap) \
+static void name(const uint8_t *in, float *out, size_t count, \
+		float scale, float offset) \
+{ \
+	union { utype u; type f; } v; \
+	size_t i; \
+\
+	for (i = 0; i < count; i++) { \
+		memcpy(&v.u, in + i * sizeof(v.u), sizeof(v.u)); \
+		v.u = swap(v.u); \
+		out[i] = scale * v.f + offset; \
+	} \
+}
+
+ANALOG_INT_KERNEL(conv_s8, int8_t, uint8_t, NO_SWAP)
+ANALOG_INT_KERNEL(conv_u8, uint8_t, uint8_t, NO_SWAP)
+ANALOG_INT_KERNEL(conv_s16, int16_t, uint16_t, NO_SWAP)
+ANALOG_INT_KERNEL(conv_u16, uint16_t, uint16_t, NO_SWAP)
+ANALOG_INT_KERNEL(conv_s16_swap, int16_t, uint16_t, GUINT16_SWAP_LE_BE)
+ANALOG_INT_KERNEL(conv_u16_swap, uint16_t, uint16_t, GUINT16_SWAP_LE_BE)
+ANALOG_INT_KERNEL(conv_s32, int32_t, uint32_t, NO_SWAP)
+ANALOG_INT_KERNEL(conv_u32, uint32_t, uint32_t, NO_SWAP)
+ANALOG_INT_KERNEL(conv_s32_swap, int32_t, uint32_t, GUINT32_SWAP_LE_BE)
+ANALOG_INT_KERNEL(conv_u32_swap, uint32_t, uint32_t, GUINT32_SWAP_LE_BE)
+ANALOG_FLOAT_KERNEL(conv_float, float, uint32_t, NO_SWAP)
+ANALOG_FLOAT_KERNEL(conv_float_swap, float, uint32_t, GUINT32_SWAP_LE_BE)
+ANALOG_FLOAT_KERNEL(conv_double, double, uint64_t, NO_SWAP)
+ANALOG_FLOAT_KERNEL(conv_double_swap, double, uint64_t, GUINT64_SWAP_LE_BE)
+
+static void conv_float_copy(const uint8_t *in, float *out, size_t count,
+		float scale, float offset)
+{
+	(void)scale;
+	(void)offset;
+
+	memcpy(out, in, count * sizeof(float));
+}
+
+/** @private
+ *
+ * Prepare the conversion of data in the given encoding to floats.
+ *
+ * The plan holds the scale and offset as floats and the conversion
+ * routine for the encoding, so callers converting many frames of the
+ * same encoding only need to do this once.
+ *
+ * @param[out] plan The conversion plan to initialize. Must not be NULL.
+ * @param[in] encoding The encoding of the data. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ */
+SR_PRIV int sr_analog_float_plan_init(struct sr_analog_float_plan *plan,
+		const struct sr_analog_encoding *encoding)
+{
+	gboolean swap;
+
+	if (!plan || !encoding || !encoding->scale.q || !encoding->offset.q)
+		return SR_ERR_ARG;
+
+#ifdef WORDS_BIGENDIAN
+	swap = !encoding->is_bigendian;
+#else
+	swap = encoding->is_bigendian;
+#endif
+
+	plan->unitsize = encoding->unitsize;
+	plan->scale = encoding->scale.p / (float)encoding->scale.q;
+	plan->offset = encoding->offset.p / (float)encoding->offset.q;
+	plan->convert = NULL;
+
+	if (encoding->is_float) {
+		switch (encoding->unitsize) {
+		case sizeof(float):
+			if (!swap && plan->scale == 1 && plan->offset == 0)
+				/* The data is already in the right format. */
+				plan->convert = conv_float_copy;
+			else
+				plan->convert = swap ? conv_float_swap : conv_float;
+			break;
+		case sizeof(double):
+			plan->convert = swap ? conv_double_swap : conv_double;
+			break;
+		}
+	} else if (encoding->is_signed) {
+		switch (encoding->unitsize) {
+		case 1:
+			plan->convert = conv_s8;
+			break;
+		case 2:
+			plan->convert = swap ? conv_s16_swap : conv_s16;
+			break;
+		case 4:
+			plan->convert = swap ? conv_s32_swap : conv_s32;
+			break;
+		}
+	} else {
+		switch (encoding->unitsize) {
+		case 1:
+			plan->convert = conv_u8;
+			break;
+		case 2:
+			plan->convert = swap ? conv_u16_swap : conv_u16;
+			break;
+		case 4:
+			plan->convert = swap ? conv_u32_swap : conv_u32;
+			break;
+		}
+	}
+
+	if (!plan->convert) {
+		sr_err("Unsupported unit size '%d' for analog-to-float"
+		       " conversion.", encoding->unitsize);
+		return SR_ERR;
+	}
+
+	return SR_OK;
+}
+
+/** @private
+ *
+ * Convert count values to floats according to a conversion plan.
+ *
+ * @param[in] plan A plan set up by sr_analog_float_plan_init().
+ * @param[in] data The data to convert.
+ * @param[out] outbuf Memory for count floats.
+ * @param[in] count The number of values to convert.
+ */
+SR_PRIV void sr_analog_float_plan_run(const struct sr_analog_float_plan *plan,
+		const void *data, float *outbuf, size_t count)
+{
+	plan->convert(data, outbuf, count, plan->scale, plan->offset);
+}
+
 /**
  * Convert an analog datafeed payload to an array of floats.
  *
@@ -174,122 +329,19 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
 SR_API int sr_analog_to_float(const struct sr_datafeed_analog *analog,
 		float *outbuf)
 {
-	unsigned int b, count;
-	gboolean bigendian;
+	struct sr_analog_float_plan plan;
+	size_t count;
+	int ret;
 
 	if (!analog || !(analog->data) || !(analog->meaning)
 			|| !(analog->encoding) || !outbuf)
 		return SR_ERR_ARG;
 
-	count = analog->num_samples * g_slist_length(analog->meaning->channels);
-
-#ifdef WORDS_BIGENDIAN
-	bigendian = TRUE;
-#else
-	bigendian = FALSE;
-#endif
-
-	if (!analog->encoding->is_float) {
-		float offset = analog->encoding->offset.p / (float)analog->encoding->offset.q;
-		float scale = analog->encoding->scale.p / (float)analog->encoding->scale.q;
-		gboolean is_signed = analog->encoding->is_signed;
-		gboolean is_bigendian = analog->encoding->is_bigendian;
-		int8_t *data8 = (int8_t *)(analog->data);
-		int16_t *data16 = (int16_t *)(analog->data);
-		int32_t *data32 = (int32_t *)(analog->data);
+	if ((ret = sr_analog_float_plan_init(&plan, analog->encoding)) != SR_OK)
+		return ret;
 
-		switch (analog->encoding->unitsize) {
-		case 1:
-			if (is_signed) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * data8[i];
-					outbuf[i] += offset;
-				}
-			} else {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * R8(data8 + i);
-					outbuf[i] += offset;
-				}
-			}
-			break;
-		case 2:
-			if (is_signed && is_bigendian) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RB16S(&data16[i]);
-					outbuf[i] += offset;
-				}
-			} else if (is_bigendian) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RB16(&data16[i]);
-					outbuf[i] += offset;
-				}
-			} else if (is_signed) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RL16S(&data16[i]);
-					outbuf[i] += offset;
-				}
-			} else {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RL16(&data16[i]);
-					outbuf[i] += offset;
-				}
-			}
-			break;
-		case 4:
-			if (is_signed && is_bigendian) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RB32S(&data32[i]);
-					outbuf[i] += offset;
-				}
-			} else if (is_bigendian) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RB32(&data32[i]);
-					outbuf[i] += offset;
-				}
-			} else if (is_signed) {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RL32S(&data32[i]);
-					outbuf[i] += offset;
-				}
-			} else {
-				for (unsigned int i = 0; i < count; i++) {
-					outbuf[i] = scale * RL32(&data32[i]);
-					outbuf[i] += offset;
-				}
-			}
-			break;
-		default:
-			sr_err("Unsupported unit size '%d' for analog-to-float"
-			       " conversion.", analog->encoding->unitsize);
-			return SR_ERR;
-		}
-		return SR_OK;
-	}
-
-	if (analog->encoding->unitsize == sizeof(float)
-			&& analog->encoding->is_bigendian == bigendian
-			&& analog->encoding->scale.p == 1
-			&& analog->encoding->scale.q == 1
-			&& analog->encoding->offset.p / (float)analog->encoding->offset.q == 0) {
-		/* The data is already in the right format. */
-		memcpy(outbuf, analog->data, count * sizeof(float));
-	} else {
-		for (unsigned int i = 0; i < count; i += analog->encoding->unitsize) {
-			for (b = 0; b < analog->encoding->unitsize; b++) {
-				if (analog->encoding->is_bigendian == bigendian)
-					((uint8_t *)outbuf)[i + b] =
-						((uint8_t *)analog->data)[i * analog->encoding->unitsize + b];
-				else
-					((uint8_t *)outbuf)[i + (analog->encoding->unitsize - b)] =
-						((uint8_t *)analog->data)[i * analog->encoding->unitsize + b];
-			}
-			if (analog->encoding->scale.p != 1
-					|| analog->encoding->scale.q != 1)
-				outbuf[i] = (outbuf[i] * analog->encoding->scale.p) / analog->encoding->scale.q;
-			float offset = ((float)analog->encoding->offset.p / (float)analog->encoding->offset.q);
-			outbuf[i] += offset;
-		}
-	}
+	count = analog->num_samples * g_slist_length(analog->meaning->channels);
+	sr_analog_float_plan_run(&plan, analog->data, outbuf, count);
 
 	return SR_OK;
 }
@@ -629,4 +681,62 @@ SR_API int sr_rational_div(struct sr_rational *res, const struct sr_rational *nu
 	return sr_rational_mult(res, num, &t);
 }
 
+/** @private
+ *
+ * Set a rational number to a floating point value.
+ *
+ * The value is expanded into a continued fraction. The result is the
+ * first convergent which equals the value in double precision, or the
+ * last one whose numerator and denominator fit in 63 bits. Small and
+ * large values keep their precision, and simple values like 0.1 give
+ * simple fractions.
+ *
+ * @param[out] r Rational number struct to set. Must not be NULL.
+ * @param[in] value The value.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Value out of range.
+ */
+SR_PRIV int sr_rational_from_double(struct sr_rational *r, double value)
+{
+	uint64_t p, q, p_prev, q_prev, a, t;
+	double x, frac;
+	unsigned int i;
+
+	x = fabs(value);
+	if (!isfinite(x) || x >= (double)INT64_MAX)
+		return SR_ERR_ARG;
+
+	/* Convergents p/q, starting from 1/0. */
+	p = 1;
+	q = 0;
+	p_prev = 0;
+	q_prev = 1;
+	for (i = 0; i < 64; i++) {
+		if (x >= (double)INT64_MAX)
+			break;
+		a = (uint64_t)x;
+		if (a && (p > (INT64_MAX - p_prev) / a
+				|| q > (INT64_MAX - q_prev) / a))
+			break;
+		t = a * p + p_prev;
+		p_prev = p;
+		p = t;
+		t = a * q + q_prev;
+		q_prev = q;
+		q = t;
+		if ((double)p / q == fabs(value))
+			break;
+		frac = x - a;
+		if (frac == 0)
+			break;
+		x = 1 / frac;
+	}
+
+	r->p = value < 0 ? -(int64_t)p : (int64_t)p;
+	r->q = q;
+
+	return SR_OK;
+}
+
 /** @} */
@@ -169,6 +169,11 @@ SR_API GSList *sr_buildinfo_libs_get(void)
 	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBFTDI_VERSION));
 	l = g_slist_append(l, m);
 #endif
+#ifdef HAVE_ZLIB
+	m = g_slist_append(NULL, g_strdup("zlib"));
+	m = g_slist_append(m, g_strdup_printf("%s", CONF_ZLIB_VERSION));
+	l = g_slist_append(l, m);
+#endif
 #ifdef HAVE_LIBGPIB
 	m = g_slist_append(NULL, g_strdup("libgpib"));
 	m = g_slist_append(m, g_strdup_printf("%s", CONF_LIBGPIB_VERSION));
@@ -509,6 +514,11 @@ static int sanity_check_all_transform_modules(void)
 			sr_err("No receive in module '%s'.", d);
 			errors++;
 		}
+		if ((transforms[i]->flags & SR_TRANSFORM_FUSABLE)
+				&& !transforms[i]->logic_block) {
+			sr_err("No logic_block in fusable module '%s'.", d);
+			errors++;
+		}
 		/* Note: cleanup() is optional. */
 
 		if (errors == 0)
@@ -23,14 +23,275 @@
  * Conversion helper functions.
  */
 
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "conv"
 
+/* Number of samples converted per pass when working through floats. */
+#define A2L_CHUNK 256
+
+/*
+ * Fused kernels for integer encodings. Instead of converting every sample
+ * to a float and comparing that against the threshold, the thresholds are
+ * moved into the integer domain once and the raw samples are compared
+ * directly. A negative scale reverses the order of the values, this is
+ * handled by multiplying the raw value with the sign of the scale.
+ */
+#define NO_SWAP(x) (x)
+
+#define A2L_INT_KERNELS(name, type, utype, swap) \
+static void name##_threshold(const uint8_t *in, uint8_t *out, size_t count, \
+		int64_t sign, int64_t thr) \
+{ \
+	utype u; \
+	size_t i; \
+\
+	for (i = 0; i < count; i++) { \
+		memcpy(&u, in + i * sizeof(u), sizeof(u)); \
+		out[i] = sign * (type)swap(u) >= thr; \
+	} \
+} \
+\
+static void name##_schmitt(const uint8_t *in, uint8_t *out, size_t count, \
+		int64_t sign, int64_t lo, int64_t hi, uint8_t *state) \
+{ \
+	utype u; \
+	int64_t v; \
+	uint8_t st; \
+	size_t i; \
+\
+	st = *state; \
+	for (i = 0; i < count; i++) { \
+		memcpy(&u, in + i * sizeof(u), sizeof(u)); \
+		v = sign * (type)swap(u); \
+		if (v < lo) \
+			st = 0; \
+		else if (v >= hi) \
+			st = 1; \
+		out[i] = st; \
+	} \
+	*state = st; \
+}
+
+A2L_INT_KERNELS(a2l_s8, int8_t, uint8_t, NO_SWAP)
+A2L_INT_KERNELS(a2l_u8, uint8_t, uint8_t, NO_SWAP)
+A2L_INT_KERNELS(a2l_s16, int16_t, uint16_t, NO_SWAP)
+A2L_INT_KERNELS(a2l_u16, uint16_t, uint16_t, NO_SWAP)
+A2L_INT_KERNELS(a2l_s16_swap, int16_t, uint16_t, GUINT16_SWAP_LE_BE)
+A2L_INT_KERNELS(a2l_u16_swap, uint16_t, uint16_t, GUINT16_SWAP_LE_BE)
+A2L_INT_KERNELS(a2l_s32, int32_t, uint32_t, NO_SWAP)
+A2L_INT_KERNELS(a2l_u32, uint32_t, uint32_t, NO_SWAP)
+A2L_INT_KERNELS(a2l_s32_swap, int32_t, uint32_t, GUINT32_SWAP_LE_BE)
+A2L_INT_KERNELS(a2l_u32_swap, uint32_t, uint32_t, GUINT32_SWAP_LE_BE)
+
+struct a2l_int_type {
+	unsigned int unitsize;
+	gboolean is_signed;
+	gboolean swap;
+	int64_t min;
+	int64_t max;
+	void (*threshold)(const uint8_t *in, uint8_t *out, size_t count,
+			int64_t sign, int64_t thr);
+	void (*schmitt)(const uint8_t *in, uint8_t *out, size_t count,
+			int64_t sign, int64_t lo, int64_t hi, uint8_t *state);
+};
+
+#define A2L_INT_TYPE(name, size, sgn, swp, lo, hi) \
+	{ size, sgn, swp, lo, hi, name##_threshold, name##_schmitt }
+
+static const struct a2l_int_type a2l_int_types[] = {
+	A2L_INT_TYPE(a2l_s8, 1, TRUE, FALSE, INT8_MIN, INT8_MAX),
+	A2L_INT_TYPE(a2l_s8, 1, TRUE, TRUE, INT8_MIN, INT8_MAX),
+	A2L_INT_TYPE(a2l_u8, 1, FALSE, FALSE, 0, UINT8_MAX),
+	A2L_INT_TYPE(a2l_u8, 1, FALSE, TRUE, 0, UINT8_MAX),
+	A2L_INT_TYPE(a2l_s16, 2, TRUE, FALSE, INT16_MIN, INT16_MAX),
+	A2L_INT_TYPE(a2l_s16_swap, 2, TRUE, TRUE, INT16_MIN, INT16_MAX),
+	A2L_INT_TYPE(a2l_u16, 2, FALSE, FALSE, 0, UINT16_MAX),
+	A2L_INT_TYPE(a2l_u16_swap, 2, FALSE, TRUE, 0, UINT16_MAX),
+	A2L_INT_TYPE(a2l_s32, 4, TRUE, FALSE, INT32_MIN, INT32_MAX),
+	A2L_INT_TYPE(a2l_s32_swap, 4, TRUE, TRUE, INT32_MIN, INT32_MAX),
+	A2L_INT_TYPE(a2l_u32, 4, FALSE, FALSE, 0, UINT32_MAX),
+	A2L_INT_TYPE(a2l_u32_swap, 4, FALSE, TRUE, 0, UINT32_MAX),
+};
+
+/* Prepared state of one analog-to-logic conversion call. */
+struct a2l_ctx {
+	struct sr_analog_float_plan plan;
+	const struct a2l_int_type *type;
+	int64_t sign;
+	int64_t lo, hi;
+};
+
+static const struct a2l_int_type *a2l_int_type_find(
+		const struct sr_analog_encoding *encoding)
+{
+	gboolean swap;
+	unsigned int i;
+
+	if (encoding->is_float)
+		return NULL;
+
+#ifdef WORDS_BIGENDIAN
+	swap = !encoding->is_bigendian;
+#else
+	swap = encoding->is_bigendian;
+#endif
+
+	for (i = 0; i < ARRAY_SIZE(a2l_int_types); i++) {
+		if (a2l_int_types[i].unitsize == encoding->unitsize &&
+		    a2l_int_types[i].is_signed == !!encoding->is_signed &&
+		    a2l_int_types[i].swap == swap)
+			return &a2l_int_types[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Find the smallest sign-adjusted raw value whose converted float is at
+ * least (or, if strict, above) thr. The float is computed exactly like
+ * the analog-to-float conversion does, so the fused kernels produce the
+ * same results as comparing the converted values. Returns max + 1 if no
+ * raw value qualifies.
+ */
+static int64_t a2l_int_threshold(const struct a2l_ctx *ctx, float thr,
+		gboolean strict)
+{
+	int64_t lo, hi, mid;
+	float value;
+
+	if (ctx->sign > 0) {
+		lo = ctx->type->min;
+		hi = ctx->type->max + 1;
+	} else {
+		lo = -ctx->type->max;
+		hi = -ctx->type->min + 1;
+	}
+
+	/* The converted value never decreases with the adjusted raw value. */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		value = ctx->plan.scale * (float)(ctx->sign * mid) +
+			ctx->plan.offset;
+		if (strict ? value > thr : value >= thr)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return lo;
+}
+
+static int a2l_init(struct a2l_ctx *ctx,
+		const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, gboolean schmitt)
+{
+	int ret;
+
+	if (!analog || !analog->encoding)
+		return SR_ERR_ARG;
+
+	if ((ret = sr_analog_float_plan_init(&ctx->plan, analog->encoding)) != SR_OK)
+		return ret;
+
+	ctx->type = a2l_int_type_find(analog->encoding);
+	if (!ctx->type)
+		return SR_OK;
+
+	ctx->sign = (ctx->plan.scale < 0) ? -1 : 1;
+	if (schmitt) {
+		/* Becomes 0 below lo_thr, becomes 1 above hi_thr. */
+		ctx->lo = a2l_int_threshold(ctx, lo_thr, FALSE);
+		ctx->hi = a2l_int_threshold(ctx, hi_thr, TRUE);
+	} else {
+		ctx->lo = a2l_int_threshold(ctx, lo_thr, FALSE);
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Convert count samples to 0/1 bytes. Integer encodings use the fused
+ * kernels, everything else is converted to floats in chunks on the stack.
+ */
+static void a2l_run(const struct a2l_ctx *ctx, const uint8_t *in,
+		uint8_t *out, size_t count, float lo_thr, float hi_thr,
+		uint8_t *state)
+{
+	float buf[A2L_CHUNK];
+	size_t i, n;
+	uint8_t st;
+
+	if (ctx->type) {
+		if (state)
+			ctx->type->schmitt(in, out, count, ctx->sign,
+				ctx->lo, ctx->hi, state);
+		else
+			ctx->type->threshold(in, out, count, ctx->sign, ctx->lo);
+		return;
+	}
+
+	while (count) {
+		n = MIN(count, A2L_CHUNK);
+		sr_analog_float_plan_run(&ctx->plan, in, buf, n);
+		if (state) {
+			st = *state;
+			for (i = 0; i < n; i++) {
+				if (buf[i] < lo_thr)
+					st = 0;
+				else if (buf[i] > hi_thr)
+					st = 1;
+				out[i] = st;
+			}
+			*state = st;
+		} else {
+			for (i = 0; i < n; i++)
+				out[i] = buf[i] >= lo_thr;
+		}
+		in += n * ctx->plan.unitsize;
+		out += n;
+		count -= n;
+	}
+}
+
+/*
+ * Same as a2l_run(), but only update one bit in each sample of a logic
+ * buffer with the given unit size.
+ */
+static void a2l_run_packed(const struct a2l_ctx *ctx, const uint8_t *in,
+		uint8_t *output, unsigned int unitsize, unsigned int bit,
+		size_t count, float lo_thr, float hi_thr, uint8_t *state)
+{
+	uint8_t bits[A2L_CHUNK];
+	uint8_t mask, *out;
+	size_t i, n;
+
+	out = output + bit / 8;
+	mask = 1 << (bit % 8);
+
+	while (count) {
+		n = MIN(count, A2L_CHUNK);
+		a2l_run(ctx, in, bits, n, lo_thr, hi_thr, state);
+		for (i = 0; i < n; i++)
+			out[i * unitsize] = (out[i * unitsize] & ~mask) |
+				(-bits[i] & mask);
+		in += n * ctx->plan.unitsize;
+		out += n * unitsize;
+		count -= n;
+	}
+}
+
 /**
  * Convert analog values to logic values by using a fixed threshold.
  *
+ * No memory is allocated. Integer encodings are compared against the
+ * threshold without converting every sample to a float first.
+ *
  * @param[in] analog The analog input values.
  * @param[in] threshold The threshold to use.
  * @param[out] output The converted output values; either 0 or 1. Must provide
@@ -42,22 +303,16 @@
 SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 		float threshold, uint8_t *output, uint64_t count)
 {
-	float *input;
+	struct a2l_ctx ctx;
+	int ret;
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
+	if (!output && count)
+		return SR_ERR_ARG;
 
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+	if ((ret = a2l_init(&ctx, analog, threshold, threshold, FALSE)) != SR_OK)
+		return ret;
 
-	for (uint64_t i = 0; i < count; i++)
-		output[i] = (input[i] >= threshold) ? 1 : 0;
-
-	if (!analog->encoding->is_float)
-		g_free(input);
+	a2l_run(&ctx, analog->data, output, count, threshold, threshold, NULL);
 
 	return SR_OK;
 }
@@ -65,6 +320,9 @@ SR_API int sr_a2l_threshold(const struct sr_datafeed_analog *analog,
 /**
  * Convert analog values to logic values by using a Schmitt-trigger algorithm.
  *
+ * No memory is allocated. Integer encodings are compared against the
+ * thresholds without converting every sample to a float first.
+ *
  * @param analog The analog input values.
  * @param lo_thr The low threshold - result becomes 0 below it.
  * @param lo_thr The high threshold - result becomes 1 above it.
@@ -80,28 +338,265 @@ SR_API int sr_a2l_schmitt_trigger(const struct sr_datafeed_analog *analog,
 		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
 		uint64_t count)
 {
-	float *input;
+	struct a2l_ctx ctx;
+	int ret;
 
-	if (!analog->encoding->is_float) {
-		input = g_try_malloc(sizeof(float) * count);
-		if (!input)
-			return SR_ERR;
+	if (!state || (!output && count))
+		return SR_ERR_ARG;
 
-		sr_analog_to_float(analog, input);
-	} else
-		input = analog->data;
+	if ((ret = a2l_init(&ctx, analog, lo_thr, hi_thr, TRUE)) != SR_OK)
+		return ret;
 
-	for (uint64_t i = 0; i < count; i++) {
-		if (input[i] < lo_thr)
-			*state = 0;
-		else if (input[i] > hi_thr)
-			*state = 1;
+	a2l_run(&ctx, analog->data, output, count, lo_thr, hi_thr, state);
 
-		output[i] = *state;
-	}
+	return SR_OK;
+}
 
-	if (!analog->encoding->is_float)
-		g_free(input);
+/**
+ * Convert analog values to one bit of a logic sample buffer by using a
+ * fixed threshold.
+ *
+ * This allows converting several analog channels into one logic buffer,
+ * e.g. for mixed signal data. Only the selected bit of each logic sample
+ * is modified. No memory is allocated.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] threshold The threshold to use.
+ * @param[out] output Logic samples of unitsize bytes each. Must provide
+ *                    space for count samples.
+ * @param[in] unitsize The size of one logic sample in bytes.
+ * @param[in] bit The bit to write, 0 is the lowest bit of the first byte.
+ *                Must be less than unitsize * 8.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_threshold_packed(const struct sr_datafeed_analog *analog,
+		float threshold, uint8_t *output, unsigned int unitsize,
+		unsigned int bit, uint64_t count)
+{
+	struct a2l_ctx ctx;
+	int ret;
+
+	if ((!output && count) || !unitsize || bit >= unitsize * 8)
+		return SR_ERR_ARG;
+
+	if ((ret = a2l_init(&ctx, analog, threshold, threshold, FALSE)) != SR_OK)
+		return ret;
+
+	a2l_run_packed(&ctx, analog->data, output, unitsize, bit, count,
+		threshold, threshold, NULL);
 
 	return SR_OK;
 }
+
+/**
+ * Convert analog values to one bit of a logic sample buffer by using a
+ * Schmitt-trigger algorithm.
+ *
+ * Only the selected bit of each logic sample is modified. No memory is
+ * allocated.
+ *
+ * @param[in] analog The analog input values.
+ * @param[in] lo_thr The low threshold - result becomes 0 below it.
+ * @param[in] hi_thr The high threshold - result becomes 1 above it.
+ * @param[in,out] state The internal converter state, see
+ *                      sr_a2l_schmitt_trigger().
+ * @param[out] output Logic samples of unitsize bytes each. Must provide
+ *                    space for count samples.
+ * @param[in] unitsize The size of one logic sample in bytes.
+ * @param[in] bit The bit to write, 0 is the lowest bit of the first byte.
+ *                Must be less than unitsize * 8.
+ * @param[in] count The number of samples to process.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Unsupported encoding.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_a2l_schmitt_trigger_packed(const struct sr_datafeed_analog *analog,
+		float lo_thr, float hi_thr, uint8_t *state, uint8_t *output,
+		unsigned int unitsize, unsigned int bit, uint64_t count)
+{
+	struct a2l_ctx ctx;
+	int ret;
+
+	if (!state || (!output && count) || !unitsize || bit >= unitsize * 8)
+		return SR_ERR_ARG;
+
+	if ((ret = a2l_init(&ctx, analog, lo_thr, hi_thr, TRUE)) != SR_OK)
+		return ret;
+
+	a2l_run_packed(&ctx, analog->data, output, unitsize, bit, count,
+		lo_thr, hi_thr, state);
+
+	return SR_OK;
+}
+
+/*
+ * Transpose an 8x8 bit matrix, bit c of byte r moves to bit r of byte c.
+ */
+static inline uint64_t transpose_8x8(uint64_t x)
+{
+	uint64_t t;
+
+	t = (x ^ (x >> 7)) & UINT64_C(0x00aa00aa00aa00aa);
+	x ^= t ^ (t << 7);
+	t = (x ^ (x >> 14)) & UINT64_C(0x0000cccc0000cccc);
+	x ^= t ^ (t << 14);
+	t = (x ^ (x >> 28)) & UINT64_C(0x00000000f0f0f0f0);
+	x ^= t ^ (t << 28);
+
+	return x;
+}
+
+#ifdef __SSE2__
+/*
+ * Transpose 16 words of 64 samples each. The words are first transposed
+ * bytewise, so vector j holds byte j of every word, then the bits of each
+ * sample are collected with one movemask per sample.
+ */
+static void transpose_64x16_sse2(const uint64_t *src, uint16_t *dst)
+{
+	__m128i a[8], b[8];
+	unsigned int i, j;
+
+	for (i = 0; i < 8; i++) {
+		a[i] = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+		a[i] = _mm_unpacklo_epi8(a[i], _mm_srli_si128(a[i], 8));
+	}
+	for (i = 0; i < 8; i += 2) {
+		b[i] = _mm_unpacklo_epi16(a[i], a[i + 1]);
+		b[i + 1] = _mm_unpackhi_epi16(a[i], a[i + 1]);
+	}
+	for (i = 0; i < 8; i += 4) {
+		for (j = 0; j < 2; j++) {
+			a[i + 2 * j] = _mm_unpacklo_epi32(b[i + j], b[i + j + 2]);
+			a[i + 2 * j + 1] = _mm_unpackhi_epi32(b[i + j], b[i + j + 2]);
+		}
+	}
+	for (i = 0; i < 4; i++) {
+		b[2 * i] = _mm_unpacklo_epi64(a[i], a[i + 4]);
+		b[2 * i + 1] = _mm_unpackhi_epi64(a[i], a[i + 4]);
+	}
+
+	for (j = 0; j < 8; j++) {
+		for (i = 0; i < 8; i++) {
+			dst[8 * j + 7 - i] = _mm_movemask_epi8(b[j]);
+			b[j] = _mm_add_epi8(b[j], b[j]);
+		}
+	}
+}
+#endif
+
+/*
+ * Transpose 16 words of 64 samples each, as 8x8 bit matrices made of
+ * byte j of eight words.
+ */
+static void transpose_64x16(const uint64_t *src, uint16_t *dst)
+{
+	uint64_t x, y;
+	unsigned int g, j, c;
+
+	for (j = 0; j < 8; j++) {
+		for (c = 0; c < 8; c++)
+			dst[8 * j + c] = 0;
+		for (g = 0; g < 2; g++) {
+			x = 0;
+			for (c = 0; c < 8; c++)
+				x |= ((src[8 * g + c] >> (8 * j)) & 0xff) << (8 * c);
+			y = transpose_8x8(x);
+			for (c = 0; c < 8; c++)
+				dst[8 * j + c] |= ((y >> (8 * c)) & 0xff) << (8 * g);
+		}
+	}
+}
+
+/**
+ * Prepare the transposition of channel-major logic data.
+ *
+ * @param t The transposition to set up.
+ * @param channel_mask The enabled channels. The words of a block are
+ *                     ordered by channel.
+ * @param msb_first Whether the first sample of a word is in its most
+ *                  significant bit.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_init(struct sr_transpose *t, uint16_t channel_mask,
+		gboolean msb_first)
+{
+	unsigned int b, bit, i, n;
+
+	t->num_channels = 0;
+	for (i = 0; i < 16; i++) {
+		if (channel_mask & (1 << i))
+			t->num_channels++;
+	}
+	t->msb_first = msb_first;
+	t->generic = FALSE;
+	t->sparse = channel_mask != (1 << t->num_channels) - 1;
+
+	/* Packed bit n goes to the n-th enabled channel. */
+	for (b = 0; b < 256; b++) {
+		t->scatter[0][b] = t->scatter[1][b] = 0;
+		for (i = 0, n = 0; i < 16; i++) {
+			if (!(channel_mask & (1 << i)))
+				continue;
+			bit = 1 << (n & 7);
+			if ((b & bit) && n < 8)
+				t->scatter[0][b] |= 1 << i;
+			else if ((b & bit) && n < 16)
+				t->scatter[1][b] |= 1 << i;
+			n++;
+		}
+	}
+}
+
+/**
+ * Transpose a block of 64 samples of channel-major logic data.
+ *
+ * @param t The transposition, see sr_transpose_init().
+ * @param src One word of 64 samples per enabled channel. Bit n of a word
+ *            is sample n, or sample 63 - n if the samples are stored MSB
+ *            first.
+ * @param dst Memory for 64 samples with a unit size of 2.
+ *
+ * @private
+ */
+SR_PRIV void sr_transpose_64(const struct sr_transpose *t,
+		const uint64_t *src, uint16_t *dst)
+{
+	uint64_t words[16];
+	uint16_t tmp[64], *out, v;
+	unsigned int i;
+
+	if (t->num_channels < 16) {
+		memcpy(words, src, t->num_channels * sizeof(uint64_t));
+		memset(words + t->num_channels, 0,
+			(16 - t->num_channels) * sizeof(uint64_t));
+		src = words;
+	}
+
+	out = (t->sparse || t->msb_first) ? tmp : dst;
+#ifdef __SSE2__
+	if (!t->generic)
+		transpose_64x16_sse2(src, out);
+	else
+#endif
+		transpose_64x16(src, out);
+	if (out == dst)
+		return;
+
+	for (i = 0; i < 64; i++) {
+		v = tmp[i];
+		if (t->sparse)
+			v = t->scatter[0][v & 0xff] | t->scatter[1][v >> 8];
+		dst[t->msb_first ? 63 - i : i] = v;
+	}
+}
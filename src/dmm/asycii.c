@@ -471,6 +471,9 @@ SR_PRIV int sr_asycii_packet_request(struct sr_serial_dev_inst *serial)
 }
 #endif
 
+/* Packets end in a carriage return. */
+SR_PRIV const struct sr_dmm_framing sr_asycii_framing = { -1, 0xff, '\r' };
+
 /**
  * Check whether a received frame is valid.
  *
@@ -32,6 +32,9 @@
 
 #define MAX_DIGITS 4
 
+/* Packets start with 0x02. */
+SR_PRIV const struct sr_dmm_framing sr_bm25x_framing = { 0, 0xff, 0x02 };
+
 SR_PRIV gboolean sr_brymen_bm25x_packet_valid(const uint8_t *buf)
 {
 	int i;
@@ -345,6 +345,9 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 		sr_spew("User-defined LCD symbol 1 is active.");
 }
 
+/* The first byte's sync nibble is 1. */
+SR_PRIV const struct sr_dmm_framing sr_dtm0660_framing = { 0, 0xf0, 0x10 };
+
 SR_PRIV gboolean sr_dtm0660_packet_valid(const uint8_t *buf)
 {
 	struct dtm0660_info info;
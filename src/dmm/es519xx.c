@@ -622,6 +622,9 @@ static int sr_es519xx_parse(const uint8_t *buf, float *floatval,
 	return SR_OK;
 }
 
+/* Packets (and their repetition, for 11-byte ones) end in "\r\n". */
+SR_PRIV const struct sr_dmm_framing sr_es519xx_framing = { -1, 0xff, '\n' };
+
 /*
  * Functions for 2400 baud / 11 bytes protocols.
  * This includes ES51962, ES51971, ES51972, ES51978 and ES51989.
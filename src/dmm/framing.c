@@ -0,0 +1,96 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Locating DMM packets in a byte stream.
+ *
+ * Most DMM protocols have a byte at a fixed position of every packet
+ * which always has the same value, e.g. a trailing newline or a leading
+ * sync nibble. Only the offsets where that byte matches can be the start
+ * of a packet, so the (more expensive) packet validation of the parser
+ * is only run for those.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "dmm-framing"
+
+/**
+ * Find the first valid packet in a buffer.
+ *
+ * @param framing The protocol's framing, or NULL to try every offset.
+ * @param buf The received data.
+ * @param len Number of bytes in buf.
+ * @param packet_size Size of a packet in bytes.
+ * @param packet_valid The parser's packet validation function.
+ *
+ * @return The start of the first valid packet in buf, or NULL if there
+ *         is none. In that case, only the last packet_size - 1 bytes of
+ *         buf can still become part of a packet.
+ */
+SR_PRIV const uint8_t *sr_dmm_packet_find(const struct sr_dmm_framing *framing,
+		const uint8_t *buf, size_t len, size_t packet_size,
+		gboolean (*packet_valid)(const uint8_t *))
+{
+	const uint8_t *p, *last, *sync;
+	size_t offset;
+
+	if (!packet_size || len < packet_size)
+		return NULL;
+
+	/* The last offset a whole packet can start at. */
+	last = buf + len - packet_size;
+
+	if (!framing || !framing->sync_mask) {
+		for (p = buf; p <= last; p++) {
+			if (packet_valid(p))
+				return p;
+		}
+		return NULL;
+	}
+
+	if (framing->sync_offset >= (int)packet_size ||
+			framing->sync_offset < -(int)packet_size) {
+		sr_err("Sync byte offset %d outside of %zu byte packet.",
+			framing->sync_offset, packet_size);
+		return NULL;
+	}
+	if (framing->sync_offset < 0)
+		offset = packet_size + framing->sync_offset;
+	else
+		offset = framing->sync_offset;
+
+	for (p = buf; p <= last; p++) {
+		if (framing->sync_mask == 0xff) {
+			sync = memchr(p + offset, framing->sync_value,
+				last - p + 1);
+			if (!sync)
+				return NULL;
+			p = sync - offset;
+		} else if ((p[offset] & framing->sync_mask) != framing->sync_value) {
+			continue;
+		}
+		if (packet_valid(p))
+			return p;
+	}
+
+	return NULL;
+}
@@ -34,6 +34,9 @@
 
 #define LOG_PREFIX "m2110"
 
+/* Packets end in "\r\n". */
+SR_PRIV const struct sr_dmm_framing sr_m2110_framing = { -1, 0xff, '\n' };
+
 SR_PRIV gboolean sr_m2110_packet_valid(const uint8_t *buf)
 {
 	float val;
@@ -340,6 +340,9 @@ SR_PRIV int sr_metex14_packet_request(struct sr_serial_dev_inst *serial)
 }
 #endif
 
+/* Packets end in a carriage return, and so does a set of four packets. */
+SR_PRIV const struct sr_dmm_framing sr_metex14_framing = { -1, 0xff, '\r' };
+
 SR_PRIV gboolean sr_metex14_packet_valid(const uint8_t *buf)
 {
 	struct metex14_info info;
@@ -259,6 +259,9 @@ static void handle_flags(struct sr_datafeed_analog *analog, float *floatval,
 		sr_spew("Beep is active");
 }
 
+/* The last byte of a packet is always 0. */
+SR_PRIV const struct sr_dmm_framing sr_ms8250d_framing = { -1, 0xff, 0x00 };
+
 SR_PRIV gboolean sr_ms8250d_packet_valid(const uint8_t *buf)
 {
 	struct ms8250d_info info;
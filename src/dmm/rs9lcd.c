@@ -197,6 +197,9 @@ static gboolean selection_good(const struct rs9lcd_packet *rs_packet)
  * possible check to filter out bad packets, especially since detection of the
  * 22-812 depends on how well we can filter the packets.
  */
+/* There is no fixed byte, only the checksum tells packets apart. */
+SR_PRIV const struct sr_dmm_framing sr_rs9lcd_framing = { 0, 0, 0 };
+
 SR_PRIV gboolean sr_rs9lcd_packet_valid(const uint8_t *buf)
 {
 	const struct rs9lcd_packet *rs_packet = (void *)buf;
@@ -316,6 +316,9 @@ static gboolean flags_valid(const struct ut71x_info *info)
 	return TRUE;
 }
 
+/* Packets end in "\r\n". */
+SR_PRIV const struct sr_dmm_framing sr_ut71x_framing = { -1, 0xff, '\n' };
+
 SR_PRIV gboolean sr_ut71x_packet_valid(const uint8_t *buf)
 {
 	struct ut71x_info info;
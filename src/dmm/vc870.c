@@ -390,6 +390,9 @@ static gboolean flags_valid(const struct vc870_info *info)
 	return TRUE;
 }
 
+/* Packets end in "\r\n". */
+SR_PRIV const struct sr_dmm_framing sr_vc870_framing = { -1, 0xff, '\n' };
+
 SR_PRIV gboolean sr_vc870_packet_valid(const uint8_t *buf)
 {
 	struct vc870_info info;
@@ -229,6 +229,9 @@ static gboolean flags_valid(const struct vc96_info *info)
 	return TRUE;
 }
 
+/* Packets end in "\r\n". */
+SR_PRIV const struct sr_dmm_framing sr_vc96_framing = { -1, 0xff, '\n' };
+
 SR_PRIV gboolean sr_vc96_packet_valid(const uint8_t *buf)
 {
 	struct vc96_info info;
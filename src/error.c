@@ -82,6 +82,8 @@ SR_API const char *sr_strerror(int error_code)
 		return "data is invalid";
 	case SR_ERR_IO:
 		return "input/output error";
+	case SR_ERR_BUSY:
+		return "resource is busy";
 	default:
 		return "unknown error";
 	}
@@ -137,6 +139,8 @@ SR_API const char *sr_strerror_name(int error_code)
 		return "SR_ERR_DATA";
 	case SR_ERR_IO:
 		return "SR_ERR_IO";
+	case SR_ERR_BUSY:
+		return "SR_ERR_BUSY";
 	default:
 		return "unknown error code";
 	}
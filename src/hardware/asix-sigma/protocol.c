@@ -768,6 +768,35 @@ static uint16_t sigma_deinterlace_200mhz_data(uint16_t indata, int idx)
 	return outdata;
 }
 
+/*
+ * Lookup tables which deinterlace one byte of 100MHz or 200MHz sample
+ * data at a time. Entries hold the bits of all samples of that byte, at
+ * the positions of the first byte's bits in the deinterlaced samples.
+ */
+static uint16_t deinterlace_100mhz_lut[256];
+static uint16_t deinterlace_200mhz_lut[256];
+
+static void sigma_build_deinterlace_luts(void)
+{
+	static gboolean built;
+	unsigned int b, idx;
+
+	if (built)
+		return;
+
+	for (b = 0; b < 256; b++) {
+		deinterlace_100mhz_lut[b] = 0;
+		for (idx = 0; idx < 2; idx++)
+			deinterlace_100mhz_lut[b] |=
+				sigma_deinterlace_100mhz_data(b, idx) << (8 * idx);
+		deinterlace_200mhz_lut[b] = 0;
+		for (idx = 0; idx < 4; idx++)
+			deinterlace_200mhz_lut[b] |=
+				sigma_deinterlace_200mhz_data(b, idx) << (4 * idx);
+	}
+	built = TRUE;
+}
+
 static void store_sr_sample(uint8_t *samples, int idx, uint16_t data)
 {
 	samples[2 * idx + 0] = (data >> 0) & 0xff;
@@ -818,7 +847,7 @@ static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 	struct sigma_state *ss = &devc->state;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	uint16_t tsdiff, ts, sample, item16;
+	uint16_t tsdiff, ts, sample, item16, packed, count;
 	uint8_t samples[SAMPLES_BUFFER_SIZE];
 	uint8_t *send_ptr;
 	size_t send_count, trig_count;
@@ -839,22 +868,19 @@ static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 	 * cluster, then send the appropriate number of samples with the
 	 * previous values to the sigrok session. This "decodes RLE".
 	 */
-	for (ts = 0; ts < tsdiff; ts++) {
-		i = ts % 1024;
-		store_sr_sample(samples, i, ss->lastsample);
+	for (ts = 0; ts < tsdiff; ts += count) {
+		count = MIN(1024, tsdiff - ts);
+		for (i = 0; i < count; i++)
+			store_sr_sample(samples, i, ss->lastsample);
 
 		/*
-		 * If we have 1024 samples ready or we're at the
-		 * end of submitting the padding samples, submit
-		 * the packet to Sigrok. Since constant data is
-		 * sent, duplication of data for rates above 50MHz
-		 * is simple.
+		 * Submit up to 1024 samples at a time to Sigrok.
+		 * Since constant data is sent, duplication of data
+		 * for rates above 50MHz is simple.
 		 */
-		if ((i == 1023) || (ts == tsdiff - 1)) {
-			logic.length = (i + 1) * logic.unitsize;
-			for (j = 0; j < devc->samples_per_event; j++)
-				sigma_session_send(sdi, &packet);
-		}
+		logic.length = count * logic.unitsize;
+		for (j = 0; j < devc->samples_per_event; j++)
+			sigma_session_send(sdi, &packet);
 	}
 
 	/*
@@ -868,18 +894,18 @@ static void sigma_decode_dram_cluster(struct sigma_dram_cluster *dram_cluster,
 	for (i = 0; i < events_in_cluster; i++) {
 		item16 = sigma_dram_cluster_data(dram_cluster, i);
 		if (devc->cur_samplerate == SR_MHZ(200)) {
-			sample = sigma_deinterlace_200mhz_data(item16, 0);
-			store_sr_sample(samples, send_count++, sample);
-			sample = sigma_deinterlace_200mhz_data(item16, 1);
-			store_sr_sample(samples, send_count++, sample);
-			sample = sigma_deinterlace_200mhz_data(item16, 2);
-			store_sr_sample(samples, send_count++, sample);
-			sample = sigma_deinterlace_200mhz_data(item16, 3);
-			store_sr_sample(samples, send_count++, sample);
+			packed = deinterlace_200mhz_lut[item16 & 0xff];
+			packed |= deinterlace_200mhz_lut[item16 >> 8] << 2;
+			for (j = 0; j < 4; j++) {
+				sample = (packed >> (4 * j)) & 0xf;
+				store_sr_sample(samples, send_count++, sample);
+			}
 		} else if (devc->cur_samplerate == SR_MHZ(100)) {
-			sample = sigma_deinterlace_100mhz_data(item16, 0);
+			packed = deinterlace_100mhz_lut[item16 & 0xff];
+			packed |= deinterlace_100mhz_lut[item16 >> 8] << 4;
+			sample = packed & 0xff;
 			store_sr_sample(samples, send_count++, sample);
-			sample = sigma_deinterlace_100mhz_data(item16, 1);
+			sample = packed >> 8;
 			store_sr_sample(samples, send_count++, sample);
 		} else {
 			sample = item16;
@@ -992,29 +1018,103 @@ static int decode_chunk_ts(struct sigma_dram_line *dram_line,
 	return SR_OK;
 }
 
+/*
+ * The sample memory is downloaded in two stages which overlap: a thread
+ * reads batches of DRAM lines from the FTDI chip into one of two
+ * buffers, while the main thread decodes the other one and feeds the
+ * session. The download then runs at the speed of the USB transfers,
+ * rather than at the speed of both stages in sequence.
+ */
+#define DL_LINES_PER_READ	32
+#define DL_NUM_BUFFERS		2
+#define DRAM_LINES		0x8000
+
+struct download_buffer {
+	struct sigma_dram_line lines[DL_LINES_PER_READ];
+	uint32_t count;
+	int ret;
+	gboolean full;
+};
+
+struct download_pipe {
+	struct dev_context *devc;
+	uint32_t first_line;
+	uint32_t lines_total;
+	struct download_buffer buf[DL_NUM_BUFFERS];
+	GMutex mutex;
+	GCond cond;
+	gboolean abort;
+};
+
+static gpointer download_thread(gpointer data)
+{
+	struct download_pipe *pipe;
+	struct download_buffer *buf;
+	uint32_t done, count;
+	unsigned int n;
+	gboolean abort;
+	int ret;
+
+	pipe = data;
+	for (n = 0, done = 0; done < pipe->lines_total; n++, done += count) {
+		buf = &pipe->buf[n % DL_NUM_BUFFERS];
+
+		/* Wait until the main thread has decoded this buffer. */
+		g_mutex_lock(&pipe->mutex);
+		while (buf->full && !pipe->abort)
+			g_cond_wait(&pipe->cond, &pipe->mutex);
+		abort = pipe->abort;
+		g_mutex_unlock(&pipe->mutex);
+		if (abort)
+			break;
+
+		/* We can download only up-to 32 DRAM lines in one go! */
+		count = MIN(DL_LINES_PER_READ, pipe->lines_total - done);
+		ret = sigma_read_dram((pipe->first_line + done) % DRAM_LINES,
+				      count, (uint8_t *)buf->lines, pipe->devc);
+
+		g_mutex_lock(&pipe->mutex);
+		buf->count = count;
+		buf->ret = ret;
+		buf->full = TRUE;
+		g_cond_broadcast(&pipe->cond);
+		g_mutex_unlock(&pipe->mutex);
+		/* After a short read, the next one would be out of step. */
+		if (ret < 0 || (size_t)ret < count * CHUNK_SIZE)
+			break;
+	}
+
+	return NULL;
+}
+
 static int download_capture(struct sr_dev_inst *sdi)
 {
-	const uint32_t chunks_per_read = 32;
+	const uint64_t poll_timeout = 1000 * 1000;
 
 	struct dev_context *devc;
-	struct sigma_dram_line *dram_line;
-	int bufsz;
+	struct download_pipe *pipe;
+	struct download_buffer *buf;
+	GThread *thread;
+	GError *error;
 	uint32_t stoppos, triggerpos;
 	uint8_t modestatus;
-	uint32_t i;
-	uint32_t dl_lines_total, dl_lines_curr, dl_lines_done;
-	uint32_t dl_first_line, dl_line;
+	uint32_t i, n, lines;
+	uint32_t dl_lines_done;
 	uint32_t dl_events_in_line;
 	uint32_t trg_line, trg_event;
+	uint64_t start_time;
 
 	devc = sdi->priv;
 	dl_events_in_line = 64 * 7;
 	trg_line = ~0;
 	trg_event = ~0;
 
-	dram_line = g_try_malloc0(chunks_per_read * sizeof(*dram_line));
-	if (!dram_line)
+	pipe = g_try_malloc0(sizeof(*pipe));
+	if (!pipe)
 		return FALSE;
+	pipe->devc = devc;
+
+	sigma_build_deinterlace_luts();
 
 	sr_info("Downloading sample data.");
 	devc->state.state = SIGMA_DOWNLOAD;
@@ -1026,9 +1126,15 @@ static int download_capture(struct sr_dev_inst *sdi)
 	 * raise the POSTTRIGGERED flag.
 	 */
 	sigma_set_register(WRITE_MODE, WMR_FORCESTOP | WMR_SDRAMWRITEEN, devc);
-	do {
-		modestatus = sigma_get_register(READ_MODE, devc);
-	} while (!(modestatus & RMR_POSTTRIGGERED));
+	start_time = g_get_monotonic_time();
+	while (!((modestatus = sigma_get_register(READ_MODE, devc)) &
+		 RMR_POSTTRIGGERED)) {
+		if (g_get_monotonic_time() - start_time > poll_timeout) {
+			sr_err("Timeout waiting for the acquisition to stop.");
+			goto done;
+		}
+		g_usleep(1000);
+	}
 
 	/* Set SDRAM Read Enable. */
 	sigma_set_register(WRITE_MODE, WMR_SDRAMREADEN, devc);
@@ -1056,49 +1162,95 @@ static int download_capture(struct sr_dev_inst *sdi)
 	 * that case, we skip it and start reading from the next line. The
 	 * circular buffer has 32K lines (0x8000).
 	 */
-	dl_lines_total = (stoppos >> 9) + 1;
+	pipe->lines_total = (stoppos >> 9) + 1;
 	if (modestatus & RMR_ROUND) {
-		dl_first_line = dl_lines_total + 1;
-		dl_lines_total = 0x8000 - 2;
+		pipe->first_line = pipe->lines_total + 1;
+		pipe->lines_total = DRAM_LINES - 2;
 	} else {
-		dl_first_line = 0;
+		pipe->first_line = 0;
 	}
+
+	g_mutex_init(&pipe->mutex);
+	g_cond_init(&pipe->cond);
+	error = NULL;
+	thread = g_thread_try_new("asix-sigma download", download_thread,
+				  pipe, &error);
+	if (!thread) {
+		sr_err("Cannot start download thread: %s.", error->message);
+		g_error_free(error);
+		goto done_pipe;
+	}
+
+	start_time = g_get_monotonic_time();
 	dl_lines_done = 0;
-	while (dl_lines_total > dl_lines_done) {
-		/* We can download only up-to 32 DRAM lines in one go! */
-		dl_lines_curr = MIN(chunks_per_read, dl_lines_total - dl_lines_done);
+	for (n = 0; pipe->lines_total > dl_lines_done; n++) {
+		buf = &pipe->buf[n % DL_NUM_BUFFERS];
+
+		/* Wait for the download thread to fill the next buffer. */
+		g_mutex_lock(&pipe->mutex);
+		while (!buf->full)
+			g_cond_wait(&pipe->cond, &pipe->mutex);
+		g_mutex_unlock(&pipe->mutex);
+
+		if (buf->ret < 0) {
+			sr_err("Failed to download DRAM lines.");
+			break;
+		}
 
-		dl_line = dl_first_line + dl_lines_done;
-		dl_line %= 0x8000;
-		bufsz = sigma_read_dram(dl_line, dl_lines_curr,
-					(uint8_t *)dram_line, devc);
-		/* TODO: Check bufsz. For now, just avoid compiler warnings. */
-		(void)bufsz;
+		/* Only decode the lines which were read completely. */
+		lines = MIN(buf->count, (size_t)buf->ret / CHUNK_SIZE);
+		if (lines < buf->count)
+			sr_err("Short DRAM read, %d of %zu bytes, stopping.",
+			       buf->ret, (size_t)buf->count * CHUNK_SIZE);
 
 		/* This is the first DRAM line, so find the initial timestamp. */
-		if (dl_lines_done == 0) {
+		if (dl_lines_done == 0 && lines) {
 			devc->state.lastts =
-				sigma_dram_cluster_ts(&dram_line[0].cluster[0]);
+				sigma_dram_cluster_ts(&buf->lines[0].cluster[0]);
 			devc->state.lastsample = 0;
 		}
 
-		for (i = 0; i < dl_lines_curr; i++) {
+		for (i = 0; i < lines; i++) {
 			uint32_t trigger_event = ~0;
 			/* The last "DRAM line" can be only partially full. */
-			if (dl_lines_done + i == dl_lines_total - 1)
+			if (dl_lines_done + i == pipe->lines_total - 1)
 				dl_events_in_line = stoppos & 0x1ff;
 
 			/* Test if the trigger happened on this line. */
 			if (dl_lines_done + i == trg_line)
 				trigger_event = trg_event;
 
-			decode_chunk_ts(dram_line + i, dl_events_in_line,
+			decode_chunk_ts(&buf->lines[i], dl_events_in_line,
 					trigger_event, sdi);
 		}
+		dl_lines_done += lines;
+		if (lines < buf->count)
+			break;
+
+		/* Hand the buffer back to the download thread. */
+		g_mutex_lock(&pipe->mutex);
+		buf->full = FALSE;
+		g_cond_broadcast(&pipe->cond);
+		g_mutex_unlock(&pipe->mutex);
 
-		dl_lines_done += dl_lines_curr;
+		sr_dbg("Downloaded %u of %u DRAM lines.", dl_lines_done,
+		       pipe->lines_total);
 	}
-	g_free(dram_line);
+
+	g_mutex_lock(&pipe->mutex);
+	pipe->abort = TRUE;
+	g_cond_broadcast(&pipe->cond);
+	g_mutex_unlock(&pipe->mutex);
+	g_thread_join(thread);
+
+	sr_info("Downloaded %u DRAM lines in %" PRIu64 " ms.", dl_lines_done,
+		(g_get_monotonic_time() - start_time) / 1000);
+
+done_pipe:
+	g_cond_clear(&pipe->cond);
+	g_mutex_clear(&pipe->mutex);
+done:
+	g_free(pipe);
 
 	std_session_send_df_end(sdi);
 
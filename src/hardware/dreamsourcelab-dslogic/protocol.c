@@ -678,6 +678,7 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	sr_usb_ring_report(sdi, &devc->ring);
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
@@ -714,9 +715,14 @@ static void free_transfer(struct libusb_transfer *transfer)
 
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	if ((ret = sr_usb_ring_resubmit(&devc->ring, transfer)) == LIBUSB_SUCCESS)
 		return;
 
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
@@ -724,27 +730,15 @@ static void resubmit_transfer(struct libusb_transfer *transfer)
 
 }
 
-static void deinterleave_buffer(const uint8_t *src, size_t length,
-	uint16_t *dst_ptr, size_t channel_count, uint16_t channel_mask)
+static void deinterleave_buffer(const struct sr_transpose *t,
+	const uint8_t *src, size_t length, uint16_t *dst_ptr)
 {
-	uint16_t sample;
-
-	for (const uint64_t *src_ptr = (uint64_t*)src;
-		src_ptr < (uint64_t*)(src + length);
-		src_ptr += channel_count) {
-		for (int bit = 0; bit != 64; bit++) {
-			const uint64_t *word_ptr = src_ptr;
-			sample = 0;
-			for (unsigned int channel = 0; channel != 16;
-				channel++) {
-				const uint16_t m = channel_mask >> channel;
-				if (!m)
-					break;
-				if ((m & 1) && ((*word_ptr++ >> bit) & UINT64_C(1)))
-					sample |= 1 << channel;
-			}
-			*dst_ptr++ = sample;
-		}
+	const size_t block_size = t->num_channels * sizeof(uint64_t);
+	size_t i;
+
+	for (i = 0; i + block_size <= length; i += block_size) {
+		sr_transpose_64(t, (const uint64_t *)(src + i), dst_ptr);
+		dst_ptr += 64;
 	}
 }
 
@@ -770,7 +764,6 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	struct sr_dev_inst *const sdi = transfer->user_data;
 	struct dev_context *const devc = sdi->priv;
 	const size_t channel_count = enabled_channel_count(sdi);
-	const uint16_t channel_mask = enabled_channel_mask(sdi);
 	const unsigned int cur_sample_count = DSLOGIC_ATOMIC_SAMPLES *
 		transfer->actual_length /
 		(DSLOGIC_ATOMIC_BYTES * channel_count);
@@ -789,6 +782,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		return;
 	}
 
+	sr_usb_ring_completed(&devc->ring, transfer);
+
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
@@ -843,8 +838,8 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		 */
 		if (transfer->actual_length % (DSLOGIC_ATOMIC_BYTES * channel_count) != 0)
 			sr_err("Invalid transfer length!");
-		deinterleave_buffer(transfer->buffer, transfer->actual_length,
-			devc->deinterleave_buffer, channel_count, channel_mask);
+		deinterleave_buffer(&devc->transpose, transfer->buffer,
+			transfer->actual_length, devc->deinterleave_buffer);
 
 		/* Send the incoming transfer to the session bus. */
 		if (devc->trigger_pos > devc->sent_samples
@@ -893,67 +888,39 @@ static int receive_data(int fd, int revents, void *cb_data)
 	return TRUE;
 }
 
-static size_t to_bytes_per_ms(const struct sr_dev_inst *sdi)
+static uint64_t bytes_per_sec(const struct sr_dev_inst *sdi)
 {
 	const struct dev_context *const devc = sdi->priv;
 	const size_t ch_count = enabled_channel_count(sdi);
 
 	if (devc->continuous_mode)
-		return (devc->cur_samplerate * ch_count) / (1000 * 8);
-
+		return (devc->cur_samplerate * ch_count) / 8;
 
 	/* If we're in buffered mode, the transfer rate is not so important,
 	 * but we expect to get at least 10% of the high-speed USB bandwidth.
 	 */
-	return 35000000 / (1000 * 10);
-}
-
-static size_t get_buffer_size(const struct sr_dev_inst *sdi)
-{
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of the size of a data atom.
-	 */
-	const size_t block_size = enabled_channel_count(sdi) * 512;
-	const size_t s = 10 * to_bytes_per_ms(sdi);
-	if (!block_size)
-		return s;
-	return ((s + block_size - 1) / block_size) * block_size;
-}
-
-static unsigned int get_number_of_transfers(const struct sr_dev_inst *sdi)
-{
-	/* Total buffer size should be able to hold about 100ms of data. */
-	const unsigned int s = get_buffer_size(sdi);
-	const unsigned int n = (100 * to_bytes_per_ms(sdi) + s - 1) / s;
-	return (n > NUM_SIMUL_TRANSFERS) ? NUM_SIMUL_TRANSFERS : n;
-}
-
-static unsigned int get_timeout(const struct sr_dev_inst *sdi)
-{
-	const size_t total_size = get_buffer_size(sdi) *
-		get_number_of_transfers(sdi);
-	const unsigned int timeout = total_size / to_bytes_per_ms(sdi);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
+	return 35000000 / 10;
 }
 
 static int start_transfers(const struct sr_dev_inst *sdi)
 {
 	const size_t channel_count = enabled_channel_count(sdi);
-	const size_t size = get_buffer_size(sdi);
-	const unsigned int num_transfers = get_number_of_transfers(sdi);
-	const unsigned int timeout = get_timeout(sdi);
 
 	struct dev_context *devc;
 	struct sr_usb_dev_inst *usb;
 	struct libusb_transfer *transfer;
-	unsigned int i;
+	unsigned int i, num_transfers, timeout;
 	int ret;
 	unsigned char *buf;
+	size_t size;
 
 	devc = sdi->priv;
 	usb = sdi->conn;
 
+	size = devc->ring.size;
+	num_transfers = devc->ring.count;
+	timeout = devc->ring.timeout;
+
 	devc->sent_samples = 0;
 	devc->acq_aborted = FALSE;
 	devc->empty_transfer_count = 0;
@@ -973,6 +940,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		g_free(devc->deinterleave_buffer);
 		return SR_ERR_MALLOC;
 	}
+	sr_transpose_init(&devc->transpose, enabled_channel_mask(sdi), FALSE);
 
 	devc->num_transfers = num_transfers;
 	for (i = 0; i < num_transfers; i++) {
@@ -1031,8 +999,6 @@ static void LIBUSB_CALL trigger_receive(struct libusb_transfer *transfer)
 
 SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 {
-	const unsigned int timeout = get_timeout(sdi);
-
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
@@ -1051,7 +1017,17 @@ SR_PRIV int dslogic_acquisition_start(const struct sr_dev_inst *sdi)
 	devc->empty_transfer_count = 0;
 	devc->acq_aborted = FALSE;
 
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	/*
+	 * Each transfer should hold about 10ms of data and be a multiple
+	 * of the size of a data atom, the whole ring should hold about
+	 * 100ms of data.
+	 */
+	sr_usb_ring_setup(&devc->ring, bytes_per_sec(sdi),
+		enabled_channel_count(sdi) * USB_PACKET_SIZE, 100,
+		NUM_SIMUL_TRANSFERS);
+
+	usb_source_add(sdi->session, devc->ctx, devc->ring.timeout,
+		receive_data, drvc);
 
 	if ((ret = command_stop_acquisition(sdi)) != SR_OK)
 		return ret;
@@ -36,6 +36,7 @@
 
 #define MAX_RENUM_DELAY_MS	3000
 #define NUM_SIMUL_TRANSFERS	32
+#define USB_PACKET_SIZE		512
 #define MAX_EMPTY_TRANSFERS	(NUM_SIMUL_TRANSFERS * 2)
 
 #define NUM_CHANNELS		16
@@ -130,9 +131,11 @@ struct dev_context {
 
 	unsigned int num_transfers;
 	struct libusb_transfer **transfers;
+	struct sr_usb_ring ring;
 	struct sr_context *ctx;
 
 	uint16_t *deinterleave_buffer;
+	struct sr_transpose transpose;
 
 	uint16_t mode;
 	uint32_t trigger_pos;
@@ -130,6 +130,9 @@ static const uint32_t devopts[] = {
 	SR_CONF_SAMPLERATE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_TRIGGER_MATCH | SR_CONF_LIST,
 	SR_CONF_CAPTURE_RATIO | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_TRANSFER_SIZE | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_NUM_TRANSFERS | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_USB_EVENT_THREAD | SR_CONF_GET | SR_CONF_SET,
 };
 
 static const int32_t trigger_matches[] = {
@@ -499,6 +502,15 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_CAPTURE_RATIO:
 		*data = g_variant_new_uint64(devc->capture_ratio);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		*data = g_variant_new_uint64(devc->ring.transfer_size);
+		break;
+	case SR_CONF_USB_NUM_TRANSFERS:
+		*data = g_variant_new_uint64(devc->ring.num_transfers);
+		break;
+	case SR_CONF_USB_EVENT_THREAD:
+		*data = g_variant_new_boolean(devc->event_thread);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -531,6 +543,22 @@ static int config_set(uint32_t key, GVariant *data,
 	case SR_CONF_CAPTURE_RATIO:
 		devc->capture_ratio = g_variant_get_uint64(data);
 		break;
+	case SR_CONF_USB_TRANSFER_SIZE:
+		/* 0 selects the automatic size. */
+		if ((g_variant_get_uint64(data) != 0 &&
+		     g_variant_get_uint64(data) < USB_PACKET_SIZE) ||
+		    g_variant_get_uint64(data) > SR_USB_RING_MAX_TRANSFER_SIZE)
+			return SR_ERR_ARG;
+		devc->ring.transfer_size = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_USB_NUM_TRANSFERS:
+		if (g_variant_get_uint64(data) > NUM_SIMUL_TRANSFERS)
+			return SR_ERR_ARG;
+		devc->ring.num_transfers = g_variant_get_uint64(data);
+		break;
+	case SR_CONF_USB_EVENT_THREAD:
+		devc->event_thread = g_variant_get_boolean(data);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -270,6 +270,7 @@ SR_PRIV void fx2lafw_abort_acquisition(struct dev_context *devc)
 	int i;
 
 	devc->acq_aborted = TRUE;
+	g_atomic_int_set(&devc->ring.stopping, TRUE);
 
 	for (i = devc->num_transfers - 1; i >= 0; i--) {
 		if (devc->transfers[i])
@@ -283,18 +284,14 @@ static void finish_acquisition(struct sr_dev_inst *sdi)
 
 	devc = sdi->priv;
 
+	sr_usb_ring_report(sdi, &devc->ring);
 	std_session_send_df_end(sdi);
 
 	usb_source_remove(sdi->session, devc->ctx);
 
 	devc->num_transfers = 0;
 	g_free(devc->transfers);
-
-	/* Free the deinterlace buffers if we had them. */
-	if (g_slist_length(devc->enabled_analog_channels) > 0) {
-		g_free(devc->logic_buffer);
-		g_free(devc->analog_buffer);
-	}
+	sr_usb_ring_thread_cleanup(&devc->ring);
 
 	if (devc->stl) {
 		soft_trigger_logic_free(devc->stl);
@@ -329,9 +326,14 @@ static void free_transfer(struct libusb_transfer *transfer)
 
 static void resubmit_transfer(struct libusb_transfer *transfer)
 {
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 	int ret;
 
-	if ((ret = libusb_submit_transfer(transfer)) == LIBUSB_SUCCESS)
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	if ((ret = sr_usb_ring_resubmit(&devc->ring, transfer)) == LIBUSB_SUCCESS)
 		return;
 
 	sr_err("%s: %s", __func__, libusb_error_name(ret));
@@ -348,6 +350,9 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
+	struct sr_buffer *logic_buffer, *analog_buffer;
+	uint8_t *logic_data;
+	float *analog_data;
 
 	(void)sample_width;
 
@@ -355,17 +360,37 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 
 	length /= 2;
 
+	/*
+	 * Deinterlace into buffers from the session's pool, which the
+	 * packets take over. Consumers can then retain the packets
+	 * without copying them.
+	 */
+	logic_buffer = sr_pool_buffer_new(sdi->session->pool, length);
+	analog_buffer = sr_pool_buffer_new(sdi->session->pool,
+		sizeof(float) * length);
+	if (!logic_buffer || !analog_buffer) {
+		sr_err("Deinterlace buffer malloc failed.");
+		if (logic_buffer)
+			sr_buffer_unref(logic_buffer);
+		if (analog_buffer)
+			sr_buffer_unref(analog_buffer);
+		fx2lafw_abort_acquisition(devc);
+		return;
+	}
+	logic_data = logic_buffer->data;
+	analog_data = analog_buffer->data;
+
 	/* Send the logic */
 	for (i = 0; i < length; i++) {
-		devc->logic_buffer[i] = data[i * 2];
+		logic_data[i] = data[i * 2];
 		/* Rescale to -10V - +10V from 0-255. */
-		devc->analog_buffer[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
+		analog_data[i] = (data[i * 2 + 1] - 128.0f) / 12.8f;
 	};
 
 	const struct sr_datafeed_logic logic = {
 		.length = length,
 		.unitsize = 1,
-		.data = devc->logic_buffer
+		.data = logic_data
 	};
 
 	const struct sr_datafeed_packet logic_packet = {
@@ -373,7 +398,7 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 		.payload = &logic
 	};
 
-	sr_session_send(sdi, &logic_packet);
+	sr_session_send_buffer(sdi, &logic_packet, logic_buffer);
 
 	sr_analog_init(&analog, &encoding, &meaning, &spec, 2);
 	analog.meaning->channels = devc->enabled_analog_channels;
@@ -381,14 +406,14 @@ static void mso_send_data_proc(struct sr_dev_inst *sdi,
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0 /* SR_MQFLAG_DC */;
 	analog.num_samples = length;
-	analog.data = devc->analog_buffer;
+	analog.data = analog_data;
 
 	const struct sr_datafeed_packet analog_packet = {
 		.type = SR_DF_ANALOG,
 		.payload = &analog
 	};
 
-	sr_session_send(sdi, &analog_packet);
+	sr_session_send_buffer(sdi, &analog_packet, analog_buffer);
 }
 
 static void la_send_data_proc(struct sr_dev_inst *sdi,
@@ -408,15 +433,68 @@ static void la_send_data_proc(struct sr_dev_inst *sdi,
 	sr_session_send(sdi, &packet);
 }
 
-static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+/*
+ * Send the samples of a completed transfer to the session bus. The soft
+ * trigger may swap the buffer, which must be @a size bytes large.
+ *
+ * Returns TRUE if the acquisition is done.
+ */
+static gboolean process_samples(struct sr_dev_inst *sdi, uint8_t **buffer,
+	int size, int actual_length)
 {
-	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
-	gboolean packet_has_error = FALSE;
 	unsigned int num_samples;
 	int trigger_offset, cur_sample_count, unitsize;
 	int pre_trigger_samples;
 
+	devc = sdi->priv;
+
+	unitsize = devc->sample_wide ? 2 : 1;
+	cur_sample_count = actual_length / unitsize;
+
+	if (devc->trigger_fired) {
+		if (!devc->limit_samples || devc->sent_samples < devc->limit_samples) {
+			/* Send the incoming transfer to the session bus. */
+			if (devc->limit_samples && devc->sent_samples + cur_sample_count > devc->limit_samples)
+				num_samples = devc->limit_samples - devc->sent_samples;
+			else
+				num_samples = cur_sample_count;
+
+			devc->send_data_proc(sdi, *buffer,
+				num_samples * unitsize, unitsize);
+			devc->sent_samples += num_samples;
+		}
+	} else {
+		/* Retains the buffer and swaps in another if not triggered. */
+		trigger_offset = soft_trigger_logic_check_swap(devc->stl,
+			buffer, size, actual_length, &pre_trigger_samples);
+		if (trigger_offset < -1) {
+			return TRUE;
+		} else if (trigger_offset > -1) {
+			devc->sent_samples += pre_trigger_samples;
+			num_samples = cur_sample_count - trigger_offset;
+			if (devc->limit_samples &&
+					num_samples > devc->limit_samples - devc->sent_samples)
+				num_samples = devc->limit_samples - devc->sent_samples;
+
+			devc->send_data_proc(sdi, *buffer
+					+ trigger_offset * unitsize,
+					num_samples * unitsize, unitsize);
+			devc->sent_samples += num_samples;
+
+			devc->trigger_fired = TRUE;
+		}
+	}
+
+	return devc->limit_samples && devc->sent_samples >= devc->limit_samples;
+}
+
+static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	gboolean packet_has_error = FALSE;
+
 	sdi = transfer->user_data;
 	devc = sdi->priv;
 
@@ -429,13 +507,11 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 		return;
 	}
 
+	sr_usb_ring_completed(&devc->ring, transfer);
+
 	sr_dbg("receive_transfer(): status %s received %d bytes.",
 		libusb_error_name(transfer->status), transfer->actual_length);
 
-	/* Save incoming transfer before reusing the transfer struct. */
-	unitsize = devc->sample_wide ? 2 : 1;
-	cur_sample_count = transfer->actual_length / unitsize;
-
 	switch (transfer->status) {
 	case LIBUSB_TRANSFER_NO_DEVICE:
 		fx2lafw_abort_acquisition(devc);
@@ -465,42 +541,62 @@ static void LIBUSB_CALL receive_transfer(struct libusb_transfer *transfer)
 	} else {
 		devc->empty_transfer_count = 0;
 	}
-	if (devc->trigger_fired) {
-		if (!devc->limit_samples || devc->sent_samples < devc->limit_samples) {
-			/* Send the incoming transfer to the session bus. */
-			if (devc->limit_samples && devc->sent_samples + cur_sample_count > devc->limit_samples)
-				num_samples = devc->limit_samples - devc->sent_samples;
-			else
-				num_samples = cur_sample_count;
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer,
-				num_samples * unitsize, unitsize);
-			devc->sent_samples += num_samples;
-		}
-	} else {
-		trigger_offset = soft_trigger_logic_check(devc->stl,
-			transfer->buffer, transfer->actual_length, &pre_trigger_samples);
-		if (trigger_offset > -1) {
-			devc->sent_samples += pre_trigger_samples;
-			num_samples = cur_sample_count - trigger_offset;
-			if (devc->limit_samples &&
-					num_samples > devc->limit_samples - devc->sent_samples)
-				num_samples = devc->limit_samples - devc->sent_samples;
+	if (process_samples(sdi, &transfer->buffer, transfer->length,
+			transfer->actual_length)) {
+		fx2lafw_abort_acquisition(devc);
+		free_transfer(transfer);
+	} else
+		resubmit_transfer(transfer);
+}
 
-			devc->send_data_proc(sdi, (uint8_t *)transfer->buffer
-					+ trigger_offset * unitsize,
-					num_samples * unitsize, unitsize);
-			devc->sent_samples += num_samples;
+/*
+ * Transfer callback in event thread mode. This runs on the USB event
+ * thread, which must not touch the session.
+ */
+static void LIBUSB_CALL hand_off_transfer(struct libusb_transfer *transfer)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
 
-			devc->trigger_fired = TRUE;
+	sdi = transfer->user_data;
+	devc = sdi->priv;
+
+	sr_usb_ring_hand_off(&devc->ring, transfer);
+}
+
+/* Process the transfers handed over by the USB event thread. */
+static int receive_chunks(int fd, int revents, void *cb_data)
+{
+	struct sr_dev_inst *sdi;
+	struct dev_context *devc;
+	struct sr_usb_chunk *chunk;
+	struct libusb_transfer *transfer;
+
+	(void)fd;
+	(void)revents;
+
+	sdi = cb_data;
+	devc = sdi->priv;
+
+	while ((chunk = sr_usb_ring_next(&devc->ring))) {
+		transfer = chunk->transfer;
+		if (!transfer) {
+			devc->empty_transfer_count = 0;
+			if (!devc->acq_aborted && process_samples(sdi,
+					&chunk->data, devc->ring.size, chunk->length))
+				fx2lafw_abort_acquisition(devc);
+			sr_usb_ring_release(&devc->ring, chunk);
+			continue;
 		}
+		sr_usb_ring_release(&devc->ring, chunk);
+		receive_transfer(transfer);
+		/* The last transfer ended the acquisition and freed the ring. */
+		if (devc->submitted_transfers == 0)
+			break;
 	}
 
-	if (devc->limit_samples && devc->sent_samples >= devc->limit_samples) {
-		fx2lafw_abort_acquisition(devc);
-		free_transfer(transfer);
-	} else
-		resubmit_transfer(transfer);
+	return TRUE;
 }
 
 static int configure_channels(const struct sr_dev_inst *sdi)
@@ -537,48 +633,6 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static unsigned int to_bytes_per_ms(unsigned int samplerate)
-{
-	return samplerate / 1000;
-}
-
-static size_t get_buffer_size(struct dev_context *devc)
-{
-	size_t s;
-
-	/*
-	 * The buffer should be large enough to hold 10ms of data and
-	 * a multiple of 512.
-	 */
-	s = 10 * to_bytes_per_ms(devc->cur_samplerate);
-	return (s + 511) & ~511;
-}
-
-static unsigned int get_number_of_transfers(struct dev_context *devc)
-{
-	unsigned int n;
-
-	/* Total buffer size should be able to hold about 500ms of data. */
-	n = (500 * to_bytes_per_ms(devc->cur_samplerate) /
-		get_buffer_size(devc));
-
-	if (n > NUM_SIMUL_TRANSFERS)
-		return NUM_SIMUL_TRANSFERS;
-
-	return n;
-}
-
-static unsigned int get_timeout(struct dev_context *devc)
-{
-	size_t total_size;
-	unsigned int timeout;
-
-	total_size = get_buffer_size(devc) *
-			get_number_of_transfers(devc);
-	timeout = total_size / to_bytes_per_ms(devc->cur_samplerate);
-	return timeout + timeout / 4; /* Leave a headroom of 25% percent. */
-}
-
 static int receive_data(int fd, int revents, void *cb_data)
 {
 	struct timeval tv;
@@ -617,16 +671,16 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		int pre_trigger_samples = 0;
 		if (devc->limit_samples > 0)
 			pre_trigger_samples = (devc->capture_ratio * devc->limit_samples) / 100;
-		devc->stl = soft_trigger_logic_new(sdi, trigger, pre_trigger_samples);
+		devc->stl = soft_trigger_logic_new_swap(sdi, trigger,
+				pre_trigger_samples);
 		if (!devc->stl)
 			return SR_ERR_MALLOC;
 		devc->trigger_fired = FALSE;
 	} else
 		devc->trigger_fired = TRUE;
 
-	num_transfers = get_number_of_transfers(devc);
-
-	size = get_buffer_size(devc);
+	num_transfers = devc->ring.count;
+	size = devc->ring.size;
 	devc->submitted_transfers = 0;
 
 	devc->transfers = g_try_malloc0(sizeof(*devc->transfers) * num_transfers);
@@ -635,7 +689,7 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		return SR_ERR_MALLOC;
 	}
 
-	timeout = get_timeout(devc);
+	timeout = devc->ring.timeout;
 	devc->num_transfers = num_transfers;
 	for (i = 0; i < num_transfers; i++) {
 		if (!(buf = g_try_malloc(size))) {
@@ -645,7 +699,9 @@ static int start_transfers(const struct sr_dev_inst *sdi)
 		transfer = libusb_alloc_transfer(0);
 		libusb_fill_bulk_transfer(transfer, usb->devhdl,
 				2 | LIBUSB_ENDPOINT_IN, buf, size,
-				receive_transfer, (void *)sdi, timeout);
+				devc->event_thread ? hand_off_transfer
+					: receive_transfer,
+				(void *)sdi, timeout);
 		sr_info("submitting transfer: %d", i);
 		if ((ret = libusb_submit_transfer(transfer)) != 0) {
 			sr_err("Failed to submit transfer: %s.",
@@ -679,8 +735,7 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 	struct sr_dev_driver *di;
 	struct drv_context *drvc;
 	struct dev_context *devc;
-	int timeout, ret;
-	size_t size;
+	int ret;
 
 	di = sdi->driver;
 	drvc = di->context;
@@ -696,17 +751,33 @@ SR_PRIV int fx2lafw_start_acquisition(const struct sr_dev_inst *sdi)
 		return SR_ERR;
 	}
 
-	timeout = get_timeout(devc);
-	usb_source_add(sdi->session, devc->ctx, timeout, receive_data, drvc);
+	/*
+	 * Each transfer should hold about 10ms of data and be a multiple
+	 * of 512 bytes, the whole ring should hold about 500ms of data.
+	 */
+	sr_usb_ring_setup(&devc->ring,
+		devc->cur_samplerate * (devc->sample_wide ? 2 : 1),
+		USB_PACKET_SIZE, 500, NUM_SIMUL_TRANSFERS);
 
-	size = get_buffer_size(devc);
-	/* Prepare for analog sampling. */
-	if (g_slist_length(devc->enabled_analog_channels) > 0) {
-		/* We need a buffer half the size of a transfer. */
-		devc->logic_buffer = g_try_malloc(size / 2);
-		devc->analog_buffer = g_try_malloc(
-			sizeof(float) * size / 2);
+	if (devc->event_thread) {
+		/*
+		 * Run the transfer callbacks on a thread of their own, so
+		 * that slow datafeed consumers don't delay resubmission.
+		 */
+		if ((ret = sr_usb_ring_thread_init(&devc->ring)) != SR_OK)
+			return ret;
+		ret = usb_thread_source_add(sdi->session, devc->ctx,
+			devc->ring.timeout, devc->ring.filled,
+			receive_chunks, (void *)sdi);
+		if (ret != SR_OK) {
+			sr_usb_ring_thread_cleanup(&devc->ring);
+			return ret;
+		}
+	} else {
+		usb_source_add(sdi->session, devc->ctx, devc->ring.timeout,
+			receive_data, drvc);
 	}
+
 	start_transfers(sdi);
 	if ((ret = command_start_acquisition(sdi)) != SR_OK) {
 		fx2lafw_abort_acquisition(devc);
@@ -216,6 +216,9 @@ static int config_get(uint32_t key, GVariant **data,
 	case SR_CONF_SAMPLERATE:
 		*data = g_variant_new_uint64(state->sample_rate);
 		break;
+	case SR_CONF_SCPI_PIPELINE_DEPTH:
+		*data = g_variant_new_uint64(devc->pipeline_depth);
+		break;
 	default:
 		return SR_ERR_NA;
 	}
@@ -251,6 +254,12 @@ static int config_set(uint32_t key, GVariant *data,
 		devc->frame_limit = g_variant_get_uint64(data);
 		ret = SR_OK;
 		break;
+	case SR_CONF_SCPI_PIPELINE_DEPTH:
+		if (!g_variant_get_uint64(data))
+			return SR_ERR_ARG;
+		devc->pipeline_depth = g_variant_get_uint64(data);
+		ret = SR_OK;
+		break;
 	case SR_CONF_TRIGGER_SOURCE:
 		if ((idx = std_str_idx(data, *model->trigger_sources, model->num_trigger_sources)) < 0)
 			return SR_ERR_ARG;
@@ -411,40 +420,52 @@ static int config_list(uint32_t key, GVariant **data,
 	return SR_OK;
 }
 
+/*
+ * Queue the data queries for all enabled channels of a frame. Each of
+ * them names its channel, so that they don't depend on one another and
+ * can be sent ahead of reading the previous channel's data.
+ */
 SR_PRIV int hmo_request_data(const struct sr_dev_inst *sdi)
 {
 	char command[MAX_COMMAND_SIZE];
 	struct sr_channel *ch;
 	struct dev_context *devc;
 	const struct scope_config *model;
+	GSList *l;
+	int ret;
 
 	devc = sdi->priv;
 	model = devc->model_config;
 
-	ch = devc->current_channel->data;
-
-	switch (ch->type) {
-	case SR_CHANNEL_ANALOG:
-		g_snprintf(command, sizeof(command),
-			   (*model->scpi_dialect)[SCPI_CMD_GET_ANALOG_DATA],
+	for (l = devc->enabled_channels; l; l = l->next) {
+		ch = l->data;
+		switch (ch->type) {
+		case SR_CHANNEL_ANALOG:
+			g_snprintf(command, sizeof(command),
+				   (*model->scpi_dialect)[SCPI_CMD_GET_ANALOG_DATA],
 #ifdef WORDS_BIGENDIAN
-			   "MSBF",
+				   "MSBF",
 #else
-			   "LSBF",
+				   "LSBF",
 #endif
-			   ch->index + 1);
-		break;
-	case SR_CHANNEL_LOGIC:
-		g_snprintf(command, sizeof(command),
-			   (*model->scpi_dialect)[SCPI_CMD_GET_DIG_DATA],
-			   ch->index < 8 ? 1 : 2);
-		break;
-	default:
-		sr_err("Invalid channel type.");
-		break;
+				   ch->index + 1);
+			break;
+		case SR_CHANNEL_LOGIC:
+			g_snprintf(command, sizeof(command),
+				   (*model->scpi_dialect)[SCPI_CMD_GET_DIG_DATA],
+				   ch->index < 8 ? 1 : 2);
+			break;
+		default:
+			sr_err("Invalid channel type.");
+			return SR_ERR;
+		}
+		ret = sr_scpi_pipeline_query(sdi->conn, &devc->pipeline,
+			command);
+		if (ret != SR_OK)
+			return ret;
 	}
 
-	return sr_scpi_send(sdi->conn, command);
+	return SR_OK;
 }
 
 static int hmo_check_channels(GSList *channels)
@@ -663,6 +684,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	std_session_send_df_header(sdi);
 
 	devc->current_channel = devc->enabled_channels;
+	sr_scpi_pipeline_init(&devc->pipeline, devc->pipeline_depth);
+	sr_scpi_frame_stats_start(&devc->frame_stats);
 
 	return hmo_request_data(sdi);
 
@@ -686,6 +709,9 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_block_free(&devc->block);
+	sr_scpi_pipeline_clear(&devc->pipeline);
+	sr_scpi_frame_stats_report(&devc->frame_stats, sdi->model);
 
 	return SR_OK;
 }
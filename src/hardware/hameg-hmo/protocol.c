@@ -24,7 +24,8 @@
 #include "protocol.h"
 
 SR_PRIV void hmo_queue_logic_data(struct dev_context *devc,
-				  size_t group, GByteArray *pod_data);
+				  size_t group, const uint8_t *pod_data,
+				  size_t pod_len);
 SR_PRIV void hmo_send_logic_packet(struct sr_dev_inst *sdi,
 				   struct dev_context *devc);
 SR_PRIV void hmo_cleanup_logic_data(struct dev_context *devc);
@@ -60,6 +61,7 @@ static const char *hameg_scpi_dialect[] = {
 static const uint32_t devopts[] = {
 	SR_CONF_OSCILLOSCOPE,
 	SR_CONF_LIMIT_FRAMES | SR_CONF_GET | SR_CONF_SET,
+	SR_CONF_SCPI_PIPELINE_DEPTH | SR_CONF_GET | SR_CONF_SET,
 	SR_CONF_SAMPLERATE | SR_CONF_GET,
 	SR_CONF_TIMEBASE | SR_CONF_GET | SR_CONF_SET | SR_CONF_LIST,
 	SR_CONF_NUM_HDIV | SR_CONF_GET,
@@ -738,6 +740,7 @@ SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi)
 
 	devc->model_config = &scope_models[model_index];
 	devc->frame_limit = 0;
+	devc->pipeline_depth = 1;
 
 	if (!(devc->model_state = scope_state_new(devc->model_config)))
 		return SR_ERR_MALLOC;
@@ -747,7 +750,8 @@ SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi)
 
 /* Queue data of one channel group, for later submission. */
 SR_PRIV void hmo_queue_logic_data(struct dev_context *devc,
-				  size_t group, GByteArray *pod_data)
+				  size_t group, const uint8_t *pod_data,
+				  size_t pod_len)
 {
 	size_t size;
 	GByteArray *store;
@@ -767,7 +771,7 @@ SR_PRIV void hmo_queue_logic_data(struct dev_context *devc,
 	 * identical size. We haven't yet seen any "odd" configuration.
 	 */
 	if (!devc->logic_data) {
-		size = pod_data->len * devc->pod_count;
+		size = pod_len * devc->pod_count;
 		store = g_byte_array_sized_new(size);
 		memset(store->data, 0, size);
 		store = g_byte_array_set_size(store, size);
@@ -775,7 +779,7 @@ SR_PRIV void hmo_queue_logic_data(struct dev_context *devc,
 	} else {
 		store = devc->logic_data;
 		size = store->len / devc->pod_count;
-		if (size != pod_data->len)
+		if (size != pod_len)
 			return;
 		if (group >= devc->pod_count)
 			return;
@@ -788,8 +792,8 @@ SR_PRIV void hmo_queue_logic_data(struct dev_context *devc,
 	logic_data = store->data;
 	logic_data += group;
 	logic_step = devc->pod_count;
-	for (idx = 0; idx < pod_data->len; idx++) {
-		*logic_data = pod_data->data[idx];
+	for (idx = 0; idx < pod_len; idx++) {
+		*logic_data = pod_data[idx];
 		logic_data += logic_step;
 	}
 }
@@ -835,19 +839,18 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct scope_state *state;
 	struct sr_datafeed_packet packet;
-	GByteArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
+	struct sr_buffer *buffer;
 	size_t group;
+	int ret;
 
 	(void)fd;
 	(void)revents;
 
-	data = NULL;
-
 	if (!(sdi = cb_data))
 		return TRUE;
 
@@ -865,30 +868,50 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	state = devc->model_state;
 
 	/*
-	 * Send "frame begin" packet upon reception of data for the
-	 * first enabled channel.
+	 * The channel's data block is read piecewise, as it arrives, so
+	 * that large transfers don't stall the session. The data goes to
+	 * a buffer from the session's pool, which is passed on as is.
 	 */
-	if (devc->current_channel == devc->enabled_channels) {
-		packet.type = SR_DF_FRAME_BEGIN;
+	if (devc->block.state == SCPI_BLOCK_IDLE) {
+		if (sr_scpi_block_begin(sdi->conn, NULL, &devc->block,
+				NULL, 0, sdi->session->pool) != SR_OK)
+			return TRUE;
+
+		/*
+		 * Send "frame begin" packet upon reception of data for the
+		 * first enabled channel.
+		 */
+		if (devc->current_channel == devc->enabled_channels) {
+			packet.type = SR_DF_FRAME_BEGIN;
+			sr_session_send(sdi, &packet);
+		}
+	}
+	ret = sr_scpi_block_read(sdi->conn, &devc->block);
+	if (ret < 0) {
+		sr_err("Error while reading block data, aborting capture.");
+		sr_scpi_block_free(&devc->block);
+		hmo_cleanup_logic_data(devc);
+		packet.type = SR_DF_FRAME_END;
 		sr_session_send(sdi, &packet);
+		sr_dev_acquisition_stop(sdi);
+		return TRUE;
 	}
+	if (ret == 0)
+		return TRUE;
+	buffer = devc->block.buffer;
+
+	/* Let the device prepare the next channel's data meanwhile. */
+	sr_scpi_pipeline_done(sdi->conn, &devc->pipeline);
 
 	/*
 	 * Pass on the received data of the channel(s).
 	 */
 	switch (ch->type) {
 	case SR_CHANNEL_ANALOG:
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			if (data)
-				g_byte_array_free(data, TRUE);
-
-			return TRUE;
-		}
-
 		packet.type = SR_DF_ANALOG;
 
-		analog.data = data->data;
-		analog.num_samples = data->len / sizeof(float);
+		analog.data = devc->block.data;
+		analog.num_samples = devc->block.size / sizeof(float);
 		analog.encoding = &encoding;
 		analog.meaning = &meaning;
 		analog.spec = &spec;
@@ -920,17 +943,11 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		/* TODO: Use proper 'digits' value for this device (and its modes). */
 		spec.spec_digits = 2;
 		packet.payload = &analog;
-		sr_session_send(sdi, &packet);
+		sr_session_send_buffer(sdi, &packet,
+			buffer ? sr_buffer_ref(buffer) : NULL);
 		g_slist_free(meaning.channels);
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	case SR_CHANNEL_LOGIC:
-		if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-			g_free(data);
-			return TRUE;
-		}
-
 		/*
 		 * If only data from the first pod is involved in the
 		 * acquisition, then the raw input bytes can get passed
@@ -946,23 +963,23 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 		 */
 		if (devc->pod_count == 1) {
 			packet.type = SR_DF_LOGIC;
-			logic.data = data->data;
-			logic.length = data->len;
+			logic.data = devc->block.data;
+			logic.length = devc->block.size;
 			logic.unitsize = 1;
 			packet.payload = &logic;
-			sr_session_send(sdi, &packet);
+			sr_session_send_buffer(sdi, &packet,
+				buffer ? sr_buffer_ref(buffer) : NULL);
 		} else {
 			group = ch->index / 8;
-			hmo_queue_logic_data(devc, group, data);
+			hmo_queue_logic_data(devc, group, devc->block.data,
+				devc->block.size);
 		}
-
-		g_byte_array_free(data, TRUE);
-		data = NULL;
 		break;
 	default:
 		sr_err("Invalid channel type.");
 		break;
 	}
+	sr_scpi_block_free(&devc->block);
 
 	/*
 	 * Advance to the next enabled channel. When data for all enabled
@@ -971,7 +988,6 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 	 */
 	if (devc->current_channel->next) {
 		devc->current_channel = devc->current_channel->next;
-		hmo_request_data(sdi);
 		return TRUE;
 	}
 	hmo_send_logic_packet(sdi, devc);
@@ -986,6 +1002,7 @@ SR_PRIV int hmo_receive_data(int fd, int revents, void *cb_data)
 
 	packet.type = SR_DF_FRAME_END;
 	sr_session_send(sdi, &packet);
+	sr_scpi_frame_stats_frame(&devc->frame_stats);
 
 	/*
 	 * End of frame was reached. Stop acquisition after the specified
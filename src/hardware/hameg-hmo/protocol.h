@@ -25,6 +25,7 @@
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "scpi.h"
 
 #define LOG_PREFIX "hameg-hmo"
 
@@ -108,6 +109,14 @@ struct dev_context {
 
 	size_t pod_count;
 	GByteArray *logic_data;
+
+	/* Block read of the current channel's data. */
+	struct sr_scpi_block block;
+
+	/* Data queries of the current frame, sent ahead of time. */
+	uint64_t pipeline_depth;
+	struct sr_scpi_pipeline pipeline;
+	struct sr_scpi_frame_stats frame_stats;
 };
 
 SR_PRIV int hmo_init_device(struct sr_dev_inst *sdi);
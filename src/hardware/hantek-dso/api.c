@@ -649,6 +649,13 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	struct sr_analog_spec spec;
 	struct dev_context *devc = sdi->priv;
 	GSList *channels = devc->enabled_channels;
+	const uint64_t *vdiv;
+	uint8_t *samples;
+
+	if (!(samples = g_try_malloc(num_samples))) {
+		sr_err("Sample buffer malloc failed.");
+		return;
+	}
 
 	packet.type = SR_DF_ANALOG;
 	packet.payload = &analog;
@@ -658,42 +665,50 @@ static void send_chunk(struct sr_dev_inst *sdi, unsigned char *buf,
 	analog.meaning->mq = SR_MQ_VOLTAGE;
 	analog.meaning->unit = SR_UNIT_VOLT;
 	analog.meaning->mqflags = 0;
-	/* TODO: Check malloc return value. */
-	analog.data = g_try_malloc(num_samples * sizeof(float));
+	analog.data = samples;
+
+	/*
+	 * Voltage values are encoded as a value 0-255 (0-512 on the
+	 * DSO-5200*), where the value is a point in the range
+	 * represented by the vdiv setting. There are 8 vertical divs,
+	 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
+	 * and 255 = +2V. The raw values are passed on, with an encoding
+	 * which describes exactly that, and consumers convert to volts
+	 * on demand.
+	 */
+	encoding.unitsize = 1;
+	encoding.is_float = FALSE;
+	encoding.is_signed = FALSE;
 
 	for (int ch = 0; ch < NUM_CHANNELS; ch++) {
 		if (!devc->ch_enabled[ch])
 			continue;
 
-		float range = ((float)vdivs[devc->voltage[ch]][0] / vdivs[devc->voltage[ch]][1]) * 8;
+		vdiv = vdivs[devc->voltage[ch]];
+		float range = ((float)vdiv[0] / vdiv[1]) * 8;
 		float vdivlog = log10f(range / 255);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
 		analog.encoding->digits = digits;
 		analog.spec->spec_digits = digits;
+		sr_rational_set(&encoding.scale, vdiv[0] * 8, vdiv[1] * 255);
+		sr_rational_set(&encoding.offset, -(int64_t)vdiv[0] * 4, vdiv[1]);
 		analog.meaning->channels = g_slist_append(NULL, channels->data);
 
-		for (int i = 0; i < num_samples; i++) {
-			/*
-			 * The device always sends data for both channels. If a channel
-			 * is disabled, it contains a copy of the enabled channel's
-			 * data. However, we only send the requested channels to
-			 * the bus.
-			 *
-			 * Voltage values are encoded as a value 0-255 (0-512 on the
-			 * DSO-5200*), where the value is a point in the range
-			 * represented by the vdiv setting. There are 8 vertical divs,
-			 * so e.g. 500mV/div represents 4V peak-to-peak where 0 = -2V
-			 * and 255 = +2V.
-			 */
-			/* TODO: Support for DSO-5xxx series 9-bit samples. */
-			((float *)analog.data)[i] = range / 255 * *(buf + i * 2 + 1 - ch) - range / 2;
-		}
+		/*
+		 * The device always sends data for both channels. If a channel
+		 * is disabled, it contains a copy of the enabled channel's
+		 * data. However, we only send the requested channels to
+		 * the bus.
+		 */
+		/* TODO: Support for DSO-5xxx series 9-bit samples. */
+		for (int i = 0; i < num_samples; i++)
+			samples[i] = buf[i * 2 + 1 - ch];
 		sr_session_send(sdi, &packet);
 		g_slist_free(analog.meaning->channels);
 
 		channels = channels->next;
 	}
-	g_free(analog.data);
+	g_free(samples);
 }
 
 /*
@@ -483,6 +483,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_block_free(&devc->block);
 
 	return SR_OK;
 }
@@ -542,7 +542,7 @@ SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi)
 	return SR_OK;
 }
 
-static int lecroy_waveform_2_x_to_analog(GByteArray *data,
+static int lecroy_waveform_2_x_to_analog(const uint8_t *data, size_t len,
 		struct lecroy_wavedesc *desc, struct sr_datafeed_analog *analog)
 {
 	struct sr_analog_encoding *encoding = analog->encoding;
@@ -552,10 +552,16 @@ static int lecroy_waveform_2_x_to_analog(GByteArray *data,
 	int16_t *waveform_data;
 	unsigned int i, num_samples;
 
-	data_float = g_malloc(desc->version_2_x.wave_array_count * sizeof(float));
 	num_samples = desc->version_2_x.wave_array_count;
+	if ((uint64_t)desc->version_2_x.wave_descriptor_length
+			+ desc->version_2_x.user_text_len
+			+ (uint64_t)num_samples * sizeof(int16_t) > len) {
+		sr_err("Waveform data exceeds the received block.");
+		return SR_ERR_DATA;
+	}
+	data_float = g_malloc(num_samples * sizeof(float));
 
-	waveform_data = (int16_t*)(data->data +
+	waveform_data = (int16_t*)(data +
 		+ desc->version_2_x.wave_descriptor_length
 		+ desc->version_2_x.user_text_len);
 
@@ -594,19 +600,19 @@ static int lecroy_waveform_2_x_to_analog(GByteArray *data,
 	return SR_OK;
 }
 
-static int lecroy_waveform_to_analog(GByteArray *data,
+static int lecroy_waveform_to_analog(const uint8_t *data, size_t len,
 		struct sr_datafeed_analog *analog)
 {
 	struct lecroy_wavedesc *desc;
 
-	if (data->len < sizeof(struct lecroy_wavedesc))
+	if (len < sizeof(struct lecroy_wavedesc))
 		return SR_ERR;
 
-	desc = (struct lecroy_wavedesc*)data->data;
+	desc = (struct lecroy_wavedesc*)data;
 
 	if (!strncmp(desc->template_name, "LECROY_2_2", 16) ||
 	    !strncmp(desc->template_name, "LECROY_2_3", 16)) {
-		return lecroy_waveform_2_x_to_analog(data, desc, analog);
+		return lecroy_waveform_2_x_to_analog(data, len, desc, analog);
 	}
 
 	sr_err("Waveformat template '%.16s' not supported.", desc->template_name);
@@ -621,18 +627,16 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	struct dev_context *devc;
 	struct scope_state *state;
 	struct sr_datafeed_packet packet;
-	GByteArray *data;
 	struct sr_datafeed_analog analog;
 	struct sr_analog_encoding encoding;
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	char buf[8];
+	int ret;
 
 	(void)fd;
 	(void)revents;
 
-	data = NULL;
-
 	if (!(sdi = cb_data))
 		return TRUE;
 
@@ -645,23 +649,34 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	if (ch->type != SR_CHANNEL_ANALOG)
 		return SR_ERR;
 
-	/* Pass on the received data of the channel(s). */
-	if (sr_scpi_read_data(sdi->conn, buf, 4) != 4) {
-		sr_err("Reading header failed, scope probably didn't send any data.");
-		return TRUE;
+	/*
+	 * Pass on the received data of the channel(s). The waveform is
+	 * read piecewise, as it arrives, so that large transfers don't
+	 * stall the session.
+	 */
+	if (devc->block.state == SCPI_BLOCK_IDLE) {
+		if (sr_scpi_read_data(sdi->conn, buf, 4) != 4) {
+			sr_err("Reading header failed, scope probably didn't send any data.");
+			return TRUE;
+		}
+		if (sr_scpi_block_begin(sdi->conn, NULL, &devc->block,
+				NULL, 0, NULL) != SR_OK)
+			return TRUE;
 	}
-
-	if (sr_scpi_get_block(sdi->conn, NULL, &data) != SR_OK) {
-		if (data)
-			g_byte_array_free(data, TRUE);
+	ret = sr_scpi_block_read(sdi->conn, &devc->block);
+	if (ret < 0)
+		sr_scpi_block_free(&devc->block);
+	if (ret <= 0)
 		return TRUE;
-	}
 
 	analog.encoding = &encoding;
 	analog.meaning = &meaning;
 	analog.spec = &spec;
 
-	if (lecroy_waveform_to_analog(data, &analog) != SR_OK)
+	ret = lecroy_waveform_to_analog(devc->block.data, devc->block.size,
+		&analog);
+	sr_scpi_block_free(&devc->block);
+	if (ret != SR_OK)
 		return SR_ERR;
 
 	if (analog.num_samples == 0) {
@@ -696,9 +711,6 @@ SR_PRIV int lecroy_xstream_receive_data(int fd, int revents, void *cb_data)
 	packet.type = SR_DF_ANALOG;
 	sr_session_send(sdi, &packet);
 
-	g_byte_array_free(data, TRUE);
-	data = NULL;
-
 	g_slist_free(meaning.channels);
 	g_free(analog.data);
 
@@ -25,6 +25,7 @@
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "scpi.h"
 
 #define LOG_PREFIX "lecroy-xstream"
 
@@ -88,6 +89,9 @@ struct dev_context {
 	uint64_t num_frames;
 
 	uint64_t frame_limit;
+
+	/* Block read of the current channel's waveform. */
+	struct sr_scpi_block block;
 };
 
 SR_PRIV int lecroy_xstream_init_device(struct sr_dev_inst *sdi);
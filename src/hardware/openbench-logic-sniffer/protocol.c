@@ -332,6 +332,89 @@ SR_PRIV void abort_acquisition(const struct sr_dev_inst *sdi)
 	std_session_send_df_end(sdi);
 }
 
+/*
+ * Handle a complete sample in devc->sample: store an RLE count, or the
+ * sample itself and the repetitions counted before it.
+ */
+static void process_sample(struct dev_context *devc, int num_ols_changrp)
+{
+	uint32_t sample;
+	unsigned int i;
+	int offset, j;
+
+	devc->cnt_samples++;
+	devc->cnt_samples_rle++;
+	/*
+	 * Got a full sample. Convert from the OLS's little-endian
+	 * sample to the local format.
+	 */
+	sample = devc->sample[0] | (devc->sample[1] << 8) \
+			| (devc->sample[2] << 16) | (devc->sample[3] << 24);
+	if (devc->flag_reg & FLAG_RLE) {
+		/*
+		 * In RLE mode the high bit of the sample is the
+		 * "count" flag, meaning this sample is the number
+		 * of times the previous sample occurred.
+		 */
+		if (devc->sample[devc->num_bytes - 1] & 0x80) {
+			/* Clear the high bit. */
+			sample &= ~(0x80 << (devc->num_bytes - 1) * 8);
+			devc->rle_count = sample;
+			devc->cnt_samples_rle += devc->rle_count;
+			devc->num_bytes = 0;
+			return;
+		}
+	}
+	devc->num_samples += devc->rle_count + 1;
+	if (devc->num_samples > devc->limit_samples) {
+		/* Save us from overrunning the buffer. */
+		devc->rle_count -= devc->num_samples - devc->limit_samples;
+		devc->num_samples = devc->limit_samples;
+	}
+
+	if (num_ols_changrp < 4) {
+		/*
+		 * Some channel groups may have been turned
+		 * off, to speed up transfer between the
+		 * hardware and the PC. Expand that here before
+		 * submitting it over the session bus --
+		 * whatever is listening on the bus will be
+		 * expecting a full 32-bit sample, based on
+		 * the number of channels.
+		 */
+		j = 0;
+		memset(devc->tmp_sample, 0, 4);
+		for (i = 0; i < 4; i++) {
+			if (((devc->flag_reg >> 2) & (1 << i)) == 0) {
+				/*
+				 * This channel group was
+				 * enabled, copy from received
+				 * sample.
+				 */
+				devc->tmp_sample[i] = devc->sample[j++];
+			} else if (devc->flag_reg & FLAG_DEMUX && (i > 2)) {
+				/* group 2 & 3 get added to 0 & 1 */
+				devc->tmp_sample[i - 2] = devc->sample[j++];
+			}
+		}
+		memcpy(devc->sample, devc->tmp_sample, 4);
+	}
+
+	/*
+	 * the OLS sends its sample buffer backwards.
+	 * store it in reverse order here, so we can dump
+	 * this on the session bus later.
+	 */
+	offset = (devc->limit_samples - devc->num_samples) * 4;
+	for (i = 0; i <= devc->rle_count; i++) {
+		memcpy(devc->raw_sample_buf + offset + (i * 4),
+		       devc->sample, 4);
+	}
+	memset(devc->sample, 0, 4);
+	devc->num_bytes = 0;
+	devc->rle_count = 0;
+}
+
 SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 {
 	struct dev_context *devc;
@@ -339,10 +422,10 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	struct sr_serial_dev_inst *serial;
 	struct sr_datafeed_packet packet;
 	struct sr_datafeed_logic logic;
-	uint32_t sample;
-	int num_ols_changrp, offset, j;
+	struct sr_buffer *buffer;
+	int num_ols_changrp, len, pos;
 	unsigned int i;
-	unsigned char byte;
+	uint8_t buf[OLS_READ_SIZE];
 
 	(void)fd;
 
@@ -373,92 +456,23 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 	}
 
 	if (revents == G_IO_IN && devc->num_samples < devc->limit_samples) {
-		if (serial_read_nonblocking(serial, &byte, 1) != 1)
+		/* Drain everything the port has, not one byte per dispatch. */
+		len = serial_read_nonblocking(serial, buf, sizeof(buf));
+		if (len < 0)
 			return FALSE;
-		devc->cnt_bytes++;
-
-		/* Ignore it if we've read enough. */
-		if (devc->num_samples >= devc->limit_samples)
-			return TRUE;
-
-		devc->sample[devc->num_bytes++] = byte;
-		sr_spew("Received byte 0x%.2x.", byte);
-		if (devc->num_bytes == num_ols_changrp) {
-			devc->cnt_samples++;
-			devc->cnt_samples_rle++;
-			/*
-			 * Got a full sample. Convert from the OLS's little-endian
-			 * sample to the local format.
-			 */
-			sample = devc->sample[0] | (devc->sample[1] << 8) \
-					| (devc->sample[2] << 16) | (devc->sample[3] << 24);
-			sr_dbg("Received sample 0x%.*x.", devc->num_bytes * 2, sample);
-			if (devc->flag_reg & FLAG_RLE) {
-				/*
-				 * In RLE mode the high bit of the sample is the
-				 * "count" flag, meaning this sample is the number
-				 * of times the previous sample occurred.
-				 */
-				if (devc->sample[devc->num_bytes - 1] & 0x80) {
-					/* Clear the high bit. */
-					sample &= ~(0x80 << (devc->num_bytes - 1) * 8);
-					devc->rle_count = sample;
-					devc->cnt_samples_rle += devc->rle_count;
-					sr_dbg("RLE count: %u.", devc->rle_count);
-					devc->num_bytes = 0;
-					return TRUE;
-				}
-			}
-			devc->num_samples += devc->rle_count + 1;
-			if (devc->num_samples > devc->limit_samples) {
-				/* Save us from overrunning the buffer. */
-				devc->rle_count -= devc->num_samples - devc->limit_samples;
-				devc->num_samples = devc->limit_samples;
-			}
+		devc->cnt_bytes += len;
 
-			if (num_ols_changrp < 4) {
-				/*
-				 * Some channel groups may have been turned
-				 * off, to speed up transfer between the
-				 * hardware and the PC. Expand that here before
-				 * submitting it over the session bus --
-				 * whatever is listening on the bus will be
-				 * expecting a full 32-bit sample, based on
-				 * the number of channels.
-				 */
-				j = 0;
-				memset(devc->tmp_sample, 0, 4);
-				for (i = 0; i < 4; i++) {
-					if (((devc->flag_reg >> 2) & (1 << i)) == 0) {
-						/*
-						 * This channel group was
-						 * enabled, copy from received
-						 * sample.
-						 */
-						devc->tmp_sample[i] = devc->sample[j++];
-					} else if (devc->flag_reg & FLAG_DEMUX && (i > 2)) {
-						/* group 2 & 3 get added to 0 & 1 */
-						devc->tmp_sample[i - 2] = devc->sample[j++];
-					}
-				}
-				memcpy(devc->sample, devc->tmp_sample, 4);
-				sr_spew("Expanded sample: 0x%.8x.", sample);
-			}
+		for (pos = 0; pos < len; pos++) {
+			/* Ignore the rest if we've read enough. */
+			if (devc->num_samples >= devc->limit_samples)
+				break;
 
-			/*
-			 * the OLS sends its sample buffer backwards.
-			 * store it in reverse order here, so we can dump
-			 * this on the session bus later.
-			 */
-			offset = (devc->limit_samples - devc->num_samples) * 4;
-			for (i = 0; i <= devc->rle_count; i++) {
-				memcpy(devc->raw_sample_buf + offset + (i * 4),
-				       devc->sample, 4);
-			}
-			memset(devc->sample, 0, 4);
-			devc->num_bytes = 0;
-			devc->rle_count = 0;
+			devc->sample[devc->num_bytes++] = buf[pos];
+			if (devc->num_bytes == num_ols_changrp)
+				process_sample(devc, num_ols_changrp);
 		}
+		sr_spew("Received %d bytes, %u samples so far.", len,
+			devc->num_samples);
 	} else {
 		/*
 		 * This is the main loop telling us a timeout was reached, or
@@ -468,6 +482,13 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 		sr_dbg("Received %d bytes, %d samples, %d decompressed samples.",
 				devc->cnt_bytes, devc->cnt_samples,
 				devc->cnt_samples_rle);
+		/*
+		 * Hand the buffer over to the session, so that consumers
+		 * can retain the samples without copying them.
+		 */
+		buffer = sr_buffer_new(devc->raw_sample_buf,
+			devc->limit_samples * 4, NULL, NULL);
+		devc->raw_sample_buf = NULL;
 		if (devc->trigger_at != -1) {
 			/*
 			 * A trigger was set up, so we need to tell the frontend
@@ -479,9 +500,10 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 				packet.payload = &logic;
 				logic.length = devc->trigger_at * 4;
 				logic.unitsize = 4;
-				logic.data = devc->raw_sample_buf +
+				logic.data = (uint8_t *)buffer->data +
 					(devc->limit_samples - devc->num_samples) * 4;
-				sr_session_send(sdi, &packet);
+				sr_session_send_buffer(sdi, &packet,
+					sr_buffer_ref(buffer));
 			}
 
 			/* Send the trigger. */
@@ -493,20 +515,22 @@ SR_PRIV int ols_receive_data(int fd, int revents, void *cb_data)
 			packet.payload = &logic;
 			logic.length = (devc->num_samples * 4) - (devc->trigger_at * 4);
 			logic.unitsize = 4;
-			logic.data = devc->raw_sample_buf + devc->trigger_at * 4 +
+			logic.data = (uint8_t *)buffer->data + devc->trigger_at * 4 +
 				(devc->limit_samples - devc->num_samples) * 4;
-			sr_session_send(sdi, &packet);
+			sr_session_send_buffer(sdi, &packet,
+				sr_buffer_ref(buffer));
 		} else {
 			/* no trigger was used */
 			packet.type = SR_DF_LOGIC;
 			packet.payload = &logic;
 			logic.length = devc->num_samples * 4;
 			logic.unitsize = 4;
-			logic.data = devc->raw_sample_buf +
+			logic.data = (uint8_t *)buffer->data +
 				(devc->limit_samples - devc->num_samples) * 4;
-			sr_session_send(sdi, &packet);
+			sr_session_send_buffer(sdi, &packet,
+				sr_buffer_ref(buffer));
 		}
-		g_free(devc->raw_sample_buf);
+		sr_buffer_unref(buffer);
 
 		serial_flush(serial);
 		abort_acquisition(sdi);
@@ -34,6 +34,8 @@
 #define CLOCK_RATE                 SR_MHZ(100)
 #define MIN_NUM_SAMPLES            4
 #define DEFAULT_SAMPLERATE         SR_KHZ(200)
+/* Bytes read from the port per event loop dispatch, at most. */
+#define OLS_READ_SIZE              4096
 
 /* Command opcodes */
 #define CMD_RESET                  0x00
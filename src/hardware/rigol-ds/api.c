@@ -279,7 +279,6 @@ static void clear_helper(struct dev_context *devc)
 {
 	unsigned int i;
 
-	g_free(devc->data);
 	g_free(devc->buffer);
 	for (i = 0; i < ARRAY_SIZE(devc->coupling); i++)
 		g_free(devc->coupling[i]);
@@ -413,7 +412,6 @@ static struct sr_dev_inst *probe_device(struct sr_scpi_dev_inst *scpi)
 	}
 
 	devc->buffer = g_malloc(ACQ_BUFFER_SIZE);
-	devc->data = g_malloc(ACQ_BUFFER_SIZE * sizeof(float));
 
 	devc->data_source = DATA_SOURCE_LIVE;
 
@@ -869,6 +867,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 
 	devc->num_frames = 0;
+	sr_scpi_frame_stats_start(&devc->frame_stats);
 
 	some_digital = FALSE;
 	for (l = sdi->channels; l; l = l->next) {
@@ -990,6 +989,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_frame_stats_report(&devc->frame_stats, sdi->model);
 
 	return SR_OK;
 }
@@ -571,8 +571,10 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
+	struct sr_rational r_scale, r_offset;
 	double vdiv, offset, origin;
-	int len, i, vref;
+	float *data;
+	int len, vref, i, ret;
 	struct sr_channel *ch;
 	gsize expected_data_bytes;
 
@@ -694,18 +696,49 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		vdiv = devc->vert_inc[ch->index];
 		origin = devc->vert_origin[ch->index];
 		offset = devc->vert_offset[ch->index];
-		if (devc->model->series->protocol >= PROTOCOL_V3)
-			for (i = 0; i < len; i++)
-				devc->data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
-		else
-			for (i = 0; i < len; i++)
-				devc->data[i] = (128 - devc->buffer[i]) * vdiv - offset;
 		float vdivlog = log10f(vdiv);
 		int digits = -(int)vdivlog + (vdivlog < 0.0);
 		sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+		if (devc->model->series->protocol >= PROTOCOL_V3) {
+			/* (raw - vref - origin) * vdiv */
+			ret = sr_rational_from_double(&r_scale, vdiv);
+			if (ret == SR_OK)
+				ret = sr_rational_from_double(&r_offset,
+					-(vref + origin) * vdiv);
+		} else {
+			/* (128 - raw) * vdiv - offset */
+			ret = sr_rational_from_double(&r_scale, -vdiv);
+			if (ret == SR_OK)
+				ret = sr_rational_from_double(&r_offset,
+					128 * vdiv - offset);
+		}
+		data = NULL;
+		if (ret == SR_OK) {
+			/*
+			 * Pass on the raw ADC bytes. The encoding describes
+			 * the vertical setup, consumers convert to volts on
+			 * demand.
+			 */
+			encoding.unitsize = 1;
+			encoding.is_float = FALSE;
+			encoding.is_signed = FALSE;
+			encoding.scale = r_scale;
+			encoding.offset = r_offset;
+			analog.data = devc->buffer;
+		} else {
+			/* The vertical setup has no rational, send volts. */
+			sr_dbg("Vertical setup out of range, sending floats.");
+			data = g_malloc(len * sizeof(float));
+			if (devc->model->series->protocol >= PROTOCOL_V3)
+				for (i = 0; i < len; i++)
+					data[i] = ((int)devc->buffer[i] - vref - origin) * vdiv;
+			else
+				for (i = 0; i < len; i++)
+					data[i] = (128 - devc->buffer[i]) * vdiv - offset;
+			analog.data = data;
+		}
 		analog.meaning->channels = g_slist_append(NULL, ch);
 		analog.num_samples = len;
-		analog.data = devc->data;
 		analog.meaning->mq = SR_MQ_VOLTAGE;
 		analog.meaning->unit = SR_UNIT_VOLT;
 		analog.meaning->mqflags = 0;
@@ -713,6 +746,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		packet.payload = &analog;
 		sr_session_send(sdi, &packet);
 		g_slist_free(analog.meaning->channels);
+		g_free(data);
 	} else {
 		logic.length = len;
 		// TODO: For the MSO1000Z series, we need a way to express that
@@ -778,6 +812,7 @@ SR_PRIV int rigol_ds_receive(int fd, int revents, void *cb_data)
 		/* Done with this frame. */
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(sdi, &packet);
+		sr_scpi_frame_stats_frame(&devc->frame_stats);
 
 		if (++devc->num_frames == devc->limit_frames) {
 			/* Last frame, stop capture. */
@@ -25,6 +25,7 @@
 #include <stdbool.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "scpi.h"
 
 #define LOG_PREFIX "rigol-ds"
 
@@ -142,6 +143,7 @@ struct dev_context {
 
 	/* Number of frames received in total. */
 	uint64_t num_frames;
+	struct sr_scpi_frame_stats frame_stats;
 	/* GSList entry for the current channel. */
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
@@ -156,9 +158,8 @@ struct dev_context {
 	enum wait_events wait_event;
 	/* Trigger/block copying/stop waiting status */
 	int wait_status;
-	/* Acq buffers used for reading from the scope and sending data to app */
+	/* Acq buffer used for reading from the scope and sending data to app */
 	unsigned char *buffer;
-	float *data;
 };
 
 SR_PRIV int rigol_ds_config_set(const struct sr_dev_inst *sdi, const char *format, ...);
@@ -568,7 +568,6 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 	struct dev_context *devc = sdi->priv;
 	const struct sr_channel *c;
 	const GSList *l;
-	uint16_t mask;
 
 	devc->dig_channel_cnt = 0;
 	devc->dig_channel_mask = 0;
@@ -577,13 +576,12 @@ static int configure_channels(const struct sr_dev_inst *sdi)
 		if (!c->enabled)
 			continue;
 
-		mask = 1 << c->index;
-		devc->dig_channel_masks[devc->dig_channel_cnt++] = mask;
-		devc->dig_channel_mask |= mask;
-
+		devc->dig_channel_cnt++;
+		devc->dig_channel_mask |= 1 << c->index;
 	}
 	sr_dbg("%d channels enabled (0x%04x)",
 	       devc->dig_channel_cnt, devc->dig_channel_mask);
+	sr_transpose_init(&devc->transpose, devc->dig_channel_mask, TRUE);
 
 	return SR_OK;
 }
@@ -845,44 +843,74 @@ static void saleae_logic_pro_send_data(const struct sr_dev_inst *sdi,
  * One batch from the device consists of 32 samples per active digital channel.
  * This stream of batches is packed into USB packets with 16384 bytes each.
  */
+/*
+ * Convert one or two batches of 32 samples. A batch holds one word per
+ * enabled channel, the first sample in the MSB.
+ */
+static unsigned int convert_batches(struct dev_context *devc,
+				    const uint32_t *src, unsigned int batches,
+				    uint16_t *dst)
+{
+	uint64_t words[16];
+	uint16_t tmp[64];
+	unsigned int i, cnt;
+
+	cnt = devc->dig_channel_cnt;
+	for (i = 0; i < cnt; i++) {
+		words[i] = (uint64_t)src[i] << 32;
+		if (batches == 2)
+			words[i] |= src[cnt + i];
+	}
+
+	if (batches == 2) {
+		sr_transpose_64(&devc->transpose, words, dst);
+		return 64;
+	}
+	sr_transpose_64(&devc->transpose, words, tmp);
+	memcpy(dst, tmp, 32 * sizeof(uint16_t));
+
+	return 32;
+}
+
 static void saleae_logic_pro_convert_data(const struct sr_dev_inst *sdi,
 					 const uint32_t *src, size_t srccnt)
 {
 	struct dev_context *devc = sdi->priv;
-	uint8_t *dst = devc->conv_buffer;
-	uint32_t samples;
-	uint16_t channel_mask;
-	unsigned int sample_index, batch_index;
-	uint16_t *dst_batch;
-
-	/* Copy partial batch to the beginning. */
-	memcpy(dst, dst + devc->conv_size, CONV_BATCH_SIZE);
-	/* Reset converted size. */
+	uint16_t *dst = (uint16_t *)devc->conv_buffer;
+	unsigned int cnt, n;
+
+	cnt = devc->dig_channel_cnt;
 	devc->conv_size = 0;
+	if (!cnt)
+		return;
+
+	/* Complete the batch left over from the previous transfer. */
+	if (devc->batch_index) {
+		n = MIN(cnt - devc->batch_index, srccnt);
+		memcpy(devc->batch + devc->batch_index, src, n * sizeof(*src));
+		devc->batch_index += n;
+		src += n;
+		srccnt -= n;
+		if (devc->batch_index < cnt)
+			return;
+		n = convert_batches(devc, devc->batch, 1, dst);
+		dst += n;
+		devc->conv_size += n * sizeof(uint16_t);
+		devc->batch_index = 0;
+	}
 
-	batch_index = devc->batch_index;
-	while (srccnt--) {
-		samples = *src++;
-		dst_batch = (uint16_t*)dst;
-
-		/* First index of the batch. */
-		if (batch_index == 0)
-			memset(dst, 0, CONV_BATCH_SIZE);
-
-		/* Convert one channel. */
-		channel_mask = devc->dig_channel_masks[batch_index];
-		for (sample_index = 0; sample_index <= 31; sample_index++)
-			if ((samples >> (31 - sample_index)) & 1)
-				dst_batch[sample_index] |= channel_mask;
-
-		/* Last index of the batch. */
-		if (++batch_index == devc->dig_channel_cnt) {
-			devc->conv_size += CONV_BATCH_SIZE;
-			batch_index = 0;
-			dst += CONV_BATCH_SIZE;
-		}
+	/* Two batches make a block of 64 samples for the transposition. */
+	while (srccnt >= cnt) {
+		n = convert_batches(devc, src, srccnt >= 2 * cnt ? 2 : 1, dst);
+		src += n / 32 * cnt;
+		srccnt -= n / 32 * cnt;
+		dst += n;
+		devc->conv_size += n * sizeof(uint16_t);
 	}
-	devc->batch_index = batch_index;
+
+	/* Keep a partial batch for the next transfer. */
+	memcpy(devc->batch, src, srccnt * sizeof(*src));
+	devc->batch_index = srccnt;
 }
 
 SR_PRIV void LIBUSB_CALL saleae_logic_pro_receive_data(struct libusb_transfer *transfer)
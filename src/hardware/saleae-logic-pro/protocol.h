@@ -31,7 +31,7 @@
 #define CONV_BATCH_SIZE (2 * 32)
 
 /*
- * One packet + one partial conversion: Worst case is only one active
+ * One packet + one completed partial batch: Worst case is only one active
  * channel converted to 2 bytes per sample, with 8 * 16384 samples per packet.
  */
 #define CONV_BUFFER_SIZE (2 * 8 * 16384 + CONV_BATCH_SIZE)
@@ -39,7 +39,6 @@
 struct dev_context {
 	unsigned int dig_channel_cnt;
 	uint16_t dig_channel_mask;
-	uint16_t dig_channel_masks[16];
 	uint64_t dig_samplerate;
 
 	uint32_t lfsr;
@@ -50,7 +49,10 @@ struct dev_context {
 
 	uint8_t *conv_buffer;
 	unsigned int conv_size;
+	/* Words of a partial batch, from the end of the previous packet. */
+	uint32_t batch[16];
 	unsigned int batch_index;
+	struct sr_transpose transpose;
 };
 
 SR_PRIV int saleae_logic_pro_init(const struct sr_dev_inst *sdi);
@@ -44,6 +44,19 @@ static const uint32_t devopts[] = {
 	SR_CONF_LIMIT_MSEC | SR_CONF_SET,
 };
 
+static void clear_helper(void *priv)
+{
+	struct dev_context *devc;
+
+	devc = priv;
+	g_free(devc->info);
+}
+
+static int dev_clear(const struct sr_dev_driver *di)
+{
+	return std_dev_clear_with_callback(di, clear_helper);
+}
+
 static GSList *scan(struct sr_dev_driver *di, GSList *options)
 {
 	struct dmm_info *dmm;
@@ -130,6 +143,7 @@ static GSList *scan(struct sr_dev_driver *di, GSList *options)
 	sdi->model = g_strdup(dmm->device);
 	devc = g_malloc0(sizeof(struct dev_context));
 	sr_sw_limits_init(&devc->limits);
+	devc->info = g_malloc(dmm->info_size);
 	sdi->inst_type = SR_INST_SERIAL;
 	sdi->conn = serial;
 	sdi->priv = devc;
@@ -204,7 +218,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			.cleanup = std_cleanup, \
 			.scan = scan, \
 			.dev_list = std_dev_list, \
-			.dev_clear = std_dev_clear, \
+			.dev_clear = dev_clear, \
 			.config_get = NULL, \
 			.config_set = config_set, \
 			.config_list = config_list, \
@@ -215,7 +229,8 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 			.context = NULL, \
 		}, \
 		VENDOR, MODEL, CONN, BAUDRATE, PACKETSIZE, TIMEOUT, DELAY, \
-		REQUEST, 1, NULL, VALID, PARSE, DETAILS, sizeof(struct CHIPSET##_info) \
+		REQUEST, 1, NULL, VALID, PARSE, DETAILS, sizeof(struct CHIPSET##_info), \
+		&sr_##CHIPSET##_framing \
 	}).di
 
 SR_REGISTER_DEV_DRIVER_LIST(serial_dmm_drivers,
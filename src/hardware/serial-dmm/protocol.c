@@ -128,6 +128,7 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	struct dev_context *devc;
 	int len, offset;
 	struct sr_serial_dev_inst *serial;
+	const uint8_t *packet;
 
 	dmm = (struct dmm_info *)sdi->driver;
 
@@ -145,23 +146,29 @@ static void handle_new_data(struct sr_dev_inst *sdi, void *info)
 	}
 	devc->buflen += len;
 
-	/* Now look for packets in that data. */
+	/*
+	 * Now look for packets in that data. Only the offsets where the
+	 * chipset's sync byte matches get validated.
+	 */
 	offset = 0;
 	while ((devc->buflen - offset) >= dmm->packet_size) {
-		if (dmm->packet_valid(devc->buf + offset)) {
-			handle_packet(devc->buf + offset, sdi, info);
-			offset += dmm->packet_size;
-
-			/* Request next packet, if required. */
-			if (!dmm->packet_request)
-				break;
-			if (dmm->req_timeout_ms || dmm->req_delay_ms)
-				devc->req_next_at = g_get_monotonic_time() +
-					dmm->req_delay_ms * 1000;
-			req_packet(sdi);
-		} else {
-			offset++;
+		packet = sr_dmm_packet_find(dmm->framing, devc->buf + offset,
+			devc->buflen - offset, dmm->packet_size,
+			dmm->packet_valid);
+		if (!packet) {
+			offset = devc->buflen - dmm->packet_size + 1;
+			break;
 		}
+		handle_packet(packet, sdi, info);
+		offset = packet - devc->buf + dmm->packet_size;
+
+		/* Request next packet, if required. */
+		if (!dmm->packet_request)
+			break;
+		if (dmm->req_timeout_ms || dmm->req_delay_ms)
+			devc->req_next_at = g_get_monotonic_time() +
+				dmm->req_delay_ms * 1000;
+		req_packet(sdi);
 	}
 
 	/* If we have any data left, move it to the beginning of our buffer. */
@@ -175,7 +182,6 @@ int receive_data(int fd, int revents, void *cb_data)
 	struct sr_dev_inst *sdi;
 	struct dev_context *devc;
 	struct dmm_info *dmm;
-	void *info;
 
 	(void)fd;
 
@@ -189,9 +195,7 @@ int receive_data(int fd, int revents, void *cb_data)
 
 	if (revents == G_IO_IN) {
 		/* Serial data arrived. */
-		info = g_malloc(dmm->info_size);
-		handle_new_data(sdi, info);
-		g_free(info);
+		handle_new_data(sdi, devc->info);
 	} else {
 		/* Timeout; send another packet request if DMM needs it. */
 		if (dmm->packet_request && (req_packet(sdi) < 0))
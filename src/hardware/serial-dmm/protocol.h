@@ -60,6 +60,8 @@ struct dmm_info {
 	void (*dmm_details)(struct sr_datafeed_analog *, void *);
 	/** Size of chipset info struct. */
 	gsize info_size;
+	/** Where the chipset's packets can start. */
+	const struct sr_dmm_framing *framing;
 };
 
 #define DMM_BUFSIZE 256
@@ -71,6 +73,9 @@ struct dev_context {
 	int bufoffset;
 	int buflen;
 
+	/* The chipset info struct, reused for every packet. */
+	void *info;
+
 	/**
 	 * The timestamp [µs] to send the next request.
 	 * Used only if device needs polling.
@@ -807,6 +807,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 	devc = sdi->priv;
 
 	devc->num_frames = 0;
+	sr_scpi_frame_stats_start(&devc->frame_stats);
 	some_digital = FALSE;
 
 	/*
@@ -919,6 +920,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 	scpi = sdi->conn;
 	sr_scpi_source_remove(sdi->session, scpi);
+	sr_scpi_frame_stats_report(&devc->frame_stats, sdi->model);
 
 	return SR_OK;
 }
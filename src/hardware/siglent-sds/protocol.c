@@ -465,7 +465,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 	struct sr_analog_spec spec;
 	struct sr_datafeed_logic logic;
 	struct sr_channel *ch;
-	int len, i;
+	int len;
 	float wait;
 	gboolean read_complete = FALSE;
 
@@ -579,25 +579,39 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 				if (ch->type == SR_CHANNEL_ANALOG) {
 					float vdiv = devc->vdiv[ch->index];
 					float offset = devc->vert_offset[ch->index];
-					GArray *float_data;
-					static GArray *data;
-					float voltage, vdivlog;
-					int digits;
-
-					data = g_array_sized_new(FALSE, FALSE, sizeof(uint8_t), len);
-					g_array_append_vals(data, devc->buffer, len);
-					float_data = g_array_new(FALSE, FALSE, sizeof(float));
-					for (i = 0; i < len; i++) {
-						voltage = (float)g_array_index(data, int8_t, i) / 25;
-						voltage = ((vdiv * voltage) - offset);
-						g_array_append_val(float_data, voltage);
-					}
+					struct sr_rational r_scale, r_offset;
+					float *data, vdivlog;
+					int digits, i, ret;
+
 					vdivlog = log10f(vdiv);
 					digits = -(int) vdivlog + (vdivlog < 0.0);
 					sr_analog_init(&analog, &encoding, &meaning, &spec, digits);
+					ret = sr_rational_from_double(&r_scale, vdiv / 25.0);
+					if (ret == SR_OK)
+						ret = sr_rational_from_double(&r_offset, -offset);
+					data = NULL;
+					if (ret == SR_OK) {
+						/*
+						 * Pass on the raw ADC bytes, 25 counts per
+						 * division. Consumers convert to volts on
+						 * demand.
+						 */
+						encoding.unitsize = 1;
+						encoding.is_float = FALSE;
+						encoding.is_signed = TRUE;
+						encoding.scale = r_scale;
+						encoding.offset = r_offset;
+						analog.data = devc->buffer;
+					} else {
+						/* The vertical setup has no rational, send volts. */
+						sr_dbg("Vertical setup out of range, sending floats.");
+						data = g_malloc(len * sizeof(float));
+						for (i = 0; i < len; i++)
+							data[i] = vdiv * ((int8_t)devc->buffer[i] / 25.0f) - offset;
+						analog.data = data;
+					}
 					analog.meaning->channels = g_slist_append(NULL, ch);
-					analog.num_samples = float_data->len;
-					analog.data = (float *)float_data->data;
+					analog.num_samples = len;
 					analog.meaning->mq = SR_MQ_VOLTAGE;
 					analog.meaning->unit = SR_UNIT_VOLT;
 					analog.meaning->mqflags = 0;
@@ -605,7 +619,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 					packet.payload = &analog;
 					sr_session_send(sdi, &packet);
 					g_slist_free(analog.meaning->channels);
-					g_array_free(data, TRUE);
+					g_free(data);
 				}
 				len = 0;
 				if (devc->num_samples == (devc->num_block_bytes - SIGLENT_HEADER_SIZE)) {
@@ -635,6 +649,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 				/* Done with this frame. */
 				packet.type = SR_DF_FRAME_END;
 				sr_session_send(sdi, &packet);
+				sr_scpi_frame_stats_frame(&devc->frame_stats);
 				if (++devc->num_frames == devc->limit_frames) {
 					/* Last frame, stop capture. */
 					sdi->driver->dev_acquisition_stop(sdi);
@@ -660,6 +675,7 @@ SR_PRIV int siglent_sds_receive(int fd, int revents, void *cb_data)
 		sr_session_send(sdi, &packet);
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(sdi, &packet);
+		sr_scpi_frame_stats_frame(&devc->frame_stats);
 		sdi->driver->dev_acquisition_stop(sdi);
 
 		if (++devc->num_frames == devc->limit_frames) {
@@ -24,6 +24,7 @@
 #include <glib.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
+#include "scpi.h"
 
 #define LOG_PREFIX "siglent-sds"
 
@@ -135,6 +136,7 @@ struct dev_context {
 
 	/* Number of frames received in total. */
 	uint64_t num_frames;
+	struct sr_scpi_frame_stats frame_stats;
 	/* GSList entry for the current channel. */
 	GSList *channel_entry;
 	/* Number of bytes received for current channel. */
@@ -516,6 +516,7 @@ static int dev_acquisition_start(const struct sr_dev_inst *sdi)
 
 	/* Request data for the first enabled channel. */
 	devc->current_channel = devc->enabled_channels;
+	sr_scpi_frame_stats_start(&devc->frame_stats);
 	dlm_channel_data_request(sdi);
 
 	sr_scpi_source_add(sdi->session, scpi, G_IO_IN, 5,
@@ -537,6 +538,7 @@ static int dev_acquisition_stop(struct sr_dev_inst *sdi)
 	devc->enabled_channels = NULL;
 
 	sr_scpi_source_remove(sdi->session, sdi->conn);
+	sr_scpi_frame_stats_report(&devc->frame_stats, sdi->model);
 
 	return SR_OK;
 }
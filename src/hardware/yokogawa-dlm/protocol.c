@@ -1113,6 +1113,7 @@ SR_PRIV int dlm_data_receive(int fd, int revents, void *cb_data)
 	if (!devc->current_channel->next) {
 		packet.type = SR_DF_FRAME_END;
 		sr_session_send(sdi, &packet);
+		sr_scpi_frame_stats_frame(&devc->frame_stats);
 		devc->current_channel = devc->enabled_channels;
 
 		/*
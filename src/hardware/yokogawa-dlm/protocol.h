@@ -106,6 +106,7 @@ struct dev_context {
 	GSList *enabled_channels;
 	GSList *current_channel;
 	uint64_t num_frames;
+	struct sr_scpi_frame_stats frame_stats;
 
 	uint64_t frame_limit;
 
@@ -199,6 +199,20 @@ static struct sr_key_info sr_key_info_config[] = {
 		"Probe factor", NULL},
 	{SR_CONF_ADC_POWERLINE_CYCLES, SR_T_FLOAT, "nplc",
 		"Number of ADC powerline cycles", NULL},
+	{SR_CONF_USB_TRANSFER_SIZE, SR_T_UINT64, "usb_transfer_size",
+		"USB transfer size", NULL},
+	{SR_CONF_USB_NUM_TRANSFERS, SR_T_UINT64, "usb_num_transfers",
+		"Number of USB transfers", NULL},
+	{SR_CONF_USB_SHORT_PACKETS, SR_T_UINT64, "usb_short_packets",
+		"USB short packets", NULL},
+	{SR_CONF_USB_DROPPED_TRANSFERS, SR_T_UINT64, "usb_dropped_transfers",
+		"Dropped USB transfers", NULL},
+	{SR_CONF_USB_RESUBMIT_LATENCY, SR_T_UINT64, "usb_resubmit_latency",
+		"USB resubmit latency", NULL},
+	{SR_CONF_USB_EVENT_THREAD, SR_T_BOOL, "usb_event_thread",
+		"USB event thread", NULL},
+	{SR_CONF_SCPI_PIPELINE_DEPTH, SR_T_UINT64, "scpi_pipeline_depth",
+		"SCPI pipeline depth", NULL},
 
 	/* Acquisition modes, sample limiting */
 	{SR_CONF_LIMIT_MSEC, SR_T_UINT64, "limit_time",
@@ -69,6 +69,13 @@
 
 #define CHUNK_SIZE (4 * 1024 * 1024)
 
+/* Idle runs of at least this many bytes are sent from the run buffer. */
+#define RUN_BUFFER_SIZE (256 * 1024)
+
+/* Single character identifiers, '!' to '~', are looked up in an array. */
+#define SHORT_ID_FIRST '!'
+#define SHORT_ID_COUNT ('~' - '!' + 1)
+
 struct context {
 	gboolean started;
 	gboolean got_header;
@@ -81,10 +88,16 @@ struct context {
 	int64_t skip;
 	gboolean skip_until_end;
 	GSList *channels;
+	/* Channel index + 1 by identifier, 0 for unknown identifiers. */
+	int short_ids[SHORT_ID_COUNT];
+	GHashTable *long_ids;
 	size_t bytes_per_sample;
 	size_t samples_in_buffer;
 	uint8_t *buffer;
 	uint8_t *current_levels;
+	/* Copies of a single sample, sent repeatedly for long idle runs. */
+	struct sr_buffer *run;
+	size_t run_samples;
 	GSList *prev_sr_channels;
 };
 
@@ -226,6 +239,38 @@ static int check_header_in_reread(const struct sr_input *in)
 	return TRUE;
 }
 
+/*
+ * Register the identifier of a channel. When several variables share an
+ * identifier, the first one wins.
+ */
+static void add_identifier(struct context *inc, const char *identifier,
+		unsigned int index)
+{
+	int *slot;
+
+	if (identifier[0] >= SHORT_ID_FIRST && identifier[1] == '\0' &&
+	    identifier[0] < SHORT_ID_FIRST + SHORT_ID_COUNT) {
+		slot = &inc->short_ids[identifier[0] - SHORT_ID_FIRST];
+		if (!*slot)
+			*slot = index + 1;
+		return;
+	}
+
+	if (!g_hash_table_lookup(inc->long_ids, identifier))
+		g_hash_table_insert(inc->long_ids, (gpointer)identifier,
+			GINT_TO_POINTER(index + 1));
+}
+
+/* Get the channel index of an identifier, or -1 if it is unknown. */
+static int find_identifier(const struct context *inc, const char *identifier)
+{
+	if (identifier[0] >= SHORT_ID_FIRST && identifier[1] == '\0' &&
+	    identifier[0] < SHORT_ID_FIRST + SHORT_ID_COUNT)
+		return inc->short_ids[identifier[0] - SHORT_ID_FIRST] - 1;
+
+	return GPOINTER_TO_INT(g_hash_table_lookup(inc->long_ids, identifier)) - 1;
+}
+
 /*
  * Parse VCD header to get values for context structure.
  * The context structure should be zeroed before calling this.
@@ -292,6 +337,7 @@ static gboolean parse_header(const struct sr_input *in, GString *buf)
 				sr_info("Channel %d is '%s' identified by '%s'.",
 						inc->channelcount, vcd_ch->name, vcd_ch->identifier);
 
+				add_identifier(inc, vcd_ch->identifier, inc->channelcount);
 				sr_channel_new(in->sdi, inc->channelcount++, SR_CHANNEL_LOGIC, TRUE, vcd_ch->name);
 				inc->channels = g_slist_append(inc->channels, vcd_ch);
 			}
@@ -368,18 +414,98 @@ static void send_buffer(const struct sr_input *in)
 	inc->samples_in_buffer = 0;
 }
 
+/*
+ * Write count copies of a sample to p. The copied region doubles with
+ * every memcpy(), so long runs cost no per-sample work.
+ */
+static void fill_samples(uint8_t *p, const uint8_t *sample,
+		size_t unitsize, size_t count)
+{
+	size_t done, total, len;
+
+	if (!count)
+		return;
+	total = count * unitsize;
+	memcpy(p, sample, unitsize);
+	for (done = unitsize; done < total; done += len) {
+		len = MIN(done, total - done);
+		memcpy(p + done, p, len);
+	}
+}
+
+/*
+ * Fill the run buffer with copies of the current sample, unless it holds
+ * them already. A buffer which earlier packets still reference is left
+ * to them, and replaced.
+ */
+static void fill_run_buffer(struct context *inc)
+{
+	size_t count;
+
+	count = RUN_BUFFER_SIZE / inc->bytes_per_sample;
+	if (inc->run_samples == count && !memcmp(inc->run->data,
+			inc->current_levels, inc->bytes_per_sample))
+		return;
+
+	if (inc->run && g_atomic_int_get(&inc->run->refcount) > 1) {
+		sr_buffer_unref(inc->run);
+		inc->run = NULL;
+	}
+	if (!inc->run)
+		inc->run = sr_buffer_new(g_malloc(RUN_BUFFER_SIZE),
+			RUN_BUFFER_SIZE, NULL, NULL);
+	fill_samples(inc->run->data, inc->current_levels,
+		inc->bytes_per_sample, count);
+	inc->run_samples = count;
+}
+
+/*
+ * Send a long run of the current sample as repeated chunks of the run
+ * buffer, after the samples accumulated so far.
+ */
+static void send_run(const struct sr_input *in, size_t count)
+{
+	struct context *inc;
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	size_t n;
+
+	inc = in->priv;
+	send_buffer(in);
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = inc->bytes_per_sample;
+	while (count) {
+		fill_run_buffer(inc);
+		n = MIN(count, inc->run_samples);
+		logic.data = inc->run->data;
+		logic.length = n * inc->bytes_per_sample;
+		sr_session_send_buffer(in->sdi, &packet, sr_buffer_ref(inc->run));
+		count -= n;
+		/* In-place transforms may have changed the samples. */
+		if (in->sdi->session && in->sdi->session->transforms)
+			inc->run_samples = 0;
+	}
+}
+
 /*
  * Add N copies of the current sample to buffer.
- * When the buffer fills up, automatically send it.
+ * When the buffer fills up, automatically send it. Long runs are sent
+ * from the run buffer instead.
  */
 static void add_samples(const struct sr_input *in, size_t count)
 {
 	struct context *inc;
 	size_t samples_per_chunk;
-	size_t space_left, i;
+	size_t space_left;
 	uint8_t *p;
 
 	inc = in->priv;
+	if (count * inc->bytes_per_sample >= RUN_BUFFER_SIZE) {
+		send_run(in, count);
+		return;
+	}
 	samples_per_chunk = CHUNK_SIZE / inc->bytes_per_sample;
 
 	while (count) {
@@ -389,12 +515,10 @@ static void add_samples(const struct sr_input *in, size_t count)
 			space_left = count;
 
 		p = inc->buffer + inc->samples_in_buffer * inc->bytes_per_sample;
-		for (i = 0; i < space_left; i++) {
-			memcpy(p, inc->current_levels, inc->bytes_per_sample);
-			p += inc->bytes_per_sample;
-			inc->samples_in_buffer++;
-			count--;
-		}
+		fill_samples(p, inc->current_levels, inc->bytes_per_sample,
+			space_left);
+		inc->samples_in_buffer += space_left;
+		count -= space_left;
 
 		if (inc->samples_in_buffer == samples_per_chunk)
 			send_buffer(in);
@@ -404,25 +528,52 @@ static void add_samples(const struct sr_input *in, size_t count)
 /* Set the channel level depending on the identifier and parsed value. */
 static void process_bit(struct context *inc, char *identifier, unsigned int bit)
 {
-	GSList *l;
-	struct vcd_channel *vcd_ch;
-	unsigned int j;
-
-	for (j = 0, l = inc->channels; j < inc->channelcount && l; j++, l = l->next) {
-		vcd_ch = l->data;
-		if (g_strcmp0(identifier, vcd_ch->identifier) == 0) {
-			/* Found our channel. */
-			size_t byte_idx = (j / 8);
-			size_t bit_idx = j - 8 * byte_idx;
-			if (bit)
-				inc->current_levels[byte_idx] |= (uint8_t)1 << bit_idx;
-			else
-				inc->current_levels[byte_idx] &= ~((uint8_t)1 << bit_idx);
-			break;
-		}
-	}
-	if (j == inc->channelcount)
+	size_t byte_idx, bit_idx;
+	int j;
+
+	j = find_identifier(inc, identifier);
+	if (j < 0) {
 		sr_dbg("Did not find channel for identifier '%s'.", identifier);
+		return;
+	}
+
+	byte_idx = j / 8;
+	bit_idx = j % 8;
+	if (bit)
+		inc->current_levels[byte_idx] |= (uint8_t)1 << bit_idx;
+	else
+		inc->current_levels[byte_idx] &= ~((uint8_t)1 << bit_idx);
+}
+
+static inline gboolean is_separator(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*
+ * Get the next whitespace delimited token of the data section, and
+ * terminate it in place. Returns NULL at the end of the data.
+ */
+static char *next_token(char **data)
+{
+	char *p, *token;
+
+	p = *data;
+	while (*p && is_separator(*p))
+		p++;
+	if (!*p) {
+		*data = p;
+		return NULL;
+	}
+
+	token = p;
+	while (*p && !is_separator(*p))
+		p++;
+	if (*p)
+		*p++ = '\0';
+	*data = p;
+
+	return token;
 }
 
 /* Parse a set of lines from the data section. */
@@ -430,25 +581,22 @@ static void parse_contents(const struct sr_input *in, char *data)
 {
 	struct context *inc;
 	uint64_t timestamp;
-	unsigned int bit, i;
-	char **tokens;
+	unsigned int bit;
+	char *token, *identifier;
 
 	inc = in->priv;
 
 	/* Read one space-delimited token at a time. */
-	tokens = g_strsplit_set(data, " \t\r\n", 0);
-	remove_empty_parts(tokens);
-	for (i = 0; tokens[i]; i++) {
+	while ((token = next_token(&data))) {
 		if (inc->skip_until_end) {
-			if (!strcmp(tokens[i], "$end")) {
-				/* Done with unhandled/unknown section. */
+			/* Done with unhandled/unknown section? */
+			if (!strcmp(token, "$end"))
 				inc->skip_until_end = FALSE;
-				break;
-			}
+			continue;
 		}
-		if (tokens[i][0] == '#' && g_ascii_isdigit(tokens[i][1])) {
+		if (token[0] == '#' && g_ascii_isdigit(token[1])) {
 			/* Numeric value beginning with # is a new timestamp value */
-			timestamp = strtoull(tokens[i] + 1, NULL, 10);
+			timestamp = strtoull(token + 1, NULL, 10);
 
 			if (inc->downsample > 1)
 				timestamp /= inc->downsample;
@@ -467,8 +615,6 @@ static void parse_contents(const struct sr_input *in, char *data)
 				/* Ignore repeated timestamps (e.g. sigrok outputs these) */
 			} else if (timestamp < inc->prev_timestamp) {
 				sr_err("Invalid timestamp: %" PRIu64 " (smaller than previous timestamp).", timestamp);
-				inc->skip_until_end = TRUE;
-				break;
 			} else {
 				if (inc->compress != 0 && timestamp - inc->prev_timestamp > inc->compress) {
 					/* Compress long idle periods */
@@ -481,68 +627,56 @@ static void parse_contents(const struct sr_input *in, char *data)
 				add_samples(in, timestamp - inc->prev_timestamp);
 				inc->prev_timestamp = timestamp;
 			}
-		} else if (tokens[i][0] == '$' && tokens[i][1] != '\0') {
+		} else if (token[0] == '$' && token[1] != '\0') {
 			/*
 			 * This is probably a $dumpvars, $comment or similar.
 			 * $dump* contain useful data.
 			 */
-			if (g_strcmp0(tokens[i], "$dumpvars") == 0
-					|| g_strcmp0(tokens[i], "$dumpon") == 0
-					|| g_strcmp0(tokens[i], "$dumpoff") == 0
-					|| g_strcmp0(tokens[i], "$end") == 0) {
-				/* Ignore, parse contents as normally. */
-			} else {
-				/* Ignore this and future lines until $end. */
+			if (strcmp(token, "$dumpvars") && strcmp(token, "$dumpon")
+					&& strcmp(token, "$dumpoff") && strcmp(token, "$end")) {
+				/* Ignore this and following tokens until $end. */
 				inc->skip_until_end = TRUE;
-				break;
 			}
-		} else if (strchr("rR", tokens[i][0]) != NULL) {
+		} else if (token[0] == 'r' || token[0] == 'R') {
 			sr_dbg("Real type vector values not supported yet!");
-			if (!tokens[++i])
-				/* No tokens left, bail out */
-				break;
-			else
-				/* Process next token */
-				continue;
-		} else if (strchr("bB", tokens[i][0]) != NULL) {
-			bit = (tokens[i][1] == '1');
+			/* Skip the identifier. */
+			next_token(&data);
+		} else if (token[0] == 'b' || token[0] == 'B') {
+			bit = (token[1] == '1');
+			identifier = next_token(&data);
 
 			/*
-			 * Bail out if a) char after 'b' is NUL, or b) there is
-			 * a second character after 'b', or c) there is no
-			 * identifier.
+			 * Ignore the value if a) char after 'b' is NUL, or
+			 * b) there is a second character after 'b', or
+			 * c) there is no identifier.
 			 */
-			if (!tokens[i][1] || tokens[i][2] || !tokens[++i]) {
+			if (!token[1] || token[2] || !identifier) {
 				sr_dbg("Unexpected vector format!");
-				break;
+				continue;
 			}
 
-			process_bit(inc, tokens[i], bit);
-		} else if (strchr("01xXzZ", tokens[i][0]) != NULL) {
-			char *identifier;
-
+			process_bit(inc, identifier, bit);
+		} else if (strchr("01xXzZ", token[0])) {
 			/* A new 1-bit sample value */
-			bit = (tokens[i][0] == '1');
+			bit = (token[0] == '1');
 
 			/*
 			 * The identifier is either the next character, or, if
 			 * there was whitespace after the bit, the next token.
 			 */
-			if (tokens[i][1] == '\0') {
-				if (!tokens[++i]) {
+			if (token[1] == '\0') {
+				if (!(identifier = next_token(&data))) {
 					sr_dbg("Identifier missing!");
 					break;
 				}
-				identifier = tokens[i];
 			} else {
-				identifier = tokens[i] + 1;
+				identifier = token + 1;
 			}
 			process_bit(inc, identifier, bit);
 		} else {
-			sr_warn("Skipping unknown token '%s'.", tokens[i]);
+			sr_warn("Skipping unknown token '%s'.", token);
 		}
 	}
-	g_strfreev(tokens);
 }
 
 static int init(struct sr_input *in, GHashTable *options)
@@ -564,6 +698,7 @@ static int init(struct sr_input *in, GHashTable *options)
 	in->priv = inc;
 
 	inc->buffer = g_malloc(CHUNK_SIZE);
+	inc->long_ids = g_hash_table_new(g_str_hash, g_str_equal);
 
 	return SR_OK;
 }
@@ -611,9 +746,7 @@ static int process_buffer(struct sr_input *in)
 
 	while ((p = g_strrstr_len(in->buf->str, in->buf->len, "\n"))) {
 		*p = '\0';
-		g_strstrip(in->buf->str);
-		if (in->buf->str[0] != '\0')
-			parse_contents(in, in->buf->str);
+		parse_contents(in, in->buf->str);
 		g_string_erase(in->buf, 0, p - in->buf->str + 1);
 	}
 
@@ -672,11 +805,22 @@ static void cleanup(struct sr_input *in)
 
 	inc = in->priv;
 	keep_header_for_reread(in);
+	if (inc->long_ids) {
+		/* The keys are owned by the channel list. */
+		g_hash_table_destroy(inc->long_ids);
+		inc->long_ids = NULL;
+	}
+	memset(inc->short_ids, 0, sizeof(inc->short_ids));
 	g_slist_free_full(inc->channels, free_channel);
 	inc->channels = NULL;
 
 	g_free(inc->buffer);
 	inc->buffer = NULL;
+	if (inc->run) {
+		sr_buffer_unref(inc->run);
+		inc->run = NULL;
+	}
+	inc->run_samples = 0;
 	g_free(inc->current_levels);
 	inc->current_levels = NULL;
 }
@@ -695,6 +839,7 @@ static int reset(struct sr_input *in)
 	inc->channelcount = 0;
 	/* The inc->channels list was released in cleanup() above. */
 	inc->buffer = g_malloc(CHUNK_SIZE);
+	inc->long_ids = g_hash_table_new(g_str_hash, g_str_equal);
 
 	return SR_OK;
 }
@@ -197,14 +197,25 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 	struct sr_analog_meaning meaning;
 	struct sr_analog_spec spec;
 	struct context *inc;
+	struct sr_buffer *buffer;
 	float *fdata;
 	int total_samples, samplenum;
 	char *s, *d;
 
 	inc = in->priv;
 
+	/*
+	 * The packet takes over a buffer from the session's pool, so that
+	 * consumers can retain it without copying.
+	 */
 	total_samples = num_samples * inc->num_channels;
-	fdata = g_malloc0(total_samples * sizeof(float));
+	buffer = sr_pool_buffer_new(in->sdi->session ?
+		in->sdi->session->pool : NULL, total_samples * sizeof(float));
+	if (!buffer) {
+		sr_err("Sample buffer malloc failed.");
+		return;
+	}
+	fdata = buffer->data;
 	s = in->buf->str + offset;
 	d = (char *)fdata;
 
@@ -246,8 +257,7 @@ static void send_chunk(const struct sr_input *in, int offset, int num_samples)
 	analog.meaning->mq = 0;
 	analog.meaning->mqflags = 0;
 	analog.meaning->unit = 0;
-	sr_session_send(in->sdi, &packet);
-	g_free(fdata);
+	sr_session_send_buffer(in->sdi, &packet, buffer);
 }
 
 static int process_buffer(struct sr_input *in)
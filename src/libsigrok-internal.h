@@ -639,6 +639,22 @@ struct sr_transform {
 	void *priv;
 };
 
+/** Transform module capabilities, see sr_transform_module.flags. */
+enum sr_transform_flags {
+	/**
+	 * receive() modifies the packet it is given and passes that same
+	 * packet on, if it passes on anything at all.
+	 */
+	SR_TRANSFORM_INPLACE = 1 << 0,
+	/**
+	 * The module has a logic_block() kernel. The session runs adjacent
+	 * fusable modules block by block in a single pass over the logic
+	 * data, instead of handing each of them the whole packet in turn.
+	 * Implies SR_TRANSFORM_INPLACE.
+	 */
+	SR_TRANSFORM_FUSABLE = 1 << 1,
+};
+
 struct sr_transform_module {
 	/**
 	 * A unique ID for this transform module, suitable for use in
@@ -697,6 +713,22 @@ struct sr_transform_module {
 			struct sr_datafeed_packet *packet_in,
 			struct sr_datafeed_packet **packet_out);
 
+	/** Capabilities of this module, see enum sr_transform_flags. */
+	int flags;
+
+	/**
+	 * Transform a block of logic samples in place. Used instead of
+	 * receive() for SR_DF_LOGIC packets if SR_TRANSFORM_FUSABLE is set.
+	 *
+	 * @param t Pointer to the respective 'struct sr_transform'.
+	 * @param data The samples.
+	 * @param length Length of the block in bytes, a multiple of
+	 *               @a unitsize.
+	 * @param unitsize Number of bytes per sample.
+	 */
+	void (*logic_block) (const struct sr_transform *t, uint8_t *data,
+			size_t length, unsigned int unitsize);
+
 	/**
 	 * This function is called after the caller is finished using
 	 * the transform module, and can be used to free any internal
@@ -850,6 +882,16 @@ SR_PRIV void sr_config_free(struct sr_config *src);
 SR_PRIV int sr_dev_acquisition_start(struct sr_dev_inst *sdi);
 SR_PRIV int sr_dev_acquisition_stop(struct sr_dev_inst *sdi);
 
+/*--- scan.c ----------------------------------------------------------------*/
+
+/** Probe a single resource for a device, see sr_scan_resources(). */
+typedef struct sr_dev_inst *(*sr_scan_probe_callback)(const char *resource,
+		void *cb_data);
+
+SR_PRIV GSList *sr_scan_resources(GSList *resources,
+		sr_scan_probe_callback probe, void *cb_data);
+SR_PRIV gint64 sr_scan_time_left(void);
+
 /*--- session.c -------------------------------------------------------------*/
 
 struct sr_session {
@@ -862,6 +904,8 @@ struct sr_session {
 	/** List of struct datafeed_callback pointers. */
 	GSList *datafeed_callbacks;
 	GSList *transforms;
+	/** The transforms above, compiled into stages. */
+	GSList *transform_stages;
 	struct sr_trigger *trigger;
 
 	/** Callback to invoke on session stop. */
@@ -882,6 +926,8 @@ struct sr_session {
 	unsigned int stop_check_id;
 	/** Whether the session has been started. */
 	gboolean running;
+	/** Pool for sample buffers of this session. */
+	struct sr_pool *pool;
 };
 
 SR_PRIV int sr_session_source_add_internal(struct sr_session *session,
@@ -908,12 +954,40 @@ SR_PRIV int sr_session_source_remove_pollfd(struct sr_session *session,
 SR_PRIV int sr_session_source_remove_channel(struct sr_session *session,
 		GIOChannel *channel);
 
+/** Reference counted memory, e.g. holding the sample data of packets. */
+struct sr_buffer {
+	void *data;
+	size_t size;
+	int refcount;
+	void (*release)(void *data, void *cb_data);
+	void *cb_data;
+};
+
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet);
+SR_PRIV void sr_session_transforms_compile(struct sr_session *session);
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buffer);
+SR_PRIV struct sr_buffer *sr_buffer_new(void *data, size_t size,
+		void (*release)(void *data, void *cb_data), void *cb_data);
+SR_PRIV struct sr_buffer *sr_buffer_ref(struct sr_buffer *buffer);
+SR_PRIV void sr_buffer_unref(struct sr_buffer *buffer);
 SR_PRIV int sr_sessionfile_check(const char *filename);
 SR_PRIV struct sr_dev_inst *sr_session_prepare_sdi(const char *filename,
 		struct sr_session **session);
 
+/*--- pool.c ----------------------------------------------------------------*/
+
+struct sr_pool;
+
+SR_PRIV struct sr_pool *sr_pool_new(void);
+SR_PRIV void sr_pool_destroy(struct sr_pool *pool);
+SR_PRIV void *sr_pool_alloc(struct sr_pool *pool, size_t size);
+SR_PRIV void sr_pool_release(void *mem);
+SR_PRIV struct sr_buffer *sr_pool_buffer_new(struct sr_pool *pool, size_t size);
+SR_PRIV void sr_pool_stats_get(struct sr_pool *pool,
+		struct sr_pool_stats *stats);
+
 /*--- session_file.c --------------------------------------------------------*/
 
 #if !HAVE_ZIP_DISCARD
@@ -925,6 +999,35 @@ SR_PRIV void sr_zip_discard(struct zip *archive);
 SR_PRIV GKeyFile *sr_sessionfile_read_metadata(struct zip *archive,
 			const struct zip_stat *entry);
 
+/** One chunk of a series, and the samples it holds. */
+struct sr_session_file_chunk {
+	uint64_t index;
+	uint64_t start;
+	uint64_t count;
+};
+
+/** The chunks of one "logic-1" or "analog-1-N" series, in order. */
+struct sr_session_file_series {
+	char *name;
+	GArray *chunks;
+	uint64_t num_samples;
+	unsigned int unitsize;
+	/* Summary levels, loaded on first use. */
+	uint8_t *summary;
+	unsigned int num_levels;
+	uint64_t level_offset[64];
+	uint64_t level_count[64];
+};
+
+struct sr_session_file {
+	struct zip *archive;
+	struct sr_session_file_series logic;
+	/* Analog series, keyed by channel index. */
+	GHashTable *analog;
+	/* Samples per block in the finest summary level, 0 if none. */
+	uint64_t summary_blocksize;
+};
+
 /*--- analog.c --------------------------------------------------------------*/
 
 SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
@@ -933,6 +1036,45 @@ SR_PRIV int sr_analog_init(struct sr_datafeed_analog *analog,
                            struct sr_analog_spec *spec,
                            int digits);
 
+/** Precomputed conversion of analog data in some encoding to floats. */
+struct sr_analog_float_plan {
+	void (*convert)(const uint8_t *in, float *out, size_t count,
+			float scale, float offset);
+	unsigned int unitsize;
+	float scale;
+	float offset;
+};
+
+SR_PRIV int sr_analog_float_plan_init(struct sr_analog_float_plan *plan,
+		const struct sr_analog_encoding *encoding);
+SR_PRIV void sr_analog_float_plan_run(const struct sr_analog_float_plan *plan,
+		const void *data, float *outbuf, size_t count);
+SR_PRIV int sr_rational_from_double(struct sr_rational *r, double value);
+
+/*--- conversion.c ----------------------------------------------------------*/
+
+/**
+ * Transposition of channel-major logic data, as sent by some devices, to
+ * samples. Blocks of 64 samples are transposed at once, the input holds
+ * one 64-bit word per enabled channel.
+ */
+struct sr_transpose {
+	unsigned int num_channels;
+	/** The first sample is in the MSB instead of the LSB of the words. */
+	gboolean msb_first;
+	/** The enabled channels are not channels 0 to num_channels - 1. */
+	gboolean sparse;
+	/** Use the portable kernel even if a SIMD one is built, for tests. */
+	gboolean generic;
+	/** Move packed channel bits to their channels, per byte. */
+	uint16_t scatter[2][256];
+};
+
+SR_PRIV void sr_transpose_init(struct sr_transpose *t, uint16_t channel_mask,
+		gboolean msb_first);
+SR_PRIV void sr_transpose_64(const struct sr_transpose *t,
+		const uint64_t *src, uint16_t *dst);
+
 /*--- std.c -----------------------------------------------------------------*/
 
 typedef int (*dev_close_callback)(struct sr_dev_inst *sdi);
@@ -1031,26 +1173,70 @@ SR_PRIV void sr_hexdump_free(GString *s);
 
 /*--- soft-trigger.c --------------------------------------------------------*/
 
+/** Trigger match bitmasks for one 64-bit word of logic data. */
+struct soft_trigger_mask {
+	uint64_t zero;
+	uint64_t one;
+	uint64_t rising;
+	uint64_t falling;
+	uint64_t edge;
+};
+
+/**
+ * A trigger stage, compiled into bitmasks over a logic sample.
+ *
+ * Bit (n % 64) of word (n / 64) corresponds to the logic channel with
+ * index n, i.e. samples are interpreted as little endian words.
+ */
+struct soft_trigger_stage {
+	/** One entry per 64-bit word of a sample. */
+	struct soft_trigger_mask *words;
+	/** Masks replicated across all samples in a 64-bit word. */
+	struct soft_trigger_mask lanes;
+	/** Whether this stage has any edge matches. */
+	gboolean has_edges;
+	/** Whether this stage has no matches at all (client error). */
+	gboolean empty;
+};
+
 struct soft_trigger_logic {
 	const struct sr_dev_inst *sdi;
 	const struct sr_trigger *trigger;
-	int count;
 	int unitsize;
 	int cur_stage;
+	struct soft_trigger_stage *stages;
+	int num_stages;
+	/** Number of 64-bit words needed to hold one sample. */
+	int num_words;
+	/** Samples per 64-bit word for the word-parallel scan, or 0. */
+	int lanes;
+	/** Whether prev_sample holds the last sample of the previous buffer. */
+	gboolean prev_valid;
 	uint8_t *prev_sample;
 	uint8_t *pre_trigger_buffer;
 	uint8_t *pre_trigger_head;
 	int pre_trigger_size;
 	int pre_trigger_fill;
+	/** Driver buffers covering the pre-trigger window (swap mode). */
+	GQueue *retained;
+	/** Number of bytes of logic data in the retained buffers. */
+	int retained_len;
+	/** Buffers ready to be handed back to the driver (swap mode). */
+	GQueue *spares;
 };
 
 SR_PRIV int logic_channel_unitsize(GSList *channels);
 SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
 		int pre_trigger_samples);
+SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new_swap(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples);
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *st);
 SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *st, uint8_t *buf,
 		int len, int *pre_trigger_samples);
+SR_PRIV int soft_trigger_logic_check_swap(struct soft_trigger_logic *st,
+		uint8_t **buf, size_t bufsize, int len, int *pre_trigger_samples);
 
 /*--- hardware/serial.c -----------------------------------------------------*/
 
@@ -1093,6 +1279,8 @@ SR_PRIV int serial_source_add(struct sr_session *session,
 SR_PRIV int serial_source_remove(struct sr_session *session,
 		struct sr_serial_dev_inst *serial);
 SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id);
+SR_PRIV int sr_serial_usb_bus_address(const char *port_name, int *bus,
+		int *address);
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes);
 #endif
 
@@ -1109,6 +1297,7 @@ SR_PRIV int ezusb_upload_firmware(struct sr_context *ctx, libusb_device *dev,
 /*--- hardware/usb.c --------------------------------------------------------*/
 
 #ifdef HAVE_LIBUSB_1_0
+SR_PRIV gboolean sr_usb_conn_valid(const char *conn);
 SR_PRIV GSList *sr_usb_find(libusb_context *usb_ctx, const char *conn);
 SR_PRIV int sr_usb_open(libusb_context *usb_ctx, struct sr_usb_dev_inst *usb);
 SR_PRIV void sr_usb_close(struct sr_usb_dev_inst *usb);
@@ -1118,6 +1307,91 @@ SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx
 SR_PRIV int usb_get_port_path(libusb_device *dev, char *path, int path_len);
 SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 		const char *manufacturer, const char *product);
+
+/** Largest transfer size a user may select for a transfer ring. */
+#define SR_USB_RING_MAX_TRANSFER_SIZE (4 * 1024 * 1024)
+/** Largest number of transfers in a transfer ring. */
+#define SR_USB_RING_MAX_TRANSFERS 64
+
+/**
+ * A set of bulk transfers kept in flight during an acquisition, sized
+ * from the device's data rate.
+ */
+struct sr_usb_ring {
+	/** User override of the transfer size in bytes, 0 = automatic. */
+	uint64_t transfer_size;
+	/** User override of the number of transfers, 0 = automatic. */
+	uint64_t num_transfers;
+	/** Transfer size in use, as computed by sr_usb_ring_setup(). */
+	size_t size;
+	/** Number of transfers in use. */
+	unsigned int count;
+	/** Timeout in ms for the transfers and the USB event source. */
+	unsigned int timeout;
+	/**
+	 * Telemetry of the current acquisition. In event thread mode, both
+	 * threads update it with the mutex held.
+	 */
+	uint64_t completed;
+	uint64_t short_packets;
+	uint64_t dropped;
+	uint64_t latency_max;
+	uint64_t latency_total;
+	/** When each transfer came back, 0 once it is resubmitted. */
+	struct {
+		const struct libusb_transfer *transfer;
+		int64_t completed_at;
+	} slots[SR_USB_RING_MAX_TRANSFERS];
+	/** Event thread mode, see sr_usb_ring_thread_init(). */
+	int stopping;
+	struct sr_usb_queue *filled;
+	struct sr_usb_queue *spare;
+	GMutex mutex;
+};
+
+/** Single producer, single consumer queue of pointers. */
+struct sr_usb_queue {
+	void **slots;
+	unsigned int size;
+	int head;
+	int tail;
+	/** Main context to wake up when an item is pushed, or NULL. */
+	GMainContext *context;
+};
+
+/** Data of a completed transfer, handed from the USB event thread to
+ * the session thread. */
+struct sr_usb_chunk {
+	/** The transfer itself, if it was not resubmitted. */
+	struct libusb_transfer *transfer;
+	unsigned char *data;
+	int length;
+};
+
+SR_PRIV void sr_usb_ring_setup(struct sr_usb_ring *ring,
+		uint64_t bytes_per_sec, size_t align, unsigned int buffered_ms,
+		unsigned int max_transfers);
+SR_PRIV void sr_usb_ring_completed(struct sr_usb_ring *ring,
+		const struct libusb_transfer *transfer);
+SR_PRIV int sr_usb_ring_resubmit(struct sr_usb_ring *ring,
+		struct libusb_transfer *transfer);
+SR_PRIV void sr_usb_ring_report(const struct sr_dev_inst *sdi,
+		const struct sr_usb_ring *ring);
+SR_PRIV int usb_thread_source_add(struct sr_session *session,
+		struct sr_context *ctx, int timeout, struct sr_usb_queue *queue,
+		sr_receive_data_callback cb, void *cb_data);
+SR_PRIV struct sr_usb_queue *sr_usb_queue_new(unsigned int capacity);
+SR_PRIV void sr_usb_queue_free(struct sr_usb_queue *queue);
+SR_PRIV gboolean sr_usb_queue_push(struct sr_usb_queue *queue, void *item);
+SR_PRIV void *sr_usb_queue_pop(struct sr_usb_queue *queue);
+SR_PRIV gboolean sr_usb_queue_is_empty(struct sr_usb_queue *queue);
+SR_PRIV int sr_usb_ring_thread_init(struct sr_usb_ring *ring);
+SR_PRIV void sr_usb_ring_thread_cleanup(struct sr_usb_ring *ring);
+SR_PRIV void sr_usb_ring_hand_off(struct sr_usb_ring *ring,
+		struct libusb_transfer *transfer);
+SR_PRIV struct sr_usb_chunk *sr_usb_ring_next(struct sr_usb_ring *ring);
+SR_PRIV void sr_usb_ring_release(struct sr_usb_ring *ring,
+		struct sr_usb_chunk *chunk);
 #endif
 
 
@@ -1174,6 +1448,25 @@ SR_PRIV int sr_modbus_write_multiple_registers(struct sr_modbus_dev_inst*modbus,
 SR_PRIV int sr_modbus_close(struct sr_modbus_dev_inst *modbus);
 SR_PRIV void sr_modbus_free(struct sr_modbus_dev_inst *modbus);
 
+/*--- dmm/framing.c ---------------------------------------------------------*/
+
+/**
+ * Where a DMM protocol's packets can start in a byte stream: a byte at a
+ * fixed offset which has the same value in every valid packet.
+ */
+struct sr_dmm_framing {
+	/** Offset of the sync byte, negative ones count from the packet's end. */
+	int sync_offset;
+	/** Fixed bits of the sync byte, 0 if there is no sync byte. */
+	uint8_t sync_mask;
+	/** Value of the fixed bits. */
+	uint8_t sync_value;
+};
+
+SR_PRIV const uint8_t *sr_dmm_packet_find(const struct sr_dmm_framing *framing,
+		const uint8_t *buf, size_t len, size_t packet_size,
+		gboolean (*packet_valid)(const uint8_t *));
+
 /*--- hardware/dmm/es519xx.c ------------------------------------------------*/
 
 /**
@@ -1198,6 +1491,7 @@ struct es519xx_info {
 	int digits;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_es519xx_framing;
 SR_PRIV gboolean sr_es519xx_2400_11b_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_es519xx_2400_11b_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -1233,6 +1527,7 @@ struct fs9922_info {
 	int bargraph_sign, bargraph_value;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_fs9922_framing;
 SR_PRIV gboolean sr_fs9922_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_fs9922_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -1249,6 +1544,7 @@ struct fs9721_info {
 	gboolean is_c2c1_11, is_c2c1_10, is_c2c1_01, is_c2c1_00, is_sign;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_fs9721_framing;
 SR_PRIV gboolean sr_fs9721_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_fs9721_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -1269,6 +1565,7 @@ struct ms8250d_info {
 	gboolean is_ncv, is_min, is_max, is_sign, is_autotimer;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_ms8250d_framing;
 SR_PRIV gboolean sr_ms8250d_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_ms8250d_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -1285,6 +1582,7 @@ struct dtm0660_info {
 	gboolean is_minmax, is_max, is_sign;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_dtm0660_framing;
 SR_PRIV gboolean sr_dtm0660_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_dtm0660_parse(const uint8_t *buf, float *floatval,
 			struct sr_datafeed_analog *analog, void *info);
@@ -1296,6 +1594,7 @@ SR_PRIV int sr_dtm0660_parse(const uint8_t *buf, float *floatval,
 /* Dummy info struct. The parser does not use it. */
 struct m2110_info { int dummy; };
 
+SR_PRIV extern const struct sr_dmm_framing sr_m2110_framing;
 SR_PRIV gboolean sr_m2110_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_m2110_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -1317,6 +1616,7 @@ struct metex14_info {
 #ifdef HAVE_LIBSERIALPORT
 SR_PRIV int sr_metex14_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+SR_PRIV extern const struct sr_dmm_framing sr_metex14_framing;
 SR_PRIV gboolean sr_metex14_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_metex14_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -1331,6 +1631,7 @@ SR_PRIV int sr_metex14_4packets_parse(const uint8_t *buf, float *floatval,
 /* Dummy info struct. The parser does not use it. */
 struct rs9lcd_info { int dummy; };
 
+SR_PRIV extern const struct sr_dmm_framing sr_rs9lcd_framing;
 SR_PRIV gboolean sr_rs9lcd_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_rs9lcd_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -1342,6 +1643,7 @@ SR_PRIV int sr_rs9lcd_parse(const uint8_t *buf, float *floatval,
 /* Dummy info struct. The parser does not use it. */
 struct bm25x_info { int dummy; };
 
+SR_PRIV extern const struct sr_dmm_framing sr_bm25x_framing;
 SR_PRIV gboolean sr_brymen_bm25x_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_brymen_bm25x_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
@@ -1357,6 +1659,7 @@ struct ut71x_info {
 	gboolean is_auto, is_manual, is_sign, is_power, is_loop_current;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_ut71x_framing;
 SR_PRIV gboolean sr_ut71x_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_ut71x_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -1378,6 +1681,7 @@ struct vc870_info {
 	gboolean is_frequency, is_dual_display, is_auto;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_vc870_framing;
 SR_PRIV gboolean sr_vc870_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_vc870_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -1393,6 +1697,7 @@ struct vc96_info {
 	gboolean is_unitless;
 };
 
+SR_PRIV extern const struct sr_dmm_framing sr_vc96_framing;
 SR_PRIV gboolean sr_vc96_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_vc96_parse(const uint8_t *buf, float *floatval,
 		struct sr_datafeed_analog *analog, void *info);
@@ -1448,6 +1753,7 @@ struct asycii_info {
 #ifdef HAVE_LIBSERIALPORT
 SR_PRIV int sr_asycii_packet_request(struct sr_serial_dev_inst *serial);
 #endif
+SR_PRIV extern const struct sr_dmm_framing sr_asycii_framing;
 SR_PRIV gboolean sr_asycii_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_asycii_parse(const uint8_t *buf, float *floatval,
 			    struct sr_datafeed_analog *analog, void *info);
@@ -1489,6 +1795,7 @@ struct eev121gw_info {
 };
 
 extern SR_PRIV const char *eev121gw_channel_formats[];
+SR_PRIV extern const struct sr_dmm_framing sr_eev121gw_framing;
 SR_PRIV gboolean sr_eev121gw_packet_valid(const uint8_t *buf);
 SR_PRIV int sr_eev121gw_parse(const uint8_t *buf, float *floatval,
 			     struct sr_datafeed_analog *analog, void *info);
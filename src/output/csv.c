@@ -307,7 +307,8 @@ static GString *gen_header(const struct sr_output *o,
  * the first packet.
  */
 static void process_analog(struct context *ctx,
-			   const struct sr_datafeed_analog *analog)
+			   const struct sr_datafeed_analog *analog,
+			   struct sr_pool *pool)
 {
 	int ret;
 	size_t num_rcvd_ch, num_have_ch;
@@ -332,7 +333,13 @@ static void process_analog(struct context *ctx,
 	num_rcvd_ch = g_slist_length(meaning->channels);
 	ctx->channels_seen += num_rcvd_ch;
 	sr_dbg("Processing packet of %zu analog channels", num_rcvd_ch);
-	fdata = g_malloc(analog->num_samples * num_rcvd_ch * sizeof(float));
+	/* Scratch space, recycled through the session's pool. */
+	fdata = sr_pool_alloc(pool,
+		analog->num_samples * num_rcvd_ch * sizeof(float));
+	if (!fdata) {
+		sr_err("Analog conversion buffer malloc failed.");
+		return;
+	}
 	if ((ret = sr_analog_to_float(analog, fdata)) != SR_OK)
 		sr_warn("Problems converting data to floating point values.");
 
@@ -358,7 +365,7 @@ static void process_analog(struct context *ctx,
 		}
 		idx_send++;
 	}
-	g_free(fdata);
+	sr_pool_release(fdata);
 }
 
 /*
@@ -582,7 +589,8 @@ static int receive(const struct sr_output *o,
 		process_logic(ctx, packet->payload);
 		break;
 	case SR_DF_ANALOG:
-		process_analog(ctx, packet->payload);
+		process_analog(ctx, packet->payload,
+			o->sdi->session ? o->sdi->session->pool : NULL);
 		break;
 	case SR_DF_FRAME_BEGIN:
 		*out = g_string_new(ctx->frame);
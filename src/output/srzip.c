@@ -24,25 +24,110 @@
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <zip.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
 
 #define LOG_PREFIX "output/srzip"
 
+#define DEFAULT_CHUNKSIZE (4 * 1024 * 1024)
+#define DEFAULT_LEVEL 6
+
+/*
+ * Samples per block in the finest summary level. Every following level
+ * doubles the block size, up to a single block covering all samples.
+ */
+#define SUMMARY_BLOCKSIZE 1024
+
+/* Data of one "logic-1" or "analog-1-N" series, collected into chunks. */
+struct chunk_stream {
+	char *basename;
+	uint8_t *buf;
+	size_t len;
+	size_t size;
+	unsigned int next_chunk_num;
+	/* Logic unit size, 0 for analog data. */
+	unsigned int unitsize;
+	/* Last logic sample of the previous chunk, for the summary. */
+	uint8_t *last;
+	/* Summary blocks of all chunks, finest level first. */
+	GByteArray *summary;
+};
+
+/* A completed chunk, handed to the worker pool. */
+struct chunk_job {
+	char *name;
+	struct chunk_stream *stream;
+	uint8_t *buf;
+	size_t len;
+	uint8_t *prev;
+	/* Summary blocks of this chunk, computed by the worker. */
+	uint8_t *summary;
+	size_t summary_len;
+	/* Where the worker put the (compressed) data in the spill file. */
+	uint64_t offset;
+	uint64_t comp_len;
+	uint32_t crc;
+	gboolean deflated;
+	int ret;
+};
+
 struct out_context {
 	gboolean zip_created;
 	uint64_t samplerate;
 	char *filename;
 	gint first_analog_index;
 	gint *analog_index_map;
+
+	/*
+	 * Streaming mode: the archive stays open for the whole acquisition.
+	 * Completed chunks go to a spill file next to the output file and
+	 * are added to the archive as ranges of it, libzip only reads them
+	 * when the archive is closed at the end.
+	 */
+	gboolean streaming;
+	uint64_t chunksize;
+	struct zip *archive;
+	GKeyFile *meta;
+	char *spillname;
+	FILE *spill;
+	uint64_t spill_pos;
+	int unitsize;
+	struct chunk_stream logic;
+	struct chunk_stream *analog;
+	guint num_analog;
+
+	/*
+	 * Completed chunks are compressed and written to the spill file by
+	 * a pool of worker threads, so receive() only has to queue them.
+	 * At most max_queued chunks can be pending, after that receive()
+	 * blocks until a worker is done.
+	 */
+	int level;
+	guint workers;
+	gboolean summary;
+	GThreadPool *pool;
+	GSList *jobs;
+	GMutex mutex;
+	GCond cond;
+	GMutex spill_mutex;
+	guint queued;
+	guint max_queued;
+
+	/* Back-pressure statistics, logged when the archive is written. */
+	guint max_depth;
+	uint64_t stalls;
+	gint64 stall_time;
+	uint64_t raw_bytes;
+	uint64_t comp_bytes;
 };
 
 static int init(struct sr_output *o, GHashTable *options)
 {
 	struct out_context *outc;
 
-	(void)options;
-
 	if (!o->filename || o->filename[0] == '\0') {
 		sr_info("srzip output module requires a file name, cannot save.");
 		return SR_ERR_ARG;
@@ -50,11 +135,711 @@ static int init(struct sr_output *o, GHashTable *options)
 
 	outc = g_malloc0(sizeof(struct out_context));
 	outc->filename = g_strdup(o->filename);
+	outc->streaming = g_variant_get_boolean(
+		g_hash_table_lookup(options, "streaming"));
+	outc->chunksize = g_variant_get_uint64(
+		g_hash_table_lookup(options, "chunksize"));
+	if (!outc->chunksize)
+		outc->chunksize = DEFAULT_CHUNKSIZE;
+	/* zlib takes 32-bit lengths. */
+	outc->chunksize = MIN(outc->chunksize, G_MAXINT32);
+	outc->level = g_variant_get_int32(g_hash_table_lookup(options, "level"));
+	if (outc->level < 0 || outc->level > 9) {
+		sr_err("Invalid compression level %d.", outc->level);
+		g_free(outc->filename);
+		g_free(outc);
+		return SR_ERR_ARG;
+	}
+	outc->workers = g_variant_get_uint32(
+		g_hash_table_lookup(options, "workers"));
+	if (!outc->workers) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		outc->workers = g_get_num_processors();
+#else
+		outc->workers = 2;
+#endif
+	}
+	outc->max_queued = 2 * outc->workers;
+	outc->summary = g_variant_get_boolean(
+		g_hash_table_lookup(options, "summary"));
+	if (!outc->streaming && (outc->chunksize != DEFAULT_CHUNKSIZE
+			|| outc->level != DEFAULT_LEVEL || outc->summary
+			|| g_variant_get_uint32(g_hash_table_lookup(options,
+				"workers"))))
+		sr_warn("The chunksize, level, workers and summary options "
+			"only apply to the streaming mode, ignoring them.");
+	g_mutex_init(&outc->mutex);
+	g_cond_init(&outc->cond);
+	g_mutex_init(&outc->spill_mutex);
 	o->priv = outc;
 
 	return SR_OK;
 }
 
+#ifdef HAVE_ZLIB
+/* Raw deflate, as stored in zip archives. */
+static uint8_t *deflate_chunk(const uint8_t *buf, size_t len, int level,
+		size_t *comp_len)
+{
+	z_stream zs;
+	uint8_t *comp;
+	size_t bound;
+
+	memset(&zs, 0, sizeof(zs));
+	if (deflateInit2(&zs, level, Z_DEFLATED, -MAX_WBITS, 8,
+			Z_DEFAULT_STRATEGY) != Z_OK)
+		return NULL;
+
+	bound = deflateBound(&zs, len);
+	if (!(comp = g_try_malloc(bound))) {
+		deflateEnd(&zs);
+		return NULL;
+	}
+
+	zs.next_in = (Bytef *)buf;
+	zs.avail_in = len;
+	zs.next_out = comp;
+	zs.avail_out = bound;
+	if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+		deflateEnd(&zs);
+		g_free(comp);
+		return NULL;
+	}
+	*comp_len = zs.total_out;
+	deflateEnd(&zs);
+
+	return comp;
+}
+#endif
+
+/*
+ * Summary of logic data: per block, a mask of the bits that changed from
+ * any sample to the next. The change into the first sample of a block is
+ * accounted to that block.
+ */
+static void logic_summary(const uint8_t *data, size_t count,
+		unsigned int unitsize, const uint8_t *prev, uint8_t *out)
+{
+	uint64_t v, last, acc;
+	size_t i, j;
+	unsigned int k;
+
+	if (!prev)
+		prev = data;
+
+	if (unitsize <= sizeof(uint64_t)) {
+		v = last = 0;
+		memcpy(&last, prev, unitsize);
+		for (i = 0; i < count; i += SUMMARY_BLOCKSIZE) {
+			acc = 0;
+			for (j = i; j < MIN(count, i + SUMMARY_BLOCKSIZE); j++) {
+				memcpy(&v, data + j * unitsize, unitsize);
+				acc |= v ^ last;
+				last = v;
+			}
+			memcpy(out, &acc, unitsize);
+			out += unitsize;
+		}
+		return;
+	}
+
+	for (i = 0; i < count; i += SUMMARY_BLOCKSIZE) {
+		memset(out, 0, unitsize);
+		for (j = i; j < MIN(count, i + SUMMARY_BLOCKSIZE); j++) {
+			for (k = 0; k < unitsize; k++)
+				out[k] |= data[j * unitsize + k] ^ prev[k];
+			prev = data + j * unitsize;
+		}
+		out += unitsize;
+	}
+}
+
+/* Summary of analog data: the minimum and maximum of every block. */
+static void analog_summary(const float *data, size_t count, float *out)
+{
+	float min, max;
+	size_t i, j;
+
+	for (i = 0; i < count; i += SUMMARY_BLOCKSIZE) {
+		min = max = data[i];
+		for (j = i + 1; j < MIN(count, i + SUMMARY_BLOCKSIZE); j++) {
+			min = MIN(min, data[j]);
+			max = MAX(max, data[j]);
+		}
+		*out++ = min;
+		*out++ = max;
+	}
+}
+
+static void chunk_job_summary(struct chunk_job *job)
+{
+	unsigned int unitsize;
+	size_t count, blocks;
+
+	unitsize = job->stream->unitsize;
+	count = job->len / (unitsize ? unitsize : sizeof(float));
+	blocks = (count + SUMMARY_BLOCKSIZE - 1) / SUMMARY_BLOCKSIZE;
+	if (unitsize) {
+		job->summary_len = blocks * unitsize;
+		job->summary = g_malloc(job->summary_len);
+		logic_summary(job->buf, count, unitsize, job->prev,
+			job->summary);
+	} else {
+		job->summary_len = blocks * 2 * sizeof(float);
+		job->summary = g_malloc(job->summary_len);
+		analog_summary((const float *)job->buf, count,
+			(float *)job->summary);
+	}
+}
+
+/* Worker thread: compress one chunk and append it to the spill file. */
+static void chunk_job_run(gpointer data, gpointer user_data)
+{
+	struct chunk_job *job;
+	struct out_context *outc;
+	uint8_t *comp, *out;
+	size_t out_len;
+#ifdef HAVE_ZLIB
+	size_t comp_len;
+#endif
+
+	job = data;
+	outc = user_data;
+
+	if (outc->summary)
+		chunk_job_summary(job);
+
+	comp = NULL;
+	out = job->buf;
+	out_len = job->len;
+#ifdef HAVE_ZLIB
+	if (outc->level > 0)
+		comp = deflate_chunk(job->buf, job->len, outc->level, &comp_len);
+	/* Incompressible chunks are left to libzip. */
+	if (comp && comp_len < job->len) {
+		job->crc = crc32(0, job->buf, job->len);
+		job->deflated = TRUE;
+		out = comp;
+		out_len = comp_len;
+	}
+#endif
+
+	g_mutex_lock(&outc->spill_mutex);
+	job->offset = outc->spill_pos;
+	job->comp_len = out_len;
+	if (fwrite(out, 1, out_len, outc->spill) != out_len) {
+		sr_err("Failed to write to '%s': %s", outc->spillname,
+			g_strerror(errno));
+		job->ret = SR_ERR;
+	} else {
+		outc->spill_pos += out_len;
+	}
+	g_mutex_unlock(&outc->spill_mutex);
+
+	g_free(comp);
+	g_free(job->buf);
+	job->buf = NULL;
+
+	g_mutex_lock(&outc->mutex);
+	outc->queued--;
+	outc->comp_bytes += out_len;
+	g_cond_signal(&outc->cond);
+	g_mutex_unlock(&outc->mutex);
+}
+
+static void chunk_job_free(gpointer data)
+{
+	struct chunk_job *job;
+
+	job = data;
+	g_free(job->name);
+	g_free(job->buf);
+	g_free(job->prev);
+	g_free(job->summary);
+	g_free(job);
+}
+
+/* State of a libzip source returning a chunk that is already deflated. */
+struct deflated_source {
+	char *filename;
+	uint64_t offset;
+	uint64_t comp_len;
+	uint64_t size;
+	uint32_t crc;
+	GIOChannel *channel;
+	uint64_t remaining;
+};
+
+static zip_int64_t deflated_source_cb(void *userdata, void *data,
+		zip_uint64_t len, enum zip_source_cmd cmd)
+{
+	struct deflated_source *ds;
+	struct zip_stat *st;
+	GIOStatus status;
+	gsize count;
+	int *err;
+
+	ds = userdata;
+
+	switch (cmd) {
+	case ZIP_SOURCE_OPEN:
+		ds->channel = g_io_channel_new_file(ds->filename, "r", NULL);
+		if (!ds->channel)
+			return -1;
+		g_io_channel_set_encoding(ds->channel, NULL, NULL);
+		if (g_io_channel_seek_position(ds->channel, ds->offset,
+				G_SEEK_SET, NULL) != G_IO_STATUS_NORMAL)
+			return -1;
+		ds->remaining = ds->comp_len;
+		return 0;
+	case ZIP_SOURCE_READ:
+		len = MIN(len, ds->remaining);
+		if (!len)
+			return 0;
+		status = g_io_channel_read_chars(ds->channel, data, len,
+			&count, NULL);
+		if (status == G_IO_STATUS_ERROR)
+			return -1;
+		ds->remaining -= count;
+		return count;
+	case ZIP_SOURCE_CLOSE:
+		if (ds->channel)
+			g_io_channel_unref(ds->channel);
+		ds->channel = NULL;
+		return 0;
+	case ZIP_SOURCE_STAT:
+		/* Reporting the compression method makes libzip copy as is. */
+		st = data;
+		zip_stat_init(st);
+		st->size = ds->size;
+		st->comp_size = ds->comp_len;
+		st->comp_method = ZIP_CM_DEFLATE;
+		st->crc = ds->crc;
+		st->valid |= ZIP_STAT_SIZE | ZIP_STAT_COMP_SIZE |
+			ZIP_STAT_COMP_METHOD | ZIP_STAT_CRC;
+		return sizeof(*st);
+	case ZIP_SOURCE_ERROR:
+		err = data;
+		err[0] = ZIP_ER_READ;
+		err[1] = 0;
+		return 2 * sizeof(int);
+	case ZIP_SOURCE_FREE:
+		if (ds->channel)
+			g_io_channel_unref(ds->channel);
+		g_free(ds->filename);
+		g_free(ds);
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+static int stream_init(const struct sr_output *o)
+{
+	struct out_context *outc;
+	GError *error;
+	guint i;
+
+	outc = o->priv;
+
+	outc->spillname = g_strconcat(outc->filename, ".tmp", NULL);
+	if (!(outc->spill = g_fopen(outc->spillname, "wb"))) {
+		sr_err("Cannot create '%s': %s", outc->spillname,
+			g_strerror(errno));
+		return SR_ERR;
+	}
+	outc->spill_pos = 0;
+
+	error = NULL;
+	outc->pool = g_thread_pool_new(chunk_job_run, outc, outc->workers,
+		FALSE, &error);
+	if (!outc->pool) {
+		sr_err("Cannot create worker threads: %s", error->message);
+		g_error_free(error);
+		return SR_ERR;
+	}
+
+	outc->logic.basename = g_strdup("logic-1");
+	outc->logic.next_chunk_num = 1;
+	outc->logic.summary = g_byte_array_new();
+	outc->analog = g_malloc0(sizeof(struct chunk_stream) * outc->num_analog);
+	for (i = 0; i < outc->num_analog; i++) {
+		outc->analog[i].basename = g_strdup_printf("analog-1-%u",
+			outc->first_analog_index + i);
+		outc->analog[i].next_chunk_num = 1;
+		outc->analog[i].summary = g_byte_array_new();
+	}
+
+	return SR_OK;
+}
+
+/* Queue the chunk buffer for the workers. This takes ownership of it. */
+static int stream_flush(struct out_context *outc, struct chunk_stream *chunk)
+{
+	struct chunk_job *job;
+	gint64 start;
+
+	if (!chunk->len)
+		return SR_OK;
+
+	job = g_malloc0(sizeof(struct chunk_job));
+	job->name = g_strdup_printf("%s-%u", chunk->basename,
+		chunk->next_chunk_num++);
+	job->stream = chunk;
+	job->buf = chunk->buf;
+	job->len = chunk->len;
+	if (outc->summary && chunk->unitsize) {
+		/* The worker needs the sample before the chunk. */
+		job->prev = chunk->last;
+		chunk->last = g_memdup(chunk->buf + chunk->len - chunk->unitsize,
+			chunk->unitsize);
+	}
+	chunk->buf = NULL;
+	chunk->len = 0;
+	outc->jobs = g_slist_prepend(outc->jobs, job);
+
+	g_mutex_lock(&outc->mutex);
+	if (outc->queued >= outc->max_queued) {
+		outc->stalls++;
+		start = g_get_monotonic_time();
+		while (outc->queued >= outc->max_queued)
+			g_cond_wait(&outc->cond, &outc->mutex);
+		outc->stall_time += g_get_monotonic_time() - start;
+	}
+	outc->queued++;
+	outc->max_depth = MAX(outc->max_depth, outc->queued);
+	outc->raw_bytes += job->len;
+	g_mutex_unlock(&outc->mutex);
+
+	g_thread_pool_push(outc->pool, job, NULL);
+
+	return SR_OK;
+}
+
+/*
+ * Make sure the chunk buffer exists. Its size is a multiple of unitsize,
+ * and of the summary block size if summaries are written, so the workers
+ * can compute the summary of every chunk on its own.
+ */
+static int stream_buf_alloc(struct out_context *outc,
+		struct chunk_stream *chunk, size_t unitsize)
+{
+	if (chunk->buf)
+		return SR_OK;
+
+	if (outc->summary)
+		unitsize *= SUMMARY_BLOCKSIZE;
+	chunk->size = outc->chunksize - outc->chunksize % unitsize;
+	if (!chunk->size)
+		chunk->size = unitsize;
+	if (!(chunk->buf = g_try_malloc(chunk->size))) {
+		sr_err("Chunk buffer malloc failed.");
+		return SR_ERR_MALLOC;
+	}
+
+	return SR_OK;
+}
+
+static int stream_append_logic(const struct sr_output *o,
+		const struct sr_datafeed_logic *logic)
+{
+	struct out_context *outc;
+	struct chunk_stream *chunk;
+	const uint8_t *data;
+	size_t len, n;
+	int ret;
+
+	outc = o->priv;
+	chunk = &outc->logic;
+
+	if (!outc->unitsize)
+		outc->unitsize = chunk->unitsize = logic->unitsize;
+	if (logic->unitsize != outc->unitsize) {
+		sr_err("Unit size changed from %d to %d.", outc->unitsize,
+			logic->unitsize);
+		return SR_ERR_DATA;
+	}
+
+	data = logic->data;
+	len = logic->length - logic->length % logic->unitsize;
+	while (len) {
+		if ((ret = stream_buf_alloc(outc, chunk, logic->unitsize)) != SR_OK)
+			return ret;
+		n = MIN(len, chunk->size - chunk->len);
+		memcpy(chunk->buf + chunk->len, data, n);
+		chunk->len += n;
+		if (chunk->len == chunk->size &&
+		    (ret = stream_flush(outc, chunk)) != SR_OK)
+			return ret;
+		data += n;
+		len -= n;
+	}
+
+	return SR_OK;
+}
+
+static int stream_append_analog(const struct sr_output *o,
+		const struct sr_datafeed_analog *analog, unsigned int index)
+{
+	struct out_context *outc;
+	struct chunk_stream *chunk;
+	struct sr_analog_float_plan plan;
+	const uint8_t *data;
+	size_t count, n;
+	int ret;
+
+	outc = o->priv;
+	chunk = &outc->analog[index];
+
+	if ((ret = sr_analog_float_plan_init(&plan, analog->encoding)) != SR_OK)
+		return ret;
+
+	/* Convert straight into the chunk buffer. */
+	data = analog->data;
+	count = analog->num_samples;
+	while (count) {
+		if ((ret = stream_buf_alloc(outc, chunk, sizeof(float))) != SR_OK)
+			return ret;
+		n = MIN(count, (chunk->size - chunk->len) / sizeof(float));
+		sr_analog_float_plan_run(&plan, data,
+			(float *)(chunk->buf + chunk->len), n);
+		chunk->len += n * sizeof(float);
+		if (chunk->len == chunk->size &&
+		    (ret = stream_flush(outc, chunk)) != SR_OK)
+			return ret;
+		data += n * plan.unitsize;
+		count -= n;
+	}
+
+	return SR_OK;
+}
+
+/* Wait for the workers to finish all queued chunks. */
+static void stream_drain(struct out_context *outc)
+{
+	if (outc->pool)
+		g_thread_pool_free(outc->pool, FALSE, TRUE);
+	outc->pool = NULL;
+}
+
+static void stream_free(struct out_context *outc)
+{
+	guint i;
+
+	stream_drain(outc);
+	g_slist_free_full(outc->jobs, chunk_job_free);
+	outc->jobs = NULL;
+
+	if (outc->archive)
+		zip_discard(outc->archive);
+	outc->archive = NULL;
+	if (outc->spill)
+		fclose(outc->spill);
+	outc->spill = NULL;
+	if (outc->spillname)
+		g_unlink(outc->spillname);
+	g_free(outc->spillname);
+	outc->spillname = NULL;
+	if (outc->meta)
+		g_key_file_free(outc->meta);
+	outc->meta = NULL;
+
+	g_free(outc->logic.basename);
+	g_free(outc->logic.buf);
+	g_free(outc->logic.last);
+	if (outc->logic.summary)
+		g_byte_array_free(outc->logic.summary, TRUE);
+	memset(&outc->logic, 0, sizeof(outc->logic));
+	for (i = 0; outc->analog && i < outc->num_analog; i++) {
+		g_free(outc->analog[i].basename);
+		g_free(outc->analog[i].buf);
+		g_byte_array_free(outc->analog[i].summary, TRUE);
+	}
+	g_free(outc->analog);
+	outc->analog = NULL;
+}
+
+/* Add the chunks written by the workers to the archive, in order. */
+static int stream_add_chunks(struct out_context *outc)
+{
+	struct chunk_job *job;
+	struct deflated_source *ds;
+	struct zip_source *src;
+	GSList *l;
+
+	outc->jobs = g_slist_reverse(outc->jobs);
+	for (l = outc->jobs; l; l = l->next) {
+		job = l->data;
+		if (job->ret != SR_OK)
+			return job->ret;
+
+		if (job->summary)
+			g_byte_array_append(job->stream->summary,
+				job->summary, job->summary_len);
+
+		if (job->deflated) {
+			ds = g_malloc0(sizeof(struct deflated_source));
+			ds->filename = g_strdup(outc->spillname);
+			ds->offset = job->offset;
+			ds->comp_len = job->comp_len;
+			ds->size = job->len;
+			ds->crc = job->crc;
+			src = zip_source_function(outc->archive,
+				deflated_source_cb, ds);
+			if (!src) {
+				g_free(ds->filename);
+				g_free(ds);
+			}
+		} else {
+			src = zip_source_file(outc->archive, outc->spillname,
+				job->offset, job->comp_len);
+		}
+		if (!src) {
+			sr_err("Failed to create zip source: %s",
+				zip_strerror(outc->archive));
+			return SR_ERR;
+		}
+
+		if (zip_add(outc->archive, job->name, src) < 0) {
+			sr_err("Failed to add chunk '%s': %s", job->name,
+				zip_strerror(outc->archive));
+			zip_source_free(src);
+			return SR_ERR;
+		}
+	}
+
+	return SR_OK;
+}
+
+/*
+ * Append the coarser summary levels to the finest one, each combining
+ * pairs of blocks of the previous level, and add the result to the
+ * archive as "summary-<series>".
+ */
+static int stream_add_summary(struct out_context *outc,
+		struct chunk_stream *chunk)
+{
+	struct zip_source *src;
+	const uint8_t *a, *b;
+	uint8_t *out;
+	float *f;
+	size_t recsize, count, start, i, k;
+	char *name;
+	int64_t ret;
+
+	if (!chunk->summary->len)
+		return SR_OK;
+
+	recsize = chunk->unitsize ? chunk->unitsize : 2 * sizeof(float);
+	start = 0;
+	count = chunk->summary->len / recsize;
+	while (count > 1) {
+		g_byte_array_set_size(chunk->summary,
+			chunk->summary->len + (count + 1) / 2 * recsize);
+		for (i = 0; i < count; i += 2) {
+			a = chunk->summary->data + (start + i) * recsize;
+			b = (i + 1 < count) ? a + recsize : a;
+			out = chunk->summary->data +
+				(start + count + i / 2) * recsize;
+			if (chunk->unitsize) {
+				for (k = 0; k < recsize; k++)
+					out[k] = a[k] | b[k];
+			} else {
+				f = (float *)out;
+				f[0] = MIN(((const float *)a)[0], ((const float *)b)[0]);
+				f[1] = MAX(((const float *)a)[1], ((const float *)b)[1]);
+			}
+		}
+		start += count;
+		count = (count + 1) / 2;
+	}
+
+	name = g_strdup_printf("summary-%s", chunk->basename);
+	src = zip_source_buffer(outc->archive, chunk->summary->data,
+		chunk->summary->len, FALSE);
+	ret = zip_add(outc->archive, name, src);
+	if (ret < 0) {
+		sr_err("Failed to add '%s': %s", name,
+			zip_strerror(outc->archive));
+		zip_source_free(src);
+	}
+	g_free(name);
+
+	return ret < 0 ? SR_ERR : SR_OK;
+}
+
+/* Write out the remaining data, the metadata and the central directory. */
+static int stream_finish(const struct sr_output *o)
+{
+	struct out_context *outc;
+	struct zip_source *metasrc;
+	char *metabuf;
+	gsize metalen;
+	guint i;
+	int ret;
+
+	outc = o->priv;
+
+	ret = stream_flush(outc, &outc->logic);
+	for (i = 0; ret == SR_OK && i < outc->num_analog; i++)
+		ret = stream_flush(outc, &outc->analog[i]);
+	stream_drain(outc);
+	if (ret == SR_OK && fflush(outc->spill)) {
+		sr_err("Failed to write to '%s': %s", outc->spillname,
+			g_strerror(errno));
+		ret = SR_ERR;
+	}
+	if (ret == SR_OK)
+		ret = stream_add_chunks(outc);
+	if (ret == SR_OK && outc->summary) {
+		ret = stream_add_summary(outc, &outc->logic);
+		for (i = 0; ret == SR_OK && i < outc->num_analog; i++)
+			ret = stream_add_summary(outc, &outc->analog[i]);
+		g_key_file_set_integer(outc->meta, "device 1",
+			"summary blocksize", SUMMARY_BLOCKSIZE);
+	}
+	if (ret != SR_OK) {
+		stream_free(outc);
+		return ret;
+	}
+
+	sr_info("Queued %" PRIu64 " bytes, %" PRIu64 " bytes after "
+		"compression. Queue depth max %u of %u, stalled %" PRIu64
+		" times for %" G_GINT64_FORMAT " ms total.", outc->raw_bytes,
+		outc->comp_bytes, outc->max_depth, outc->max_queued,
+		outc->stalls, outc->stall_time / 1000);
+
+	if (outc->unitsize)
+		g_key_file_set_integer(outc->meta, "device 1", "unitsize",
+			outc->unitsize);
+	metabuf = g_key_file_to_data(outc->meta, &metalen, NULL);
+	metasrc = zip_source_buffer(outc->archive, metabuf, metalen, FALSE);
+	if (zip_add(outc->archive, "metadata", metasrc) < 0) {
+		sr_err("Error saving metadata into zipfile: %s",
+			zip_strerror(outc->archive));
+		zip_source_free(metasrc);
+		g_free(metabuf);
+		stream_free(outc);
+		return SR_ERR;
+	}
+
+	if (outc->spill)
+		fclose(outc->spill);
+	outc->spill = NULL;
+	if (zip_close(outc->archive) < 0) {
+		sr_err("Error saving session file: %s",
+			zip_strerror(outc->archive));
+		g_free(metabuf);
+		stream_free(outc);
+		return SR_ERR;
+	}
+	outc->archive = NULL;
+	g_free(metabuf);
+	stream_free(outc);
+
+	return SR_OK;
+}
+
 static int zip_create(const struct sr_output *o)
 {
 	struct out_context *outc;
@@ -70,6 +855,7 @@ static int zip_create(const struct sr_output *o)
 	guint logic_channels = 0, enabled_logic_channels = 0;
 	guint enabled_analog_channels = 0;
 	guint index;
+	int ret;
 
 	outc = o->priv;
 
@@ -167,6 +953,16 @@ static int zip_create(const struct sr_output *o)
 		}
 	}
 
+	if (outc->streaming) {
+		/* Metadata gets written when the acquisition ends. */
+		outc->archive = zipfile;
+		outc->meta = meta;
+		outc->num_analog = enabled_analog_channels;
+		if ((ret = stream_init(o)) != SR_OK)
+			stream_free(outc);
+		return ret;
+	}
+
 	metabuf = g_key_file_to_data(meta, &metalen, NULL);
 	g_key_file_free(meta);
 
@@ -347,6 +1143,9 @@ static int zip_append_analog(const struct sr_output *o,
 	if (outc->analog_index_map[index] == -1)
 		return SR_ERR_ARG; /* Channel index was not in the list */
 
+	if (outc->streaming)
+		return stream_append_analog(o, analog, index);
+
 	index += outc->first_analog_index;
 
 	if (!(archive = zip_open(outc->filename, 0, NULL)))
@@ -442,7 +1241,11 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			outc->zip_created = TRUE;
 		}
 		logic = packet->payload;
-		ret = zip_append(o, logic->data, logic->unitsize, logic->length);
+		if (outc->streaming)
+			ret = stream_append_logic(o, logic);
+		else
+			ret = zip_append(o, logic->data, logic->unitsize,
+				logic->length);
 		if (ret != SR_OK)
 			return ret;
 		break;
@@ -457,17 +1260,38 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 		if (ret != SR_OK)
 			return ret;
 		break;
+	case SR_DF_END:
+		if (outc->archive) {
+			ret = stream_finish(o);
+			/* Late data gets appended to the finished file. */
+			outc->streaming = FALSE;
+			return ret;
+		}
+		break;
 	}
 
 	return SR_OK;
 }
 
 static struct sr_option options[] = {
+	{"streaming", "Streaming", "Keep the archive open and write it at the end of the acquisition. Faster, but needs temporary disk space and loses all data on a crash", NULL, NULL},
+	{"chunksize", "Chunk size", "Size of the data chunks in the archive in bytes (streaming only)", NULL, NULL},
+	{"level", "Compression level", "Deflate level of the data chunks (1-9), 0 leaves compression to libzip (streaming only)", NULL, NULL},
+	{"workers", "Worker threads", "Number of compression threads, 0 for one per CPU (streaming only)", NULL, NULL},
+	{"summary", "Summary", "Write min/max and transition summaries for fast overviews (streaming only)", NULL, NULL},
 	ALL_ZERO
 };
 
 static const struct sr_option *get_options(void)
 {
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(DEFAULT_CHUNKSIZE));
+		options[2].def = g_variant_ref_sink(g_variant_new_int32(DEFAULT_LEVEL));
+		options[3].def = g_variant_ref_sink(g_variant_new_uint32(0));
+		options[4].def = g_variant_ref_sink(g_variant_new_boolean(FALSE));
+	}
+
 	return options;
 }
 
@@ -476,6 +1300,13 @@ static int cleanup(struct sr_output *o)
 	struct out_context *outc;
 
 	outc = o->priv;
+	/* Acquisitions that did not end properly still get saved. */
+	if (outc->archive)
+		stream_finish(o);
+	stream_free(outc);
+	g_mutex_clear(&outc->mutex);
+	g_cond_clear(&outc->cond);
+	g_mutex_clear(&outc->spill_mutex);
 	g_free(outc->analog_index_map);
 	g_free(outc->filename);
 	g_free(outc);
@@ -32,6 +32,8 @@ struct context {
 	uint8_t *prevsample;
 	gboolean header_done;
 	int period;
+	/* Timestamp units per sample, or 0 if that is not an integer. */
+	uint64_t period_mult;
 	int *channel_index;
 	uint64_t samplerate;
 	uint64_t samplecount;
@@ -78,6 +80,14 @@ static int init(struct sr_output *o, GHashTable *options)
 	return SR_OK;
 }
 
+static void update_period_mult(struct context *ctx)
+{
+	if (ctx->samplerate && ctx->period % ctx->samplerate == 0)
+		ctx->period_mult = ctx->period / ctx->samplerate;
+	else
+		ctx->period_mult = 0;
+}
+
 static GString *gen_header(const struct sr_output *o)
 {
 	struct context *ctx;
@@ -128,6 +138,7 @@ static GString *gen_header(const struct sr_output *o)
 		ctx->period = SR_MHZ(1);
 	else
 		ctx->period = SR_KHZ(1);
+	update_period_mult(ctx);
 	frequency_s = sr_period_string(1, ctx->period);
 	g_string_append_printf(header, "$timescale %s $end\n", frequency_s);
 	g_free(frequency_s);
@@ -152,6 +163,99 @@ static GString *gen_header(const struct sr_output *o)
 	return header;
 }
 
+/* Append the timestamp of a sample, "#<time>". */
+static void append_timestamp(const struct context *ctx, GString *out,
+		uint64_t samplenum)
+{
+	char buf[24], *p;
+	uint64_t t;
+
+	if (!ctx->period_mult) {
+		g_string_append_printf(out, "#%.0f",
+			(double)samplenum / ctx->samplerate * ctx->period);
+		return;
+	}
+
+	/* Common case, the samplerate divides the timescale. */
+	t = samplenum * ctx->period_mult;
+	p = buf + sizeof(buf);
+	do {
+		*--p = '0' + t % 10;
+		t /= 10;
+	} while (t);
+	*--p = '#';
+	g_string_append_len(out, p, buf + sizeof(buf) - p);
+}
+
+/*
+ * Find the first sample at or after pos which differs from the sample
+ * before it. The buffer is compared against itself shifted by one
+ * sample, eight bytes at a time, so runs of unchanged samples are
+ * skipped at memory speed regardless of the unit size.
+ */
+static uint64_t next_change(const uint8_t *data, uint64_t count,
+		unsigned int unitsize, uint64_t pos)
+{
+	uint64_t a, b, k, length;
+
+	length = count * unitsize;
+	k = pos * unitsize;
+	while (k + sizeof(a) <= length) {
+		memcpy(&a, data + k, sizeof(a));
+		memcpy(&b, data + k - unitsize, sizeof(b));
+		if (a != b)
+			break;
+		k += sizeof(a);
+	}
+	while (k < length && data[k] == data[k - unitsize])
+		k++;
+
+	return k / unitsize;
+}
+
+/*
+ * Write the channels which differ between sample and prev. All channels
+ * are written if there is no previous sample.
+ */
+static void write_changes(const struct context *ctx, GString *out,
+		uint64_t samplenum, const uint8_t *sample, const uint8_t *prev,
+		unsigned int unitsize)
+{
+	unsigned int k, diff;
+	int p;
+	gboolean timestamp_written;
+
+	/*
+	 * TODO Check whether the mapping from data image positions to
+	 * channel numbers (ctx->channel_index) is required. Experiments
+	 * suggest that the data image "is dense", and packs bits of
+	 * enabled channels, and leaves no room for positions of disabled
+	 * channels.
+	 */
+	timestamp_written = FALSE;
+	for (k = 0; k < unitsize && (int)(8 * k) < ctx->num_enabled_channels; k++) {
+		diff = prev ? sample[k] ^ prev[k] : 0xff;
+		for (p = 8 * k; diff && p < ctx->num_enabled_channels; p++, diff >>= 1) {
+			/* VCD only contains deltas/changes of signals. */
+			if (!(diff & 1))
+				continue;
+
+			/* Output timestamp of subsequent signal changes. */
+			if (!timestamp_written)
+				append_timestamp(ctx, out, samplenum);
+			timestamp_written = TRUE;
+
+			/* Output which signal changed to which value. */
+			g_string_append_c(out, ' ');
+			g_string_append_c(out, '0' + ((sample[k] >> (p % 8)) & 1));
+			g_string_append_c(out, '!' + p);
+		}
+	}
+
+	if (timestamp_written)
+		g_string_append_c(out, '\n');
+}
+
 static int receive(const struct sr_output *o, const struct sr_datafeed_packet *packet,
 		GString **out)
 {
@@ -160,10 +264,9 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 	const struct sr_config *src;
 	GSList *l;
 	struct context *ctx;
-	unsigned int i;
-	int p, curbit, prevbit, index;
-	uint8_t *sample;
-	gboolean timestamp_written;
+	const uint8_t *data, *prev;
+	uint64_t i, count;
+	unsigned int unitsize;
 
 	*out = NULL;
 	if (!o || !o->priv)
@@ -178,6 +281,7 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			if (src->key != SR_CONF_SAMPLERATE)
 				continue;
 			ctx->samplerate = g_variant_get_uint64(src->data);
+			update_period_mult(ctx);
 		}
 		break;
 	case SR_DF_LOGIC:
@@ -195,57 +299,32 @@ static int receive(const struct sr_output *o, const struct sr_datafeed_packet *p
 			ctx->prevsample = g_malloc0(logic->unitsize);
 		}
 
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			sample = logic->data + i;
-			timestamp_written = FALSE;
-
-			for (p = 0; p < ctx->num_enabled_channels; p++) {
-				/*
-				 * TODO Check whether the mapping from
-				 * data image positions to channel numbers
-				 * is required. Experiments suggest that
-				 * the data image "is dense", and packs
-				 * bits of enabled channels, and leaves no
-				 * room for positions of disabled channels.
-				 */
-				/* index = ctx->channel_index[p]; */
-				index = p;
-
-				curbit = ((unsigned)sample[index / 8]
-						>> (index % 8)) & 1;
-				prevbit = ((unsigned)ctx->prevsample[index / 8]
-						>> (index % 8)) & 1;
-
-				/* VCD only contains deltas/changes of signals. */
-				if (prevbit == curbit && ctx->samplecount > 0)
-					continue;
-
-				/* Output timestamp of subsequent signal changes. */
-				if (!timestamp_written)
-					g_string_append_printf(*out, "#%.0f",
-						(double)ctx->samplecount /
-							ctx->samplerate * ctx->period);
-
-				/* Output which signal changed to which value. */
-				g_string_append_c(*out, ' ');
-				g_string_append_c(*out, '0' + curbit);
-				g_string_append_c(*out, '!' + p);
-
-				timestamp_written = TRUE;
-			}
-
-			if (timestamp_written)
-				g_string_append_c(*out, '\n');
-
-			ctx->samplecount++;
-			memcpy(ctx->prevsample, sample, logic->unitsize);
+		data = logic->data;
+		unitsize = logic->unitsize;
+		count = logic->length / unitsize;
+		if (!count)
+			break;
+
+		/* Only visit the samples where something changes. */
+		for (i = 0; i < count; i = next_change(data, count, unitsize, i + 1)) {
+			if (i > 0)
+				prev = data + (i - 1) * unitsize;
+			else if (ctx->samplecount > 0)
+				prev = ctx->prevsample;
+			else
+				prev = NULL;
+			write_changes(ctx, *out, ctx->samplecount + i,
+				data + i * unitsize, prev, unitsize);
 		}
+
+		ctx->samplecount += count;
+		memcpy(ctx->prevsample, data + (count - 1) * unitsize, unitsize);
 		break;
 	case SR_DF_END:
 		/* Write final timestamp as length indicator. */
 		*out = g_string_sized_new(512);
-		g_string_printf(*out, "#%.0f\n",
-				(double)ctx->samplecount / ctx->samplerate * ctx->period);
+		append_timestamp(ctx, *out, ctx->samplecount);
+		g_string_append_c(*out, '\n');
 		break;
 	}
 
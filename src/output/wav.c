@@ -60,6 +60,7 @@ static int realloc_chanbufs(const struct sr_output *o, int size)
 static int flush_chanbufs(const struct sr_output *o, GString *out)
 {
 	struct out_context *outc;
+	struct sr_pool *pool;
 	int num_samples, i, j;
 	char *buf, *bufp;
 
@@ -67,7 +68,9 @@ static int flush_chanbufs(const struct sr_output *o, GString *out)
 
 	/* Any one of them will do. */
 	num_samples = outc->chanbuf_used[0];
-	if (!(buf = g_try_malloc(4 * num_samples * outc->num_channels))) {
+	/* Scratch space, recycled through the session's pool. */
+	pool = o->sdi->session ? o->sdi->session->pool : NULL;
+	if (!(buf = sr_pool_alloc(pool, 4 * num_samples * outc->num_channels))) {
 		sr_err("Unable to allocate enough interleaved output buffer memory.");
 		return SR_ERR;
 	}
@@ -80,7 +83,7 @@ static int flush_chanbufs(const struct sr_output *o, GString *out)
 		}
 	}
 	g_string_append_len(out, buf, 4 * num_samples * outc->num_channels);
-	g_free(buf);
+	sr_pool_release(buf);
 
 	for (i = 0; i < outc->num_channels; i++)
 		outc->chanbuf_used[i] = 0;
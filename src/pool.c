@@ -0,0 +1,282 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <inttypes.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "pool"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Buffer pool for sample data.
+ *
+ * Drivers, input and output modules which need a fresh buffer for every
+ * packet can take it from the session's pool instead of the heap. Freed
+ * blocks are kept on a free list per power-of-two size class, and handed
+ * out again for the next request of the same class. Blocks can be
+ * returned from any thread.
+ *
+ * Modules which keep one buffer for the whole acquisition and send
+ * from it, like most input modules do, don't use the pool: the packets
+ * borrow that buffer, and only consumers which retain them pay for a
+ * copy. The same goes for drivers which send straight from their USB
+ * transfers, like hantek-4032l: copying every transfer into the pool
+ * would cost more than the copies it saves. The GStrings of output
+ * modules are not pooled either, as the frontend takes them over and
+ * frees them with g_string_free().
+ */
+
+/* Size classes go from 64 bytes to 16 MiB. */
+#define POOL_MIN_SHIFT		6
+#define POOL_NUM_CLASSES	19
+/* Blocks too large for any size class bypass the free lists. */
+#define POOL_OVERSIZE		POOL_NUM_CLASSES
+/* Free blocks kept per size class. */
+#define POOL_MAX_CACHED		16
+
+struct pool_block {
+	struct sr_pool *pool;
+	struct pool_block *next;
+	unsigned int size_class;
+};
+
+/* Keep the data that follows the header suitably aligned. */
+#define POOL_HEADER_SIZE \
+	((sizeof(struct pool_block) + 15) & ~(size_t)15)
+
+struct sr_pool {
+	GMutex mutex;
+	/* Set once the owner is done with the pool. */
+	gboolean orphaned;
+	struct pool_block *free_list[POOL_NUM_CLASSES];
+	unsigned int num_free[POOL_NUM_CLASSES];
+	struct sr_pool_stats stats;
+};
+
+static unsigned int size_class(size_t size)
+{
+	unsigned int c;
+
+	for (c = 0; c < POOL_NUM_CLASSES; c++) {
+		if (size <= (size_t)1 << (c + POOL_MIN_SHIFT))
+			return c;
+	}
+
+	return POOL_OVERSIZE;
+}
+
+static void pool_free_lists(struct sr_pool *pool)
+{
+	struct pool_block *block;
+	unsigned int c;
+
+	for (c = 0; c < POOL_NUM_CLASSES; c++) {
+		while ((block = pool->free_list[c])) {
+			pool->free_list[c] = block->next;
+			g_free(block);
+		}
+		pool->num_free[c] = 0;
+	}
+	pool->stats.cached_bytes = 0;
+}
+
+/**
+ * Create a buffer pool.
+ *
+ * @return The new pool. Free it with sr_pool_destroy().
+ */
+SR_PRIV struct sr_pool *sr_pool_new(void)
+{
+	struct sr_pool *pool;
+
+	pool = g_malloc0(sizeof(*pool));
+	g_mutex_init(&pool->mutex);
+
+	return pool;
+}
+
+/**
+ * Destroy a buffer pool.
+ *
+ * Blocks which are still in use remain valid. The pool goes away when
+ * the last of them has been released.
+ */
+SR_PRIV void sr_pool_destroy(struct sr_pool *pool)
+{
+	gboolean unused;
+
+	if (!pool)
+		return;
+
+	g_mutex_lock(&pool->mutex);
+	sr_dbg("%" PRIu64 " allocations, %" PRIu64 " from free lists, "
+		"%" PRIu64 " oversized, %" PRIu64 " still in use.",
+		pool->stats.allocations, pool->stats.hits,
+		pool->stats.oversize, pool->stats.outstanding);
+	pool_free_lists(pool);
+	pool->orphaned = TRUE;
+	unused = pool->stats.outstanding == 0;
+	g_mutex_unlock(&pool->mutex);
+
+	if (unused) {
+		g_mutex_clear(&pool->mutex);
+		g_free(pool);
+	}
+}
+
+/**
+ * Allocate memory from a pool.
+ *
+ * @param pool The pool to allocate from. If NULL, e.g. for a module
+ *             used outside of a session, the memory comes from the heap.
+ * @param size Number of bytes needed.
+ *
+ * @return The memory, to be returned with sr_pool_release(). NULL if
+ *         out of memory.
+ */
+SR_PRIV void *sr_pool_alloc(struct sr_pool *pool, size_t size)
+{
+	struct pool_block *block;
+	unsigned int c;
+
+	if (!pool) {
+		if (!(block = g_try_malloc(POOL_HEADER_SIZE + size)))
+			return NULL;
+		block->pool = NULL;
+		block->next = NULL;
+		block->size_class = POOL_OVERSIZE;
+		return (uint8_t *)block + POOL_HEADER_SIZE;
+	}
+
+	c = size_class(size);
+
+	g_mutex_lock(&pool->mutex);
+	pool->stats.allocations++;
+	block = NULL;
+	if (c == POOL_OVERSIZE) {
+		pool->stats.oversize++;
+	} else if ((block = pool->free_list[c])) {
+		pool->free_list[c] = block->next;
+		pool->num_free[c]--;
+		pool->stats.cached_bytes -= (size_t)1 << (c + POOL_MIN_SHIFT);
+		pool->stats.hits++;
+	}
+	if (block)
+		pool->stats.outstanding++;
+	g_mutex_unlock(&pool->mutex);
+
+	if (!block) {
+		if (c != POOL_OVERSIZE)
+			size = (size_t)1 << (c + POOL_MIN_SHIFT);
+		block = g_try_malloc(POOL_HEADER_SIZE + size);
+		if (!block)
+			return NULL;
+		block->pool = pool;
+		block->size_class = c;
+		g_mutex_lock(&pool->mutex);
+		pool->stats.outstanding++;
+		g_mutex_unlock(&pool->mutex);
+	}
+	block->next = NULL;
+
+	return (uint8_t *)block + POOL_HEADER_SIZE;
+}
+
+/**
+ * Return memory allocated by sr_pool_alloc() to its pool.
+ *
+ * This may be called from any thread.
+ */
+SR_PRIV void sr_pool_release(void *mem)
+{
+	struct pool_block *block;
+	struct sr_pool *pool;
+	unsigned int c;
+	gboolean unused;
+
+	if (!mem)
+		return;
+
+	block = (struct pool_block *)((uint8_t *)mem - POOL_HEADER_SIZE);
+	pool = block->pool;
+	c = block->size_class;
+
+	if (!pool) {
+		g_free(block);
+		return;
+	}
+
+	g_mutex_lock(&pool->mutex);
+	pool->stats.outstanding--;
+	if (!pool->orphaned && c != POOL_OVERSIZE
+			&& pool->num_free[c] < POOL_MAX_CACHED) {
+		block->next = pool->free_list[c];
+		pool->free_list[c] = block;
+		pool->num_free[c]++;
+		pool->stats.cached_bytes += (size_t)1 << (c + POOL_MIN_SHIFT);
+		block = NULL;
+	}
+	unused = pool->orphaned && pool->stats.outstanding == 0;
+	g_mutex_unlock(&pool->mutex);
+
+	g_free(block);
+	if (unused) {
+		g_mutex_clear(&pool->mutex);
+		g_free(pool);
+	}
+}
+
+static void pool_buffer_release(void *data, void *cb_data)
+{
+	(void)cb_data;
+
+	sr_pool_release(data);
+}
+
+/**
+ * Allocate a reference counted buffer from a pool.
+ *
+ * The memory returns to the pool when the last reference to the buffer
+ * is dropped, e.g. after a packet sent with sr_session_send_buffer()
+ * has been released by all datafeed consumers.
+ *
+ * @return The buffer, or NULL if out of memory.
+ */
+SR_PRIV struct sr_buffer *sr_pool_buffer_new(struct sr_pool *pool, size_t size)
+{
+	void *mem;
+
+	if (!(mem = sr_pool_alloc(pool, size)))
+		return NULL;
+
+	return sr_buffer_new(mem, size, pool_buffer_release, NULL);
+}
+
+/** Get a snapshot of the pool's statistics. */
+SR_PRIV void sr_pool_stats_get(struct sr_pool *pool,
+		struct sr_pool_stats *stats)
+{
+	g_mutex_lock(&pool->mutex);
+	*stats = pool->stats;
+	g_mutex_unlock(&pool->mutex);
+}
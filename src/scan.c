@@ -0,0 +1,583 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/** @cond PRIVATE */
+#define LOG_PREFIX "scan"
+/** @endcond */
+
+/**
+ * @file
+ *
+ * Concurrent scanning for devices.
+ */
+
+/**
+ * @defgroup grp_scan Scanning
+ *
+ * Scan for devices with several drivers, or on several ports, at once.
+ *
+ * Scanning with one driver after the other is slow on hosts with many
+ * ports, since most of the time is spent waiting for devices which don't
+ * answer. A scan collects the driver scans to be done, and runs them on
+ * a pool of worker threads. Some scans still run one after the other:
+ * those with the same driver, as a driver's list of device instances is
+ * not locked, and those whose connection option (SR_CONF_CONN) names the
+ * same port or USB device, as only one of them could open it.
+ *
+ * Inside a driver's scan, the resources found on SCPI transports are
+ * probed concurrently as well. Probes of the same resource by different
+ * driver scans run one after the other. Outside of a scan, e.g. in
+ * sr_driver_scan(), the resources are probed one at a time.
+ *
+ * An optional deadline bounds the whole scan. Probes which didn't start
+ * before it are skipped, and serial port packet detection gives up at
+ * the deadline. Probes which are already talking to a device are not
+ * interrupted, they finish within their own timeouts.
+ *
+ * The time taken by every probe is recorded, so that slow ports and
+ * drivers can be found.
+ *
+ * @{
+ */
+
+/* Driver scans run at the same time. */
+#define SCAN_MAX_THREADS	8
+/* Resources probed at the same time, by a single driver scan. */
+#define SCAN_MAX_PROBE_THREADS	8
+
+struct sr_scan {
+	struct sr_context *ctx;
+	/* struct scan_job, in the order they were added. */
+	GSList *jobs;
+	gint64 deadline;
+	GMutex mutex;
+	/* struct sr_scan_probe, protected by mutex. */
+	GSList *probes;
+	/* Resources being probed, protected by mutex. */
+	GHashTable *busy;
+	GCond busy_cond;
+};
+
+struct scan_job {
+	struct sr_scan *scan;
+	struct sr_dev_driver *driver;
+	GSList *options;
+	GSList *devices;
+	/* Ports and USB devices the scan is limited to (char *). */
+	GSList *keys;
+};
+
+struct resource_probe {
+	const char *resource;
+	sr_scan_probe_callback probe;
+	void *cb_data;
+	const struct scan_job *job;
+	struct sr_dev_inst *sdi;
+	gint64 duration;
+	gboolean skipped;
+};
+
+/* The job the calling thread works on, if it runs a driver scan. */
+static GPrivate current_job;
+
+static gboolean deadline_passed(const struct scan_job *job)
+{
+	return job && job->scan->deadline
+		&& g_get_monotonic_time() >= job->scan->deadline;
+}
+
+static void probe_record(const struct scan_job *job, const char *resource,
+		int num_devices, gint64 duration, gboolean skipped)
+{
+	struct sr_scan_probe *probe;
+
+	if (skipped)
+		sr_dbg("%s: %s skipped, scan deadline passed.",
+			job ? job->driver->name : "-",
+			resource ? resource : "scan");
+	else
+		sr_dbg("%s: %s found %d device(s) in %.3f ms.",
+			job ? job->driver->name : "-",
+			resource ? resource : "scan", num_devices,
+			duration / 1000.0);
+
+	if (!job)
+		return;
+
+	probe = g_malloc0(sizeof(*probe));
+	probe->driver = job->driver;
+	probe->resource = g_strdup(resource);
+	probe->num_devices = num_devices;
+	probe->duration_us = duration;
+	probe->skipped = skipped;
+
+	g_mutex_lock(&job->scan->mutex);
+	job->scan->probes = g_slist_append(job->scan->probes, probe);
+	g_mutex_unlock(&job->scan->mutex);
+}
+
+static void probe_free(void *data)
+{
+	struct sr_scan_probe *probe;
+
+	probe = data;
+	g_free(probe->resource);
+	g_free(probe);
+}
+
+/* Wait until no other driver scan probes the resource, and claim it. */
+static void resource_claim(struct sr_scan *scan, const char *resource)
+{
+	g_mutex_lock(&scan->mutex);
+	while (g_hash_table_contains(scan->busy, resource))
+		g_cond_wait(&scan->busy_cond, &scan->mutex);
+	g_hash_table_add(scan->busy, (char *)resource);
+	g_mutex_unlock(&scan->mutex);
+}
+
+static void resource_release(struct sr_scan *scan, const char *resource)
+{
+	g_mutex_lock(&scan->mutex);
+	g_hash_table_remove(scan->busy, resource);
+	g_cond_broadcast(&scan->busy_cond);
+	g_mutex_unlock(&scan->mutex);
+}
+
+static void resource_probe_run(gpointer data, gpointer user_data)
+{
+	struct resource_probe *rp;
+	struct sr_scan *scan;
+	gpointer job;
+	gint64 start;
+
+	(void)user_data;
+
+	rp = data;
+	scan = rp->job ? rp->job->scan : NULL;
+	if (scan)
+		resource_claim(scan, rp->resource);
+	if (deadline_passed(rp->job)) {
+		rp->skipped = TRUE;
+	} else {
+		/* For sr_scan_time_left() in the probe. */
+		job = g_private_get(&current_job);
+		g_private_set(&current_job, (gpointer)rp->job);
+		start = g_get_monotonic_time();
+		rp->sdi = rp->probe(rp->resource, rp->cb_data);
+		rp->duration = g_get_monotonic_time() - start;
+		g_private_set(&current_job, job);
+	}
+	if (scan)
+		resource_release(scan, rp->resource);
+}
+
+/** @private
+ *  Probe a list of resources for devices, several at a time.
+ *
+ *  This is meant for driver scans which try a number of ports or other
+ *  resources, which don't depend on one another. When the driver scan is
+ *  part of sr_scan_run(), the callback runs on worker threads, it must
+ *  only touch the resource it was given. Otherwise the resources are
+ *  probed one at a time, by the calling thread.
+ *
+ *  @param resources List of resources (char *) to probe.
+ *  @param probe Called with each resource, returns a device found on it
+ *               or NULL.
+ *  @param cb_data Passed on to the callback.
+ *
+ *  @return The devices found, in the order of the resources.
+ */
+SR_PRIV GSList *sr_scan_resources(GSList *resources,
+		sr_scan_probe_callback probe, void *cb_data)
+{
+	struct resource_probe *probes, *rp;
+	const struct scan_job *job;
+	GThreadPool *pool;
+	GError *error;
+	GSList *l, *devices;
+	guint num, i;
+
+	if (!(num = g_slist_length(resources)))
+		return NULL;
+
+	job = g_private_get(&current_job);
+	probes = g_malloc0(num * sizeof(*probes));
+	for (l = resources, i = 0; l; l = l->next, i++) {
+		probes[i].resource = l->data;
+		probes[i].probe = probe;
+		probes[i].cb_data = cb_data;
+		probes[i].job = job;
+	}
+
+	error = NULL;
+	pool = NULL;
+	if (num > 1 && job) {
+		pool = g_thread_pool_new(resource_probe_run, NULL,
+			MIN(num, SCAN_MAX_PROBE_THREADS), FALSE, &error);
+		if (!pool) {
+			sr_warn("Probing one resource at a time: %s",
+				error->message);
+			g_error_free(error);
+		}
+	}
+	for (i = 0; i < num; i++) {
+		if (pool)
+			g_thread_pool_push(pool, &probes[i], NULL);
+		else
+			resource_probe_run(&probes[i], NULL);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+
+	devices = NULL;
+	for (i = 0; i < num; i++) {
+		rp = &probes[i];
+		probe_record(rp->job, rp->resource, rp->sdi ? 1 : 0,
+			rp->duration, rp->skipped);
+		if (rp->sdi)
+			devices = g_slist_append(devices, rp->sdi);
+	}
+	g_free(probes);
+
+	return devices;
+}
+
+/** @private
+ *  Time left until the deadline of the scan the calling thread works for.
+ *
+ *  @return Microseconds left, 0 if the deadline passed, or -1 if there is
+ *          no deadline.
+ */
+SR_PRIV gint64 sr_scan_time_left(void)
+{
+	const struct scan_job *job;
+
+	job = g_private_get(&current_job);
+	if (!job || !job->scan->deadline)
+		return -1;
+
+	return MAX(job->scan->deadline - g_get_monotonic_time(), 0);
+}
+
+/* Run all scans of one driver, in the order they were added. */
+static void job_group_run(gpointer data, gpointer user_data)
+{
+	struct scan_job *job;
+	GSList *group, *l;
+	gint64 start;
+
+	(void)user_data;
+
+	group = data;
+	for (l = group; l; l = l->next) {
+		job = l->data;
+		if (deadline_passed(job)) {
+			probe_record(job, NULL, 0, 0, TRUE);
+			continue;
+		}
+		g_private_set(&current_job, job);
+		start = g_get_monotonic_time();
+		job->devices = sr_driver_scan(job->driver, job->options);
+		probe_record(job, NULL, g_slist_length(job->devices),
+			g_get_monotonic_time() - start, FALSE);
+		g_private_set(&current_job, NULL);
+	}
+	g_slist_free(group);
+}
+
+/*
+ * Get what a driver scan is limited to by its connection option: the
+ * option's value, and the USB device it names, as "usb/<bus>.<address>".
+ * A scan without one gets no keys, it only runs after other scans with
+ * the same driver.
+ */
+static GSList *job_keys_get(const struct scan_job *job)
+{
+	struct sr_config *src;
+	const char *conn;
+	GSList *l, *keys;
+#ifdef HAVE_LIBUSB_1_0
+	struct sr_usb_dev_inst *usb;
+	GSList *usb_devices;
+	const char *spec;
+#endif
+#ifdef HAVE_LIBSERIALPORT
+	int bus, address;
+#endif
+
+	conn = NULL;
+	for (l = job->options; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_CONN)
+			conn = g_variant_get_string(src->data, NULL);
+	}
+	if (!conn)
+		return NULL;
+
+	keys = g_slist_append(NULL, g_strdup(conn));
+#ifdef HAVE_LIBUSB_1_0
+	/* The SCPI drivers' USBTMC resources hold a bus.address spec. */
+	spec = conn;
+	if (g_str_has_prefix(spec, "usbtmc/"))
+		spec += strlen("usbtmc/");
+	if (sr_usb_conn_valid(spec)) {
+		usb_devices = sr_usb_find(job->scan->ctx->libusb_ctx, spec);
+		for (l = usb_devices; l; l = l->next) {
+			usb = l->data;
+			keys = g_slist_append(keys, g_strdup_printf("usb/%d.%d",
+				usb->bus, usb->address));
+		}
+		g_slist_free_full(usb_devices,
+			(GDestroyNotify)sr_usb_dev_inst_free);
+	}
+#endif
+#ifdef HAVE_LIBSERIALPORT
+	if (sr_serial_usb_bus_address(conn, &bus, &address) == SR_OK)
+		keys = g_slist_append(keys, g_strdup_printf("usb/%d.%d",
+			bus, address));
+#endif
+
+	return keys;
+}
+
+/* Whether two driver scans must not run at the same time. */
+static gboolean jobs_conflict(const struct scan_job *a,
+		const struct scan_job *b)
+{
+	GSList *l;
+
+	if (a->driver == b->driver)
+		return TRUE;
+	for (l = a->keys; l; l = l->next) {
+		if (g_slist_find_custom(b->keys, l->data,
+				(GCompareFunc)g_strcmp0))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**
+ * Create a new scan.
+ *
+ * @param ctx The libsigrok context. Must not be NULL.
+ *
+ * @return The scan, or NULL on invalid arguments. Free it with
+ *         sr_scan_free().
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_scan *sr_scan_new(struct sr_context *ctx)
+{
+	struct sr_scan *scan;
+
+	if (!ctx)
+		return NULL;
+
+	scan = g_malloc0(sizeof(*scan));
+	scan->ctx = ctx;
+	g_mutex_init(&scan->mutex);
+	scan->busy = g_hash_table_new(g_str_hash, g_str_equal);
+	g_cond_init(&scan->busy_cond);
+
+	return scan;
+}
+
+/**
+ * Free a scan. The devices it found are not affected.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_scan_free(struct sr_scan *scan)
+{
+	if (!scan)
+		return;
+
+	g_slist_free_full(scan->jobs, g_free);
+	g_slist_free_full(scan->probes, probe_free);
+	g_hash_table_destroy(scan->busy);
+	g_cond_clear(&scan->busy_cond);
+	g_mutex_clear(&scan->mutex);
+	g_free(scan);
+}
+
+/**
+ * Add a driver scan to a scan.
+ *
+ * The same driver can be added several times, e.g. with a different
+ * port in its options each time.
+ *
+ * @param scan The scan. Must not be NULL.
+ * @param driver The driver that should scan. It must have been initialized
+ *               with sr_driver_init(). Must not be NULL.
+ * @param options A list of 'struct sr_config' options to pass to the
+ *                driver's scanner, as with sr_driver_scan(). They must stay
+ *                valid until sr_scan_run() returned. Can be NULL/empty.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid arguments.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_scan_add(struct sr_scan *scan, struct sr_dev_driver *driver,
+		GSList *options)
+{
+	struct scan_job *job;
+
+	if (!scan || !driver)
+		return SR_ERR_ARG;
+
+	job = g_malloc0(sizeof(*job));
+	job->scan = scan;
+	job->driver = driver;
+	job->options = options;
+	scan->jobs = g_slist_append(scan->jobs, job);
+
+	return SR_OK;
+}
+
+/**
+ * Run all driver scans added to a scan, and wait for them to finish.
+ *
+ * @param scan The scan. Must not be NULL.
+ * @param timeout_ms The time after which no more probes are started, in
+ *                   milliseconds. 0 for no limit.
+ *
+ * @return A GSList * of 'struct sr_dev_inst' found by all driver scans,
+ *         in the order the scans were added, or NULL if no devices were
+ *         found. This list must be freed by the caller using g_slist_free(),
+ *         but without freeing the data pointed to in the list.
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_scan_run(struct sr_scan *scan, uint64_t timeout_ms)
+{
+	struct scan_job *job, **jobs;
+	GThreadPool *pool;
+	GError *error;
+	GSList *groups, *g, *l, *devices;
+	guint num, i, j, k, from, to, *group;
+	gint64 start;
+
+	if (!scan)
+		return NULL;
+
+	g_slist_free_full(scan->probes, probe_free);
+	scan->probes = NULL;
+
+	start = g_get_monotonic_time();
+	scan->deadline = timeout_ms ? start + timeout_ms * 1000 : 0;
+
+	/*
+	 * Group the scans which conflict with one another, directly or
+	 * through other scans. A group is numbered after its first scan.
+	 */
+	num = g_slist_length(scan->jobs);
+	jobs = g_malloc0(num * sizeof(*jobs));
+	group = g_malloc0(num * sizeof(*group));
+	for (l = scan->jobs, i = 0; l; l = l->next, i++) {
+		job = jobs[i] = l->data;
+		job->devices = NULL;
+		job->keys = job_keys_get(job);
+		group[i] = i;
+		for (j = 0; j < i; j++) {
+			if (group[j] == group[i] || !jobs_conflict(job, jobs[j]))
+				continue;
+			from = MAX(group[i], group[j]);
+			to = MIN(group[i], group[j]);
+			for (k = 0; k <= i; k++) {
+				if (group[k] == from)
+					group[k] = to;
+			}
+		}
+	}
+	groups = NULL;
+	for (i = 0; i < num; i++) {
+		if (group[i] != i)
+			continue;
+		g = NULL;
+		for (j = i; j < num; j++) {
+			if (group[j] == i)
+				g = g_slist_append(g, jobs[j]);
+		}
+		groups = g_slist_append(groups, g);
+	}
+	g_free(group);
+	g_free(jobs);
+
+	error = NULL;
+	pool = g_thread_pool_new(job_group_run, NULL,
+		MAX(MIN(g_slist_length(groups), SCAN_MAX_THREADS), 1),
+		FALSE, &error);
+	if (!pool) {
+		sr_warn("Scanning one driver at a time: %s", error->message);
+		g_error_free(error);
+	}
+	for (g = groups; g; g = g->next) {
+		if (pool)
+			g_thread_pool_push(pool, g->data, NULL);
+		else
+			job_group_run(g->data, NULL);
+	}
+	if (pool)
+		g_thread_pool_free(pool, FALSE, TRUE);
+	g_slist_free(groups);
+
+	devices = NULL;
+	for (l = scan->jobs; l; l = l->next) {
+		job = l->data;
+		devices = g_slist_concat(devices, job->devices);
+		job->devices = NULL;
+		g_slist_free_full(job->keys, g_free);
+		job->keys = NULL;
+	}
+
+	sr_info("%d scan(s) found %d device(s) in %.3f s.",
+		g_slist_length(scan->jobs), g_slist_length(devices),
+		(g_get_monotonic_time() - start) / (double)G_USEC_PER_SEC);
+
+	return devices;
+}
+
+/**
+ * Get the probes done by the last sr_scan_run().
+ *
+ * There is one entry for every driver scan, with a NULL resource, and
+ * one for every resource probed by the driver scans which probe several
+ * resources concurrently.
+ *
+ * @param scan The scan. Must not be NULL.
+ *
+ * @return A GSList * of 'struct sr_scan_probe', owned by the scan.
+ *
+ * @since 0.6.0
+ */
+SR_API GSList *sr_scan_probes_get(const struct sr_scan *scan)
+{
+	if (!scan)
+		return NULL;
+
+	return scan->probes;
+}
+
+/** @} */
@@ -93,6 +93,8 @@ struct sr_scpi_dev_inst {
 	int (*read_data)(void *priv, char *buf, int maxlen);
 	int (*write_data)(void *priv, char *buf, int len);
 	int (*read_complete)(void *priv);
+	/* Optional, whether read_data() would return without blocking. */
+	int (*read_ready)(void *priv);
 	int (*close)(struct sr_scpi_dev_inst *scpi);
 	void (*free)(void *priv);
 	unsigned int read_timeout_us;
@@ -101,6 +103,68 @@ struct sr_scpi_dev_inst {
 	uint64_t firmware_version;
 	GMutex scpi_mutex;
 	char *actual_channel_name;
+	/*
+	 * The block read in progress, see sr_scpi_block_begin(). Other
+	 * requests wait on block_cond until it is done.
+	 */
+	struct sr_scpi_block *block;
+	GThread *block_thread;
+	GCond block_cond;
+};
+
+enum sr_scpi_block_state {
+	SCPI_BLOCK_IDLE,
+	SCPI_BLOCK_HEADER,
+	SCPI_BLOCK_DATA,
+	SCPI_BLOCK_TRAILER,
+	SCPI_BLOCK_DONE,
+};
+
+/**
+ * An incremental read of a definite length block ("#<n><length><data>"),
+ * which can be advanced from a session source callback.
+ */
+struct sr_scpi_block {
+	enum sr_scpi_block_state state;
+	/* The '#', the digit count and up to 9 length digits. */
+	char header[11];
+	size_t header_len;
+	/** The block's data, once sr_scpi_block_read() returned 1. */
+	uint8_t *data;
+	/** Length of the block's data. */
+	size_t size;
+	/** Number of data bytes received so far. */
+	size_t received;
+	/** Holds the data if it was taken from a pool, NULL otherwise. */
+	struct sr_buffer *buffer;
+	/* Where to put the data, see sr_scpi_block_begin(). */
+	uint8_t *user_buf;
+	size_t user_size;
+	struct sr_pool *pool;
+	gint64 timeout;
+	/* The device, while the read holds it. */
+	struct sr_scpi_dev_inst *scpi;
+};
+
+/**
+ * Queries which are sent ahead of reading the responses to earlier ones,
+ * so that the instrument can prepare the next response while the current
+ * one is still being transferred.
+ */
+struct sr_scpi_pipeline {
+	/** Maximum number of queries awaiting their response. */
+	unsigned int depth;
+	/** Number of queries sent, whose response was not read yet. */
+	unsigned int in_flight;
+	/* Queries not sent yet. */
+	GQueue queue;
+};
+
+/** Frame rate of an acquisition, for performance comparison. */
+struct sr_scpi_frame_stats {
+	uint64_t frames;
+	gint64 start;
+	gint64 last;
 };
 
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
@@ -145,6 +209,23 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 			const char *command, GString **scpi_response);
 SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
 			const char *command, GByteArray **scpi_response);
+SR_PRIV int sr_scpi_block_begin(struct sr_scpi_dev_inst *scpi,
+			const char *command, struct sr_scpi_block *block,
+			void *buf, size_t buf_size, struct sr_pool *pool);
+SR_PRIV int sr_scpi_block_read(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_block *block);
+SR_PRIV void sr_scpi_block_free(struct sr_scpi_block *block);
+SR_PRIV void sr_scpi_pipeline_init(struct sr_scpi_pipeline *pipeline,
+			unsigned int depth);
+SR_PRIV int sr_scpi_pipeline_query(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_pipeline *pipeline, const char *command);
+SR_PRIV int sr_scpi_pipeline_done(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_pipeline *pipeline);
+SR_PRIV void sr_scpi_pipeline_clear(struct sr_scpi_pipeline *pipeline);
+SR_PRIV void sr_scpi_frame_stats_start(struct sr_scpi_frame_stats *stats);
+SR_PRIV void sr_scpi_frame_stats_frame(struct sr_scpi_frame_stats *stats);
+SR_PRIV void sr_scpi_frame_stats_report(const struct sr_scpi_frame_stats *stats,
+			const char *model);
 SR_PRIV int sr_scpi_get_hw_id(struct sr_scpi_dev_inst *scpi,
 			struct sr_scpi_hw_info **scpi_response);
 SR_PRIV void sr_scpi_hw_info_free(struct sr_scpi_hw_info *hw_info);
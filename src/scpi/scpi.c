@@ -20,6 +20,7 @@
 
 #include <config.h>
 #include <glib.h>
+#include <inttypes.h>
 #include <string.h>
 #include <libsigrok/libsigrok.h>
 #include "libsigrok-internal.h"
@@ -133,6 +134,41 @@ static struct sr_dev_inst *sr_scpi_scan_resource(struct drv_context *drvc,
 	return sdi;
 }
 
+/*
+ * Lock the device for a request. A block read holds the device from
+ * sr_scpi_block_begin() until it is done, across sr_scpi_block_read()
+ * calls, so the request waits for as long as the read makes progress.
+ * The thread doing the block read would wait forever, it gets
+ * SR_ERR_BUSY right away.
+ */
+static int scpi_lock(struct sr_scpi_dev_inst *scpi)
+{
+	g_mutex_lock(&scpi->scpi_mutex);
+	while (scpi->block) {
+		if (scpi->block_thread == g_thread_self() ||
+				g_get_monotonic_time() > scpi->block->timeout) {
+			g_mutex_unlock(&scpi->scpi_mutex);
+			sr_err("SCPI device is busy with a block read.");
+			return SR_ERR_BUSY;
+		}
+		g_cond_wait_until(&scpi->block_cond, &scpi->scpi_mutex,
+			scpi->block->timeout);
+	}
+
+	return SR_OK;
+}
+
+/* Let other requests go ahead again, with the mutex held. */
+static void scpi_block_end(struct sr_scpi_dev_inst *scpi)
+{
+	if (!scpi->block)
+		return;
+	scpi->block->scpi = NULL;
+	scpi->block = NULL;
+	scpi->block_thread = NULL;
+	g_cond_broadcast(&scpi->block_cond);
+}
+
 /**
  * Send a SCPI command with a variadic argument list without mutex.
  *
@@ -281,7 +317,7 @@ static int scpi_get_data(struct sr_scpi_dev_inst *scpi,
 	}
 
 	/* Initiate SCPI read operation. */
-	if (sr_scpi_read_begin(scpi) != SR_OK)
+	if (scpi->read_begin(scpi->priv) != SR_OK)
 		return SR_ERR;
 
 	/* Keep reading until completion or until timeout. */
@@ -310,14 +346,40 @@ static int scpi_get_data(struct sr_scpi_dev_inst *scpi,
 	return SR_OK;
 }
 
+struct scpi_scan_context {
+	struct drv_context *drvc;
+	const char *serialcomm;
+	struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi);
+};
+
+/* Probe a "<prefix>:<params>" resource found by a transport's scan. */
+static struct sr_dev_inst *scpi_scan_probe(const char *resource, void *cb_data)
+{
+	struct scpi_scan_context *sc;
+	struct sr_dev_inst *sdi;
+	gchar **res;
+
+	sc = cb_data;
+	sdi = NULL;
+
+	res = g_strsplit(resource, ":", 2);
+	if (res[0] && (sdi = sr_scpi_scan_resource(sc->drvc, res[0],
+			sc->serialcomm ? sc->serialcomm : res[1],
+			sc->probe_device)))
+		sdi->connection_id = g_strdup(resource);
+	g_strfreev(res);
+
+	return sdi;
+}
+
 SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		struct sr_dev_inst *(*probe_device)(struct sr_scpi_dev_inst *scpi))
 {
+	struct scpi_scan_context sc;
 	GSList *resources, *l, *devices;
 	struct sr_dev_inst *sdi;
 	const char *resource = NULL;
 	const char *serialcomm = NULL;
-	gchar **res;
 	unsigned i;
 
 	for (l = options; l; l = l->next) {
@@ -332,23 +394,23 @@ SR_PRIV GSList *sr_scpi_scan(struct drv_context *drvc, GSList *options,
 		}
 	}
 
-	devices = NULL;
+	/*
+	 * Collect the resources of all transports first, then probe them,
+	 * concurrently when this is part of a sr_scan_run(). Most of them
+	 * won't answer, and waiting for each of them in turn adds up.
+	 */
+	resources = NULL;
 	for (i = 0; i < ARRAY_SIZE(scpi_devs); i++) {
 		if ((resource && strcmp(resource, scpi_devs[i]->prefix))
 		    || !scpi_devs[i]->scan)
 			continue;
-		resources = scpi_devs[i]->scan(drvc);
-		for (l = resources; l; l = l->next) {
-			res = g_strsplit(l->data, ":", 2);
-			if (res[0] && (sdi = sr_scpi_scan_resource(drvc, res[0],
-			               serialcomm ? serialcomm : res[1], probe_device))) {
-				devices = g_slist_append(devices, sdi);
-				sdi->connection_id = g_strdup(l->data);
-			}
-			g_strfreev(res);
-		}
-		g_slist_free_full(resources, g_free);
+		resources = g_slist_concat(resources, scpi_devs[i]->scan(drvc));
 	}
+	sc.drvc = drvc;
+	sc.serialcomm = serialcomm;
+	sc.probe_device = probe_device;
+	devices = sr_scan_resources(resources, scpi_scan_probe, &sc);
+	g_slist_free_full(resources, g_free);
 
 	if (!devices && resource) {
 		sdi = sr_scpi_scan_resource(drvc, resource, serialcomm, probe_device);
@@ -403,6 +465,7 @@ SR_PRIV struct sr_scpi_dev_inst *scpi_dev_inst_new(struct drv_context *drvc,
 SR_PRIV int sr_scpi_open(struct sr_scpi_dev_inst *scpi)
 {
 	g_mutex_init(&scpi->scpi_mutex);
+	g_cond_init(&scpi->block_cond);
 
 	return scpi->open(scpi);
 }
@@ -457,11 +520,12 @@ SR_PRIV int sr_scpi_send(struct sr_scpi_dev_inst *scpi,
 	va_list args;
 	int ret;
 
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 	va_start(args, format);
-	g_mutex_lock(&scpi->scpi_mutex);
 	ret = scpi_send_variadic(scpi, format, args);
-	g_mutex_unlock(&scpi->scpi_mutex);
 	va_end(args);
+	g_mutex_unlock(&scpi->scpi_mutex);
 
 	return ret;
 }
@@ -480,7 +544,8 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 	ret = scpi_send_variadic(scpi, format, args);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
@@ -496,7 +561,14 @@ SR_PRIV int sr_scpi_send_variadic(struct sr_scpi_dev_inst *scpi,
  */
 SR_PRIV int sr_scpi_read_begin(struct sr_scpi_dev_inst *scpi)
 {
-	return scpi->read_begin(scpi->priv);
+	int ret;
+
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
+	ret = scpi->read_begin(scpi->priv);
+	g_mutex_unlock(&scpi->scpi_mutex);
+
+	return ret;
 }
 
 /**
@@ -513,7 +585,8 @@ SR_PRIV int sr_scpi_read_data(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 	ret = scpi_read_data(scpi, buf, maxlen);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
@@ -537,7 +610,8 @@ SR_PRIV int sr_scpi_write_data(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 	ret = scpi_write_data(scpi, buf, maxlen);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
@@ -567,10 +641,13 @@ SR_PRIV int sr_scpi_close(struct sr_scpi_dev_inst *scpi)
 {
 	int ret;
 
+	/* This aborts a block read in progress. */
 	g_mutex_lock(&scpi->scpi_mutex);
+	scpi_block_end(scpi);
 	ret = scpi->close(scpi);
 	g_mutex_unlock(&scpi->scpi_mutex);
 	g_mutex_clear(&scpi->scpi_mutex);
+	g_cond_clear(&scpi->block_cond);
 
 	return ret;
 }
@@ -644,7 +721,8 @@ SR_PRIV int sr_scpi_read_response(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 	ret = scpi_read_response(scpi, response, abs_timeout_us);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
@@ -656,7 +734,8 @@ SR_PRIV int sr_scpi_get_data(struct sr_scpi_dev_inst *scpi,
 {
 	int ret;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 	ret = scpi_get_data(scpi, command, scpi_response);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
@@ -928,133 +1007,444 @@ SR_PRIV int sr_scpi_get_uint8v(struct sr_scpi_dev_inst *scpi,
 	return ret;
 }
 
-/**
- * Send a SCPI command, read the reply, parse it as binary data with a
- * "definite length block" header and store the as an result in scpi_response.
- *
- * @param scpi Previously initialised SCPI device structure.
- * @param command The SCPI command to send to the device (can be NULL).
- * @param scpi_response Pointer where to store the parsed result.
- *
- * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
- *         error or upon no response. The allocated response must be freed by
- *         the caller in the case of an SR_OK as well as in the case of
- *         parsing error.
+/* Upper limit for the data read by a single sr_scpi_block_read() call. */
+#define SCPI_BLOCK_MAX_READ (1024 * 1024)
+
+static int scpi_block_begin(struct sr_scpi_dev_inst *scpi,
+		const char *command, struct sr_scpi_block *block,
+		void *buf, size_t buf_size, struct sr_pool *pool)
+{
+	memset(block, 0, sizeof(*block));
+	block->user_buf = buf;
+	block->user_size = buf_size;
+	block->pool = pool;
+
+	if (command && scpi_send(scpi, command) != SR_OK)
+		return SR_ERR;
+
+	if (scpi->read_begin(scpi->priv) != SR_OK)
+		return SR_ERR;
+
+	block->state = SCPI_BLOCK_HEADER;
+	block->timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+
+	return SR_OK;
+}
+
+/*
+ * Read up to len bytes. Unless asked to wait, nothing is read when the
+ * transport can tell that the read would block.
  */
-SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
-			       const char *command, GByteArray **scpi_response)
+static int scpi_block_read_data(struct sr_scpi_dev_inst *scpi,
+		void *buf, size_t len, gboolean wait)
 {
-	int ret;
-	GString* response;
-	char buf[10];
-	long llen;
-	long datalen;
-	gint64 timeout;
+	if (!wait && scpi->read_ready && !scpi->read_ready(scpi->priv))
+		return 0;
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	return scpi->read_data(scpi->priv, buf, MIN(len, G_MAXINT));
+}
 
-	if (command)
-		if (scpi_send(scpi, command) != SR_OK) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			return SR_ERR;
-		}
+/* Read up to len bytes, returns the number of bytes read. */
+static int scpi_block_read_some(struct sr_scpi_dev_inst *scpi,
+		struct sr_scpi_block *block, void *buf, size_t len,
+		gboolean wait)
+{
+	int ret;
 
-	if (sr_scpi_read_begin(scpi) != SR_OK) {
-		g_mutex_unlock(&scpi->scpi_mutex);
+	ret = scpi_block_read_data(scpi, buf, len, wait);
+	if (ret < 0) {
+		sr_err("Incompletely read SCPI block.");
 		return SR_ERR;
 	}
+	if (ret > 0) {
+		block->timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		return ret;
+	}
+	if (g_get_monotonic_time() > block->timeout) {
+		sr_err("Timed out waiting for SCPI block.");
+		return SR_ERR_TIMEOUT;
+	}
 
-	/*
-	 * Assume an initial maximum length, optionally gets adjusted below.
-	 * Prepare a NULL return value for when error paths will be taken.
-	 */
-	response = g_string_sized_new(1024);
+	return 0;
+}
 
-	timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+/* Parse the length spec, and set up the buffer for the data. */
+static int scpi_block_setup(struct sr_scpi_block *block)
+{
+	char buf[10];
+	long llen, datalen;
 
-	*scpi_response = NULL;
+	buf[0] = block->header[1];
+	buf[1] = '\0';
+	if (sr_atol(buf, &llen) != SR_OK || llen == 0) {
+		sr_err("Unsupported SCPI block length spec '%c'.", buf[0]);
+		return SR_ERR_DATA;
+	}
+	if (block->header_len < (size_t)(2 + llen))
+		return 0;
 
-	/* Get (the first chunk of) the response. */
-	while (response->len < 2) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
-			return ret;
+	memcpy(buf, &block->header[2], llen);
+	buf[llen] = '\0';
+	if (sr_atol(buf, &datalen) != SR_OK || datalen < 0) {
+		sr_err("Invalid SCPI block length '%s'.", buf);
+		return SR_ERR_DATA;
+	}
+	block->size = datalen;
+
+	if (block->user_buf) {
+		if (block->size > block->user_size) {
+			sr_err("SCPI block of %zu bytes exceeds buffer of %zu.",
+				block->size, block->user_size);
+			return SR_ERR_DATA;
 		}
+		block->data = block->user_buf;
+	} else if (block->pool) {
+		block->buffer = sr_pool_buffer_new(block->pool, block->size);
+		if (block->buffer)
+			block->data = block->buffer->data;
+	} else {
+		block->data = g_try_malloc(block->size);
 	}
+	if (block->size && !block->data) {
+		sr_err("Failed to allocate SCPI block of %zu bytes.", block->size);
+		return SR_ERR_MALLOC;
+	}
+	block->state = SCPI_BLOCK_DATA;
+
+	return 0;
+}
+
+/*
+ * Read what is available of a block. With wait set, reads may block
+ * until the data arrives.
+ */
+static int scpi_block_read(struct sr_scpi_dev_inst *scpi,
+		struct sr_scpi_block *block, gboolean wait)
+{
+	size_t need, total;
+	char trailer;
+	int ret;
 
 	/*
 	 * SCPI protocol data blocks are preceeded with a length spec.
 	 * The length spec consists of a '#' marker, one digit which
 	 * specifies the character count of the length spec, and the
 	 * respective number of characters which specify the data block's
-	 * length. Raw data bytes follow (thus one must no longer assume
-	 * that the received input stream would be an ASCIIZ string).
-	 *
-	 * Get the data block length, and strip off the length spec from
-	 * the input buffer, leaving just the data bytes.
+	 * length. Read just that much, so that the raw data bytes which
+	 * follow go straight to the block's buffer.
 	 */
-	if (response->str[0] != '#') {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
-		return SR_ERR_DATA;
-	}
-	buf[0] = response->str[1];
-	buf[1] = '\0';
-	ret = sr_atol(buf, &llen);
-	if ((ret != SR_OK) || (llen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
-		return ret;
+	while (block->state == SCPI_BLOCK_HEADER) {
+		if (block->header_len < 2)
+			need = 2 - block->header_len;
+		else
+			need = 2 + (block->header[1] - '0') - block->header_len;
+		ret = scpi_block_read_some(scpi, block,
+			&block->header[block->header_len], need, wait);
+		if (ret <= 0)
+			return ret;
+		block->header_len += ret;
+		if (block->header_len < 2)
+			continue;
+		if (block->header[0] != '#') {
+			sr_err("SCPI response is not a block.");
+			return SR_ERR_DATA;
+		}
+		if ((ret = scpi_block_setup(block)) < 0)
+			return ret;
 	}
 
-	while (response->len < (unsigned long)(2 + llen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
+	total = 0;
+	while (block->state == SCPI_BLOCK_DATA) {
+		if (block->received == block->size) {
+			block->state = SCPI_BLOCK_TRAILER;
+			break;
+		}
+		/* Give the main loop a chance to run during large transfers. */
+		if (total >= SCPI_BLOCK_MAX_READ)
+			return 0;
+		ret = scpi_block_read_some(scpi, block,
+			block->data + block->received,
+			block->size - block->received, wait);
+		if (ret <= 0)
 			return ret;
+		block->received += ret;
+		total += ret;
+	}
+
+	/*
+	 * Consume the block's terminating newline, if any. It may not have
+	 * arrived yet, but is only waited for until the timeout, as not all
+	 * devices send one. So it is never read blocking.
+	 */
+	if (block->state == SCPI_BLOCK_TRAILER) {
+		if (!sr_scpi_read_complete(scpi)) {
+			ret = scpi_block_read_data(scpi, &trailer, 1, FALSE);
+			if (ret == 0 && g_get_monotonic_time() <= block->timeout)
+				return 0;
 		}
+		block->state = SCPI_BLOCK_DONE;
 	}
 
-	memcpy(buf, &response->str[2], llen);
-	buf[llen] = '\0';
-	ret = sr_atol(buf, &datalen);
-	if ((ret != SR_OK) || (datalen == 0)) {
-		g_mutex_unlock(&scpi->scpi_mutex);
-		g_string_free(response, TRUE);
+	return block->state == SCPI_BLOCK_DONE ? 1 : 0;
+}
+
+/**
+ * Start an incremental read of a definite length block.
+ *
+ * The block is then read with sr_scpi_block_read(), e.g. from the
+ * driver's session source callback, so that large transfers don't
+ * stall the session. The data goes straight to its final location:
+ * @a buf if given, else a buffer from @a pool if given, else the heap.
+ *
+ * Until the block is complete, failed, or released with
+ * sr_scpi_block_free(), other requests to the device wait for it. In
+ * the thread reading the block they fail with SR_ERR_BUSY instead.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param block The read's state, to be released with sr_scpi_block_free().
+ * @param buf Buffer for the data, or NULL.
+ * @param buf_size Size of @a buf.
+ * @param pool Pool to take the buffer for the data from, or NULL.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_block_begin(struct sr_scpi_dev_inst *scpi,
+			const char *command, struct sr_scpi_block *block,
+			void *buf, size_t buf_size, struct sr_pool *pool)
+{
+	int ret;
+
+	if ((ret = scpi_lock(scpi)) != SR_OK)
 		return ret;
+	ret = scpi_block_begin(scpi, command, block, buf, buf_size, pool);
+	if (ret == SR_OK) {
+		block->scpi = scpi;
+		scpi->block = block;
+		scpi->block_thread = g_thread_self();
 	}
-	g_string_erase(response, 0, 2 + llen);
+	g_mutex_unlock(&scpi->scpi_mutex);
 
-	/*
-	 * If the initially assumed length does not cover the data block
-	 * length, then re-allocate the buffer size to the now known
-	 * length, and keep reading more chunks of response data.
-	 */
-	if (response->len < (unsigned long)(datalen)) {
-		int oldlen = response->len;
-		g_string_set_size(response, datalen);
-		g_string_set_size(response, oldlen);
+	return ret;
+}
+
+/**
+ * Read what is available of a block started with sr_scpi_block_begin().
+ *
+ * Each call does a bounded amount of work, and returns when no more
+ * data is available.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param block The read's state.
+ *
+ * @return 1 when the block is complete, with its data in block->data,
+ *         0 when more data is expected, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_block_read(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_block *block)
+{
+	int ret;
+
+	if (block->state == SCPI_BLOCK_IDLE)
+		return SR_ERR_ARG;
+
+	g_mutex_lock(&scpi->scpi_mutex);
+	if (scpi->block != block) {
+		g_mutex_unlock(&scpi->scpi_mutex);
+		sr_err("SCPI block read is not in progress.");
+		return SR_ERR_ARG;
 	}
+	scpi->block_thread = g_thread_self();
+	ret = scpi_block_read(scpi, block, FALSE);
+	if (ret != 0)
+		scpi_block_end(scpi);
+	g_mutex_unlock(&scpi->scpi_mutex);
 
-	while (response->len < (unsigned long)(datalen)) {
-		ret = scpi_read_response(scpi, response, timeout);
-		if (ret < 0) {
-			g_mutex_unlock(&scpi->scpi_mutex);
-			g_string_free(response, TRUE);
+	return ret;
+}
+
+/**
+ * Release the data of a block read, unless it is in the caller's buffer.
+ * A read still in progress is aborted.
+ *
+ * Drivers which want to keep a pooled block's data take another
+ * reference to block->buffer first.
+ */
+SR_PRIV void sr_scpi_block_free(struct sr_scpi_block *block)
+{
+	struct sr_scpi_dev_inst *scpi;
+
+	/* Abort the read, if it was still in progress. */
+	if ((scpi = block->scpi)) {
+		g_mutex_lock(&scpi->scpi_mutex);
+		scpi_block_end(scpi);
+		g_mutex_unlock(&scpi->scpi_mutex);
+	}
+	if (block->buffer)
+		sr_buffer_unref(block->buffer);
+	else if (block->data != block->user_buf)
+		g_free(block->data);
+	memset(block, 0, sizeof(*block));
+}
+
+/**
+ * Initialise a query pipeline.
+ *
+ * Only use a depth above 1 for queries which the instrument is known to
+ * buffer: IEEE 488.2 lets a device discard the response to a query once
+ * the next command arrives, and queries which depend on state set by an
+ * earlier command (e.g. a selected source) must not be reordered with it.
+ *
+ * @param pipeline The pipeline.
+ * @param depth Maximum number of queries awaiting their response, 1 to
+ *              send each query only after the previous response was read.
+ */
+SR_PRIV void sr_scpi_pipeline_init(struct sr_scpi_pipeline *pipeline,
+			unsigned int depth)
+{
+	pipeline->depth = MAX(depth, 1);
+	pipeline->in_flight = 0;
+	g_queue_init(&pipeline->queue);
+}
+
+/* Send queued queries for as long as the pipeline has room. */
+static int scpi_pipeline_fill(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_pipeline *pipeline)
+{
+	char *command;
+	int ret;
+
+	while (pipeline->in_flight < pipeline->depth) {
+		if (!(command = g_queue_pop_head(&pipeline->queue)))
+			break;
+		ret = sr_scpi_send(scpi, "%s", command);
+		g_free(command);
+		if (ret != SR_OK)
 			return ret;
-		}
-		if (ret > 0)
-			timeout = g_get_monotonic_time() + scpi->read_timeout_us;
+		pipeline->in_flight++;
 	}
 
+	return SR_OK;
+}
+
+/**
+ * Queue a query, and send it right away if the pipeline has room.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param pipeline The pipeline.
+ * @param command The query.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_pipeline_query(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_pipeline *pipeline, const char *command)
+{
+	g_queue_push_tail(&pipeline->queue, g_strdup(command));
+
+	return scpi_pipeline_fill(scpi, pipeline);
+}
+
+/**
+ * Mark the response to the oldest query sent as read, and send the
+ * next queued query. Call this as soon as the response is complete, so
+ * that the instrument can prepare the next one while it is processed.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param pipeline The pipeline.
+ *
+ * @return SR_OK on success, SR_ERR* on failure.
+ */
+SR_PRIV int sr_scpi_pipeline_done(struct sr_scpi_dev_inst *scpi,
+			struct sr_scpi_pipeline *pipeline)
+{
+	if (pipeline->in_flight)
+		pipeline->in_flight--;
+
+	return scpi_pipeline_fill(scpi, pipeline);
+}
+
+/**
+ * Drop all queries which were not sent yet, and forget about the ones
+ * awaiting their response.
+ */
+SR_PRIV void sr_scpi_pipeline_clear(struct sr_scpi_pipeline *pipeline)
+{
+	char *command;
+
+	while ((command = g_queue_pop_head(&pipeline->queue)))
+		g_free(command);
+	pipeline->in_flight = 0;
+}
+
+/** Start measuring the frame rate of an acquisition. */
+SR_PRIV void sr_scpi_frame_stats_start(struct sr_scpi_frame_stats *stats)
+{
+	stats->frames = 0;
+	stats->start = stats->last = g_get_monotonic_time();
+}
+
+/** Count a frame which was completely received. */
+SR_PRIV void sr_scpi_frame_stats_frame(struct sr_scpi_frame_stats *stats)
+{
+	stats->frames++;
+	stats->last = g_get_monotonic_time();
+}
+
+/**
+ * Log the frame rate of an acquisition.
+ *
+ * @param stats The measurement.
+ * @param model Name of the instrument's model, to tell measurements apart.
+ */
+SR_PRIV void sr_scpi_frame_stats_report(const struct sr_scpi_frame_stats *stats,
+			const char *model)
+{
+	double seconds;
+
+	if (!stats->frames || stats->last <= stats->start)
+		return;
+
+	seconds = (stats->last - stats->start) / (double)G_USEC_PER_SEC;
+	sr_info("%s: %" PRIu64 " frames in %.3f s, %.2f frames/s.",
+		model ? model : "Unknown model", stats->frames, seconds,
+		stats->frames / seconds);
+}
+
+/**
+ * Send a SCPI command, read the reply, parse it as binary data with a
+ * "definite length block" header and store the as an result in scpi_response.
+ *
+ * @param scpi Previously initialised SCPI device structure.
+ * @param command The SCPI command to send to the device (can be NULL).
+ * @param scpi_response Pointer where to store the parsed result.
+ *
+ * @return SR_OK upon successfully parsing all values, SR_ERR* upon a parsing
+ *         error or upon no response. The allocated response must be freed by
+ *         the caller in the case of an SR_OK as well as in the case of
+ *         parsing error.
+ */
+SR_PRIV int sr_scpi_get_block(struct sr_scpi_dev_inst *scpi,
+			       const char *command, GByteArray **scpi_response)
+{
+	struct sr_scpi_block block;
+	int ret;
+
+	*scpi_response = NULL;
+
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
+	ret = scpi_block_begin(scpi, command, &block, NULL, 0, NULL);
+	while (ret == SR_OK)
+		ret = scpi_block_read(scpi, &block, TRUE);
 	g_mutex_unlock(&scpi->scpi_mutex);
 
-	/* Convert received data to byte array. */
-	*scpi_response = g_byte_array_new_take(
-		(guint8*)g_string_free(response, FALSE), datalen);
+	if (ret < 0) {
+		sr_scpi_block_free(&block);
+		return ret;
+	}
+
+	/* Hand over the data without copying it. */
+	*scpi_response = g_byte_array_new_take(block.data, block.size);
 
 	return SR_OK;
 }
@@ -1230,7 +1620,8 @@ SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
 		return SR_OK;
 	}
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 
 	/* Select channel. */
 	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
@@ -1240,8 +1631,10 @@ SR_PRIV int sr_scpi_cmd(const struct sr_dev_inst *sdi,
 		g_free(scpi->actual_channel_name);
 		scpi->actual_channel_name = g_strdup(channel_name);
 		ret = scpi_send(scpi, channel_cmd, channel_name);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			g_mutex_unlock(&scpi->scpi_mutex);
 			return ret;
+		}
 	}
 
 	va_start(args, command);
@@ -1275,7 +1668,8 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		return SR_ERR_NA;
 	}
 
-	g_mutex_lock(&scpi->scpi_mutex);
+	if ((ret = scpi_lock(scpi)) != SR_OK)
+		return ret;
 
 	/* Select channel. */
 	channel_cmd = sr_scpi_cmd_get(cmdtable, channel_command);
@@ -1285,8 +1679,10 @@ SR_PRIV int sr_scpi_cmd_resp(const struct sr_dev_inst *sdi,
 		g_free(scpi->actual_channel_name);
 		scpi->actual_channel_name = g_strdup(channel_name);
 		ret = scpi_send(scpi, channel_cmd, channel_name);
-		if (ret != SR_OK)
+		if (ret != SR_OK) {
+			g_mutex_unlock(&scpi->scpi_mutex);
 			return ret;
+		}
 	}
 
 	va_start(args, command);
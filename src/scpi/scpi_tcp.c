@@ -27,6 +27,7 @@
 #include <string.h>
 #include <unistd.h>
 #ifndef _WIN32
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -242,6 +243,20 @@ static int scpi_tcp_read_complete(void *priv)
 			tcp->response_bytes_read >= tcp->response_length);
 }
 
+static int scpi_tcp_read_ready(void *priv)
+{
+	struct scpi_tcp *tcp = priv;
+	struct timeval tv;
+	fd_set fds;
+
+	FD_ZERO(&fds);
+	FD_SET(tcp->socket, &fds);
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+
+	return select(tcp->socket + 1, &fds, NULL, NULL, &tv) > 0;
+}
+
 static int scpi_tcp_close(struct sr_scpi_dev_inst *scpi)
 {
 	struct scpi_tcp *tcp = scpi->priv;
@@ -273,6 +288,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_raw_dev = {
 	.read_data     = scpi_tcp_raw_read_data,
 	.write_data    = scpi_tcp_raw_write_data,
 	.read_complete = scpi_tcp_read_complete,
+	.read_ready    = scpi_tcp_read_ready,
 	.close         = scpi_tcp_close,
 	.free          = scpi_tcp_free,
 };
@@ -289,6 +305,7 @@ SR_PRIV const struct sr_scpi_dev_inst scpi_tcp_rigol_dev = {
 	.read_begin    = scpi_tcp_read_begin,
 	.read_data     = scpi_tcp_rigol_read_data,
 	.read_complete = scpi_tcp_read_complete,
+	.read_ready    = scpi_tcp_read_ready,
 	.close         = scpi_tcp_close,
 	.free          = scpi_tcp_free,
 };
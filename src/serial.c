@@ -685,9 +685,15 @@ SR_PRIV int serial_stream_detect(struct sr_serial_dev_inst *serial,
 	uint64_t start, time, byte_delay_us;
 	size_t ibuf, i, maxlen;
 	ssize_t len;
+	gint64 left;
 
 	maxlen = *buflen;
 
+	/* Don't wait past the deadline of a scan in progress. */
+	left = sr_scan_time_left();
+	if (left >= 0 && (uint64_t)left / 1000 < timeout_ms)
+		timeout_ms = left / 1000;
+
 	sr_dbg("Detecting packets on %s (timeout = %" PRIu64
 	       "ms, baudrate = %d).", serial->port, timeout_ms, baudrate);
 
@@ -968,6 +974,37 @@ SR_PRIV GSList *sr_serial_find_usb(uint16_t vendor_id, uint16_t product_id)
 	return tty_devs;
 }
 
+/**
+ * Find the USB device a serial port belongs to.
+ *
+ * @param[in] port_name Name of the serial port, e.g. "/dev/ttyUSB0".
+ * @param[out] bus USB bus number of the device.
+ * @param[out] address USB address of the device.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_NA The port doesn't exist, or is not a USB device.
+ *
+ * @private
+ */
+SR_PRIV int sr_serial_usb_bus_address(const char *port_name, int *bus,
+		int *address)
+{
+	struct sp_port *port;
+	int ret;
+
+	if (sp_get_port_by_name(port_name, &port) != SP_OK)
+		return SR_ERR_NA;
+
+	ret = SR_ERR_NA;
+	if (sp_get_port_transport(port) == SP_TRANSPORT_USB &&
+	    sp_get_port_usb_bus_address(port, bus, address) == SP_OK)
+		ret = SR_OK;
+
+	sp_free_port(port);
+
+	return ret;
+}
+
 /** @private */
 SR_PRIV int serial_timeout(struct sr_serial_dev_inst *port, int num_bytes)
 {
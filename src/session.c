@@ -20,6 +20,7 @@
 
 #include <config.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -49,8 +50,97 @@
 struct datafeed_callback {
 	sr_datafeed_callback cb;
 	void *cb_data;
+
+	/* Only used by callbacks running on a worker thread. */
+	GThread *thread;
+	GMutex mutex;
+	GCond cond;
+	GQueue queue;
+	unsigned int queue_size;
+	enum sr_datafeed_overflow overflow;
+	gboolean busy;
+	gboolean quit;
+	uint64_t dropped;
+};
+
+/* A packet shared between the worker threads of a session. */
+struct datafeed_item {
+	const struct sr_dev_inst *sdi;
+	struct packet_container *pc;
+	int refcount;
+};
+
+/*
+ * A step of the compiled transform chain: either a single transform,
+ * or a run of fusable transforms whose logic kernels are applied to
+ * one block of samples after another.
+ */
+struct transform_stage {
+	struct sr_transform **transforms;
+	unsigned int num_transforms;
+	gboolean fused;
 };
 
+/* Fused kernels work on blocks which stay in the L1 cache. */
+#define TRANSFORM_BLOCK_SIZE (16 * 1024)
+
+/*
+ * Every packet handed to a datafeed callback lives in one of these.
+ * A refcount of 0 marks a packet which is only borrowed for the
+ * duration of sr_session_send(), and must be copied to be retained.
+ */
+struct packet_container {
+	struct sr_datafeed_packet packet;
+	int refcount;
+	/* Set once a consumer has retained the packet. */
+	gboolean registered;
+	/* Holds the sample data of logic and analog packets. */
+	struct sr_buffer *buffer;
+	union {
+		struct sr_datafeed_header header;
+		struct sr_datafeed_meta meta;
+		struct sr_datafeed_logic logic;
+		struct {
+			struct sr_datafeed_analog analog;
+			struct sr_analog_encoding encoding;
+			struct sr_analog_meaning meaning;
+			struct sr_analog_spec spec;
+		} analog;
+	} payload;
+};
+
+/* A packet being passed to the callbacks on the current thread. */
+struct packet_delivery {
+	struct packet_container *pc;
+	struct packet_delivery *next;
+};
+
+/*
+ * Packets can also be allocated by the caller, e.g. by the bindings, so
+ * only known packets may be treated as containers. The packets being
+ * passed to callbacks are listed per thread, which takes no locking on
+ * the datafeed path. Only the packets retained by a consumer are added
+ * to the set of registered packets.
+ */
+static GPrivate deliveries;
+static GMutex packets_mutex;
+static GHashTable *packets;
+
+static void packet_container_unref(struct packet_container *pc);
+
+static void packet_delivery_begin(struct packet_delivery *delivery,
+		struct packet_container *pc)
+{
+	delivery->pc = pc;
+	delivery->next = g_private_get(&deliveries);
+	g_private_set(&deliveries, delivery);
+}
+
+static void packet_delivery_end(struct packet_delivery *delivery)
+{
+	g_private_set(&deliveries, delivery->next);
+}
+
 /** Custom GLib event source for generic descriptor I/O.
  * @see https://developer.gnome.org/glib/stable/glib-The-Main-Event-Loop.html
  * @internal
@@ -198,6 +288,12 @@ static GSource *fd_source_new(struct sr_session *session, void *key,
 	return source;
 }
 
+static void transform_stage_free(struct transform_stage *stage)
+{
+	g_free(stage->transforms);
+	g_free(stage);
+}
+
 /**
  * Create a new session.
  *
@@ -230,6 +326,8 @@ SR_API int sr_session_new(struct sr_context *ctx,
 	 */
 	session->event_sources = g_hash_table_new(NULL, NULL);
 
+	session->pool = sr_pool_new();
+
 	*new_session = session;
 
 	return SR_OK;
@@ -258,6 +356,12 @@ SR_API int sr_session_destroy(struct sr_session *session)
 
 	sr_session_datafeed_callback_remove_all(session);
 
+	g_slist_free_full(session->transform_stages,
+			(GDestroyNotify)transform_stage_free);
+
+	/* Retained packets may still hold buffers from the pool. */
+	sr_pool_destroy(session->pool);
+
 	g_hash_table_unref(session->event_sources);
 
 	g_mutex_clear(&session->main_mutex);
@@ -443,6 +547,102 @@ SR_API int sr_session_dev_remove(struct sr_session *session,
 	return SR_OK;
 }
 
+static void datafeed_item_unref(struct datafeed_item *item)
+{
+	if (!g_atomic_int_dec_and_test(&item->refcount))
+		return;
+
+	packet_container_unref(item->pc);
+	g_free(item);
+}
+
+static gpointer datafeed_worker(gpointer data)
+{
+	struct datafeed_callback *cb_struct;
+	struct datafeed_item *item;
+	struct packet_delivery delivery;
+
+	cb_struct = data;
+
+	g_mutex_lock(&cb_struct->mutex);
+	for (;;) {
+		while (!(item = g_queue_pop_head(&cb_struct->queue))
+				&& !cb_struct->quit)
+			g_cond_wait(&cb_struct->cond, &cb_struct->mutex);
+		if (!item)
+			break;
+		cb_struct->busy = TRUE;
+		g_cond_broadcast(&cb_struct->cond);
+		g_mutex_unlock(&cb_struct->mutex);
+
+		packet_delivery_begin(&delivery, item->pc);
+		cb_struct->cb(item->sdi, &item->pc->packet, cb_struct->cb_data);
+		packet_delivery_end(&delivery);
+		datafeed_item_unref(item);
+
+		g_mutex_lock(&cb_struct->mutex);
+		cb_struct->busy = FALSE;
+		g_cond_broadcast(&cb_struct->cond);
+	}
+	g_mutex_unlock(&cb_struct->mutex);
+
+	return NULL;
+}
+
+/* Queue a packet for a callback running on a worker thread. */
+static void datafeed_enqueue(struct datafeed_callback *cb_struct,
+		struct datafeed_item *item)
+{
+	int type;
+
+	type = item->pc->packet.type;
+
+	g_mutex_lock(&cb_struct->mutex);
+	if (cb_struct->queue.length >= cb_struct->queue_size
+			&& cb_struct->overflow == SR_DATAFEED_DROP
+			&& (type == SR_DF_LOGIC || type == SR_DF_ANALOG)) {
+		cb_struct->dropped++;
+		g_mutex_unlock(&cb_struct->mutex);
+		return;
+	}
+	/* Packets other than sample data are never dropped. */
+	while (cb_struct->queue.length >= cb_struct->queue_size)
+		g_cond_wait(&cb_struct->cond, &cb_struct->mutex);
+
+	g_atomic_int_inc(&item->refcount);
+	g_queue_push_tail(&cb_struct->queue, item);
+	g_cond_broadcast(&cb_struct->cond);
+	g_mutex_unlock(&cb_struct->mutex);
+}
+
+/* Wait until a worker thread has processed all queued packets. */
+static void datafeed_flush(struct datafeed_callback *cb_struct)
+{
+	g_mutex_lock(&cb_struct->mutex);
+	while (cb_struct->queue.length > 0 || cb_struct->busy)
+		g_cond_wait(&cb_struct->cond, &cb_struct->mutex);
+	if (cb_struct->dropped) {
+		sr_warn("Datafeed callback dropped %" PRIu64 " packets.",
+			cb_struct->dropped);
+		cb_struct->dropped = 0;
+	}
+	g_mutex_unlock(&cb_struct->mutex);
+}
+
+static void datafeed_callback_free(struct datafeed_callback *cb_struct)
+{
+	if (cb_struct->thread) {
+		g_mutex_lock(&cb_struct->mutex);
+		cb_struct->quit = TRUE;
+		g_cond_broadcast(&cb_struct->cond);
+		g_mutex_unlock(&cb_struct->mutex);
+		g_thread_join(cb_struct->thread);
+		g_mutex_clear(&cb_struct->mutex);
+		g_cond_clear(&cb_struct->cond);
+	}
+	g_free(cb_struct);
+}
+
 /**
  * Remove all datafeed callbacks in a session.
  *
@@ -460,7 +660,8 @@ SR_API int sr_session_datafeed_callback_remove_all(struct sr_session *session)
 		return SR_ERR_ARG;
 	}
 
-	g_slist_free_full(session->datafeed_callbacks, g_free);
+	g_slist_free_full(session->datafeed_callbacks,
+		(GDestroyNotify)datafeed_callback_free);
 	session->datafeed_callbacks = NULL;
 
 	return SR_OK;
@@ -504,6 +705,76 @@ SR_API int sr_session_datafeed_callback_add(struct sr_session *session,
 	return SR_OK;
 }
 
+/**
+ * Add a datafeed callback to a session, which runs on a worker thread.
+ *
+ * The callback receives the same packets in the same order as one added
+ * with sr_session_datafeed_callback_add(), but it runs on a thread of
+ * its own. Slow callbacks thus don't hold up the acquisition or each
+ * other. The packets passed to the callback must not be modified.
+ *
+ * Up to @a queue_size packets are queued for the callback. If it falls
+ * further behind, @a overflow selects whether the acquisition waits for
+ * it, or whether sample data packets are dropped. Other packets are
+ * never dropped. Sending SR_DF_END waits until the callback has
+ * processed all packets.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param cb Function to call when a chunk of data is received.
+ *           Must not be NULL.
+ * @param cb_data Opaque pointer passed in by the caller.
+ * @param queue_size Maximum number of queued packets. Must not be 0.
+ * @param overflow What to do when the queue is full.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_BUG No session exists.
+ * @retval SR_ERR_ARG Invalid argument.
+ * @retval SR_ERR Failed to start the worker thread.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_datafeed_callback_add_threaded(
+		struct sr_session *session, sr_datafeed_callback cb,
+		void *cb_data, unsigned int queue_size,
+		enum sr_datafeed_overflow overflow)
+{
+	struct datafeed_callback *cb_struct;
+
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_BUG;
+	}
+
+	if (!cb || queue_size == 0) {
+		sr_err("%s: invalid argument", __func__);
+		return SR_ERR_ARG;
+	}
+
+	cb_struct = g_malloc0(sizeof(struct datafeed_callback));
+	cb_struct->cb = cb;
+	cb_struct->cb_data = cb_data;
+	cb_struct->queue_size = queue_size;
+	cb_struct->overflow = overflow;
+	g_mutex_init(&cb_struct->mutex);
+	g_cond_init(&cb_struct->cond);
+	g_queue_init(&cb_struct->queue);
+
+	cb_struct->thread = g_thread_try_new("datafeed", datafeed_worker,
+		cb_struct, NULL);
+	if (!cb_struct->thread) {
+		sr_err("Failed to start datafeed worker thread.");
+		g_mutex_clear(&cb_struct->mutex);
+		g_cond_clear(&cb_struct->cond);
+		g_free(cb_struct);
+		return SR_ERR;
+	}
+
+	session->datafeed_callbacks =
+	    g_slist_append(session->datafeed_callbacks, cb_struct);
+
+	return SR_OK;
+}
+
 /**
  * Get the trigger assigned to this session.
  *
@@ -993,6 +1264,37 @@ SR_API int sr_session_is_running(struct sr_session *session)
 	return session->running;
 }
 
+/**
+ * Get the statistics of the session's buffer pool.
+ *
+ * A high number of hits relative to allocations means that the sample
+ * buffers of the session were mostly recycled instead of allocated.
+ *
+ * @param session The session to use. Must not be NULL.
+ * @param stats Will be filled with the statistics. Must not be NULL.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_pool_stats_get(struct sr_session *session,
+		struct sr_pool_stats *stats)
+{
+	if (!session) {
+		sr_err("%s: session was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+	if (!stats) {
+		sr_err("%s: stats was NULL", __func__);
+		return SR_ERR_ARG;
+	}
+
+	sr_pool_stats_get(session->pool, stats);
+
+	return SR_OK;
+}
+
 /**
  * Set the callback to be invoked after a session stopped running.
  *
@@ -1071,6 +1373,239 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
 	}
 }
 
+/**
+ * Create a reference counted buffer.
+ *
+ * @param data The buffer's memory. Ownership passes to the buffer.
+ * @param size Size of @a data in bytes.
+ * @param release Called with @a data and @a cb_data when the last
+ *                reference is dropped. If NULL, @a data is freed with
+ *                g_free().
+ * @param cb_data Opaque pointer passed to @a release.
+ *
+ * @return The new buffer, holding a single reference.
+ *
+ * @private
+ */
+SR_PRIV struct sr_buffer *sr_buffer_new(void *data, size_t size,
+		void (*release)(void *data, void *cb_data), void *cb_data)
+{
+	struct sr_buffer *buffer;
+
+	buffer = g_malloc(sizeof(*buffer));
+	buffer->data = data;
+	buffer->size = size;
+	buffer->refcount = 1;
+	buffer->release = release;
+	buffer->cb_data = cb_data;
+
+	return buffer;
+}
+
+/** @private */
+SR_PRIV struct sr_buffer *sr_buffer_ref(struct sr_buffer *buffer)
+{
+	g_atomic_int_inc(&buffer->refcount);
+
+	return buffer;
+}
+
+/** @private */
+SR_PRIV void sr_buffer_unref(struct sr_buffer *buffer)
+{
+	if (!g_atomic_int_dec_and_test(&buffer->refcount))
+		return;
+
+	if (buffer->release)
+		buffer->release(buffer->data, buffer->cb_data);
+	else
+		g_free(buffer->data);
+	g_free(buffer);
+}
+
+static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
+{
+	g_variant_ref(src->data);
+	meta_copy->config = g_slist_append(meta_copy->config,
+	                                   g_memdup(src, sizeof(struct sr_config)));
+}
+
+/*
+ * Copy the payload of @a packet into the container. The sample data is
+ * shared with @a buffer if given, copied otherwise.
+ */
+static int packet_container_fill(struct packet_container *pc,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buffer)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const void *data;
+	void *data_copy;
+	size_t size;
+
+	pc->packet.type = packet->type;
+
+	data = NULL;
+	size = 0;
+	switch (packet->type) {
+	case SR_DF_TRIGGER:
+	case SR_DF_END:
+	case SR_DF_FRAME_BEGIN:
+	case SR_DF_FRAME_END:
+		/* No payload. */
+		return SR_OK;
+	case SR_DF_HEADER:
+		pc->payload.header = *(const struct sr_datafeed_header *)packet->payload;
+		pc->packet.payload = &pc->payload.header;
+		return SR_OK;
+	case SR_DF_META:
+		meta = packet->payload;
+		g_slist_foreach(meta->config, (GFunc)copy_src, &pc->payload.meta);
+		pc->packet.payload = &pc->payload.meta;
+		return SR_OK;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		pc->payload.logic = *logic;
+		pc->packet.payload = &pc->payload.logic;
+		data = logic->data;
+		size = logic->length;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet->payload;
+		pc->payload.analog.analog = *analog;
+		pc->payload.analog.encoding = *analog->encoding;
+		pc->payload.analog.meaning = *analog->meaning;
+		pc->payload.analog.meaning.channels =
+			g_slist_copy(analog->meaning->channels);
+		pc->payload.analog.spec = *analog->spec;
+		pc->payload.analog.analog.encoding = &pc->payload.analog.encoding;
+		pc->payload.analog.analog.meaning = &pc->payload.analog.meaning;
+		pc->payload.analog.analog.spec = &pc->payload.analog.spec;
+		pc->packet.payload = &pc->payload.analog.analog;
+		data = analog->data;
+		size = analog->encoding->unitsize * analog->num_samples;
+		break;
+	default:
+		sr_err("Unknown packet type %d", packet->type);
+		return SR_ERR_ARG;
+	}
+
+	if (buffer) {
+		pc->buffer = sr_buffer_ref(buffer);
+		return SR_OK;
+	}
+
+	data_copy = g_try_malloc(size);
+	if (size && !data_copy)
+		return SR_ERR_MALLOC;
+	memcpy(data_copy, data, size);
+	pc->buffer = sr_buffer_new(data_copy, size, NULL, NULL);
+	if (packet->type == SR_DF_LOGIC)
+		pc->payload.logic.data = data_copy;
+	else
+		pc->payload.analog.analog.data = data_copy;
+
+	return SR_OK;
+}
+
+/* Make a packet retained by a consumer known to packet_container_get(). */
+static void packet_container_register(struct packet_container *pc)
+{
+	if (g_atomic_int_get(&pc->registered))
+		return;
+
+	g_mutex_lock(&packets_mutex);
+	if (!pc->registered) {
+		if (!packets)
+			packets = g_hash_table_new(NULL, NULL);
+		g_hash_table_add(packets, pc);
+		g_atomic_int_set(&pc->registered, TRUE);
+	}
+	g_mutex_unlock(&packets_mutex);
+}
+
+static void packet_container_free(struct packet_container *pc)
+{
+	struct sr_config *src;
+	GSList *l;
+
+	switch (pc->packet.type) {
+	case SR_DF_META:
+		for (l = pc->payload.meta.config; l; l = l->next) {
+			src = l->data;
+			g_variant_unref(src->data);
+			g_free(src);
+		}
+		g_slist_free(pc->payload.meta.config);
+		break;
+	case SR_DF_ANALOG:
+		g_slist_free(pc->payload.analog.meaning.channels);
+		break;
+	}
+	if (pc->buffer)
+		sr_buffer_unref(pc->buffer);
+	if (pc->registered) {
+		g_mutex_lock(&packets_mutex);
+		g_hash_table_remove(packets, pc);
+		g_mutex_unlock(&packets_mutex);
+	}
+	g_free(pc);
+}
+
+/*
+ * Take a reference to a container. A borrowed container is copied,
+ * sharing its sample data with the sender's buffer if there is one.
+ */
+static struct packet_container *packet_container_ref(
+		struct packet_container *pc)
+{
+	struct packet_container *copy;
+
+	if (pc->refcount > 0) {
+		g_atomic_int_inc(&pc->refcount);
+		return pc;
+	}
+
+	copy = g_malloc0(sizeof(*copy));
+	copy->refcount = 1;
+	if (packet_container_fill(copy, &pc->packet, pc->buffer) != SR_OK) {
+		packet_container_free(copy);
+		return NULL;
+	}
+
+	return copy;
+}
+
+static void packet_container_unref(struct packet_container *pc)
+{
+	if (g_atomic_int_dec_and_test(&pc->refcount))
+		packet_container_free(pc);
+}
+
+static struct packet_container *packet_container_get(
+		const struct sr_datafeed_packet *packet, const char *func)
+{
+	struct packet_delivery *delivery;
+	gboolean found;
+
+	for (delivery = g_private_get(&deliveries); delivery;
+			delivery = delivery->next) {
+		if (&delivery->pc->packet == packet)
+			return delivery->pc;
+	}
+
+	g_mutex_lock(&packets_mutex);
+	found = packet && packets && g_hash_table_contains(packets, packet);
+	g_mutex_unlock(&packets_mutex);
+	if (!found) {
+		sr_err("%s: packet was not created by libsigrok", func);
+		return NULL;
+	}
+
+	return (struct packet_container *)packet;
+}
+
 /**
  * Send a packet to whatever is listening on the datafeed bus.
  *
@@ -1086,41 +1621,179 @@ static void datafeed_dump(const struct sr_datafeed_packet *packet)
  */
 SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 		const struct sr_datafeed_packet *packet)
+{
+	return sr_session_send_buffer(sdi, packet, NULL);
+}
+
+static gboolean transform_is_fusable(const struct sr_transform *t)
+{
+	return (t->module->flags & SR_TRANSFORM_FUSABLE) && t->module->logic_block;
+}
+
+/**
+ * Compile the session's transforms into stages.
+ *
+ * Must be called whenever the list of transforms changes.
+ *
+ * @private
+ */
+SR_PRIV void sr_session_transforms_compile(struct sr_session *session)
+{
+	struct transform_stage *stage;
+	struct sr_transform *t;
+	GSList *l, *next, *stages;
+	unsigned int i, n;
+
+	g_slist_free_full(session->transform_stages,
+			(GDestroyNotify)transform_stage_free);
+
+	stages = NULL;
+	l = session->transforms;
+	while (l) {
+		t = l->data;
+		stage = g_malloc0(sizeof(*stage));
+		stage->fused = transform_is_fusable(t);
+		/* A fused stage takes all fusable transforms in a row. */
+		n = 1;
+		if (stage->fused) {
+			for (next = l->next; next && transform_is_fusable(next->data);
+					next = next->next)
+				n++;
+		}
+		stage->transforms = g_malloc(n * sizeof(*stage->transforms));
+		stage->num_transforms = n;
+		for (i = 0; i < n; i++, l = l->next)
+			stage->transforms[i] = l->data;
+		if (n > 1)
+			sr_dbg("Fusing %u transforms, starting with '%s'.",
+				n, t->module->id);
+		stages = g_slist_append(stages, stage);
+	}
+	session->transform_stages = stages;
+}
+
+/*
+ * Run the logic kernels of a fused stage over the packet's samples,
+ * one block at a time.
+ */
+static void transform_stage_run_fused(const struct transform_stage *stage,
+		const struct sr_datafeed_logic *logic)
+{
+	const struct sr_transform *t;
+	uint8_t *data;
+	size_t block, length, offset;
+	unsigned int i;
+
+	if (!logic->unitsize || logic->unitsize > TRANSFORM_BLOCK_SIZE)
+		return;
+
+	data = logic->data;
+	length = logic->length - logic->length % logic->unitsize;
+	block = TRANSFORM_BLOCK_SIZE - TRANSFORM_BLOCK_SIZE % logic->unitsize;
+	for (offset = 0; offset < length; offset += block) {
+		if (block > length - offset)
+			block = length - offset;
+		for (i = 0; i < stage->num_transforms; i++) {
+			t = stage->transforms[i];
+			t->module->logic_block(t, data + offset, block,
+					logic->unitsize);
+		}
+	}
+}
+
+static int transform_stage_run(const struct transform_stage *stage,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct sr_transform *t;
+	unsigned int i;
+	int ret;
+
+	if (stage->fused && packet_in->type == SR_DF_LOGIC) {
+		transform_stage_run_fused(stage, packet_in->payload);
+		*packet_out = packet_in;
+		return SR_OK;
+	}
+
+	for (i = 0; i < stage->num_transforms; i++) {
+		t = stage->transforms[i];
+		sr_spew("Running transform module '%s'.", t->module->id);
+		ret = t->module->receive(t, packet_in, packet_out);
+		if (ret < 0)
+			return ret;
+		if (!*packet_out)
+			break;
+		if (*packet_out != packet_in
+				&& (t->module->flags & SR_TRANSFORM_INPLACE)) {
+			sr_err("In-place transform module '%s' returned "
+				"a new packet.", t->module->id);
+			return SR_ERR_BUG;
+		}
+		packet_in = *packet_out;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Send a packet whose sample data lives in a reference counted buffer.
+ *
+ * Datafeed consumers which retain the packet then share @a buffer
+ * instead of copying the sample data.
+ *
+ * @param sdi The device instance the packet originates from.
+ * @param packet The datafeed packet to send to the session bus. Its
+ *               sample data must point into @a buffer.
+ * @param buffer The buffer holding the sample data, or NULL. The
+ *               caller's reference is taken over in any case.
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR_ARG Invalid argument.
+ *
+ * @private
+ */
+SR_PRIV int sr_session_send_buffer(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, struct sr_buffer *buffer)
 {
 	GSList *l;
 	struct datafeed_callback *cb_struct;
+	struct datafeed_item *item;
 	struct sr_datafeed_packet *packet_in, *packet_out;
-	struct sr_transform *t;
+	struct packet_container borrowed, *pc;
+	struct packet_delivery delivery;
 	int ret;
 
 	if (!sdi) {
 		sr_err("%s: sdi was NULL", __func__);
-		return SR_ERR_ARG;
+		ret = SR_ERR_ARG;
+		goto out;
 	}
 
 	if (!packet) {
 		sr_err("%s: packet was NULL", __func__);
-		return SR_ERR_ARG;
+		ret = SR_ERR_ARG;
+		goto out;
 	}
 
 	if (!sdi->session) {
 		sr_err("%s: session was NULL", __func__);
-		return SR_ERR_BUG;
+		ret = SR_ERR_BUG;
+		goto out;
 	}
 
 	/*
-	 * Pass the packet to the first transform module. If that returns
-	 * another packet (instead of NULL), pass that packet to the next
-	 * transform module in the list, and so on.
+	 * Pass the packet to the first stage of the transform chain. If
+	 * that returns another packet (instead of NULL), pass that packet
+	 * to the next stage, and so on.
 	 */
+	ret = SR_OK;
 	packet_in = (struct sr_datafeed_packet *)packet;
-	for (l = sdi->session->transforms; l; l = l->next) {
-		t = l->data;
-		sr_spew("Running transform module '%s'.", t->module->id);
-		ret = t->module->receive(t, packet_in, &packet_out);
+	for (l = sdi->session->transform_stages; l; l = l->next) {
+		ret = transform_stage_run(l->data, packet_in, &packet_out);
 		if (ret < 0) {
 			sr_err("Error while running transform module: %d.", ret);
-			return SR_ERR;
+			ret = SR_ERR;
+			goto out;
 		}
 		if (!packet_out) {
 			/*
@@ -1128,7 +1801,7 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			 * packet, abort.
 			 */
 			sr_spew("Transform module didn't return a packet, aborting.");
-			return SR_OK;
+			goto out;
 		} else {
 			/*
 			 * Use this transform module's output packet as input
@@ -1137,20 +1810,80 @@ SR_PRIV int sr_session_send(const struct sr_dev_inst *sdi,
 			packet_in = packet_out;
 		}
 	}
-	packet = packet_in;
+
+	/*
+	 * Wrap the packet, so that callbacks can retain it. If the sample
+	 * data lives in a buffer, retaining the packet only takes another
+	 * reference to it. Otherwise the packet is borrowed, and gets
+	 * copied when retained.
+	 */
+	pc = NULL;
+	if (buffer && packet_in == packet) {
+		pc = g_malloc0(sizeof(*pc));
+		pc->refcount = 1;
+		if ((ret = packet_container_fill(pc, packet, buffer)) != SR_OK) {
+			packet_container_free(pc);
+			goto out;
+		}
+	} else {
+		borrowed.packet = *packet_in;
+		borrowed.refcount = 0;
+		borrowed.registered = FALSE;
+		borrowed.buffer = NULL;
+	}
+	packet_delivery_begin(&delivery, pc ? pc : &borrowed);
+	packet = &delivery.pc->packet;
 
 	/*
 	 * If the last transform did output a packet, pass it to all datafeed
-	 * callbacks.
+	 * callbacks. Callbacks on worker threads share a single reference
+	 * to the packet.
 	 */
+	item = NULL;
 	for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
 		if (sr_log_loglevel_get() >= SR_LOG_DBG)
 			datafeed_dump(packet);
 		cb_struct = l->data;
-		cb_struct->cb(sdi, packet, cb_struct->cb_data);
+		if (!cb_struct->thread) {
+			cb_struct->cb(sdi, packet, cb_struct->cb_data);
+			continue;
+		}
+		if (!item) {
+			item = g_malloc0(sizeof(*item));
+			item->sdi = sdi;
+			item->refcount = 1;
+			item->pc = packet_container_ref(delivery.pc);
+			if (!item->pc) {
+				g_free(item);
+				item = NULL;
+				ret = SR_ERR_MALLOC;
+				break;
+			}
+		}
+		datafeed_enqueue(cb_struct, item);
+	}
+	/* Worker threads got a reference, which copied borrowed packets. */
+	packet_delivery_end(&delivery);
+	if (pc)
+		packet_container_unref(pc);
+	if (!item)
+		goto out;
+	datafeed_item_unref(item);
+
+	/* Make sure SR_DF_END has reached all callbacks when we return. */
+	if (packet->type == SR_DF_END) {
+		for (l = sdi->session->datafeed_callbacks; l; l = l->next) {
+			cb_struct = l->data;
+			if (cb_struct->thread)
+				datafeed_flush(cb_struct);
+		}
 	}
 
-	return SR_OK;
+out:
+	if (buffer)
+		sr_buffer_unref(buffer);
+
+	return ret;
 }
 
 /**
@@ -1443,129 +2176,99 @@ SR_PRIV int sr_session_source_destroyed(struct sr_session *session,
 	return stop_check_later(session);
 }
 
-static void copy_src(struct sr_config *src, struct sr_datafeed_meta *meta_copy)
-{
-	g_variant_ref(src->data);
-	meta_copy->config = g_slist_append(meta_copy->config,
-	                                   g_memdup(src, sizeof(struct sr_config)));
-}
-
+/**
+ * Copy a datafeed packet.
+ *
+ * The copy, including its sample data, is independent of the original.
+ * Use sr_packet_ref() instead if the packet only needs to be retained.
+ *
+ * @param packet The packet to copy. Must not be NULL.
+ * @param copy Will be set to the copy. Free it with sr_packet_free().
+ *
+ * @retval SR_OK Success.
+ * @retval SR_ERR Failed to copy the packet.
+ */
 SR_API int sr_packet_copy(const struct sr_datafeed_packet *packet,
 		struct sr_datafeed_packet **copy)
 {
-	const struct sr_datafeed_meta *meta;
-	struct sr_datafeed_meta *meta_copy;
-	const struct sr_datafeed_logic *logic;
-	struct sr_datafeed_logic *logic_copy;
-	const struct sr_datafeed_analog *analog;
-	struct sr_datafeed_analog *analog_copy;
-	uint8_t *payload;
+	struct packet_container *pc;
 
-	*copy = g_malloc0(sizeof(struct sr_datafeed_packet));
-	(*copy)->type = packet->type;
-
-	switch (packet->type) {
-	case SR_DF_TRIGGER:
-	case SR_DF_END:
-		/* No payload. */
-		break;
-	case SR_DF_HEADER:
-		payload = g_malloc(sizeof(struct sr_datafeed_header));
-		memcpy(payload, packet->payload, sizeof(struct sr_datafeed_header));
-		(*copy)->payload = payload;
-		break;
-	case SR_DF_META:
-		meta = packet->payload;
-		meta_copy = g_malloc0(sizeof(struct sr_datafeed_meta));
-		g_slist_foreach(meta->config, (GFunc)copy_src, meta_copy->config);
-		(*copy)->payload = meta_copy;
-		break;
-	case SR_DF_LOGIC:
-		logic = packet->payload;
-		logic_copy = g_malloc(sizeof(*logic_copy));
-		if (!logic_copy)
-			return SR_ERR;
-		logic_copy->length = logic->length;
-		logic_copy->unitsize = logic->unitsize;
-		logic_copy->data = g_malloc(logic->length * logic->unitsize);
-		if (!logic_copy->data) {
-			g_free(logic_copy);
-			return SR_ERR;
-		}
-		memcpy(logic_copy->data, logic->data, logic->length * logic->unitsize);
-		(*copy)->payload = logic_copy;
-		break;
-	case SR_DF_ANALOG:
-		analog = packet->payload;
-		analog_copy = g_malloc(sizeof(*analog_copy));
-		analog_copy->data = g_malloc(
-				analog->encoding->unitsize * analog->num_samples);
-		memcpy(analog_copy->data, analog->data,
-				analog->encoding->unitsize * analog->num_samples);
-		analog_copy->num_samples = analog->num_samples;
-		analog_copy->encoding = g_memdup(analog->encoding,
-				sizeof(struct sr_analog_encoding));
-		analog_copy->meaning = g_memdup(analog->meaning,
-				sizeof(struct sr_analog_meaning));
-		analog_copy->meaning->channels = g_slist_copy(
-				analog->meaning->channels);
-		analog_copy->spec = g_memdup(analog->spec,
-				sizeof(struct sr_analog_spec));
-		(*copy)->payload = analog_copy;
-		break;
-	default:
-		sr_err("Unknown packet type %d", packet->type);
+	pc = g_malloc0(sizeof(*pc));
+	pc->refcount = 1;
+	if (packet_container_fill(pc, packet, NULL) != SR_OK) {
+		packet_container_free(pc);
+		*copy = NULL;
 		return SR_ERR;
 	}
+	packet_container_register(pc);
+	*copy = &pc->packet;
 
 	return SR_OK;
 }
 
+/**
+ * Free a packet returned by sr_packet_copy().
+ *
+ * This is the same as sr_packet_unref().
+ */
 SR_API void sr_packet_free(struct sr_datafeed_packet *packet)
 {
-	const struct sr_datafeed_meta *meta;
-	const struct sr_datafeed_logic *logic;
-	const struct sr_datafeed_analog *analog;
-	struct sr_config *src;
-	GSList *l;
+	sr_packet_unref(packet);
+}
 
-	switch (packet->type) {
-	case SR_DF_TRIGGER:
-	case SR_DF_END:
-		/* No payload. */
-		break;
-	case SR_DF_HEADER:
-		/* Payload is a simple struct. */
-		g_free((void *)packet->payload);
-		break;
-	case SR_DF_META:
-		meta = packet->payload;
-		for (l = meta->config; l; l = l->next) {
-			src = l->data;
-			g_variant_unref(src->data);
-			g_free(src);
-		}
-		g_slist_free(meta->config);
-		g_free((void *)packet->payload);
-		break;
-	case SR_DF_LOGIC:
-		logic = packet->payload;
-		g_free(logic->data);
-		g_free((void *)packet->payload);
-		break;
-	case SR_DF_ANALOG:
-		analog = packet->payload;
-		g_free(analog->data);
-		g_free(analog->encoding);
-		g_slist_free(analog->meaning->channels);
-		g_free(analog->meaning);
-		g_free(analog->spec);
-		g_free((void *)packet->payload);
-		break;
-	default:
-		sr_err("Unknown packet type %d", packet->type);
+/**
+ * Retain a datafeed packet.
+ *
+ * Packets passed to a datafeed callback are only valid until the
+ * callback returns, unless retained with this function from within
+ * the callback. If the sample data of the packet is reference counted,
+ * the packet is shared with its sender. Otherwise a copy is returned.
+ * The returned packet must not be modified.
+ *
+ * @param packet A packet passed to the running datafeed callback, or
+ *               returned by sr_packet_ref() or sr_packet_copy().
+ *
+ * @return The retained packet, to be released with sr_packet_unref().
+ *         NULL on error.
+ *
+ * @since 0.6.0
+ */
+SR_API struct sr_datafeed_packet *sr_packet_ref(
+		const struct sr_datafeed_packet *packet)
+{
+	struct packet_container *pc;
+
+	if (!(pc = packet_container_get(packet, __func__)))
+		return NULL;
+
+	/* A borrowed packet gets copied, to outlive the callback. */
+	if (!(pc = packet_container_ref(pc)))
+		return NULL;
+	packet_container_register(pc);
+
+	return &pc->packet;
+}
+
+/**
+ * Release a packet retained with sr_packet_ref().
+ *
+ * @param packet The packet to release.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_packet_unref(struct sr_datafeed_packet *packet)
+{
+	struct packet_container *pc;
+
+	if (!(pc = packet_container_get(packet, __func__)))
+		return;
+
+	if (pc->refcount == 0) {
+		sr_err("%s: packet is not retained", __func__);
+		return;
 	}
-	g_free(packet);
+
+	packet_container_unref(pc);
 }
 
 /** @} */
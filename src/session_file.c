@@ -391,4 +391,799 @@ SR_API int sr_session_load(struct sr_context *ctx, const char *filename,
 	return ret;
 }
 
+/* Size of the buffer used to skip data at the start of a chunk. */
+#define SKIP_BUFSIZE (64 * 1024)
+
+struct chunk_entry {
+	uint64_t num;
+	uint64_t index;
+	uint64_t size;
+};
+
+static gint chunk_entry_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct chunk_entry *ca = a, *cb = b;
+
+	return (ca->num > cb->num) - (ca->num < cb->num);
+}
+
+static void series_free(gpointer data)
+{
+	struct sr_session_file_series *series;
+
+	series = data;
+	if (series->chunks)
+		g_array_free(series->chunks, TRUE);
+	series->chunks = NULL;
+	g_free(series->name);
+	series->name = NULL;
+	g_free(series->summary);
+	series->summary = NULL;
+}
+
+static void series_free_full(gpointer data)
+{
+	series_free(data);
+	g_free(data);
+}
+
+/*
+ * Parse the chunk number from "<basename>-<num>". A lone "<basename>" is
+ * the only chunk of an unchunked capture. Returns 0 if the name does not
+ * match.
+ */
+static uint64_t chunk_num_parse(const char *name, const char *basename)
+{
+	size_t len;
+	uint64_t num;
+	char *end;
+
+	len = strlen(basename);
+	if (strncmp(name, basename, len) != 0)
+		return 0;
+	if (name[len] == '\0')
+		return 1;
+	if (name[len] != '-' || !g_ascii_isdigit(name[len + 1]))
+		return 0;
+	num = g_ascii_strtoull(name + len + 1, &end, 10);
+
+	return *end ? 0 : num;
+}
+
+/*
+ * Sort the entries found for a series by chunk number and compute the
+ * sample offset of every chunk. Like the session driver, stop at the
+ * first missing chunk.
+ */
+static void series_build(struct sr_session_file_series *series,
+		GArray *entries, const char *name)
+{
+	struct chunk_entry *e;
+	struct sr_session_file_chunk chunk;
+	guint i;
+
+	g_array_sort(entries, chunk_entry_cmp);
+
+	series->name = g_strdup(name);
+	series->chunks = g_array_sized_new(FALSE, FALSE,
+		sizeof(struct sr_session_file_chunk), entries->len);
+	series->num_samples = 0;
+	for (i = 0; i < entries->len; i++) {
+		e = &g_array_index(entries, struct chunk_entry, i);
+		if (e->num != i + 1) {
+			sr_warn("Chunk %u of '%s' is missing, ignoring the "
+				"rest.", i + 1, name);
+			break;
+		}
+		if (e->size % series->unitsize)
+			sr_warn("Chunk %u of '%s' is not a multiple of the unit "
+				"size.", i + 1, name);
+		chunk.index = e->index;
+		chunk.start = series->num_samples;
+		chunk.count = e->size / series->unitsize;
+		g_array_append_val(series->chunks, chunk);
+		series->num_samples += chunk.count;
+	}
+}
+
+/* Build the chunk index from the central directory of the archive. */
+static int session_file_index(struct sr_session_file *sfile, int unitsize)
+{
+	struct sr_session_file_series *series;
+	struct chunk_entry e;
+	struct zip_stat zs;
+	GArray *logic_entries, *entries;
+	GHashTable *analog_entries;
+	GHashTableIter iter;
+	gpointer key, value;
+	const char *name;
+	char *end, *basename;
+	int64_t i, num_entries;
+	uint64_t channel;
+
+	logic_entries = g_array_new(FALSE, FALSE, sizeof(struct chunk_entry));
+	analog_entries = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, (GDestroyNotify)g_array_unref);
+
+	num_entries = zip_get_num_entries(sfile->archive, 0);
+	for (i = 0; i < num_entries; i++) {
+		if (!(name = zip_get_name(sfile->archive, i, 0)))
+			continue;
+		if (zip_stat_index(sfile->archive, i, 0, &zs) < 0)
+			continue;
+		e.index = i;
+		e.size = zs.size;
+		if ((e.num = chunk_num_parse(name, "logic-1"))) {
+			g_array_append_val(logic_entries, e);
+		} else if (g_str_has_prefix(name, "analog-1-")) {
+			channel = g_ascii_strtoull(name + 9, &end, 10);
+			if (channel == 0 || channel > G_MAXINT || *end != '-')
+				continue;
+			basename = g_strndup(name, end - name);
+			e.num = chunk_num_parse(name, basename);
+			g_free(basename);
+			if (!e.num)
+				continue;
+			/* The file numbers channels from 1. */
+			key = GUINT_TO_POINTER(channel - 1);
+			entries = g_hash_table_lookup(analog_entries, key);
+			if (!entries) {
+				entries = g_array_new(FALSE, FALSE,
+					sizeof(struct chunk_entry));
+				g_hash_table_insert(analog_entries, key, entries);
+			}
+			g_array_append_val(entries, e);
+		}
+	}
+
+	if (logic_entries->len && unitsize <= 0) {
+		sr_err("Session file has logic data but no unit size.");
+		g_array_free(logic_entries, TRUE);
+		g_hash_table_destroy(analog_entries);
+		return SR_ERR_DATA;
+	}
+	sfile->logic.unitsize = MAX(unitsize, 1);
+	series_build(&sfile->logic, logic_entries, "logic-1");
+	g_array_free(logic_entries, TRUE);
+
+	g_hash_table_iter_init(&iter, analog_entries);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		series = g_malloc0(sizeof(struct sr_session_file_series));
+		series->unitsize = sizeof(float);
+		basename = g_strdup_printf("analog-1-%u",
+			GPOINTER_TO_UINT(key) + 1);
+		series_build(series, value, basename);
+		g_free(basename);
+		g_hash_table_insert(sfile->analog, key, series);
+	}
+	g_hash_table_destroy(analog_entries);
+
+	return SR_OK;
+}
+
+/**
+ * Open a session file for random access to its data.
+ *
+ * An index of the data chunks in the file is built from the archive's
+ * directory, no data is decompressed. Ranges of samples can then be read
+ * with sr_session_file_read_logic() and sr_session_file_read_analog(),
+ * which only decompress the chunks covering the range.
+ *
+ * @param[in] filename The name of the session file.
+ * @param[out] sfile The opened session file. Must be closed with
+ *                   sr_session_file_close().
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_DATA Malformed session file
+ * @retval SR_ERR This is not a session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_open(const char *filename,
+		struct sr_session_file **sfile)
+{
+	struct sr_session_file *sf;
+	struct zip_stat zs;
+	GKeyFile *kf;
+	int ret, unitsize;
+
+	if (!sfile)
+		return SR_ERR_ARG;
+	*sfile = NULL;
+
+	if ((ret = sr_sessionfile_check(filename)) != SR_OK)
+		return ret;
+
+	sf = g_malloc0(sizeof(struct sr_session_file));
+	sf->analog = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+		NULL, series_free_full);
+
+	if (!(sf->archive = zip_open(filename, 0, NULL))) {
+		sr_session_file_close(sf);
+		return SR_ERR;
+	}
+
+	if (zip_stat(sf->archive, "metadata", 0, &zs) < 0) {
+		sr_session_file_close(sf);
+		return SR_ERR;
+	}
+	if (!(kf = sr_sessionfile_read_metadata(sf->archive, &zs))) {
+		sr_session_file_close(sf);
+		return SR_ERR_DATA;
+	}
+	unitsize = g_key_file_get_integer(kf, "device 1", "unitsize", NULL);
+	sf->summary_blocksize = g_key_file_get_uint64(kf, "device 1",
+		"summary blocksize", NULL);
+	g_key_file_free(kf);
+
+	if ((ret = session_file_index(sf, unitsize)) != SR_OK) {
+		sr_session_file_close(sf);
+		return ret;
+	}
+	*sfile = sf;
+
+	return SR_OK;
+}
+
+/**
+ * Close a session file opened with sr_session_file_open().
+ *
+ * @param[in] sfile The session file. May be NULL.
+ *
+ * @since 0.6.0
+ */
+SR_API void sr_session_file_close(struct sr_session_file *sfile)
+{
+	if (!sfile)
+		return;
+
+	if (sfile->archive)
+		zip_discard(sfile->archive);
+	series_free(&sfile->logic);
+	g_hash_table_destroy(sfile->analog);
+	g_free(sfile);
+}
+
+/**
+ * Get the number of logic samples in a session file, and their size.
+ *
+ * @param[in] sfile The session file.
+ * @param[out] num_samples The number of logic samples.
+ * @param[out] unitsize The size of one logic sample in bytes. May be NULL.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_NA The file has no logic data
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_info(const struct sr_session_file *sfile,
+		uint64_t *num_samples, unsigned int *unitsize)
+{
+	if (!sfile || !num_samples)
+		return SR_ERR_ARG;
+
+	if (!sfile->logic.chunks->len)
+		return SR_ERR_NA;
+
+	*num_samples = sfile->logic.num_samples;
+	if (unitsize)
+		*unitsize = sfile->logic.unitsize;
+
+	return SR_OK;
+}
+
+/**
+ * Get the number of samples of an analog channel in a session file.
+ *
+ * @param[in] sfile The session file.
+ * @param[in] index The index of the channel, as in the device instance
+ *                  created by sr_session_load().
+ * @param[out] num_samples The number of samples.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_NA The file has no data for this channel
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_analog_info(const struct sr_session_file *sfile,
+		int index, uint64_t *num_samples)
+{
+	struct sr_session_file_series *series;
+
+	if (!sfile || index < 0 || !num_samples)
+		return SR_ERR_ARG;
+
+	series = g_hash_table_lookup(sfile->analog, GINT_TO_POINTER(index));
+	if (!series || !series->chunks->len)
+		return SR_ERR_NA;
+
+	*num_samples = series->num_samples;
+
+	return SR_OK;
+}
+
+/* Read len bytes starting at offset skip of an archive entry. */
+static int chunk_read(struct zip *archive, uint64_t index, uint64_t skip,
+		uint8_t *buf, uint64_t len)
+{
+	struct zip_file *zf;
+	uint8_t *skipbuf;
+	zip_int64_t ret;
+
+	if (!(zf = zip_fopen_index(archive, index, 0))) {
+		sr_err("Failed to open chunk: %s", zip_strerror(archive));
+		return SR_ERR;
+	}
+
+	/* Compressed entries cannot seek, so read up to the range. */
+	skipbuf = skip ? g_malloc(SKIP_BUFSIZE) : NULL;
+	ret = 0;
+	while (skip) {
+		ret = zip_fread(zf, skipbuf, MIN(skip, SKIP_BUFSIZE));
+		if (ret <= 0)
+			break;
+		skip -= ret;
+	}
+	g_free(skipbuf);
+
+	while (!skip && len) {
+		ret = zip_fread(zf, buf, len);
+		if (ret <= 0)
+			break;
+		buf += ret;
+		len -= ret;
+	}
+
+	if (skip || len) {
+		if (ret < 0)
+			sr_err("Failed to read chunk: %s", zip_file_strerror(zf));
+		else
+			sr_err("Chunk is shorter than its size.");
+		zip_fclose(zf);
+		return SR_ERR_DATA;
+	}
+	zip_fclose(zf);
+
+	return SR_OK;
+}
+
+static int series_read(struct sr_session_file *sfile,
+		const struct sr_session_file_series *series,
+		uint64_t start, uint64_t end, uint8_t *buf)
+{
+	const struct sr_session_file_chunk *chunk;
+	guint lo, hi, mid;
+	uint64_t n;
+	int ret;
+
+	if (start > end || end > series->num_samples)
+		return SR_ERR_ARG;
+	if (start == end)
+		return SR_OK;
+
+	/* Find the last chunk starting at or before the first sample. */
+	lo = 0;
+	hi = series->chunks->len;
+	while (hi - lo > 1) {
+		mid = lo + (hi - lo) / 2;
+		chunk = &g_array_index(series->chunks,
+			struct sr_session_file_chunk, mid);
+		if (chunk->start <= start)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	while (start < end) {
+		chunk = &g_array_index(series->chunks,
+			struct sr_session_file_chunk, lo++);
+		n = MIN(end, chunk->start + chunk->count) - start;
+		if (!n)
+			continue;
+		ret = chunk_read(sfile->archive, chunk->index,
+			(start - chunk->start) * series->unitsize,
+			buf, n * series->unitsize);
+		if (ret != SR_OK)
+			return ret;
+		buf += n * series->unitsize;
+		start += n;
+	}
+
+	return SR_OK;
+}
+
+/**
+ * Read a range of logic samples from a session file.
+ *
+ * Only the chunks covering the range are decompressed.
+ *
+ * @param[in] sfile The session file.
+ * @param[in] start The first sample to read.
+ * @param[in] end The sample after the last one to read. Must not be larger
+ *                than the number of samples in the file.
+ * @param[out] buf Memory for (end - start) samples of the unit size
+ *                 reported by sr_session_file_logic_info().
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_NA The file has no logic data
+ * @retval SR_ERR_DATA Malformed session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_logic(struct sr_session_file *sfile,
+		uint64_t start, uint64_t end, uint8_t *buf)
+{
+	if (!sfile || !buf)
+		return SR_ERR_ARG;
+
+	if (!sfile->logic.chunks->len)
+		return SR_ERR_NA;
+
+	return series_read(sfile, &sfile->logic, start, end, buf);
+}
+
+/**
+ * Read a range of samples of an analog channel from a session file.
+ *
+ * Only the chunks covering the range are decompressed.
+ *
+ * @param[in] sfile The session file.
+ * @param[in] index The index of the channel, as in the device instance
+ *                  created by sr_session_load().
+ * @param[in] start The first sample to read.
+ * @param[in] end The sample after the last one to read. Must not be larger
+ *                than the number of samples of the channel.
+ * @param[out] buf Memory for (end - start) floats.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_NA The file has no data for this channel
+ * @retval SR_ERR_DATA Malformed session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_read_analog(struct sr_session_file *sfile,
+		int index, uint64_t start, uint64_t end, float *buf)
+{
+	struct sr_session_file_series *series;
+
+	if (!sfile || index < 0 || !buf)
+		return SR_ERR_ARG;
+
+	series = g_hash_table_lookup(sfile->analog, GINT_TO_POINTER(index));
+	if (!series || !series->chunks->len)
+		return SR_ERR_NA;
+
+	return series_read(sfile, series, start, end, (uint8_t *)buf);
+}
+
+/*
+ * Load the summary of a series, as written by the srzip output module:
+ * the finest level with one record per block of summary_blocksize
+ * samples, followed by the coarser levels, each combining pairs of
+ * records of the previous one, down to a single record.
+ */
+static int series_summary_load(struct sr_session_file *sfile,
+		struct sr_session_file_series *series, size_t recsize)
+{
+	struct zip_stat zs;
+	uint64_t count, total;
+	unsigned int l;
+	char *name;
+	int ret;
+
+	if (series->summary)
+		return SR_OK;
+	if (!sfile->summary_blocksize || !series->num_samples)
+		return SR_ERR_NA;
+
+	count = (series->num_samples + sfile->summary_blocksize - 1) /
+		sfile->summary_blocksize;
+	total = 0;
+	for (l = 0; l < G_N_ELEMENTS(series->level_count); l++) {
+		series->level_offset[l] = total;
+		series->level_count[l] = count;
+		total += count;
+		if (count == 1)
+			break;
+		count = (count + 1) / 2;
+	}
+	series->num_levels = l + 1;
+
+	name = g_strdup_printf("summary-%s", series->name);
+	ret = zip_stat(sfile->archive, name, 0, &zs);
+	g_free(name);
+	if (ret < 0)
+		return SR_ERR_NA;
+	if (zs.size != total * recsize) {
+		sr_err("Summary of '%s' has an unexpected size.", series->name);
+		return SR_ERR_DATA;
+	}
+
+	if (!(series->summary = g_try_malloc(zs.size)))
+		return SR_ERR_MALLOC;
+	ret = chunk_read(sfile->archive, zs.index, 0, series->summary, zs.size);
+	if (ret != SR_OK) {
+		g_free(series->summary);
+		series->summary = NULL;
+	}
+
+	return ret;
+}
+
+static const uint8_t *series_summary_get(
+		const struct sr_session_file_series *series, size_t recsize,
+		unsigned int level, uint64_t first, uint64_t count)
+{
+	if (level >= series->num_levels || first > series->level_count[level] ||
+	    count > series->level_count[level] - first)
+		return NULL;
+
+	return series->summary + (series->level_offset[level] + first) * recsize;
+}
+
+/**
+ * Get the number of samples per block in the finest summary level of a
+ * session file.
+ *
+ * Summaries are written by the srzip output module if its "summary"
+ * option is set. Level n of a summary has blocks of blocksize << n
+ * samples, the last level has a single block covering all samples.
+ *
+ * @param[in] sfile The session file.
+ * @param[out] blocksize The number of samples per block.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_NA The file has no summaries
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_summary_blocksize(const struct sr_session_file *sfile,
+		uint64_t *blocksize)
+{
+	if (!sfile || !blocksize)
+		return SR_ERR_ARG;
+
+	if (!sfile->summary_blocksize)
+		return SR_ERR_NA;
+
+	*blocksize = sfile->summary_blocksize;
+
+	return SR_OK;
+}
+
+/**
+ * Get the transition masks of a range of blocks of the logic summary.
+ *
+ * The mask of a block has those bits set which change between any two
+ * consecutive samples in the block, or between the last sample of the
+ * previous block and the first of this one.
+ *
+ * @param[in] sfile The session file.
+ * @param[in] level The summary level, see
+ *                  sr_session_file_summary_blocksize().
+ * @param[in] first The first block.
+ * @param[in] count The number of blocks.
+ * @param[out] masks Memory for count masks of the logic unit size.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument, or blocks out of range
+ * @retval SR_ERR_NA The file has no logic summary
+ * @retval SR_ERR_DATA Malformed session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_summary(struct sr_session_file *sfile,
+		unsigned int level, uint64_t first, uint64_t count,
+		uint8_t *masks)
+{
+	const uint8_t *src;
+	int ret;
+
+	if (!sfile || !masks)
+		return SR_ERR_ARG;
+
+	ret = series_summary_load(sfile, &sfile->logic, sfile->logic.unitsize);
+	if (ret != SR_OK)
+		return ret;
+
+	src = series_summary_get(&sfile->logic, sfile->logic.unitsize,
+		level, first, count);
+	if (!src)
+		return SR_ERR_ARG;
+	memcpy(masks, src, count * sfile->logic.unitsize);
+
+	return SR_OK;
+}
+
+/**
+ * Get the minimum and maximum values of a range of blocks of the summary
+ * of an analog channel.
+ *
+ * @param[in] sfile The session file.
+ * @param[in] index The index of the channel, as in the device instance
+ *                  created by sr_session_load().
+ * @param[in] level The summary level, see
+ *                  sr_session_file_summary_blocksize().
+ * @param[in] first The first block.
+ * @param[in] count The number of blocks.
+ * @param[out] min Memory for count minimum values.
+ * @param[out] max Memory for count maximum values.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument, or blocks out of range
+ * @retval SR_ERR_NA The file has no summary for this channel
+ * @retval SR_ERR_DATA Malformed session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_analog_summary(struct sr_session_file *sfile,
+		int index, unsigned int level, uint64_t first, uint64_t count,
+		float *min, float *max)
+{
+	struct sr_session_file_series *series;
+	const float *src;
+	uint64_t i;
+	int ret;
+
+	if (!sfile || index < 0 || !min || !max)
+		return SR_ERR_ARG;
+
+	series = g_hash_table_lookup(sfile->analog, GINT_TO_POINTER(index));
+	if (!series)
+		return SR_ERR_NA;
+
+	ret = series_summary_load(sfile, series, 2 * sizeof(float));
+	if (ret != SR_OK)
+		return ret;
+
+	src = (const float *)series_summary_get(series, 2 * sizeof(float),
+		level, first, count);
+	if (!src)
+		return SR_ERR_ARG;
+	for (i = 0; i < count; i++) {
+		min[i] = src[2 * i];
+		max[i] = src[2 * i + 1];
+	}
+
+	return SR_OK;
+}
+
+static gboolean logic_mask_hit(const uint8_t *a, const uint8_t *b,
+		const uint8_t *mask, unsigned int unitsize)
+{
+	unsigned int k;
+
+	for (k = 0; k < unitsize; k++) {
+		if ((a[k] ^ (b ? b[k] : 0)) & (mask ? mask[k] : 0xff))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/*
+ * Find the first sample in [start, end) which differs from the previous
+ * one in the masked bits. Returns end if there is none.
+ */
+static int logic_scan(struct sr_session_file *sfile, uint64_t start,
+		uint64_t end, const uint8_t *mask, uint64_t *sample)
+{
+	unsigned int unitsize;
+	uint8_t *buf;
+	uint64_t i;
+	int ret;
+
+	unitsize = sfile->logic.unitsize;
+	buf = g_malloc((end - start + 1) * unitsize);
+	ret = sr_session_file_read_logic(sfile, start - 1, end, buf);
+	*sample = end;
+	for (i = 1; ret == SR_OK && i <= end - start; i++) {
+		if (logic_mask_hit(buf + i * unitsize, buf + (i - 1) * unitsize,
+				mask, unitsize)) {
+			*sample = start + i - 1;
+			break;
+		}
+	}
+	g_free(buf);
+
+	return ret;
+}
+
+/**
+ * Find the next logic transition in a session file.
+ *
+ * This uses the logic summary to skip blocks without transitions, so
+ * only O(log n) summary records and at most a few blocks of samples are
+ * looked at.
+ *
+ * @param[in] sfile The session file.
+ * @param[in] start The first sample which may be a transition.
+ * @param[in] mask The channels to look at, in the format of a logic
+ *                 sample. NULL for all channels.
+ * @param[out] sample The first sample at or after start that differs
+ *                    from the previous sample in any of the masked bits,
+ *                    or the number of samples if there is none.
+ *
+ * @retval SR_OK Success
+ * @retval SR_ERR_ARG Invalid argument
+ * @retval SR_ERR_NA The file has no logic summary
+ * @retval SR_ERR_DATA Malformed session file
+ *
+ * @since 0.6.0
+ */
+SR_API int sr_session_file_logic_next_transition(struct sr_session_file *sfile,
+		uint64_t start, const uint8_t *mask, uint64_t *sample)
+{
+	struct sr_session_file_series *series;
+	uint64_t pos, blocksize, b, n;
+	unsigned int l, unitsize;
+	int ret;
+
+	if (!sfile || !sample)
+		return SR_ERR_ARG;
+
+	series = &sfile->logic;
+	unitsize = series->unitsize;
+	if ((ret = series_summary_load(sfile, series, unitsize)) != SR_OK)
+		return ret;
+
+#define HIT(l, b) logic_mask_hit(series->summary + \
+	(series->level_offset[l] + (b)) * unitsize, NULL, mask, unitsize)
+
+	blocksize = sfile->summary_blocksize;
+	n = series->num_samples;
+	/* The first sample has no previous one to differ from. */
+	pos = MAX(start, 1);
+	while (pos < n) {
+		b = pos / blocksize;
+		if (pos % blocksize) {
+			/* Rest of a partially covered block. */
+			if (HIT(0, b)) {
+				ret = logic_scan(sfile, pos,
+					MIN(n, (b + 1) * blocksize), mask, sample);
+				if (ret != SR_OK || *sample < MIN(n, (b + 1) * blocksize))
+					return ret;
+			}
+			pos = (b + 1) * blocksize;
+			continue;
+		}
+
+		/* Skip the largest block starting at pos without a hit. */
+		l = 0;
+		while (l + 1 < series->num_levels && !(b & 1)) {
+			b >>= 1;
+			l++;
+		}
+		if (!HIT(l, b)) {
+			pos = (b + 1) * (blocksize << l);
+			continue;
+		}
+
+		/* Descend to the first finest block with a hit. */
+		while (l > 0) {
+			l--;
+			b <<= 1;
+			if (!HIT(l, b))
+				b++;
+		}
+		pos = b * blocksize;
+		ret = logic_scan(sfile, pos, MIN(n, pos + blocksize), mask,
+			sample);
+		if (ret != SR_OK || *sample < MIN(n, pos + blocksize))
+			return ret;
+		pos += blocksize;
+	}
+#undef HIT
+
+	*sample = n;
+
+	return SR_OK;
+}
+
 /** @} */
@@ -41,18 +41,142 @@ SR_PRIV int logic_channel_unitsize(GSList *channels)
 	return (number + 7) / 8;
 }
 
-SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
+/* A driver buffer held on to for the pre-trigger window. */
+struct retained_buffer {
+	uint8_t *buf;
+	size_t size;
+	int len;
+};
+
+/* Read up to 8 bytes of logic data as a little endian word. */
+static inline uint64_t logic_word(const uint8_t *p, int len)
+{
+	uint64_t word;
+	int i;
+
+	if (len >= 8)
+		return RL64(p);
+
+	word = 0;
+	for (i = 0; i < len; i++)
+		word |= (uint64_t)p[i] << (8 * i);
+
+	return word;
+}
+
+/* Replicate a (width bits wide) sample mask into all lanes of a word. */
+static uint64_t replicate_lanes(uint64_t mask, int width)
+{
+	uint64_t word;
+	int shift;
+
+	word = 0;
+	for (shift = 0; shift < 64; shift += width)
+		word |= mask << shift;
+
+	return word;
+}
+
+static int compile_stage(struct soft_trigger_logic *stl,
+		const struct sr_trigger_stage *stage,
+		struct soft_trigger_stage *cs)
+{
+	const struct sr_trigger_match *match;
+	struct soft_trigger_mask *m;
+	const GSList *l;
+	uint64_t bit;
+	int index, width;
+
+	cs->words = g_malloc0(stl->num_words * sizeof(*cs->words));
+	cs->empty = stage->matches == NULL;
+
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		if (!match->channel->enabled)
+			/* Ignore disabled channels with a trigger. */
+			continue;
+		index = match->channel->index;
+		if (match->channel->type != SR_CHANNEL_LOGIC
+				|| index >= stl->unitsize * 8) {
+			sr_err("Cannot trigger on channel %s.",
+				match->channel->name);
+			return SR_ERR_ARG;
+		}
+		m = &cs->words[index / 64];
+		bit = UINT64_C(1) << (index % 64);
+		switch (match->match) {
+		case SR_TRIGGER_ZERO:
+			m->zero |= bit;
+			break;
+		case SR_TRIGGER_ONE:
+			m->one |= bit;
+			break;
+		case SR_TRIGGER_RISING:
+			m->rising |= bit;
+			break;
+		case SR_TRIGGER_FALLING:
+			m->falling |= bit;
+			break;
+		case SR_TRIGGER_EDGE:
+			m->edge |= bit;
+			break;
+		default:
+			sr_err("Unsupported trigger match %d on channel %s.",
+				match->match, match->channel->name);
+			return SR_ERR_ARG;
+		}
+		if (match->match != SR_TRIGGER_ZERO
+				&& match->match != SR_TRIGGER_ONE)
+			cs->has_edges = TRUE;
+	}
+
+	if (stl->lanes) {
+		width = stl->unitsize * 8;
+		m = &cs->words[0];
+		cs->lanes.zero = replicate_lanes(m->zero, width);
+		cs->lanes.one = replicate_lanes(m->one, width);
+		cs->lanes.rising = replicate_lanes(m->rising, width);
+		cs->lanes.falling = replicate_lanes(m->falling, width);
+		cs->lanes.edge = replicate_lanes(m->edge, width);
+	}
+
+	return SR_OK;
+}
+
+static struct soft_trigger_logic *soft_trigger_logic_create(
 		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
-		int pre_trigger_samples)
+		int pre_trigger_samples, gboolean swap)
 {
 	struct soft_trigger_logic *stl;
+	GSList *l;
+	int i;
 
 	stl = g_malloc0(sizeof(struct soft_trigger_logic));
 	stl->sdi = sdi;
 	stl->trigger = trigger;
 	stl->unitsize = logic_channel_unitsize(sdi->channels);
+	stl->num_words = (stl->unitsize + 7) / 8;
+	/* Samples that evenly fill a 64-bit word get scanned in parallel. */
+	if (stl->unitsize == 1 || stl->unitsize == 2 || stl->unitsize == 4)
+		stl->lanes = 8 / stl->unitsize;
+
+	stl->num_stages = g_slist_length(trigger->stages);
+	stl->stages = g_malloc0(stl->num_stages * sizeof(*stl->stages));
+	for (l = trigger->stages, i = 0; l; l = l->next, i++) {
+		if (compile_stage(stl, l->data, &stl->stages[i]) != SR_OK) {
+			soft_trigger_logic_free(stl);
+			return NULL;
+		}
+	}
+
 	stl->prev_sample = g_malloc0(stl->unitsize);
 	stl->pre_trigger_size = stl->unitsize * pre_trigger_samples;
+	if (swap) {
+		/* The driver's buffers are retained instead of copied. */
+		stl->retained = g_queue_new();
+		stl->spares = g_queue_new();
+		return stl;
+	}
 	stl->pre_trigger_buffer = g_try_malloc(stl->pre_trigger_size);
 	if (pre_trigger_samples > 0 && !stl->pre_trigger_buffer) {
 		/*
@@ -73,8 +197,46 @@ SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
 	return stl;
 }
 
+SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples)
+{
+	return soft_trigger_logic_create(sdi, trigger, pre_trigger_samples,
+		FALSE);
+}
+
+/**
+ * Create a soft trigger which retains the driver's buffers for the
+ * pre-trigger window, see soft_trigger_logic_check_swap().
+ */
+SR_PRIV struct soft_trigger_logic *soft_trigger_logic_new_swap(
+		const struct sr_dev_inst *sdi, struct sr_trigger *trigger,
+		int pre_trigger_samples)
+{
+	return soft_trigger_logic_create(sdi, trigger, pre_trigger_samples,
+		TRUE);
+}
+
+static void retained_buffer_free(void *p)
+{
+	struct retained_buffer *rb;
+
+	rb = p;
+	g_free(rb->buf);
+	g_free(rb);
+}
+
 SR_PRIV void soft_trigger_logic_free(struct soft_trigger_logic *stl)
 {
+	int i;
+
+	if (stl->retained)
+		g_queue_free_full(stl->retained, retained_buffer_free);
+	if (stl->spares)
+		g_queue_free_full(stl->spares, retained_buffer_free);
+	for (i = 0; i < stl->num_stages; i++)
+		g_free(stl->stages[i].words);
+	g_free(stl->stages);
 	g_free(stl->pre_trigger_buffer);
 	g_free(stl->prev_sample);
 	g_free(stl);
@@ -138,109 +300,355 @@ static void pre_trigger_send(struct soft_trigger_logic *stl,
 	}
 }
 
-static gboolean logic_check_match(struct soft_trigger_logic *stl,
-		uint8_t *sample, struct sr_trigger_match *match)
+/*
+ * Returns a mask of the conditions in m which are not met by the
+ * current word c, given the previous word p. Zero means a match.
+ */
+static inline uint64_t mask_misses(const struct soft_trigger_mask *m,
+		uint64_t c, uint64_t p)
+{
+	return (m->zero & c) | (m->one & ~c)
+		| (m->rising & (~c | p))
+		| (m->falling & (c | ~p))
+		| (m->edge & ~(c ^ p));
+}
+
+/*
+ * Check a single sample against a compiled stage. The previous sample
+ * is NULL if not known, in which case edge matches cannot succeed.
+ */
+static gboolean stage_match(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage *stage,
+		const uint8_t *sample, const uint8_t *prev)
 {
-	int bit, prev_bit;
-	gboolean result;
+	uint64_t c, p;
+	int w, len;
 
-	stl->count++;
-	result = FALSE;
-	bit = *(sample + match->channel->index / 8)
-			& (1 << (match->channel->index % 8));
-	if (match->match == SR_TRIGGER_ZERO)
-		result = bit == 0;
-	else if (match->match == SR_TRIGGER_ONE)
-		result = bit != 0;
-	else {
-		/* Edge matches. */
-		if (stl->count == 1)
-			/* First sample, don't have enough for an edge match yet. */
+	if (stage->has_edges && !prev)
+		return FALSE;
+
+	p = 0;
+	for (w = 0; w < stl->num_words; w++) {
+		len = MIN(stl->unitsize - w * 8, 8);
+		c = logic_word(sample + w * 8, len);
+		if (prev)
+			p = logic_word(prev + w * 8, len);
+		if (mask_misses(&stage->words[w], c, p))
 			return FALSE;
-		prev_bit = *(stl->prev_sample + match->channel->index / 8)
-				& (1 << (match->channel->index % 8));
-		if (match->match == SR_TRIGGER_RISING)
-			result = prev_bit == 0 && bit != 0;
-		else if (match->match == SR_TRIGGER_FALLING)
-			result = prev_bit != 0 && bit == 0;
-		else if (match->match == SR_TRIGGER_EDGE)
-			result = prev_bit != bit;
 	}
 
-	return result;
+	return TRUE;
 }
 
-/* Returns the offset (in samples) within buf of where the trigger
- * occurred, or -1 if not triggered. */
-SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
-		uint8_t *buf, int len, int *pre_trigger_samples)
+/* Returns the first sample in the lowest zero lane of x, or -1. */
+static inline int first_zero_lane(uint64_t x, uint64_t lo, uint64_t hi,
+		int width)
 {
-	struct sr_datafeed_packet packet;
-	struct sr_trigger_stage *stage;
-	struct sr_trigger_match *match;
-	GSList *l, *l_stage;
-	int offset;
-	int i;
-	gboolean match_found;
+	uint64_t zero;
+	int bit;
+
+	/*
+	 * Only flags the lanes of x which are zero, and possibly lanes
+	 * above the first zero lane due to the borrow. The lowest flag
+	 * is always exact.
+	 */
+	zero = (x - lo) & ~x & hi;
+	if (!zero)
+		return -1;
+
+#ifdef __GNUC__
+	bit = __builtin_ctzll(zero);
+#else
+	for (bit = 0; !(zero & (UINT64_C(1) << bit)); bit++);
+#endif
+
+	return bit / width;
+}
+
+/*
+ * Find the first sample in [start, num_samples) of buf which matches the
+ * given stage. Returns its index, or -1 if there is none.
+ */
+static int stage_scan(const struct soft_trigger_logic *stl,
+		const struct soft_trigger_stage *stage,
+		const uint8_t *buf, int start, int num_samples)
+{
+	const uint8_t *prev;
+	uint64_t c, p, pv, lo, hi;
+	int i, lane, width, unitsize;
+
+	unitsize = stl->unitsize;
+	i = start;
+
+	/* Edge matches need a previous sample. */
+	if (i == 0 && stage->has_edges && !stl->prev_valid)
+		i = 1;
+
+	if (stl->lanes) {
+		width = unitsize * 8;
+		lo = replicate_lanes(1, width);
+		hi = lo << (width - 1);
+		if (i > 0)
+			pv = logic_word(buf + (i - 1) * unitsize, unitsize);
+		else
+			pv = stl->prev_valid ? logic_word(stl->prev_sample, unitsize) : 0;
+
+		/* Test one word full of samples at a time. */
+		for (; i + stl->lanes <= num_samples; i += stl->lanes) {
+			c = RL64(buf + i * unitsize);
+			p = (c << width) | pv;
+			lane = first_zero_lane(mask_misses(&stage->lanes, c, p),
+					lo, hi, width);
+			if (lane >= 0)
+				return i + lane;
+			pv = c >> (64 - width);
+		}
+	}
 
-	offset = -1;
-	for (i = 0; i < len; i += stl->unitsize) {
-		l_stage = g_slist_nth(stl->trigger->stages, stl->cur_stage);
-		stage = l_stage->data;
-		if (!stage->matches)
+	/* Leftover samples, or sample widths that don't fill a word. */
+	for (; i < num_samples; i++) {
+		if (i > 0)
+			prev = buf + (i - 1) * unitsize;
+		else
+			prev = stl->prev_valid ? stl->prev_sample : NULL;
+		if (stage_match(stl, stage, buf + i * unitsize, prev))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Run the compiled trigger stages over buf. Returns the offset (in
+ * samples) within buf of where the trigger occurred, -1 if not
+ * triggered, or a negative error code.
+ */
+static int trigger_scan(struct soft_trigger_logic *stl,
+		const uint8_t *buf, int len)
+{
+	struct soft_trigger_stage *stage;
+	const uint8_t *prev;
+	int i, num_samples;
+
+	if (stl->num_stages == 0)
+		return SR_ERR_ARG;
+
+	num_samples = len / stl->unitsize;
+	i = 0;
+	while (i < num_samples) {
+		stage = &stl->stages[stl->cur_stage];
+		if (stage->empty)
 			/* No matches supplied, client error. */
 			return SR_ERR_ARG;
 
-		match_found = TRUE;
-		for (l = stage->matches; l; l = l->next) {
-			match = l->data;
-			if (!match->channel->enabled)
-				/* Ignore disabled channels with a trigger. */
-				continue;
-			if (!logic_check_match(stl, buf + i, match)) {
-				match_found = FALSE;
+		if (stl->cur_stage == 0) {
+			/* Skip ahead to where the first stage matches. */
+			i = stage_scan(stl, stage, buf, i, num_samples);
+			if (i < 0)
 				break;
+		} else {
+			if (i > 0)
+				prev = buf + (i - 1) * stl->unitsize;
+			else
+				prev = stl->prev_valid ? stl->prev_sample : NULL;
+			if (!stage_match(stl, stage, buf + i * stl->unitsize, prev)) {
+				/*
+				 * We had a match at an earlier stage, but failed on
+				 * the current stage. However, we may have a match on
+				 * this stage in the next bit -- trigger on 0001 will
+				 * fail on seeing 00001, so we need to go back to
+				 * stage 0 -- but at the next sample from the one that
+				 * matched originally. Samples of earlier buffers are
+				 * gone, so never go back past this buffer.
+				 */
+				i = MAX(i - stl->cur_stage + 1, 0);
+				/* Reset trigger stage. */
+				stl->cur_stage = 0;
+				continue;
 			}
 		}
-		memcpy(stl->prev_sample, buf + i, stl->unitsize);
-		if (match_found) {
-			/* Matched on the current stage. */
-			if (l_stage->next) {
-				/* Advance to next stage. */
-				stl->cur_stage++;
-			} else {
-				/* Matched on last stage, send pre-trigger data. */
-				pre_trigger_append(stl, buf, i);
-				pre_trigger_send(stl, pre_trigger_samples);
-
-				/* Fire trigger. */
-				offset = i / stl->unitsize;
-
-				packet.type = SR_DF_TRIGGER;
-				packet.payload = NULL;
-				sr_session_send(stl->sdi, &packet);
-				break;
-			}
-		} else if (stl->cur_stage > 0) {
-			/*
-			 * We had a match at an earlier stage, but failed on the
-			 * current stage. However, we may have a match on this
-			 * stage in the next bit -- trigger on 0001 will fail on
-			 * seeing 00001, so we need to go back to stage 0 -- but
-			 * at the next sample from the one that matched originally,
-			 * which the counter increment at the end of the loop
-			 * takes care of.
-			 */
-			i -= stl->cur_stage * stl->unitsize;
-			if (i < -1)
-				i = -1; /* Oops, went back past this buffer. */
-			/* Reset trigger stage. */
-			stl->cur_stage = 0;
+
+		/* Matched on the current stage. */
+		if (stl->cur_stage + 1 < stl->num_stages) {
+			/* Advance to next stage. */
+			stl->cur_stage++;
+			i++;
+			continue;
 		}
+
+		/* Matched on last stage. */
+		return i;
+	}
+
+	if (num_samples > 0) {
+		memcpy(stl->prev_sample, buf + (num_samples - 1) * stl->unitsize,
+			stl->unitsize);
+		stl->prev_valid = TRUE;
 	}
 
-	if (offset == -1)
+	return -1;
+}
+
+static void send_trigger(struct soft_trigger_logic *stl)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = SR_DF_TRIGGER;
+	packet.payload = NULL;
+	sr_session_send(stl->sdi, &packet);
+}
+
+/* Returns the offset (in samples) within buf of where the trigger
+ * occurred, or -1 if not triggered. */
+SR_PRIV int soft_trigger_logic_check(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len, int *pre_trigger_samples)
+{
+	int offset;
+
+	offset = trigger_scan(stl, buf, len);
+	if (offset < -1)
+		return offset;
+
+	if (offset == -1) {
 		pre_trigger_append(stl, buf, len);
+		return offset;
+	}
+
+	/* Send pre-trigger data, then fire trigger. */
+	pre_trigger_append(stl, buf, offset * stl->unitsize);
+	pre_trigger_send(stl, pre_trigger_samples);
+	send_trigger(stl);
 
 	return offset;
 }
+
+/*
+ * Send the newest pre_trigger_size bytes of the retained buffers, followed
+ * by the first len bytes of buf, straight out of the driver's buffers.
+ */
+static void retained_send(struct soft_trigger_logic *stl,
+		uint8_t *buf, int len, int *pre_trigger_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct retained_buffer *rb;
+	int skip;
+
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	logic.unitsize = stl->unitsize;
+
+	if (pre_trigger_samples)
+		*pre_trigger_samples = 0;
+
+	skip = MAX(stl->retained_len + len - stl->pre_trigger_size, 0);
+	while ((rb = g_queue_pop_head(stl->retained))) {
+		if (rb->len > skip) {
+			logic.length = rb->len - skip;
+			logic.data = rb->buf + skip;
+			sr_session_send(stl->sdi, &packet);
+			if (pre_trigger_samples)
+				*pre_trigger_samples += logic.length / stl->unitsize;
+			skip = 0;
+		} else {
+			skip -= rb->len;
+		}
+		g_free(rb->buf);
+		g_free(rb);
+	}
+	stl->retained_len = 0;
+
+	if (len > skip) {
+		logic.length = len - skip;
+		logic.data = buf + skip;
+		sr_session_send(stl->sdi, &packet);
+		if (pre_trigger_samples)
+			*pre_trigger_samples += logic.length / stl->unitsize;
+	}
+}
+
+/* Get a spare buffer of at least size bytes, or NULL. */
+static uint8_t *spare_buffer_get(struct soft_trigger_logic *stl, size_t size)
+{
+	struct retained_buffer *rb;
+	uint8_t *buf;
+
+	buf = NULL;
+	while (!buf && (rb = g_queue_pop_head(stl->spares))) {
+		if (rb->size >= size)
+			buf = rb->buf;
+		else
+			g_free(rb->buf);
+		g_free(rb);
+	}
+
+	if (!buf)
+		buf = g_try_malloc(size);
+
+	return buf;
+}
+
+/**
+ * Check for a trigger like soft_trigger_logic_check(), but without copying
+ * data into the pre-trigger buffer.
+ *
+ * If the trigger did not fire, the soft trigger takes ownership of the
+ * g_malloc()ed buffer *buf of bufsize bytes for as long as it covers the
+ * pre-trigger window, and *buf is replaced with a buffer of at least
+ * bufsize bytes which is owned by the caller from now on. Buffers which
+ * drop out of the pre-trigger window are handed back this way, so there
+ * is no allocation once the window is filled.
+ *
+ * If the trigger fired, *buf is left alone, and the retained buffers are
+ * sent as they are, followed by the part of *buf before the trigger.
+ *
+ * The soft trigger must have been created with soft_trigger_logic_new_swap().
+ *
+ * @return The offset (in samples) within *buf of where the trigger
+ *         occurred, -1 if not triggered, or a negative error code.
+ */
+SR_PRIV int soft_trigger_logic_check_swap(struct soft_trigger_logic *stl,
+		uint8_t **buf, size_t bufsize, int len, int *pre_trigger_samples)
+{
+	struct retained_buffer *rb;
+	uint8_t *spare;
+	int offset;
+
+	offset = trigger_scan(stl, *buf, len);
+	if (offset < -1)
+		return offset;
+
+	if (offset >= 0) {
+		retained_send(stl, *buf, offset * stl->unitsize,
+			pre_trigger_samples);
+		send_trigger(stl);
+		return offset;
+	}
+
+	rb = g_malloc(sizeof(struct retained_buffer));
+	rb->buf = *buf;
+	rb->size = bufsize;
+	rb->len = len - len % stl->unitsize;
+	g_queue_push_tail(stl->retained, rb);
+	stl->retained_len += rb->len;
+
+	/* Drop buffers which are no longer needed for the pre-trigger window. */
+	while ((rb = g_queue_peek_head(stl->retained))
+			&& stl->retained_len - rb->len >= stl->pre_trigger_size) {
+		g_queue_pop_head(stl->retained);
+		stl->retained_len -= rb->len;
+		g_queue_push_tail(stl->spares, rb);
+	}
+
+	if (!(spare = spare_buffer_get(stl, bufsize))) {
+		sr_err("Failed to allocate transfer buffer.");
+		/* The buffer just passed in is still the newest retained one. */
+		rb = g_queue_pop_tail(stl->retained);
+		stl->retained_len -= rb->len;
+		g_free(rb);
+		return SR_ERR_MALLOC;
+	}
+	*buf = spare;
+
+	return -1;
+}
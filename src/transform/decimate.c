@@ -0,0 +1,632 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/decimate"
+
+enum logic_mode {
+	/* A channel is high if it was high at any time in the window. */
+	LOGIC_OR,
+	/* A channel is high if it was high during all of the window. */
+	LOGIC_AND,
+	/* A channel is high if it changed state in the window. */
+	LOGIC_EDGE,
+};
+
+enum analog_mode {
+	/*
+	 * The minimum and maximum of a window of twice the factor, in the
+	 * order they occurred. This keeps the output rate the same as in
+	 * the other modes.
+	 */
+	ANALOG_MINMAX,
+	/* The mean value of the window. */
+	ANALOG_MEAN,
+	/* The value of the largest magnitude in the window. */
+	ANALOG_PEAK,
+};
+
+static const char *logic_modes[] = {
+	[LOGIC_OR] = "or",
+	[LOGIC_AND] = "and",
+	[LOGIC_EDGE] = "edge",
+};
+
+static const char *analog_modes[] = {
+	[ANALOG_MINMAX] = "minmax",
+	[ANALOG_MEAN] = "mean",
+	[ANALOG_PEAK] = "peak",
+};
+
+/* The analog window in progress for one channel. */
+struct analog_window {
+	uint64_t count;
+	double sum;
+	float min, max, peak;
+	uint64_t min_pos, max_pos;
+};
+
+struct context {
+	uint64_t factor;
+	enum logic_mode logic_mode;
+	enum analog_mode analog_mode;
+
+	/* The logic window in progress. */
+	unsigned int unitsize;
+	uint64_t logic_count;
+	uint8_t *acc;
+	/* Last logic sample seen, for edge detection. */
+	uint8_t *prev;
+	gboolean have_prev;
+
+	/* Analog windows in progress, by channel. */
+	GHashTable *analog_windows;
+
+	/* Output buffers, grown as needed. */
+	uint8_t *logic_buf;
+	size_t logic_buf_size;
+	float *float_buf;
+	size_t float_buf_size;
+	/* The samples of one channel of a multi-channel packet. */
+	float *chan_buf;
+	size_t chan_buf_size;
+	/* The windows of the channels of the current packet. */
+	struct analog_window **windows;
+	size_t windows_size;
+	float *analog_buf;
+	size_t analog_buf_size;
+
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	struct sr_datafeed_meta meta;
+	struct sr_config *samplerate;
+};
+
+static int find_mode(const char **modes, unsigned int num_modes,
+		const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_modes; i++) {
+		if (!strcmp(modes[i], name))
+			return i;
+	}
+
+	sr_err("Unknown mode '%s'.", name);
+
+	return -1;
+}
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	uint64_t factor;
+	int logic_mode, analog_mode;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	factor = g_variant_get_uint64(g_hash_table_lookup(options, "factor"));
+	if (!factor) {
+		sr_err("Invalid decimation factor 0.");
+		return SR_ERR_ARG;
+	}
+	logic_mode = find_mode(logic_modes, ARRAY_SIZE(logic_modes),
+		g_variant_get_string(g_hash_table_lookup(options, "logic"), NULL));
+	analog_mode = find_mode(analog_modes, ARRAY_SIZE(analog_modes),
+		g_variant_get_string(g_hash_table_lookup(options, "analog"), NULL));
+	if (logic_mode < 0 || analog_mode < 0)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+	ctx->factor = factor;
+	ctx->logic_mode = logic_mode;
+	ctx->analog_mode = analog_mode;
+	ctx->analog_windows = g_hash_table_new_full(g_direct_hash,
+			g_direct_equal, NULL, g_free);
+
+	return SR_OK;
+}
+
+/* Make sure *buf holds at least size bytes. */
+static int grow(void **buf, size_t *buf_size, size_t size)
+{
+	void *new_buf;
+
+	if (size <= *buf_size)
+		return SR_OK;
+	if (!(new_buf = g_try_realloc(*buf, size))) {
+		sr_err("Failed to allocate output buffer.");
+		return SR_ERR_MALLOC;
+	}
+	*buf = new_buf;
+	*buf_size = size;
+
+	return SR_OK;
+}
+
+static void logic_window_reset(struct context *ctx)
+{
+	memset(ctx->acc, ctx->logic_mode == LOGIC_AND ? 0xff : 0x00,
+		ctx->unitsize);
+	ctx->logic_count = 0;
+}
+
+/*
+ * Fold n samples into the logic window in progress, in a single pass
+ * over the data.
+ */
+static void logic_fold(struct context *ctx, const uint8_t *data, uint64_t n)
+{
+	unsigned int j, unitsize;
+	uint64_t i, len, word, prev, acc;
+	uint8_t *a, bytes[8];
+
+	unitsize = ctx->unitsize;
+	a = ctx->acc;
+	len = n * unitsize;
+	i = 0;
+
+	if (ctx->logic_mode == LOGIC_EDGE) {
+		for (j = 0; j < unitsize; j++)
+			a[j] |= data[j] ^ ctx->prev[j];
+		i = unitsize;
+	}
+
+	/*
+	 * When the unit size divides 8, a byte of a 64-bit word always
+	 * belongs to the same byte of a sample, so the data is folded a
+	 * word at a time, and the word is folded into the window last.
+	 */
+	if (8 % unitsize == 0) {
+		acc = ctx->logic_mode == LOGIC_AND ? ~(uint64_t)0 : 0;
+		switch (ctx->logic_mode) {
+		case LOGIC_OR:
+			for (; i + 8 <= len; i += 8) {
+				memcpy(&word, data + i, 8);
+				acc |= word;
+			}
+			break;
+		case LOGIC_AND:
+			for (; i + 8 <= len; i += 8) {
+				memcpy(&word, data + i, 8);
+				acc &= word;
+			}
+			break;
+		case LOGIC_EDGE:
+			for (; i + 8 <= len; i += 8) {
+				memcpy(&word, data + i, 8);
+				memcpy(&prev, data + i - unitsize, 8);
+				acc |= word ^ prev;
+			}
+			break;
+		}
+		memcpy(bytes, &acc, 8);
+		for (j = 0; j < 8; j++) {
+			if (ctx->logic_mode == LOGIC_AND)
+				a[j % unitsize] &= bytes[j];
+			else
+				a[j % unitsize] |= bytes[j];
+		}
+	}
+
+	/* Whatever is left, a sample at a time. */
+	switch (ctx->logic_mode) {
+	case LOGIC_OR:
+		for (; i < len; i += unitsize) {
+			for (j = 0; j < unitsize; j++)
+				a[j] |= data[i + j];
+		}
+		break;
+	case LOGIC_AND:
+		for (; i < len; i += unitsize) {
+			for (j = 0; j < unitsize; j++)
+				a[j] &= data[i + j];
+		}
+		break;
+	case LOGIC_EDGE:
+		for (; i < len; i += unitsize) {
+			for (j = 0; j < unitsize; j++)
+				a[j] |= data[i + j] ^ data[i + j - unitsize];
+		}
+		memcpy(ctx->prev, data + len - unitsize, unitsize);
+		break;
+	}
+}
+
+static int receive_logic(struct context *ctx,
+		const struct sr_datafeed_logic *logic,
+		struct sr_datafeed_packet **packet_out)
+{
+	const uint8_t *data;
+	uint64_t samples, n, out;
+	int ret;
+
+	*packet_out = NULL;
+	if (!logic->unitsize)
+		return SR_OK;
+
+	if (logic->unitsize != ctx->unitsize) {
+		ctx->unitsize = logic->unitsize;
+		ctx->acc = g_realloc(ctx->acc, ctx->unitsize);
+		ctx->prev = g_realloc(ctx->prev, ctx->unitsize);
+		ctx->have_prev = FALSE;
+		logic_window_reset(ctx);
+	}
+
+	data = logic->data;
+	samples = logic->length / logic->unitsize;
+	if (!samples)
+		return SR_OK;
+	if (!ctx->have_prev) {
+		memcpy(ctx->prev, data, ctx->unitsize);
+		ctx->have_prev = TRUE;
+	}
+
+	out = (ctx->logic_count + samples) / ctx->factor;
+	ret = grow((void **)&ctx->logic_buf, &ctx->logic_buf_size,
+		out * ctx->unitsize);
+	if (ret != SR_OK)
+		return ret;
+
+	out = 0;
+	while (samples) {
+		n = MIN(samples, ctx->factor - ctx->logic_count);
+		logic_fold(ctx, data, n);
+		data += n * ctx->unitsize;
+		samples -= n;
+		ctx->logic_count += n;
+		if (ctx->logic_count < ctx->factor)
+			break;
+		memcpy(ctx->logic_buf + out++ * ctx->unitsize, ctx->acc,
+			ctx->unitsize);
+		logic_window_reset(ctx);
+	}
+	if (!out)
+		return SR_OK;
+
+	ctx->logic.length = out * ctx->unitsize;
+	ctx->logic.unitsize = ctx->unitsize;
+	ctx->logic.data = ctx->logic_buf;
+	ctx->packet.type = SR_DF_LOGIC;
+	ctx->packet.payload = &ctx->logic;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static void analog_window_reset(struct analog_window *w)
+{
+	w->count = 0;
+	w->sum = 0;
+	w->min = INFINITY;
+	w->max = -INFINITY;
+	w->peak = 0;
+}
+
+/* Fold n samples into an analog window in progress. */
+static void analog_fold(struct context *ctx, struct analog_window *w,
+		const float *data, uint64_t n)
+{
+	uint64_t i;
+	double sum;
+	float peak;
+
+	switch (ctx->analog_mode) {
+	case ANALOG_MINMAX:
+		for (i = 0; i < n; i++) {
+			if (data[i] < w->min) {
+				w->min = data[i];
+				w->min_pos = w->count + i;
+			}
+			if (data[i] > w->max) {
+				w->max = data[i];
+				w->max_pos = w->count + i;
+			}
+		}
+		break;
+	case ANALOG_MEAN:
+		sum = 0;
+		for (i = 0; i < n; i++)
+			sum += data[i];
+		w->sum += sum;
+		break;
+	case ANALOG_PEAK:
+		peak = w->peak;
+		for (i = 0; i < n; i++)
+			peak = fabsf(data[i]) > fabsf(peak) ? data[i] : peak;
+		w->peak = peak;
+		break;
+	}
+	w->count += n;
+}
+
+/* Write the result of a complete window to out, returns its length. */
+static unsigned int analog_emit(struct context *ctx,
+		const struct analog_window *w, float *out)
+{
+	switch (ctx->analog_mode) {
+	case ANALOG_MINMAX:
+		out[0] = w->min_pos <= w->max_pos ? w->min : w->max;
+		out[1] = w->min_pos <= w->max_pos ? w->max : w->min;
+		return 2;
+	case ANALOG_MEAN:
+		out[0] = w->sum / w->count;
+		return 1;
+	case ANALOG_PEAK:
+		out[0] = w->peak;
+		return 1;
+	}
+
+	return 0;
+}
+
+static struct analog_window *analog_window_get(struct context *ctx,
+		void *key)
+{
+	struct analog_window *w;
+
+	if (!(w = g_hash_table_lookup(ctx->analog_windows, key))) {
+		w = g_malloc0(sizeof(*w));
+		analog_window_reset(w);
+		g_hash_table_insert(ctx->analog_windows, key, w);
+	}
+
+	return w;
+}
+
+/*
+ * The samples of a multi-channel packet are interleaved. Each channel
+ * is decimated in its own window, and the results are interleaved the
+ * same way, so the windows of the channels must be in step.
+ */
+static int receive_analog(struct context *ctx,
+		const struct sr_datafeed_analog *analog,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct analog_window **w;
+	const float *data;
+	float result[2];
+	GSList *l;
+	uint64_t samples, n, window, out, i;
+	unsigned int num_channels, c, k, num;
+	int ret;
+
+	*packet_out = NULL;
+	num_channels = g_slist_length(analog->meaning->channels);
+	samples = analog->num_samples;
+	if (!num_channels || !samples)
+		return SR_OK;
+	ret = grow((void **)&ctx->float_buf, &ctx->float_buf_size,
+		samples * num_channels * sizeof(float));
+	if (ret != SR_OK)
+		return ret;
+	if (num_channels > 1) {
+		ret = grow((void **)&ctx->chan_buf, &ctx->chan_buf_size,
+			samples * sizeof(float));
+		if (ret != SR_OK)
+			return ret;
+	}
+	ret = grow((void **)&ctx->windows, &ctx->windows_size,
+		num_channels * sizeof(*w));
+	if (ret != SR_OK)
+		return ret;
+	if ((ret = sr_analog_to_float(analog, ctx->float_buf)) != SR_OK)
+		return ret;
+
+	w = ctx->windows;
+	c = 0;
+	for (l = analog->meaning->channels; l; l = l->next)
+		w[c++] = analog_window_get(ctx, l->data);
+	for (c = 1; c < num_channels; c++) {
+		if (w[c]->count != w[0]->count)
+			break;
+	}
+	if (c < num_channels) {
+		sr_dbg("Channels out of step, dropping their partial windows.");
+		for (c = 0; c < num_channels; c++)
+			analog_window_reset(w[c]);
+	}
+
+	window = ctx->factor * (ctx->analog_mode == ANALOG_MINMAX ? 2 : 1);
+	/* At most two values per window. */
+	out = (w[0]->count + samples) / window * 2;
+	ret = grow((void **)&ctx->analog_buf, &ctx->analog_buf_size,
+		out * num_channels * sizeof(float));
+	if (ret != SR_OK)
+		return ret;
+
+	for (c = 0; c < num_channels; c++) {
+		if (num_channels > 1) {
+			for (i = 0; i < samples; i++)
+				ctx->chan_buf[i] = ctx->float_buf[i * num_channels + c];
+			data = ctx->chan_buf;
+		} else {
+			data = ctx->float_buf;
+		}
+		out = 0;
+		for (i = samples; i; i -= n) {
+			n = MIN(i, window - w[c]->count);
+			analog_fold(ctx, w[c], data, n);
+			data += n;
+			if (w[c]->count < window)
+				break;
+			num = analog_emit(ctx, w[c], result);
+			for (k = 0; k < num; k++)
+				ctx->analog_buf[(out + k) * num_channels + c] = result[k];
+			out += num;
+			analog_window_reset(w[c]);
+		}
+	}
+	if (!out)
+		return SR_OK;
+
+	sr_analog_init(&ctx->analog, &ctx->encoding, &ctx->meaning,
+		&ctx->spec, analog->encoding->digits);
+	ctx->meaning = *analog->meaning;
+	if (analog->spec)
+		ctx->spec = *analog->spec;
+	ctx->analog.data = ctx->analog_buf;
+	ctx->analog.num_samples = out;
+	ctx->packet.type = SR_DF_ANALOG;
+	ctx->packet.payload = &ctx->analog;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+/* Pass on the samplerate after decimation. */
+static int receive_meta(struct context *ctx,
+		const struct sr_datafeed_meta *meta,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct sr_config *src;
+	GSList *l, *config;
+
+	*packet_out = packet_in;
+
+	for (l = meta->config; l; l = l->next) {
+		src = l->data;
+		if (src->key == SR_CONF_SAMPLERATE)
+			break;
+	}
+	if (!l)
+		return SR_OK;
+
+	g_slist_free(ctx->meta.config);
+	if (ctx->samplerate)
+		sr_config_free(ctx->samplerate);
+	ctx->samplerate = sr_config_new(SR_CONF_SAMPLERATE,
+		g_variant_new_uint64(g_variant_get_uint64(src->data) / ctx->factor));
+	config = NULL;
+	for (l = meta->config; l; l = l->next) {
+		config = g_slist_append(config,
+			l->data == src ? ctx->samplerate : l->data);
+	}
+	ctx->meta.config = config;
+
+	ctx->packet.type = SR_DF_META;
+	ctx->packet.payload = &ctx->meta;
+	*packet_out = &ctx->packet;
+
+	return SR_OK;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		/* Partial windows of an earlier acquisition are dropped. */
+		if (ctx->unitsize)
+			logic_window_reset(ctx);
+		ctx->have_prev = FALSE;
+		g_hash_table_remove_all(ctx->analog_windows);
+		*packet_out = packet_in;
+		return SR_OK;
+	case SR_DF_META:
+		return receive_meta(ctx, packet_in->payload, packet_in, packet_out);
+	case SR_DF_LOGIC:
+		return receive_logic(ctx, packet_in->payload, packet_out);
+	case SR_DF_ANALOG:
+		return receive_analog(ctx, packet_in->payload, packet_out);
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		*packet_out = packet_in;
+		return SR_OK;
+	}
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_free(ctx->acc);
+	g_free(ctx->prev);
+	g_hash_table_destroy(ctx->analog_windows);
+	g_free(ctx->logic_buf);
+	g_free(ctx->float_buf);
+	g_free(ctx->chan_buf);
+	g_free(ctx->windows);
+	g_free(ctx->analog_buf);
+	g_slist_free(ctx->meta.config);
+	if (ctx->samplerate)
+		sr_config_free(ctx->samplerate);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "factor", "Factor", "Number of samples to reduce to one", NULL, NULL },
+	{ "logic", "Logic mode", "How to reduce logic samples", NULL, NULL },
+	{ "analog", "Analog mode", "How to reduce analog samples", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	unsigned int i;
+
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(10));
+		options[1].def = g_variant_ref_sink(g_variant_new_string(
+				logic_modes[LOGIC_OR]));
+		for (i = 0; i < ARRAY_SIZE(logic_modes); i++)
+			options[1].values = g_slist_append(options[1].values,
+				g_variant_ref_sink(g_variant_new_string(logic_modes[i])));
+		options[2].def = g_variant_ref_sink(g_variant_new_string(
+				analog_modes[ANALOG_MINMAX]));
+		for (i = 0; i < ARRAY_SIZE(analog_modes); i++)
+			options[2].values = g_slist_append(options[2].values,
+				g_variant_ref_sink(g_variant_new_string(analog_modes[i])));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_decimate = {
+	.id = "decimate",
+	.name = "Decimate",
+	.desc = "Reduce the samplerate, keeping the signal envelope",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
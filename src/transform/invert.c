@@ -24,15 +24,27 @@
 
 #define LOG_PREFIX "transform/invert"
 
+static void logic_block(const struct sr_transform *t, uint8_t *data,
+		size_t length, unsigned int unitsize)
+{
+	size_t i;
+
+	(void)t;
+	(void)unitsize;
+
+	/* For now invert every bit in every byte. */
+	for (i = 0; i < length; i++)
+		data[i] = ~data[i];
+}
+
 static int receive(const struct sr_transform *t,
 		struct sr_datafeed_packet *packet_in,
 		struct sr_datafeed_packet **packet_out)
 {
 	const struct sr_datafeed_logic *logic;
 	const struct sr_datafeed_analog *analog;
-	uint8_t *b;
 	int64_t p;
-	uint64_t i, j, q;
+	uint64_t q;
 
 	if (!t || !t->sdi || !packet_in || !packet_out)
 		return SR_ERR_ARG;
@@ -40,13 +52,11 @@ static int receive(const struct sr_transform *t,
 	switch (packet_in->type) {
 	case SR_DF_LOGIC:
 		logic = packet_in->payload;
-		for (i = 0; i <= logic->length - logic->unitsize; i += logic->unitsize) {
-			for (j = 0; j < logic->unitsize; j++) {
-				/* For now invert every bit in every byte. */
-				b = (uint8_t *)logic->data + i + logic->unitsize - 1 - j;
-				*b = ~(*b);
-			}
-		}
+		if (!logic->unitsize)
+			break;
+		logic_block(t, logic->data,
+			logic->length - logic->length % logic->unitsize,
+			logic->unitsize);
 		break;
 	case SR_DF_ANALOG:
 		analog = packet_in->payload;
@@ -75,5 +85,7 @@ SR_PRIV struct sr_transform_module transform_invert = {
 	.options = NULL,
 	.init = NULL,
 	.receive = receive,
+	.flags = SR_TRANSFORM_INPLACE | SR_TRANSFORM_FUSABLE,
+	.logic_block = logic_block,
 	.cleanup = NULL,
 };
@@ -45,5 +45,6 @@ SR_PRIV struct sr_transform_module transform_nop = {
 	.options = NULL,
 	.init = NULL,
 	.receive = receive,
+	.flags = SR_TRANSFORM_INPLACE,
 	.cleanup = NULL,
 };
@@ -109,5 +109,6 @@ SR_PRIV struct sr_transform_module transform_scale = {
 	.options = get_options,
 	.init = init,
 	.receive = receive,
+	.flags = SR_TRANSFORM_INPLACE,
 	.cleanup = cleanup,
 };
@@ -0,0 +1,195 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/subset"
+
+struct context {
+	/* The selected channels. */
+	GSList *channels;
+	/* Bits of the selected logic channels, by byte of a sample. */
+	uint8_t *mask;
+	unsigned int mask_size;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+	struct sr_channel *ch;
+	const char *names;
+	char **tokens;
+	GSList *l;
+	unsigned int i;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	names = g_variant_get_string(g_hash_table_lookup(options, "channels"), NULL);
+	if (!*names) {
+		sr_err("No channels specified.");
+		return SR_ERR_ARG;
+	}
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	tokens = g_strsplit(names, ",", 0);
+	for (i = 0; tokens[i]; i++) {
+		g_strstrip(tokens[i]);
+		for (l = t->sdi->channels; l; l = l->next) {
+			ch = l->data;
+			if (!strcmp(ch->name, tokens[i]))
+				break;
+		}
+		if (!l) {
+			sr_err("Unknown channel '%s'.", tokens[i]);
+			g_strfreev(tokens);
+			g_slist_free(ctx->channels);
+			g_free(ctx);
+			t->priv = NULL;
+			return SR_ERR_ARG;
+		}
+		ctx->channels = g_slist_append(ctx->channels, l->data);
+	}
+	g_strfreev(tokens);
+
+	for (l = ctx->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type != SR_CHANNEL_LOGIC)
+			continue;
+		if ((unsigned int)ch->index / 8 >= ctx->mask_size)
+			ctx->mask_size = ch->index / 8 + 1;
+	}
+	ctx->mask = g_malloc0(ctx->mask_size);
+	for (l = ctx->channels; l; l = l->next) {
+		ch = l->data;
+		if (ch->type == SR_CHANNEL_LOGIC)
+			ctx->mask[ch->index / 8] |= 1 << (ch->index % 8);
+	}
+
+	return SR_OK;
+}
+
+/* Logic channels outside of the subset read as low. */
+static void logic_block(const struct sr_transform *t, uint8_t *data,
+		size_t length, unsigned int unitsize)
+{
+	struct context *ctx;
+	size_t i;
+	unsigned int j;
+	uint8_t mask;
+
+	ctx = t->priv;
+
+	if (unitsize == 1) {
+		mask = ctx->mask_size ? ctx->mask[0] : 0;
+		for (i = 0; i < length; i++)
+			data[i] &= mask;
+		return;
+	}
+
+	for (i = 0; i < length; i += unitsize) {
+		for (j = 0; j < unitsize; j++)
+			data[i + j] &= (j < ctx->mask_size) ? ctx->mask[j] : 0;
+	}
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	GSList *l;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		logic_block(t, logic->data,
+			logic->length - logic->length % logic->unitsize,
+			logic->unitsize);
+		break;
+	case SR_DF_ANALOG:
+		/* Only pass on analog data of at least one selected channel. */
+		analog = packet_in->payload;
+		for (l = analog->meaning->channels; l; l = l->next) {
+			if (g_slist_find(ctx->channels, l->data))
+				break;
+		}
+		if (!l)
+			*packet_out = NULL;
+		break;
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_slist_free(ctx->channels);
+	g_free(ctx->mask);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "channels", "Channels", "Comma-separated list of channels to keep", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def)
+		options[0].def = g_variant_ref_sink(g_variant_new_string(""));
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_subset = {
+	.id = "subset",
+	.name = "Channel subset",
+	.desc = "Keep only the data of the given channels",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.flags = SR_TRANSFORM_INPLACE | SR_TRANSFORM_FUSABLE,
+	.logic_block = logic_block,
+	.cleanup = cleanup,
+};
@@ -45,12 +45,18 @@
 extern SR_PRIV struct sr_transform_module transform_nop;
 extern SR_PRIV struct sr_transform_module transform_scale;
 extern SR_PRIV struct sr_transform_module transform_invert;
+extern SR_PRIV struct sr_transform_module transform_subset;
+extern SR_PRIV struct sr_transform_module transform_window;
+extern SR_PRIV struct sr_transform_module transform_decimate;
 /* @endcond */
 
 static const struct sr_transform_module *transform_module_list[] = {
 	&transform_nop,
 	&transform_scale,
 	&transform_invert,
+	&transform_subset,
+	&transform_window,
+	&transform_decimate,
 	NULL,
 };
 
@@ -257,9 +263,12 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
 	}
 	if (new_opts)
 		g_hash_table_destroy(new_opts);
+	if (!t)
+		return NULL;
 
 	/* Add the transform to the session's list of transforms. */
 	sdi->session->transforms = g_slist_append(sdi->session->transforms, t);
+	sr_session_transforms_compile(sdi->session);
 
 	return t;
 }
@@ -271,11 +280,19 @@ SR_API const struct sr_transform *sr_transform_new(const struct sr_transform_mod
  */
 SR_API int sr_transform_free(const struct sr_transform *t)
 {
+	struct sr_session *session;
 	int ret;
 
 	if (!t)
 		return SR_ERR_ARG;
 
+	/* Take the transform out of its session's chain. */
+	session = t->sdi->session;
+	if (session && g_slist_find(session->transforms, t)) {
+		session->transforms = g_slist_remove(session->transforms, t);
+		sr_session_transforms_compile(session);
+	}
+
 	ret = SR_OK;
 	if (t->module->cleanup)
 		ret = t->module->cleanup((struct sr_transform *)t);
@@ -0,0 +1,191 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <string.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+#define LOG_PREFIX "transform/window"
+
+struct context {
+	uint64_t start;
+	/* 0 means up to the end of the acquisition. */
+	uint64_t length;
+
+	/* Logic samples seen so far. */
+	uint64_t logic_pos;
+	/* Analog samples seen so far, by channel. */
+	GHashTable *analog_pos;
+
+	/* The packet passed on when only part of a packet is kept. */
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	struct sr_datafeed_analog analog;
+};
+
+static int init(struct sr_transform *t, GHashTable *options)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi || !options)
+		return SR_ERR_ARG;
+
+	t->priv = ctx = g_malloc0(sizeof(struct context));
+
+	ctx->start = g_variant_get_uint64(g_hash_table_lookup(options, "start"));
+	ctx->length = g_variant_get_uint64(g_hash_table_lookup(options, "length"));
+	ctx->analog_pos = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+			NULL, g_free);
+
+	return SR_OK;
+}
+
+/*
+ * Clip the samples [pos, pos + count) to the window. Returns the number
+ * of samples to keep, and in skip the number of leading samples to drop.
+ */
+static uint64_t clip(const struct context *ctx, uint64_t pos, uint64_t count,
+		uint64_t *skip)
+{
+	uint64_t begin, end;
+
+	begin = MAX(pos, ctx->start);
+	end = pos + count;
+	if (ctx->length && end > ctx->start
+			&& end - ctx->start > ctx->length)
+		end = ctx->start + ctx->length;
+	if (end <= begin)
+		return 0;
+	*skip = begin - pos;
+
+	return end - begin;
+}
+
+static int receive(const struct sr_transform *t,
+		struct sr_datafeed_packet *packet_in,
+		struct sr_datafeed_packet **packet_out)
+{
+	struct context *ctx;
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	uint64_t count, keep, skip, *pos;
+	void *key;
+
+	if (!t || !t->sdi || !packet_in || !packet_out)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	*packet_out = packet_in;
+
+	switch (packet_in->type) {
+	case SR_DF_HEADER:
+		ctx->logic_pos = 0;
+		g_hash_table_remove_all(ctx->analog_pos);
+		break;
+	case SR_DF_LOGIC:
+		logic = packet_in->payload;
+		if (!logic->unitsize)
+			break;
+		count = logic->length / logic->unitsize;
+		keep = clip(ctx, ctx->logic_pos, count, &skip);
+		ctx->logic_pos += count;
+		if (keep == count)
+			break;
+		if (!keep) {
+			*packet_out = NULL;
+			break;
+		}
+		ctx->logic = *logic;
+		ctx->logic.data = (uint8_t *)logic->data + skip * logic->unitsize;
+		ctx->logic.length = keep * logic->unitsize;
+		ctx->packet.type = SR_DF_LOGIC;
+		ctx->packet.payload = &ctx->logic;
+		*packet_out = &ctx->packet;
+		break;
+	case SR_DF_ANALOG:
+		analog = packet_in->payload;
+		key = analog->meaning->channels ? analog->meaning->channels->data : NULL;
+		if (!(pos = g_hash_table_lookup(ctx->analog_pos, key))) {
+			pos = g_malloc0(sizeof(*pos));
+			g_hash_table_insert(ctx->analog_pos, key, pos);
+		}
+		count = analog->num_samples;
+		keep = clip(ctx, *pos, count, &skip);
+		*pos += count;
+		if (keep == count)
+			break;
+		if (!keep) {
+			*packet_out = NULL;
+			break;
+		}
+		ctx->analog = *analog;
+		ctx->analog.data = (uint8_t *)analog->data
+				+ skip * analog->encoding->unitsize;
+		ctx->analog.num_samples = keep;
+		ctx->packet.type = SR_DF_ANALOG;
+		ctx->packet.payload = &ctx->analog;
+		*packet_out = &ctx->packet;
+		break;
+	default:
+		sr_spew("Unsupported packet type %d, ignoring.", packet_in->type);
+		break;
+	}
+
+	return SR_OK;
+}
+
+static int cleanup(struct sr_transform *t)
+{
+	struct context *ctx;
+
+	if (!t || !t->sdi)
+		return SR_ERR_ARG;
+	ctx = t->priv;
+
+	g_hash_table_destroy(ctx->analog_pos);
+	g_free(ctx);
+	t->priv = NULL;
+
+	return SR_OK;
+}
+
+static struct sr_option options[] = {
+	{ "start", "Start", "Number of the first sample to keep", NULL, NULL },
+	{ "length", "Length", "Number of samples to keep (0 = all)", NULL, NULL },
+	ALL_ZERO
+};
+
+static const struct sr_option *get_options(void)
+{
+	if (!options[0].def) {
+		options[0].def = g_variant_ref_sink(g_variant_new_uint64(0));
+		options[1].def = g_variant_ref_sink(g_variant_new_uint64(0));
+	}
+
+	return options;
+}
+
+SR_PRIV struct sr_transform_module transform_window = {
+	.id = "window",
+	.name = "Window",
+	.desc = "Keep only a window of samples",
+	.options = get_options,
+	.init = init,
+	.receive = receive,
+	.cleanup = cleanup,
+};
@@ -20,6 +20,7 @@
  */
 
 #include <config.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <memory.h>
 #include <glib.h>
@@ -297,6 +298,165 @@ static GSource *usb_source_new(struct sr_session *session,
 	return source;
 }
 
+/** Event source for libusb I/O handled on a dedicated thread.
+ * @internal
+ */
+struct usb_thread_source {
+	GSource base;
+
+	int64_t timeout_us;
+	int64_t due_us;
+
+	/* Needed to keep track of installed sources */
+	struct sr_session *session;
+
+	struct libusb_context *usb_ctx;
+	struct sr_usb_queue *queue;
+	GThread *thread;
+	int stop;
+};
+
+/** Body of the USB event thread.
+ *
+ * Only the transfer callbacks run here. They are expected to resubmit
+ * their transfer and hand the data over to the session thread through
+ * the source's queue.
+ */
+static gpointer usb_event_thread(gpointer data)
+{
+	struct usb_thread_source *usource;
+	struct timeval tv;
+	int ret;
+
+	usource = data;
+
+	while (!g_atomic_int_get(&usource->stop)) {
+		tv.tv_sec = 0;
+		tv.tv_usec = 100 * 1000;
+		ret = libusb_handle_events_timeout_completed(usource->usb_ctx,
+			&tv, &usource->stop);
+		if (ret < 0 && ret != LIBUSB_ERROR_INTERRUPTED) {
+			sr_err("Failed to handle USB events: %s",
+				libusb_error_name(ret));
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static gboolean usb_thread_source_pending(struct usb_thread_source *usource)
+{
+	return !sr_usb_queue_is_empty(usource->queue);
+}
+
+/** USB event thread source prepare() method.
+ */
+static gboolean usb_thread_source_prepare(GSource *source, int *timeout)
+{
+	struct usb_thread_source *usource;
+	int64_t now_us;
+	int remaining_ms;
+
+	usource = (struct usb_thread_source *)source;
+
+	if (usb_thread_source_pending(usource)) {
+		*timeout = 0;
+		return TRUE;
+	}
+
+	now_us = g_source_get_time(source);
+	if (usource->due_us == 0) {
+		/* First-time initialization of the expiration time */
+		usource->due_us = now_us + usource->timeout_us;
+	}
+	if (usource->due_us != INT64_MAX)
+		remaining_ms = (MAX(0, usource->due_us - now_us) + 999) / 1000;
+	else
+		remaining_ms = -1;
+
+	*timeout = remaining_ms;
+
+	return (remaining_ms == 0);
+}
+
+/** USB event thread source check() method.
+ */
+static gboolean usb_thread_source_check(GSource *source)
+{
+	struct usb_thread_source *usource;
+
+	usource = (struct usb_thread_source *)source;
+
+	return (usb_thread_source_pending(usource)
+		|| (usource->due_us != INT64_MAX
+			&& usource->due_us <= g_source_get_time(source)));
+}
+
+/** USB event thread source dispatch() method.
+ */
+static gboolean usb_thread_source_dispatch(GSource *source,
+		GSourceFunc callback, void *user_data)
+{
+	struct usb_thread_source *usource;
+	unsigned int revents;
+	gboolean keep;
+
+	usource = (struct usb_thread_source *)source;
+	revents = usb_thread_source_pending(usource) ? G_IO_IN : 0;
+
+	if (!callback) {
+		sr_err("Callback not set, cannot dispatch event.");
+		return G_SOURCE_REMOVE;
+	}
+	keep = (*(sr_receive_data_callback)callback)(-1, revents, user_data);
+
+	if (G_LIKELY(keep) && G_LIKELY(!g_source_is_destroyed(source))) {
+		if (usource->timeout_us >= 0)
+			usource->due_us = g_source_get_time(source)
+					+ usource->timeout_us;
+		else
+			usource->due_us = INT64_MAX;
+	}
+	return keep;
+}
+
+/** USB event thread source finalize() method.
+ */
+static void usb_thread_source_finalize(GSource *source)
+{
+	struct usb_thread_source *usource;
+
+	usource = (struct usb_thread_source *)source;
+
+	sr_spew("%s", __func__);
+
+	if (usource->thread) {
+		g_atomic_int_set(&usource->stop, TRUE);
+#if (LIBUSB_API_VERSION >= 0x01000105)
+		libusb_interrupt_event_handler(usource->usb_ctx);
+#endif
+		g_thread_join(usource->thread);
+		usource->thread = NULL;
+	}
+
+	sr_session_source_destroyed(usource->session,
+			usource->usb_ctx, source);
+}
+
+/**
+ * Check whether a connection string specifies a USB device.
+ *
+ * @param conn Connection string.
+ *
+ * @return TRUE if it is of a form sr_usb_find() accepts, FALSE otherwise.
+ */
+SR_PRIV gboolean sr_usb_conn_valid(const char *conn)
+{
+	return g_regex_match_simple(CONN_USB_VIDPID, conn, 0, 0) ||
+		g_regex_match_simple(CONN_USB_BUSADDR, conn, 0, 0);
+}
+
 /**
  * Find USB devices according to a connection string.
  *
@@ -464,6 +624,74 @@ SR_PRIV int usb_source_add(struct sr_session *session, struct sr_context *ctx,
 	return ret;
 }
 
+/**
+ * Add an event source which handles libusb events on a dedicated thread.
+ *
+ * This is an alternative to usb_source_add() for drivers whose transfer
+ * callbacks must not wait for the session's datafeed consumers. The
+ * transfer callbacks run on the event thread, and should only resubmit
+ * transfers and push completed data onto @a queue. @a cb is invoked on
+ * the session thread whenever @a queue holds data (with G_IO_IN set in
+ * revents), or after @a timeout ms without data.
+ *
+ * All transfers on the libusb context must be finished before the
+ * source is removed with usb_source_remove(). A libusb context must not
+ * be used with both kinds of USB event source at the same time.
+ */
+SR_PRIV int usb_thread_source_add(struct sr_session *session,
+		struct sr_context *ctx, int timeout, struct sr_usb_queue *queue,
+		sr_receive_data_callback cb, void *cb_data)
+{
+	static GSourceFuncs usb_thread_source_funcs = {
+		.prepare  = &usb_thread_source_prepare,
+		.check    = &usb_thread_source_check,
+		.dispatch = &usb_thread_source_dispatch,
+		.finalize = &usb_thread_source_finalize
+	};
+	GSource *source;
+	struct usb_thread_source *usource;
+	int ret;
+
+	source = g_source_new(&usb_thread_source_funcs,
+		sizeof(struct usb_thread_source));
+	usource = (struct usb_thread_source *)source;
+
+	g_source_set_name(source, "usb-thread");
+	g_source_set_callback(source, (GSourceFunc)cb, cb_data, NULL);
+
+	if (timeout >= 0) {
+		usource->timeout_us = 1000 * (int64_t)timeout;
+		usource->due_us = 0;
+	} else {
+		usource->timeout_us = -1;
+		usource->due_us = INT64_MAX;
+	}
+	usource->session = session;
+	usource->usb_ctx = ctx->libusb_ctx;
+	usource->queue = queue;
+
+	ret = sr_session_source_add_internal(session, ctx->libusb_ctx, source);
+	if (ret != SR_OK) {
+		g_source_unref(source);
+		return ret;
+	}
+
+	/* Let the producer wake up the session's main loop. */
+	queue->context = g_source_get_context(source);
+
+	usource->thread = g_thread_try_new("usb-events",
+		usb_event_thread, usource, NULL);
+	if (!usource->thread) {
+		sr_err("Failed to start the USB event thread.");
+		sr_session_source_remove_internal(session, ctx->libusb_ctx);
+		g_source_unref(source);
+		return SR_ERR;
+	}
+	g_source_unref(source);
+
+	return SR_OK;
+}
+
 SR_PRIV int usb_source_remove(struct sr_session *session, struct sr_context *ctx)
 {
 	return sr_session_source_remove_internal(session, ctx->libusb_ctx);
@@ -551,3 +779,443 @@ SR_PRIV gboolean usb_match_manuf_prod(libusb_device *dev,
 
 	return ret;
 }
+
+/**
+ * Compute the transfer ring geometry for an acquisition.
+ *
+ * Without user overrides, each transfer holds about 10ms of data and
+ * enough transfers are queued to cover @a buffered_ms of data. The
+ * transfer size is always rounded up to a multiple of @a align, and the
+ * transfer count is clamped to [1, @a max_transfers], and to
+ * SR_USB_RING_MAX_TRANSFERS. The telemetry counters are reset.
+ *
+ * @param ring The ring to set up. Its transfer_size and num_transfers
+ *             fields hold the user overrides, 0 selects automatic sizing.
+ * @param bytes_per_sec The data rate of the device, 0 if unknown.
+ * @param align The granularity of a transfer, typically the endpoint's
+ *              maximum packet size.
+ * @param buffered_ms The amount of data the whole ring should hold.
+ * @param max_transfers The maximum number of transfers in flight.
+ */
+SR_PRIV void sr_usb_ring_setup(struct sr_usb_ring *ring,
+		uint64_t bytes_per_sec, size_t align, unsigned int buffered_ms,
+		unsigned int max_transfers)
+{
+	uint64_t size, count, total;
+
+	if (align == 0)
+		align = 1;
+
+	if (ring->transfer_size)
+		size = ring->transfer_size;
+	else
+		size = bytes_per_sec / 100;
+	size = (size + align - 1) / align * align;
+	if (size == 0)
+		size = align;
+
+	if (ring->num_transfers)
+		count = ring->num_transfers;
+	else
+		count = (bytes_per_sec * buffered_ms / 1000 + size - 1) / size;
+	count = MAX(count, 1);
+	count = MIN(count, max_transfers);
+	count = MIN(count, SR_USB_RING_MAX_TRANSFERS);
+
+	ring->size = size;
+	ring->count = count;
+
+	/* Leave a headroom of 25% over the time it takes to fill the ring. */
+	total = size * count;
+	if (bytes_per_sec)
+		ring->timeout = total * 1000 / bytes_per_sec;
+	else
+		ring->timeout = 1000;
+	ring->timeout += ring->timeout / 4;
+	ring->timeout = MAX(ring->timeout, 100);
+
+	ring->completed = 0;
+	ring->short_packets = 0;
+	ring->dropped = 0;
+	ring->latency_max = 0;
+	ring->latency_total = 0;
+	memset(ring->slots, 0, sizeof(ring->slots));
+
+	sr_dbg("USB ring: %u transfers of %zu bytes, timeout %u ms.",
+		ring->count, ring->size, ring->timeout);
+}
+
+/*
+ * In event thread mode, transfers are accounted for on the event thread
+ * and, once the ring overruns, on the session thread.
+ */
+static void ring_lock(struct sr_usb_ring *ring)
+{
+	if (ring->filled)
+		g_mutex_lock(&ring->mutex);
+}
+
+static void ring_unlock(struct sr_usb_ring *ring)
+{
+	if (ring->filled)
+		g_mutex_unlock(&ring->mutex);
+}
+
+/* The slot of a transfer, a free one if the transfer has none yet. */
+static int64_t *ring_slot(struct sr_usb_ring *ring,
+		const struct libusb_transfer *transfer)
+{
+	unsigned int i;
+	int free_slot;
+
+	free_slot = -1;
+	for (i = 0; i < G_N_ELEMENTS(ring->slots); i++) {
+		if (ring->slots[i].transfer == transfer)
+			return &ring->slots[i].completed_at;
+		if (free_slot < 0 && !ring->slots[i].transfer)
+			free_slot = i;
+	}
+	if (free_slot < 0)
+		return NULL;
+	ring->slots[free_slot].transfer = transfer;
+
+	return &ring->slots[free_slot].completed_at;
+}
+
+/**
+ * Account for a transfer which came back from libusb.
+ *
+ * Call this first thing in the transfer's completion callback. A
+ * transfer which is passed again before it was resubmitted, e.g. after
+ * sr_usb_ring_hand_off() failed to resubmit it, is only counted once.
+ */
+SR_PRIV void sr_usb_ring_completed(struct sr_usb_ring *ring,
+		const struct libusb_transfer *transfer)
+{
+	int64_t *completed_at;
+
+	ring_lock(ring);
+	completed_at = ring_slot(ring, transfer);
+	if (completed_at && *completed_at) {
+		ring_unlock(ring);
+		return;
+	}
+	if (completed_at)
+		*completed_at = g_get_monotonic_time();
+	ring->completed++;
+
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		if (transfer->actual_length == 0)
+			ring->dropped++;
+		else if (transfer->actual_length < transfer->length)
+			ring->short_packets++;
+		break;
+	case LIBUSB_TRANSFER_CANCELLED:
+		break;
+	default:
+		ring->dropped++;
+		break;
+	}
+	ring_unlock(ring);
+}
+
+/**
+ * Hand a completed transfer back to libusb, recording how long it
+ * was out of the ring.
+ *
+ * @return The result of libusb_submit_transfer().
+ */
+SR_PRIV int sr_usb_ring_resubmit(struct sr_usb_ring *ring,
+		struct libusb_transfer *transfer)
+{
+	int64_t *completed_at, then;
+	uint64_t latency;
+	int ret;
+
+	/* Clear the slot first, the transfer may come back right away. */
+	ring_lock(ring);
+	completed_at = ring_slot(ring, transfer);
+	then = completed_at ? *completed_at : 0;
+	if (completed_at)
+		*completed_at = 0;
+	ring_unlock(ring);
+
+	ret = libusb_submit_transfer(transfer);
+
+	ring_lock(ring);
+	if (ret != LIBUSB_SUCCESS) {
+		/* Still out of the ring, don't count it again. */
+		if (completed_at)
+			*completed_at = then;
+	} else if (then) {
+		latency = g_get_monotonic_time() - then;
+		ring->latency_total += latency;
+		ring->latency_max = MAX(ring->latency_max, latency);
+	}
+	ring_unlock(ring);
+
+	return ret;
+}
+
+/**
+ * Log the ring's telemetry and send it to the session as SR_DF_META.
+ *
+ * Call this before sending SR_DF_END, once all transfers came back.
+ */
+SR_PRIV void sr_usb_ring_report(const struct sr_dev_inst *sdi,
+		const struct sr_usb_ring *ring)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	GSList *l;
+
+	sr_info("USB ring: %" PRIu64 " transfers, %" PRIu64 " short, "
+		"%" PRIu64 " dropped, resubmit latency max %" PRIu64
+		" us, avg %" PRIu64 " us.", ring->completed,
+		ring->short_packets, ring->dropped, ring->latency_max,
+		ring->completed ? ring->latency_total / ring->completed : 0);
+
+	meta.config = NULL;
+	meta.config = g_slist_append(meta.config, sr_config_new(
+		SR_CONF_USB_TRANSFER_SIZE, g_variant_new_uint64(ring->size)));
+	meta.config = g_slist_append(meta.config, sr_config_new(
+		SR_CONF_USB_NUM_TRANSFERS, g_variant_new_uint64(ring->count)));
+	meta.config = g_slist_append(meta.config, sr_config_new(
+		SR_CONF_USB_SHORT_PACKETS,
+		g_variant_new_uint64(ring->short_packets)));
+	meta.config = g_slist_append(meta.config, sr_config_new(
+		SR_CONF_USB_DROPPED_TRANSFERS,
+		g_variant_new_uint64(ring->dropped)));
+	meta.config = g_slist_append(meta.config, sr_config_new(
+		SR_CONF_USB_RESUBMIT_LATENCY,
+		g_variant_new_uint64(ring->latency_max)));
+
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	sr_session_send(sdi, &packet);
+
+	for (l = meta.config; l; l = l->next)
+		sr_config_free(l->data);
+	g_slist_free(meta.config);
+}
+
+/**
+ * Create a single producer, single consumer queue.
+ *
+ * One thread may push while another one pops, without any locking.
+ *
+ * @param capacity The minimum number of items the queue can hold.
+ */
+SR_PRIV struct sr_usb_queue *sr_usb_queue_new(unsigned int capacity)
+{
+	struct sr_usb_queue *queue;
+	unsigned int size;
+
+	size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	queue = g_malloc0(sizeof(*queue));
+	queue->slots = g_malloc0(size * sizeof(*queue->slots));
+	queue->size = size;
+
+	return queue;
+}
+
+SR_PRIV void sr_usb_queue_free(struct sr_usb_queue *queue)
+{
+	if (!queue)
+		return;
+
+	g_free(queue->slots);
+	g_free(queue);
+}
+
+/**
+ * Append an item to the queue. Must only be called by the producer.
+ *
+ * Wakes up the queue's main context, if it has one.
+ *
+ * @return TRUE on success, FALSE if the queue is full.
+ */
+SR_PRIV gboolean sr_usb_queue_push(struct sr_usb_queue *queue, void *item)
+{
+	int head, tail;
+
+	/*
+	 * Head and tail run modulo twice the size, so that a full queue
+	 * can be told apart from an empty one.
+	 */
+	tail = queue->tail;
+	head = g_atomic_int_get(&queue->head);
+	if ((unsigned int)((tail - head) & (2 * queue->size - 1)) == queue->size)
+		return FALSE;
+
+	queue->slots[tail & (queue->size - 1)] = item;
+	g_atomic_int_set(&queue->tail, (tail + 1) & (2 * queue->size - 1));
+
+	if (queue->context)
+		g_main_context_wakeup(queue->context);
+
+	return TRUE;
+}
+
+/**
+ * Remove the oldest item from the queue. Must only be called by the
+ * consumer.
+ *
+ * @return The item, or NULL if the queue is empty.
+ */
+SR_PRIV void *sr_usb_queue_pop(struct sr_usb_queue *queue)
+{
+	int head;
+	void *item;
+
+	head = queue->head;
+	if (head == g_atomic_int_get(&queue->tail))
+		return NULL;
+
+	item = queue->slots[head & (queue->size - 1)];
+	g_atomic_int_set(&queue->head, (head + 1) & (2 * queue->size - 1));
+
+	return item;
+}
+
+SR_PRIV gboolean sr_usb_queue_is_empty(struct sr_usb_queue *queue)
+{
+	return g_atomic_int_get(&queue->head) == g_atomic_int_get(&queue->tail);
+}
+
+/**
+ * Prepare the ring for use with usb_thread_source_add().
+ *
+ * Call this after sr_usb_ring_setup(). Allocates as many spare buffers
+ * as there are transfers in the ring, so that the session thread can
+ * fall behind by the whole ring before the event thread stops
+ * resubmitting transfers on its own.
+ */
+SR_PRIV int sr_usb_ring_thread_init(struct sr_usb_ring *ring)
+{
+	struct sr_usb_chunk *chunk;
+	unsigned int i;
+
+	sr_usb_ring_thread_cleanup(ring);
+
+	g_mutex_init(&ring->mutex);
+	/* Room for every spare buffer, plus every transfer handed back. */
+	ring->filled = sr_usb_queue_new(2 * ring->count);
+	ring->spare = sr_usb_queue_new(ring->count);
+
+	for (i = 0; i < ring->count; i++) {
+		chunk = g_try_malloc0(sizeof(*chunk));
+		if (chunk)
+			chunk->data = g_try_malloc(ring->size);
+		if (!chunk || !chunk->data) {
+			sr_err("USB ring buffer malloc failed.");
+			g_free(chunk);
+			sr_usb_ring_thread_cleanup(ring);
+			return SR_ERR_MALLOC;
+		}
+		sr_usb_queue_push(ring->spare, chunk);
+	}
+	g_atomic_int_set(&ring->stopping, FALSE);
+
+	return SR_OK;
+}
+
+static void free_chunk(struct sr_usb_chunk *chunk)
+{
+	g_free(chunk->data);
+	g_free(chunk);
+}
+
+/**
+ * Release the buffers allocated by sr_usb_ring_thread_init().
+ *
+ * Must only be called when no transfer of the ring is in flight.
+ */
+SR_PRIV void sr_usb_ring_thread_cleanup(struct sr_usb_ring *ring)
+{
+	struct sr_usb_chunk *chunk;
+
+	if (ring->filled) {
+		while ((chunk = sr_usb_queue_pop(ring->filled)))
+			free_chunk(chunk);
+		sr_usb_queue_free(ring->filled);
+		ring->filled = NULL;
+		g_mutex_clear(&ring->mutex);
+	}
+	if (ring->spare) {
+		while ((chunk = sr_usb_queue_pop(ring->spare)))
+			free_chunk(chunk);
+		sr_usb_queue_free(ring->spare);
+		ring->spare = NULL;
+	}
+}
+
+/**
+ * Hand a completed transfer over to the session thread.
+ *
+ * Call this from the transfer callback when running on the USB event
+ * thread. If the transfer completed normally and a spare buffer is
+ * available, its data is copied out and the transfer is resubmitted
+ * right away. Otherwise the transfer itself is queued, and the session
+ * thread has to deal with it like a regular transfer callback would.
+ */
+SR_PRIV void sr_usb_ring_hand_off(struct sr_usb_ring *ring,
+		struct libusb_transfer *transfer)
+{
+	struct sr_usb_chunk *chunk;
+
+	chunk = NULL;
+	if (transfer->status == LIBUSB_TRANSFER_COMPLETED
+			&& transfer->actual_length > 0
+			&& !g_atomic_int_get(&ring->stopping))
+		chunk = sr_usb_queue_pop(ring->spare);
+
+	if (chunk) {
+		sr_usb_ring_completed(ring, transfer);
+		memcpy(chunk->data, transfer->buffer, transfer->actual_length);
+		chunk->length = transfer->actual_length;
+		chunk->transfer = NULL;
+		sr_usb_queue_push(ring->filled, chunk);
+		if (sr_usb_ring_resubmit(ring, transfer) == LIBUSB_SUCCESS)
+			return;
+		/* Let the session thread retry, its data was taken care of. */
+		transfer->actual_length = 0;
+	} else if (transfer->status == LIBUSB_TRANSFER_COMPLETED
+			&& !g_atomic_int_get(&ring->stopping)) {
+		sr_dbg("USB ring overrun, deferring transfer.");
+	}
+
+	chunk = g_malloc0(sizeof(*chunk));
+	chunk->transfer = transfer;
+	if (!sr_usb_queue_push(ring->filled, chunk)) {
+		sr_err("USB ring queue overflow.");
+		g_free(chunk);
+	}
+}
+
+/**
+ * Take the next item handed over by sr_usb_ring_hand_off().
+ *
+ * If the item's transfer field is set, the transfer was not resubmitted
+ * and must be handled by the caller. Otherwise the item holds the data
+ * of a completed transfer. Either way the item has to be returned with
+ * sr_usb_ring_release() afterwards.
+ *
+ * @return The item, or NULL if there is none.
+ */
+SR_PRIV struct sr_usb_chunk *sr_usb_ring_next(struct sr_usb_ring *ring)
+{
+	return ring->filled ? sr_usb_queue_pop(ring->filled) : NULL;
+}
+
+SR_PRIV void sr_usb_ring_release(struct sr_usb_ring *ring,
+		struct sr_usb_chunk *chunk)
+{
+	if (chunk->transfer || !sr_usb_queue_push(ring->spare, chunk))
+		free_chunk(chunk);
+}
@@ -123,6 +123,283 @@ START_TEST(test_analog_to_float_null)
 }
 END_TEST
 
+START_TEST(test_analog_to_float_encodings)
+{
+	int ret;
+	unsigned int i;
+	float fout[2];
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	const struct {
+		uint8_t unitsize;
+		gboolean is_signed;
+		gboolean is_float;
+		gboolean is_bigendian;
+		uint8_t data[16];
+		float out[2];
+	} v[] = {
+		{ 1, TRUE, FALSE, FALSE, { 0xfe, 0x7f }, { -2, 127 } },
+		{ 1, FALSE, FALSE, FALSE, { 0xfe, 0x7f }, { 254, 127 } },
+		{ 2, TRUE, FALSE, FALSE, { 0xfe, 0xff, 0x34, 0x12 }, { -2, 0x1234 } },
+		{ 2, TRUE, FALSE, TRUE, { 0xff, 0xfe, 0x12, 0x34 }, { -2, 0x1234 } },
+		{ 2, FALSE, FALSE, FALSE, { 0xfe, 0xff, 0x34, 0x12 }, { 0xfffe, 0x1234 } },
+		{ 2, FALSE, FALSE, TRUE, { 0xff, 0xfe, 0x12, 0x34 }, { 0xfffe, 0x1234 } },
+		{ 4, TRUE, FALSE, FALSE, { 0xfe, 0xff, 0xff, 0xff, 0x78, 0x56, 0x34, 0x12 }, { -2, 0x12345678 } },
+		{ 4, TRUE, FALSE, TRUE, { 0xff, 0xff, 0xff, 0xfe, 0x12, 0x34, 0x56, 0x78 }, { -2, 0x12345678 } },
+		{ 4, FALSE, FALSE, TRUE, { 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x07 }, { 65536, 7 } },
+		{ 4, TRUE, TRUE, FALSE, { 0x00, 0x00, 0xc0, 0x3f, 0x00, 0x00, 0x20, 0xc1 }, { 1.5, -10 } },
+		{ 4, TRUE, TRUE, TRUE, { 0x3f, 0xc0, 0x00, 0x00, 0xc1, 0x20, 0x00, 0x00 }, { 1.5, -10 } },
+		{ 8, TRUE, TRUE, FALSE, { 0, 0, 0, 0, 0, 0, 0xf8, 0x3f, 0, 0, 0, 0, 0, 0, 0x24, 0xc0 }, { 1.5, -10 } },
+		{ 8, TRUE, TRUE, TRUE, { 0x3f, 0xf8, 0, 0, 0, 0, 0, 0, 0xc0, 0x24, 0, 0, 0, 0, 0, 0 }, { 1.5, -10 } },
+	};
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = 2;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	for (i = 0; i < ARRAY_SIZE(v); i++) {
+		encoding.unitsize = v[i].unitsize;
+		encoding.is_signed = v[i].is_signed;
+		encoding.is_float = v[i].is_float;
+		encoding.is_bigendian = v[i].is_bigendian;
+		analog.data = (void *)v[i].data;
+
+		/* Plain values. */
+		encoding.scale.p = 1;
+		encoding.scale.q = 1;
+		encoding.offset.p = 0;
+		encoding.offset.q = 1;
+		ret = sr_analog_to_float(&analog, fout);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+		fail_unless(fout[0] == v[i].out[0] && fout[1] == v[i].out[1],
+			"Unexpected output %f, %f (i=%d).", fout[0], fout[1], i);
+
+		/* Scaled and offset values. */
+		encoding.scale.p = 1;
+		encoding.scale.q = 4;
+		encoding.offset.p = -3;
+		encoding.offset.q = 2;
+		ret = sr_analog_to_float(&analog, fout);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+		fail_unless(fout[0] == v[i].out[0] / 4 - 1.5f
+			&& fout[1] == v[i].out[1] / 4 - 1.5f,
+			"Unexpected scaled output %f, %f (i=%d).",
+			fout[0], fout[1], i);
+	}
+
+	/* Unsupported unit size. */
+	encoding.unitsize = 3;
+	encoding.is_float = FALSE;
+	ret = sr_analog_to_float(&analog, fout);
+	fail_unless(ret == SR_ERR);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
+/*
+ * Convert multi-thousand-sample frames in various encodings and check the
+ * results. See tests/bench_analog.c for the conversion throughput.
+ */
+START_TEST(test_analog_to_float_bulk)
+{
+	int ret;
+	unsigned int i, j, k, num_samples;
+	uint8_t *data, *p;
+	float *fout, expected;
+	uint64_t raw;
+	union { uint32_t u; float f; } f;
+	union { uint64_t u; double d; } d;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	const struct {
+		const char *name;
+		uint8_t unitsize;
+		gboolean is_signed;
+		gboolean is_float;
+		gboolean is_bigendian;
+	} v[] = {
+		{ "int8", 1, TRUE, FALSE, FALSE },
+		{ "int16le", 2, TRUE, FALSE, FALSE },
+		{ "int16be", 2, TRUE, FALSE, TRUE },
+		{ "uint32le", 4, FALSE, FALSE, FALSE },
+		{ "floatbe", 4, TRUE, TRUE, TRUE },
+		{ "doublele", 8, TRUE, TRUE, FALSE },
+	};
+
+	num_samples = 4099;
+	data = g_malloc(num_samples * sizeof(double));
+	fout = g_malloc(num_samples * sizeof(float));
+	memset(fout, 0, num_samples * sizeof(float));
+
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = num_samples;
+	analog.data = data;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.scale.p = 1;
+	encoding.scale.q = 8;
+	encoding.offset.p = -1;
+	encoding.offset.q = 2;
+
+	for (i = 0; i < ARRAY_SIZE(v); i++) {
+		encoding.unitsize = v[i].unitsize;
+		encoding.is_signed = v[i].is_signed;
+		encoding.is_float = v[i].is_float;
+		encoding.is_bigendian = v[i].is_bigendian;
+
+		/* Fill in the values 0..99 repeatedly. */
+		for (j = 0; j < num_samples; j++) {
+			f.f = j % 100;
+			d.d = j % 100;
+			if (!v[i].is_float)
+				raw = j % 100;
+			else if (v[i].unitsize == sizeof(float))
+				raw = f.u;
+			else
+				raw = d.u;
+			p = data + j * v[i].unitsize;
+			for (k = 0; k < v[i].unitsize; k++) {
+				p[v[i].is_bigendian ? v[i].unitsize - 1 - k : k] =
+					raw >> (8 * k);
+			}
+		}
+
+		ret = sr_analog_to_float(&analog, fout);
+		fail_unless(ret == SR_OK, "sr_analog_to_float() failed: %d.", ret);
+
+		for (j = 0; j < num_samples; j++) {
+			expected = (j % 100) / 8.0f - 0.5f;
+			fail_unless(fout[j] == expected, "%s: %f != %f (j=%d).",
+				v[i].name, fout[j], expected, j);
+		}
+	}
+
+	g_slist_free(meaning.channels);
+	g_free(data);
+	g_free(fout);
+}
+END_TEST
+
+/*
+ * Check the analog-to-logic conversions against thresholding the output
+ * of sr_analog_to_float(), for integer and float encodings and for both
+ * positive and negative scales.
+ */
+START_TEST(test_a2l_encodings)
+{
+	int ret;
+	unsigned int i, j, k, n;
+	uint8_t state, ref_state, *p;
+	uint8_t data[600 * 4], out[600], packed[600 * 2];
+	float fout[600], lo, hi;
+	uint32_t raw;
+	union { uint32_t u; float f; } f;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	const struct {
+		uint8_t unitsize;
+		gboolean is_signed;
+		gboolean is_float;
+		gboolean is_bigendian;
+	} v[] = {
+		{ 1, FALSE, FALSE, FALSE },
+		{ 2, TRUE, FALSE, FALSE },
+		{ 2, FALSE, FALSE, TRUE },
+		{ 4, TRUE, FALSE, TRUE },
+		{ 4, TRUE, TRUE, TRUE },
+	};
+	const struct sr_rational scales[][2] = {
+		{ { 1, 1 }, { 0, 1 } },
+		{ { 1, 100 }, { -3, 2 } },
+		{ { -3, 1 }, { 10, 1 } },
+	};
+
+	n = ARRAY_SIZE(out);
+	sr_analog_init_(&analog, &encoding, &meaning, &spec, 3);
+	analog.num_samples = n;
+	analog.data = data;
+	meaning.channels = g_slist_append(NULL, &ch);
+
+	for (i = 0; i < ARRAY_SIZE(v); i++) {
+		encoding.unitsize = v[i].unitsize;
+		encoding.is_signed = v[i].is_signed;
+		encoding.is_float = v[i].is_float;
+		encoding.is_bigendian = v[i].is_bigendian;
+
+		/* Values spread over the 8-bit range, negative if signed. */
+		for (j = 0; j < n; j++) {
+			raw = (j * 37) % 251 - (v[i].is_signed ? 125 : 0);
+			f.f = (int32_t)raw / 8.0f;
+			if (v[i].is_float)
+				raw = f.u;
+			p = data + j * v[i].unitsize;
+			for (k = 0; k < v[i].unitsize; k++) {
+				p[v[i].is_bigendian ? v[i].unitsize - 1 - k : k] =
+					raw >> (8 * k);
+			}
+		}
+
+		for (k = 0; k < ARRAY_SIZE(scales); k++) {
+			encoding.scale = scales[k][0];
+			encoding.offset = scales[k][1];
+			ret = sr_analog_to_float(&analog, fout);
+			fail_unless(ret == SR_OK);
+			lo = MIN(fout[1], fout[2]);
+			hi = MAX(fout[1], fout[2]);
+
+			ret = sr_a2l_threshold(&analog, fout[3], out, n);
+			fail_unless(ret == SR_OK);
+			for (j = 0; j < n; j++)
+				fail_unless(out[j] == (fout[j] >= fout[3]),
+					"Threshold mismatch (i=%d, k=%d, j=%d).",
+					i, k, j);
+
+			state = ref_state = 1;
+			ret = sr_a2l_schmitt_trigger(&analog, lo, hi, &state,
+				out, n);
+			fail_unless(ret == SR_OK);
+			for (j = 0; j < n; j++) {
+				if (fout[j] < lo)
+					ref_state = 0;
+				else if (fout[j] > hi)
+					ref_state = 1;
+				fail_unless(out[j] == ref_state,
+					"Schmitt mismatch (i=%d, k=%d, j=%d).",
+					i, k, j);
+			}
+			fail_unless(state == ref_state);
+
+			/* Only bit 9 of each 16-bit logic sample may change. */
+			memset(packed, 0x5a, sizeof(packed));
+			ret = sr_a2l_threshold_packed(&analog, fout[3], packed,
+				2, 9, n);
+			fail_unless(ret == SR_OK);
+			for (j = 0; j < n; j++) {
+				fail_unless(packed[j * 2] == 0x5a);
+				fail_unless(packed[j * 2 + 1] ==
+					((fout[j] >= fout[3]) ? 0x5a : 0x58),
+					"Packed mismatch (i=%d, k=%d, j=%d).",
+					i, k, j);
+			}
+		}
+	}
+
+	ret = sr_a2l_threshold_packed(&analog, 0, packed, 2, 16, n);
+	fail_unless(ret == SR_ERR_ARG);
+
+	g_slist_free(meaning.channels);
+}
+END_TEST
+
 START_TEST(test_analog_si_prefix)
 {
 	struct {
@@ -386,6 +663,9 @@ Suite *suite_analog(void)
 	tc = tcase_create("analog_to_float");
 	tcase_add_test(tc, test_analog_to_float);
 	tcase_add_test(tc, test_analog_to_float_null);
+	tcase_add_test(tc, test_analog_to_float_encodings);
+	tcase_add_test(tc, test_analog_to_float_bulk);
+	tcase_add_test(tc, test_a2l_encodings);
 	tcase_add_test(tc, test_analog_si_prefix);
 	tcase_add_test(tc, test_analog_si_prefix_null);
 	tcase_add_test(tc, test_analog_unit_to_string);
@@ -0,0 +1,190 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+/* Check simple values, which must give the simplest fraction. */
+START_TEST(test_rational_from_double)
+{
+	const struct {
+		double value;
+		int64_t p;
+		uint64_t q;
+	} v[] = {
+		{ 0, 0, 1 },
+		{ 1, 1, 1 },
+		{ -7, -7, 1 },
+		{ 0.1, 1, 10 },
+		{ -0.1, -1, 10 },
+		{ 1.0 / 3, 1, 3 },
+		{ 2.0 / 25, 2, 25 },
+		{ 0.004 / 25, 1, 6250 },
+		{ 123456.789, 123456789, 1000 },
+		{ 1e-12, 1, 1000000000000 },
+		{ -2.5e15, -2500000000000000, 1 },
+	};
+	struct sr_rational r;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < G_N_ELEMENTS(v); i++) {
+		ret = sr_rational_from_double(&r, v[i].value);
+		fail_unless(ret == SR_OK, "%g: error %d.", v[i].value, ret);
+		fail_unless(r.p == v[i].p && r.q == v[i].q,
+			"%g: got %" PRId64 "/%" PRIu64 ", expected %" PRId64
+			"/%" PRIu64 ".", v[i].value, r.p, r.q, v[i].p, v[i].q);
+	}
+}
+END_TEST
+
+/*
+ * Check that values of all magnitudes, including the float settings
+ * scopes report, convert back to the same double within rounding of the
+ * division, and that values out of range are rejected.
+ */
+START_TEST(test_rational_from_double_precision)
+{
+	const double bad[] = { NAN, INFINITY, -INFINITY, 1e19, -1e19 };
+	struct sr_rational r;
+	double value, exponent;
+	unsigned int i;
+	GRand *rand;
+	int ret;
+
+	rand = g_rand_new_with_seed(22);
+	for (i = 0; i < 10000; i++) {
+		exponent = g_rand_double_range(rand, -9, 12);
+		value = pow(10, exponent) * (g_rand_boolean(rand) ? 1 : -1);
+		if (i % 2)
+			value = (float)value;
+		ret = sr_rational_from_double(&r, value);
+		fail_unless(ret == SR_OK, "%.17g: error %d.", value, ret);
+		fail_unless(r.q > 0 && r.q <= INT64_MAX);
+		fail_unless(fabs((double)r.p / r.q - value) <=
+			4 * DBL_EPSILON * fabs(value),
+			"%.17g: got %" PRId64 "/%" PRIu64 " = %.17g.", value,
+			r.p, r.q, (double)r.p / r.q);
+	}
+	g_rand_free(rand);
+
+	for (i = 0; i < G_N_ELEMENTS(bad); i++) {
+		ret = sr_rational_from_double(&r, bad[i]);
+		fail_unless(ret == SR_ERR_ARG, "%g: got %d.", bad[i], ret);
+	}
+}
+END_TEST
+
+/*
+ * Check the raw 8-bit encodings rigol-ds and siglent-sds send against
+ * the volts they used to compute, for all ADC values.
+ */
+START_TEST(test_analog_raw_u8)
+{
+	const struct {
+		const char *name;
+		gboolean is_signed;
+		float vdiv, offset;
+		int vref, origin;
+	} v[] = {
+		/* rigol-ds protocol V3 and later, (raw - vref - origin) * vdiv. */
+		{ "rigol-v3", FALSE, 0.04f, 0, 127, -3 },
+		{ "rigol-v3", FALSE, 0.0004f, 0, 127, 12 },
+		/* rigol-ds before V3, (128 - raw) * vdiv - offset. */
+		{ "rigol", FALSE, 0.5f / 25, 0.1f, 0, 0 },
+		{ "rigol", FALSE, 2.0f / 25, -1.3f, 0, 0 },
+		/* siglent-sds, raw / 25 * vdiv - offset. */
+		{ "siglent", TRUE, 0.2f, -0.35f, 0, 0 },
+		{ "siglent", TRUE, 0.005f, 0.0125f, 0, 0 },
+	};
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	uint8_t data[256];
+	float fout[256], expected, tolerance;
+	double scale, offset;
+	unsigned int i, j;
+
+	for (j = 0; j < G_N_ELEMENTS(data); j++)
+		data[j] = j;
+
+	for (i = 0; i < G_N_ELEMENTS(v); i++) {
+		sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+		meaning.channels = g_slist_append(NULL, &ch);
+		analog.num_samples = G_N_ELEMENTS(data);
+		analog.data = data;
+		encoding.unitsize = 1;
+		encoding.is_float = FALSE;
+		encoding.is_signed = v[i].is_signed;
+		if (!strcmp(v[i].name, "rigol-v3")) {
+			scale = v[i].vdiv;
+			offset = -(v[i].vref + v[i].origin) * (double)v[i].vdiv;
+		} else if (!strcmp(v[i].name, "rigol")) {
+			scale = -v[i].vdiv;
+			offset = 128 * (double)v[i].vdiv - v[i].offset;
+		} else {
+			scale = v[i].vdiv / 25.0;
+			offset = -v[i].offset;
+		}
+		fail_unless(sr_rational_from_double(&encoding.scale, scale) == SR_OK);
+		fail_unless(sr_rational_from_double(&encoding.offset, offset) == SR_OK);
+		fail_unless(sr_analog_to_float(&analog, fout) == SR_OK);
+
+		tolerance = 256 * v[i].vdiv * 1e-6;
+		for (j = 0; j < G_N_ELEMENTS(data); j++) {
+			if (!strcmp(v[i].name, "rigol-v3"))
+				expected = ((int)data[j] - v[i].vref - v[i].origin) * v[i].vdiv;
+			else if (!strcmp(v[i].name, "rigol"))
+				expected = (128 - data[j]) * v[i].vdiv - v[i].offset;
+			else
+				expected = v[i].vdiv * ((int8_t)data[j] / 25.0f) - v[i].offset;
+			fail_unless(fabsf(fout[j] - expected) <= tolerance,
+				"%s %u: raw 0x%02x gives %g, expected %g.",
+				v[i].name, i, j, fout[j], expected);
+		}
+		g_slist_free(meaning.channels);
+	}
+}
+END_TEST
+
+Suite *suite_analog_raw(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("analog-raw");
+
+	tc = tcase_create("rational");
+	tcase_add_test(tc, test_rational_from_double);
+	tcase_add_test(tc, test_rational_from_double_precision);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("encoding");
+	tcase_add_test(tc, test_analog_raw_u8);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,131 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark of sr_analog_to_float(). Not run by "make check", build
+ * it with "make tests/bench_analog".
+ *
+ * Usage: bench_analog [megasamples]
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+
+int main(int argc, char **argv)
+{
+	unsigned int i, k;
+	size_t num_samples, j;
+	uint8_t *data, *p;
+	float *fout;
+	uint64_t raw;
+	union { uint32_t u; float f; } f;
+	union { uint64_t u; double d; } d;
+	gint64 start, usecs;
+	struct sr_channel ch;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	const struct {
+		const char *name;
+		uint8_t unitsize;
+		gboolean is_signed;
+		gboolean is_float;
+		gboolean is_bigendian;
+	} v[] = {
+		{ "int8", 1, TRUE, FALSE, FALSE },
+		{ "int16le", 2, TRUE, FALSE, FALSE },
+		{ "int16be", 2, TRUE, FALSE, TRUE },
+		{ "uint32le", 4, FALSE, FALSE, FALSE },
+		{ "floatle", 4, TRUE, TRUE, FALSE },
+		{ "floatbe", 4, TRUE, TRUE, TRUE },
+		{ "doublele", 8, TRUE, TRUE, FALSE },
+	};
+
+	num_samples = (argc > 1 ? strtoul(argv[1], NULL, 0) : 10) * 1000 * 1000;
+	if (!num_samples) {
+		fprintf(stderr, "No samples to convert.\n");
+		return EXIT_FAILURE;
+	}
+
+	data = g_malloc(num_samples * sizeof(double));
+	fout = g_malloc(num_samples * sizeof(float));
+
+	memset(&analog, 0, sizeof(analog));
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	analog.data = data;
+	analog.num_samples = num_samples;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	meaning.channels = g_slist_append(NULL, &ch);
+	encoding.scale.p = 1;
+	encoding.scale.q = 8;
+	encoding.offset.p = -1;
+	encoding.offset.q = 2;
+
+	printf("%zu samples\n", num_samples);
+
+	for (i = 0; i < G_N_ELEMENTS(v); i++) {
+		encoding.unitsize = v[i].unitsize;
+		encoding.is_signed = v[i].is_signed;
+		encoding.is_float = v[i].is_float;
+		encoding.is_bigendian = v[i].is_bigendian;
+
+		for (j = 0; j < num_samples; j++) {
+			f.f = j % 100;
+			d.d = j % 100;
+			if (!v[i].is_float)
+				raw = j % 100;
+			else if (v[i].unitsize == sizeof(float))
+				raw = f.u;
+			else
+				raw = d.u;
+			p = data + j * v[i].unitsize;
+			for (k = 0; k < v[i].unitsize; k++) {
+				p[v[i].is_bigendian ? v[i].unitsize - 1 - k : k] =
+					raw >> (8 * k);
+			}
+		}
+
+		start = g_get_monotonic_time();
+		if (sr_analog_to_float(&analog, fout) != SR_OK) {
+			fprintf(stderr, "%s: conversion failed.\n", v[i].name);
+			return EXIT_FAILURE;
+		}
+		usecs = g_get_monotonic_time() - start;
+
+		printf("%-10s %8.1f Msamples/s (%.3f ms)\n", v[i].name,
+			usecs ? (double)num_samples / usecs : 0.0,
+			usecs / 1000.0);
+	}
+
+	/* Keep the compiler from dropping the conversion. */
+	printf("(%f)\n", fout[0] + fout[num_samples - 1]);
+
+	g_slist_free(meaning.channels);
+	g_free(data);
+	g_free(fout);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Microbenchmark of sr_transpose_64(). Not run by "make check", build it
+ * with "make tests/bench_transpose".
+ *
+ * Usage: bench_transpose [channel mask [megabytes]]
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+
+/* The bit by bit loop the DSLogic driver used before. */
+static void transpose_bitwise(unsigned int num_channels, const uint64_t *src,
+		uint16_t *dst)
+{
+	unsigned int i, ch;
+	uint16_t v;
+
+	for (i = 0; i < 64; i++) {
+		v = 0;
+		for (ch = 0; ch < num_channels; ch++)
+			v |= ((src[ch] >> i) & 1) << ch;
+		dst[i] = v;
+	}
+}
+
+static void report(const char *name, size_t bytes, gint64 usecs)
+{
+	printf("%-10s %8.3f GB/s\n", name,
+		usecs ? (double)bytes / usecs / 1000 : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+	struct sr_transpose t;
+	uint64_t *src;
+	uint16_t dst[64];
+	uint16_t channel_mask;
+	size_t megabytes, num_words, bytes, i;
+	unsigned int generic;
+	gint64 start;
+	GRand *rand;
+
+	channel_mask = argc > 1 ? strtoul(argv[1], NULL, 0) : 0xffff;
+	megabytes = argc > 2 ? strtoul(argv[2], NULL, 0) : 256;
+
+	sr_transpose_init(&t, channel_mask, FALSE);
+	if (!t.num_channels) {
+		fprintf(stderr, "No channels enabled.\n");
+		return EXIT_FAILURE;
+	}
+
+	/* A whole number of blocks of t.num_channels words. */
+	num_words = megabytes * 1024 * 1024 / sizeof(uint64_t);
+	num_words -= num_words % t.num_channels;
+	bytes = num_words * sizeof(uint64_t);
+	src = g_malloc(bytes);
+	rand = g_rand_new_with_seed(1);
+	for (i = 0; i < num_words; i++)
+		src[i] = ((uint64_t)g_rand_int(rand) << 32) | g_rand_int(rand);
+	g_rand_free(rand);
+
+	printf("%u channels (mask 0x%04x), %zu MB\n", t.num_channels,
+		channel_mask, bytes / (1024 * 1024));
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < num_words; i += t.num_channels)
+		transpose_bitwise(t.num_channels, src + i, dst);
+	report("bitwise", bytes, g_get_monotonic_time() - start);
+
+	for (generic = 2; generic-- > 0;) {
+		t.generic = generic;
+		start = g_get_monotonic_time();
+		for (i = 0; i < num_words; i += t.num_channels)
+			sr_transpose_64(&t, src + i, dst);
+		report(generic ? "portable" : "default", bytes,
+			g_get_monotonic_time() - start);
+	}
+
+	/* Keep the compiler from dropping the loops. */
+	printf("(%04x)\n", dst[0] ^ dst[63]);
+
+	g_free(src);
+
+	return EXIT_SUCCESS;
+}
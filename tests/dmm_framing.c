@@ -0,0 +1,245 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define PACKET_SIZE 6
+
+/* The framing the test packets are checked against. */
+static const struct sr_dmm_framing *framing;
+static unsigned int num_validations;
+
+/* Byte of a test packet which holds the sum of the other bytes. */
+#define CHECKSUM 3
+
+/*
+ * A test packet is valid if its sync byte matches the framing and its
+ * checksum byte is right.
+ */
+static gboolean packet_valid(const uint8_t *buf)
+{
+	uint8_t sum;
+	int i, offset;
+
+	num_validations++;
+
+	if (framing && framing->sync_mask) {
+		offset = framing->sync_offset;
+		if (offset < 0)
+			offset += PACKET_SIZE;
+		if ((buf[offset] & framing->sync_mask) != framing->sync_value)
+			return FALSE;
+	}
+
+	sum = 0;
+	for (i = 0; i < PACKET_SIZE; i++) {
+		if (i != CHECKSUM)
+			sum += buf[i];
+	}
+
+	return buf[CHECKSUM] == sum;
+}
+
+/* Make buf[0..PACKET_SIZE) a valid packet. */
+static void packet_fill(uint8_t *buf)
+{
+	uint8_t sum;
+	int i, offset;
+
+	if (framing->sync_mask) {
+		offset = framing->sync_offset;
+		if (offset < 0)
+			offset += PACKET_SIZE;
+		buf[offset] = (buf[offset] & ~framing->sync_mask) |
+			framing->sync_value;
+	}
+	sum = 0;
+	for (i = 0; i < PACKET_SIZE; i++) {
+		if (i != CHECKSUM)
+			sum += buf[i];
+	}
+	buf[CHECKSUM] = sum;
+}
+
+/* Reference: try every offset. */
+static const uint8_t *packet_find_all(const uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i + PACKET_SIZE <= len; i++) {
+		if (packet_valid(buf + i))
+			return buf + i;
+	}
+
+	return NULL;
+}
+
+static const struct sr_dmm_framing test_framings[] = {
+	/* Sync byte at the start of a packet. */
+	{ 0, 0xff, 0x02 },
+	/* Sync byte at the end, like a trailing newline. */
+	{ -1, 0xff, '\n' },
+	/* Sync byte in the middle. */
+	{ 2, 0xff, 0x00 },
+	/* Sync nibble, like fs9721 and dtm0660. */
+	{ 0, 0xf0, 0x10 },
+	{ -2, 0xf0, 0x30 },
+};
+
+/*
+ * Check that sr_dmm_packet_find() finds the same packet as trying every
+ * offset, at the start and the end of the buffer and in between, and
+ * that only offsets with a matching sync byte get validated.
+ */
+START_TEST(test_dmm_packet_find)
+{
+	uint8_t buf[64];
+	const uint8_t *found, *expected;
+	unsigned int f, validations;
+	size_t len, pos, i;
+	int offset;
+	GRand *rand;
+
+	rand = g_rand_new_with_seed(42);
+	for (f = 0; f < G_N_ELEMENTS(test_framings); f++) {
+		framing = &test_framings[f];
+		offset = framing->sync_offset;
+		if (offset < 0)
+			offset += PACKET_SIZE;
+		for (len = 0; len <= sizeof(buf); len++) {
+			for (pos = 0; pos < len + 2; pos++) {
+				/* Mostly sync bytes, to get partial matches. */
+				for (i = 0; i < len; i++)
+					buf[i] = g_rand_int_range(rand, 0, 3) ?
+						framing->sync_value :
+						g_rand_int(rand);
+				if (pos + PACKET_SIZE <= len)
+					packet_fill(buf + pos);
+
+				num_validations = 0;
+				expected = packet_find_all(buf, len);
+				num_validations = 0;
+				found = sr_dmm_packet_find(framing, buf, len,
+					PACKET_SIZE, packet_valid);
+				fail_unless(found == expected,
+					"Framing %u, length %zu, packet at %zu: "
+					"found %td, expected %td.", f, len, pos,
+					found ? found - buf : -1,
+					expected ? expected - buf : -1);
+				if (pos + PACKET_SIZE <= len)
+					fail_unless(found && found <= buf + pos);
+
+				/* Count the candidates up to the result. */
+				validations = 0;
+				for (i = 0; i + PACKET_SIZE <= len &&
+						(!found || buf + i <= found); i++) {
+					if ((buf[i + offset] & framing->sync_mask) ==
+							framing->sync_value)
+						validations++;
+				}
+				fail_unless(num_validations == validations,
+					"%u validations, expected %u.",
+					num_validations, validations);
+			}
+		}
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+/* Check that without a sync byte, every offset gets validated. */
+START_TEST(test_dmm_packet_find_no_sync)
+{
+	uint8_t buf[40];
+	const uint8_t *found;
+
+	memset(buf, 0xaa, sizeof(buf));
+	memcpy(buf + 20, "\x01\x02\x03\x0f\x04\x05", PACKET_SIZE);
+
+	/* rs9lcd has no fixed byte. */
+	framing = &sr_rs9lcd_framing;
+	num_validations = 0;
+	found = sr_dmm_packet_find(framing, buf, sizeof(buf), PACKET_SIZE,
+		packet_valid);
+	fail_unless(found == buf + 20);
+	fail_unless(num_validations == 21);
+
+	framing = NULL;
+	num_validations = 0;
+	found = sr_dmm_packet_find(framing, buf, sizeof(buf), PACKET_SIZE,
+		packet_valid);
+	fail_unless(found == buf + 20);
+	fail_unless(num_validations == 21);
+
+	/* Too short for a whole packet. */
+	found = sr_dmm_packet_find(NULL, buf + 20, PACKET_SIZE - 1,
+		PACKET_SIZE, packet_valid);
+	fail_unless(found == NULL);
+}
+END_TEST
+
+/* Check that a sync byte outside of the packet is rejected. */
+START_TEST(test_dmm_packet_find_bad_offset)
+{
+	uint8_t buf[2 * PACKET_SIZE];
+	const struct sr_dmm_framing bad[] = {
+		{ PACKET_SIZE, 0xff, 0x00 },
+		{ -PACKET_SIZE - 1, 0xff, 0x00 },
+	};
+	const struct sr_dmm_framing edge[] = {
+		{ PACKET_SIZE - 1, 0xff, 0x00 },
+		{ -PACKET_SIZE, 0xff, 0x00 },
+	};
+	unsigned int i;
+
+	memset(buf, 0, sizeof(buf));
+	for (i = 0; i < G_N_ELEMENTS(bad); i++) {
+		framing = NULL;
+		num_validations = 0;
+		fail_unless(sr_dmm_packet_find(&bad[i], buf, sizeof(buf),
+			PACKET_SIZE, packet_valid) == NULL);
+		fail_unless(num_validations == 0);
+	}
+	for (i = 0; i < G_N_ELEMENTS(edge); i++) {
+		framing = NULL;
+		fail_unless(sr_dmm_packet_find(&edge[i], buf, sizeof(buf),
+			PACKET_SIZE, packet_valid) == buf);
+	}
+}
+END_TEST
+
+Suite *suite_dmm_framing(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("dmm-framing");
+
+	tc = tcase_create("packet_find");
+	tcase_add_test(tc, test_dmm_packet_find);
+	tcase_add_test(tc, test_dmm_packet_find_no_sync);
+	tcase_add_test(tc, test_dmm_packet_find_bad_offset);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -40,6 +40,43 @@ START_TEST(test_driver_init_all)
 }
 END_TEST
 
+#ifdef HAVE_HW_DEMO
+/* Check whether a concurrent scan merges the results of all driver scans. */
+START_TEST(test_scan_run)
+{
+	struct sr_dev_driver *driver;
+	struct sr_scan *scan;
+	struct sr_scan_probe *probe;
+	GSList *devices, *l;
+
+	driver = srtest_driver_get("demo");
+	srtest_driver_init(srtest_ctx, driver);
+
+	scan = sr_scan_new(srtest_ctx);
+	fail_unless(scan != NULL, "sr_scan_new() failed.");
+	fail_unless(sr_scan_add(scan, driver, NULL) == SR_OK);
+	fail_unless(sr_scan_add(scan, driver, NULL) == SR_OK);
+
+	devices = sr_scan_run(scan, 0);
+	fail_unless(g_slist_length(devices) == 2,
+		"Expected 2 devices, got %d.", g_slist_length(devices));
+	g_slist_free(devices);
+
+	l = sr_scan_probes_get(scan);
+	fail_unless(g_slist_length(l) == 2, "Expected 2 probes.");
+	for (; l; l = l->next) {
+		probe = l->data;
+		fail_unless(probe->driver == driver);
+		fail_unless(!probe->resource);
+		fail_unless(probe->num_devices == 1);
+		fail_unless(!probe->skipped);
+	}
+
+	sr_scan_free(scan);
+}
+END_TEST
+#endif
+
 /*
  * Check whether setting a samplerate works.
  *
@@ -70,6 +107,9 @@ Suite *suite_driver_all(void)
 	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
 	tcase_add_test(tc, test_driver_available);
 	tcase_add_test(tc, test_driver_init_all);
+#ifdef HAVE_HW_DEMO
+	tcase_add_test(tc, test_scan_run);
+#endif
 	// TODO: Currently broken.
 	// tcase_add_test(tc, test_config_get_set_samplerate);
 	suite_add_tcase(s, tc);
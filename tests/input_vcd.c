@@ -0,0 +1,304 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+#define HEADER(timescale, vars) \
+	"$date today $end\n" \
+	"$timescale " timescale " $end\n" \
+	"$scope module top $end\n" \
+	vars \
+	"$upscope $end\n" \
+	"$enddefinitions $end\n"
+
+/* What came out of the input module. */
+static uint64_t samplerate;
+static unsigned int unitsize;
+static GString *samples;
+static GSList *retained;
+static gboolean retain;
+
+static void datafeed_in(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_meta *meta;
+	const struct sr_datafeed_logic *logic;
+	struct sr_config *src;
+	GSList *l;
+
+	(void)sdi;
+	(void)cb_data;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		for (l = meta->config; l; l = l->next) {
+			src = l->data;
+			if (src->key == SR_CONF_SAMPLERATE)
+				samplerate = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		unitsize = logic->unitsize;
+		g_string_append_len(samples, logic->data, logic->length);
+		if (retain)
+			retained = g_slist_append(retained, sr_packet_ref(packet));
+		break;
+	}
+}
+
+/*
+ * Import a VCD text, optionally through an invert transform, and collect
+ * the samples. The text is sent in one go, the data section is parsed by
+ * sr_input_end(), once the device is in the session.
+ */
+static GSList *import(const char *text, GHashTable *options, gboolean invert)
+{
+	const struct sr_transform *t;
+	struct sr_input *in;
+	struct sr_session *session;
+	struct sr_dev_inst *sdi;
+	GSList *channels, *l;
+	GString *buf;
+	struct sr_channel *ch;
+	int ret;
+
+	samplerate = 0;
+	unitsize = 0;
+	g_string_truncate(samples, 0);
+
+	in = sr_input_new(sr_input_find("vcd"), options);
+	fail_unless(in != NULL, "Failed to create VCD input.");
+	buf = g_string_new(text);
+	ret = sr_input_send(in, buf);
+	g_string_free(buf, TRUE);
+	fail_unless(ret == SR_OK, "sr_input_send() error: %d.", ret);
+
+	sdi = sr_input_dev_inst_get(in);
+	fail_unless(sdi != NULL, "The header was not parsed.");
+	channels = NULL;
+	for (l = sr_dev_inst_channels_get(sdi); l; l = l->next) {
+		ch = l->data;
+		channels = g_slist_append(channels, g_strdup(ch->name));
+	}
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_in, NULL);
+	sr_session_dev_add(session, sdi);
+	t = NULL;
+	if (invert) {
+		t = sr_transform_new(sr_transform_find("invert"), NULL, sdi);
+		fail_unless(t != NULL, "Failed to create invert transform.");
+	}
+
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d.", ret);
+
+	if (t)
+		sr_transform_free(t);
+	sr_input_free(in);
+	sr_session_destroy(session);
+
+	return channels;
+}
+
+static void check_channels(GSList *channels, const char **names)
+{
+	GSList *l;
+	unsigned int i;
+
+	for (i = 0, l = channels; names[i] && l; i++, l = l->next) {
+		fail_unless(!strcmp(l->data, names[i]),
+			"Channel %u is '%s', expected '%s'.", i,
+			(char *)l->data, names[i]);
+	}
+	fail_unless(!names[i] && !l, "Unexpected number of channels.");
+	g_slist_free_full(channels, g_free);
+}
+
+static void setup(void)
+{
+	samples = g_string_new(NULL);
+	retained = NULL;
+	retain = FALSE;
+}
+
+static void teardown(void)
+{
+	g_string_free(samples, TRUE);
+}
+
+/* Check the samplerate derived from the timescale, and downsampling. */
+START_TEST(test_input_vcd_timescale)
+{
+	const struct {
+		const char *text;
+		uint64_t samplerate;
+	} v[] = {
+		{ HEADER("1 s", "$var wire 1 ! a $end\n") "#0 1!\n#10\n", 1 },
+		{ HEADER("10 ms", "$var wire 1 ! a $end\n") "#0 1!\n#10\n", 100 },
+		{ HEADER("100us", "$var wire 1 ! a $end\n") "#0 1!\n#10\n", 10000 },
+		{ HEADER("1 ns", "$var wire 1 ! a $end\n") "#0 1!\n#10\n", SR_GHZ(1) },
+		{ HEADER("10 ps", "$var wire 1 ! a $end\n") "#0 1!\n#10\n", SR_GHZ(100) },
+	};
+	const char *names[] = { "a", NULL };
+	GHashTable *options;
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(v); i++) {
+		check_channels(import(v[i].text, NULL, FALSE), names);
+		fail_unless(samplerate == v[i].samplerate,
+			"Timescale %u: samplerate %" PRIu64 ", expected %"
+			PRIu64 ".", i, samplerate, v[i].samplerate);
+		fail_unless(samples->len == 10);
+	}
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "downsample",
+		g_variant_ref_sink(g_variant_new_int32(5)));
+	check_channels(import(v[3].text, options, FALSE), names);
+	g_hash_table_destroy(options);
+	fail_unless(samplerate == SR_MHZ(200),
+		"Samplerate %" PRIu64 " after downsampling.", samplerate);
+	fail_unless(samples->len == 2);
+}
+END_TEST
+
+/*
+ * Check that multi-bit vectors are skipped, without disturbing the
+ * single-bit variables around them, and that single-bit vector values
+ * and long identifiers work.
+ */
+START_TEST(test_input_vcd_vectors)
+{
+	const char *text = HEADER("1 us",
+		"$var wire 1 ! a $end\n"
+		"$var wire 8 # bus [7:0] $end\n"
+		"$var reg 1 \" b $end\n"
+		"$var wire 1 <id> c [3] $end\n")
+		"#0\n$dumpvars b10101010 # 1! b1 \" 0<id> $end\n"
+		"#2 b0 \" 0! b11110000 #\n"
+		"#4 b11 \" b1 <id> 1 !\n"
+		"#5\n";
+	const char *names[] = { "a", "b", "c[3]", NULL };
+	const uint8_t expected[] = { 0x03, 0x03, 0x00, 0x00, 0x05 };
+
+	check_channels(import(text, NULL, FALSE), names);
+	fail_unless(unitsize == 1);
+	fail_unless(samples->len == sizeof(expected),
+		"%zu samples, expected %zu.", samples->len, sizeof(expected));
+	fail_unless(!memcmp(samples->str, expected, sizeof(expected)));
+}
+END_TEST
+
+/* Check the levels of the samples of the long gaps test. */
+static void check_gaps(gboolean inverted)
+{
+	uint8_t level, mask;
+	uint64_t i;
+
+	mask = inverted ? 0xff : 0x00;
+	fail_unless(samples->len == 3000001,
+		"%zu samples, expected 3000001.", samples->len);
+	for (i = 0; i < samples->len; i++) {
+		if (i < 1000000)
+			level = 0x01;
+		else if (i < 1000010)
+			level = 0x02;
+		else if (i < 2000000)
+			level = 0x01;
+		else if (i < 3000000)
+			level = 0x02;
+		else
+			level = 0x00;
+		level ^= mask;
+		if ((uint8_t)samples->str[i] != level)
+			break;
+	}
+	fail_unless(i == samples->len, "Sample %" PRIu64 " is 0x%02x.", i,
+		(uint8_t)samples->str[i]);
+}
+
+/*
+ * Check long idle gaps, also through an in-place transform, and that
+ * packets retained by a datafeed callback keep their samples when the
+ * levels change.
+ */
+START_TEST(test_input_vcd_long_gaps)
+{
+	const char *text = HEADER("1 ns",
+		"$var wire 1 ! a $end\n"
+		"$var wire 1 \" b $end\n")
+		"#0 1! 0\"\n"
+		"#1000000 0! 1\"\n"
+		"#1000010 1! 0\"\n"
+		"#2000000 0! 1\"\n"
+		"#3000000 0\"\n"
+		"#3000001\n";
+	const char *names[] = { "a", "b", NULL };
+	struct sr_datafeed_packet *packet;
+	const struct sr_datafeed_logic *logic;
+	GString *copy;
+	GSList *l;
+
+	check_channels(import(text, NULL, FALSE), names);
+	check_gaps(FALSE);
+
+	check_channels(import(text, NULL, TRUE), names);
+	check_gaps(TRUE);
+
+	retain = TRUE;
+	check_channels(import(text, NULL, FALSE), names);
+	copy = g_string_new_len(samples->str, samples->len);
+	g_string_truncate(samples, 0);
+	for (l = retained; l; l = l->next) {
+		packet = l->data;
+		fail_unless(packet != NULL);
+		logic = packet->payload;
+		g_string_append_len(samples, logic->data, logic->length);
+		sr_packet_unref(packet);
+	}
+	g_slist_free(retained);
+	check_gaps(FALSE);
+	fail_unless(!memcmp(copy->str, samples->str, copy->len));
+	g_string_free(copy, TRUE);
+}
+END_TEST
+
+Suite *suite_input_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("input-vcd");
+
+	tc = tcase_create("parse");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_input_vcd_timescale);
+	tcase_add_test(tc, test_input_vcd_vectors);
+	tcase_add_test(tc, test_input_vcd_long_gaps);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -45,7 +45,9 @@ Suite *suite_core(void);
 Suite *suite_driver_all(void);
 Suite *suite_input_all(void);
 Suite *suite_input_binary(void);
+Suite *suite_input_vcd(void);
 Suite *suite_output_all(void);
+Suite *suite_output_vcd(void);
 Suite *suite_transform_all(void);
 Suite *suite_session(void);
 Suite *suite_strutil(void);
@@ -54,4 +56,14 @@ Suite *suite_device(void);
 Suite *suite_trigger(void);
 Suite *suite_analog(void);
 
+/* Suites of tests/internal. */
+Suite *suite_soft_trigger(void);
+Suite *suite_dmm_framing(void);
+Suite *suite_transpose(void);
+Suite *suite_usb_queue(void);
+Suite *suite_pool(void);
+Suite *suite_transform_stages(void);
+Suite *suite_scpi(void);
+Suite *suite_analog_raw(void);
+
 #endif
@@ -0,0 +1,248 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "lib.h"
+
+static struct sr_dev_inst *sdi;
+static const struct sr_output *o;
+static GString *text;
+
+/* A device with the given number of logic channels, D0 and up. */
+static void device_new(int num_channels)
+{
+	char name[8];
+	int i;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < num_channels; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+}
+
+static void output_new(void)
+{
+	o = sr_output_new(sr_output_find("vcd"), NULL, sdi, NULL);
+	fail_unless(o != NULL, "Failed to create VCD output.");
+	text = g_string_new(NULL);
+}
+
+static void send(const struct sr_datafeed_packet *packet)
+{
+	GString *out;
+
+	out = NULL;
+	fail_unless(sr_output_send(o, packet, &out) == SR_OK);
+	if (out) {
+		g_string_append_len(text, out->str, out->len);
+		g_string_free(out, TRUE);
+	}
+}
+
+static void send_samplerate(uint64_t samplerate)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_ref_sink(g_variant_new_uint64(samplerate));
+	meta.config = g_slist_append(NULL, &src);
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	send(&packet);
+	g_slist_free(meta.config);
+	g_variant_unref(src.data);
+}
+
+static void send_logic(const void *data, uint64_t length, uint16_t unitsize)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+
+	logic.length = length;
+	logic.unitsize = unitsize;
+	logic.data = (void *)data;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	send(&packet);
+}
+
+static void send_end(void)
+{
+	struct sr_datafeed_packet packet;
+
+	packet.type = SR_DF_END;
+	packet.payload = NULL;
+	send(&packet);
+}
+
+/* The text after the header, which starts with a varying $date. */
+static const char *body(void)
+{
+	const char *end = "$enddefinitions $end\n";
+	const char *p;
+
+	p = strstr(text->str, end);
+	fail_unless(p != NULL, "No end of definitions in '%s'.", text->str);
+
+	return p + strlen(end);
+}
+
+static void output_free(void)
+{
+	sr_output_free(o);
+	g_string_free(text, TRUE);
+}
+
+/*
+ * Check the header, and that the first sample lists all channels, later
+ * samples only the channels which changed, across packets, and that
+ * the end is marked with a timestamp.
+ */
+START_TEST(test_output_vcd_text)
+{
+	const uint8_t data[] = { 0x05, 0x05, 0x07, 0x07, 0x06, 0x07, 0x07 };
+	struct sr_channel *ch;
+	char *header;
+
+	/* D4 is disabled, D3 never changes. */
+	device_new(5);
+	ch = g_slist_nth_data(sr_dev_inst_channels_get(sdi), 4);
+	sr_dev_channel_enable(ch, FALSE);
+	output_new();
+
+	send_samplerate(SR_MHZ(1));
+	send_logic(data, 4, 1);
+	send_logic(data + 4, 3, 1);
+	send_end();
+
+	fail_unless(g_str_has_prefix(text->str, "$date "));
+	header = g_strdup_printf("$end\n"
+		"$version %s %s $end\n"
+		"$comment\n  Acquisition with 4/5 channels at 1 MHz\n$end\n"
+		"$timescale 1 us $end\n"
+		"$scope module %s $end\n"
+		"$var wire 1 ! D0 $end\n"
+		"$var wire 1 \" D1 $end\n"
+		"$var wire 1 # D2 $end\n"
+		"$var wire 1 $ D3 $end\n"
+		"$upscope $end\n"
+		"$enddefinitions $end\n",
+		PACKAGE_NAME, SR_PACKAGE_VERSION_STRING, PACKAGE_NAME);
+	fail_unless(strstr(text->str, header) != NULL,
+		"Unexpected header '%s'.", text->str);
+	g_free(header);
+
+	fail_unless(!strcmp(body(),
+		"#0 1! 0\" 1# 0$\n"
+		"#2 1\"\n"
+		"#4 0!\n"
+		"#5 1!\n"
+		"#7\n"), "Unexpected changes '%s'.", body());
+
+	output_free();
+}
+END_TEST
+
+/*
+ * Check the channels after the first byte of a sample, long runs of
+ * unchanged samples, and timestamps of a samplerate which doesn't divide
+ * the timescale.
+ */
+START_TEST(test_output_vcd_timestamps)
+{
+	uint8_t data[2 * 1001];
+
+	device_new(10);
+	output_new();
+
+	memset(data, 0, sizeof(data));
+	memset(data + 2 * 500, 0x01, 2 * 501);
+	data[2 * 1000 + 1] = 0x02;
+
+	send_samplerate(SR_MHZ(3));
+	send_logic(data, sizeof(data), 2);
+	send_end();
+
+	fail_unless(strstr(text->str, "$timescale 1 ns $end\n") != NULL);
+	fail_unless(strstr(text->str, "$var wire 1 * D9 $end\n") != NULL);
+	fail_unless(!strcmp(body(),
+		"#0 0! 0\" 0# 0$ 0% 0& 0' 0( 0) 0*\n"
+		"#166667 1! 1)\n"
+		"#333333 0) 1*\n"
+		"#333667\n"), "Unexpected changes '%s'.", body());
+
+	output_free();
+}
+END_TEST
+
+/*
+ * Check that glitches of one sample in long runs of unchanged samples
+ * are found, at all offsets from the start of the packet.
+ */
+START_TEST(test_output_vcd_glitches)
+{
+	uint8_t data[1000];
+	GString *expected;
+	unsigned int i, pos;
+
+	device_new(1);
+	output_new();
+
+	memset(data, 0, sizeof(data));
+	expected = g_string_new("#0 0!\n");
+	for (i = 0, pos = 100; i < 16; i++, pos += 40 + i) {
+		data[pos] = 0x01;
+		g_string_append_printf(expected, "#%u 1!\n#%u 0!\n",
+			pos, pos + 1);
+	}
+	g_string_append_printf(expected, "#%zu\n", sizeof(data));
+
+	send_samplerate(SR_MHZ(1));
+	send_logic(data, sizeof(data), 1);
+	send_end();
+
+	fail_unless(!strcmp(body(), expected->str),
+		"Unexpected changes '%s', expected '%s'.", body(),
+		expected->str);
+	g_string_free(expected, TRUE);
+
+	output_free();
+}
+END_TEST
+
+Suite *suite_output_vcd(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("output-vcd");
+
+	tc = tcase_create("basic");
+	tcase_add_test(tc, test_output_vcd_text);
+	tcase_add_test(tc, test_output_vcd_timestamps);
+	tcase_add_test(tc, test_output_vcd_glitches);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,198 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+/* As in src/pool.c. */
+#define MIN_CLASS_SIZE 64
+#define MAX_CLASS_SIZE (16 * 1024 * 1024)
+#define MAX_CACHED 16
+
+static struct sr_pool_stats pool_stats(struct sr_pool *pool)
+{
+	struct sr_pool_stats stats;
+
+	sr_pool_stats_get(pool, &stats);
+
+	return stats;
+}
+
+/*
+ * Check that a released block is handed out again for any size of its
+ * class, and only for those.
+ */
+START_TEST(test_pool_size_classes)
+{
+	struct sr_pool *pool;
+	size_t size, other;
+	void *mem, *again;
+
+	pool = sr_pool_new();
+	for (size = MIN_CLASS_SIZE; size <= MAX_CLASS_SIZE; size *= 2) {
+		mem = sr_pool_alloc(pool, size);
+		fail_unless(mem != NULL);
+		/* The whole class size is usable. */
+		memset(mem, 0x55, size);
+		sr_pool_release(mem);
+
+		/* The smallest size of the class. */
+		other = size == MIN_CLASS_SIZE ? 1 : size / 2 + 1;
+		again = sr_pool_alloc(pool, other);
+		fail_unless(again == mem, "Size %zu: %zu bytes missed the "
+			"free list.", size, other);
+		sr_pool_release(again);
+
+		/* The next class up gets a block of its own. */
+		again = sr_pool_alloc(pool, size + 1);
+		fail_unless(again != mem);
+		sr_pool_release(again);
+		fail_unless(sr_pool_alloc(pool, size) == mem);
+		sr_pool_release(mem);
+	}
+	fail_unless(pool_stats(pool).oversize == 1);
+	fail_unless(pool_stats(pool).outstanding == 0);
+	sr_pool_destroy(pool);
+}
+END_TEST
+
+/* Check the bound on cached blocks, and the statistics. */
+START_TEST(test_pool_caching)
+{
+	struct sr_pool *pool;
+	struct sr_pool_stats stats;
+	void *mem[MAX_CACHED + 4];
+	unsigned int i;
+
+	pool = sr_pool_new();
+	for (i = 0; i < G_N_ELEMENTS(mem); i++)
+		mem[i] = sr_pool_alloc(pool, 1000);
+	stats = pool_stats(pool);
+	fail_unless(stats.allocations == G_N_ELEMENTS(mem));
+	fail_unless(stats.hits == 0);
+	fail_unless(stats.outstanding == G_N_ELEMENTS(mem));
+	fail_unless(stats.cached_bytes == 0);
+
+	for (i = 0; i < G_N_ELEMENTS(mem); i++)
+		sr_pool_release(mem[i]);
+	stats = pool_stats(pool);
+	fail_unless(stats.outstanding == 0);
+	fail_unless(stats.cached_bytes == MAX_CACHED * 1024,
+		"%" PRIu64 " bytes cached.", stats.cached_bytes);
+
+	for (i = 0; i < G_N_ELEMENTS(mem); i++)
+		mem[i] = sr_pool_alloc(pool, 1024);
+	stats = pool_stats(pool);
+	fail_unless(stats.allocations == 2 * G_N_ELEMENTS(mem));
+	fail_unless(stats.hits == MAX_CACHED);
+	fail_unless(stats.cached_bytes == 0);
+	for (i = 0; i < G_N_ELEMENTS(mem); i++)
+		sr_pool_release(mem[i]);
+
+	/* Oversized blocks are never cached. */
+	mem[0] = sr_pool_alloc(pool, MAX_CLASS_SIZE + 1);
+	fail_unless(mem[0] != NULL);
+	sr_pool_release(mem[0]);
+	stats = pool_stats(pool);
+	fail_unless(stats.oversize == 1);
+	fail_unless(stats.cached_bytes == MAX_CACHED * 1024);
+
+	sr_pool_destroy(pool);
+}
+END_TEST
+
+/* Check that blocks stay valid when the pool is destroyed before them. */
+START_TEST(test_pool_orphan)
+{
+	struct sr_pool *pool;
+	struct sr_buffer *buffer;
+	uint8_t *mem;
+
+	pool = sr_pool_new();
+	mem = sr_pool_alloc(pool, 100);
+	buffer = sr_pool_buffer_new(pool, 200);
+	fail_unless(mem && buffer);
+	sr_pool_release(sr_pool_alloc(pool, 300));
+
+	sr_pool_destroy(pool);
+	memset(mem, 0xaa, 100);
+	memset(buffer->data, 0x55, 200);
+
+	sr_pool_release(mem);
+	/* The last block frees the pool. */
+	sr_buffer_unref(buffer);
+
+	/* Without a pool, blocks come from the heap. */
+	mem = sr_pool_alloc(NULL, 100);
+	fail_unless(mem != NULL);
+	memset(mem, 0xaa, 100);
+	sr_pool_release(mem);
+	sr_pool_release(NULL);
+	sr_pool_destroy(NULL);
+}
+END_TEST
+
+/* Check that the session's pool statistics are available. */
+START_TEST(test_pool_session_stats)
+{
+	struct sr_session *session;
+	struct sr_pool_stats stats;
+	void *mem;
+
+	fail_unless(sr_session_new(srtest_ctx, &session) == SR_OK);
+	fail_unless(sr_session_pool_stats_get(NULL, &stats) == SR_ERR_ARG);
+	fail_unless(sr_session_pool_stats_get(session, NULL) == SR_ERR_ARG);
+
+	mem = sr_pool_alloc(session->pool, 100);
+	fail_unless(sr_session_pool_stats_get(session, &stats) == SR_OK);
+	fail_unless(stats.allocations == 1);
+	fail_unless(stats.outstanding == 1);
+	sr_pool_release(mem);
+	fail_unless(sr_session_pool_stats_get(session, &stats) == SR_OK);
+	fail_unless(stats.outstanding == 0);
+	fail_unless(stats.cached_bytes == 128);
+
+	sr_session_destroy(session);
+}
+END_TEST
+
+Suite *suite_pool(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("pool");
+
+	tc = tcase_create("alloc");
+	tcase_add_test(tc, test_pool_size_classes);
+	tcase_add_test(tc, test_pool_caching);
+	tcase_add_test(tc, test_pool_orphan);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("session");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_pool_session_stats);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,637 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "scpi.h"
+#include "lib.h"
+
+/* A transport which plays back a response, in chunks of a given size. */
+struct mock {
+	GString *input;
+	size_t pos;
+	/* After this many bytes, a read returns nothing once. 0: no limit. */
+	size_t chunk;
+	size_t in_chunk;
+	gboolean pause;
+	/* Reads with all of the input consumed. */
+	unsigned int empty_reads;
+	/* Reads with no input available, which would block a socket. */
+	unsigned int blocking_reads;
+	GString *sent;
+	/* Sending fails, like a lost connection. */
+	gboolean send_error;
+	/* Reads end at a newline, like a transport which frames messages. */
+	gboolean lines;
+	gboolean line_done;
+};
+
+static struct mock mock;
+static struct sr_scpi_dev_inst *scpi;
+
+static int mock_open(struct sr_scpi_dev_inst *scpi)
+{
+	(void)scpi;
+
+	return SR_OK;
+}
+
+static int mock_send(void *priv, const char *command)
+{
+	struct mock *m;
+
+	m = priv;
+	if (m->send_error)
+		return SR_ERR;
+	g_string_append(m->sent, command);
+
+	return SR_OK;
+}
+
+static int mock_read_begin(void *priv)
+{
+	struct mock *m;
+
+	m = priv;
+	m->line_done = FALSE;
+
+	return SR_OK;
+}
+
+static int mock_read_data(void *priv, char *buf, int maxlen)
+{
+	struct mock *m;
+	const char *nl;
+	size_t n;
+
+	m = priv;
+	if (m->pos == m->input->len)
+		m->empty_reads++;
+	if (m->pause || m->pos == m->input->len)
+		m->blocking_reads++;
+	if (m->pause) {
+		m->pause = FALSE;
+		return 0;
+	}
+	n = MIN((size_t)maxlen, m->input->len - m->pos);
+	if (m->chunk)
+		n = MIN(n, m->chunk - m->in_chunk);
+	if (m->lines && (nl = memchr(m->input->str + m->pos, '\n', n))) {
+		n = nl + 1 - (m->input->str + m->pos);
+		m->line_done = TRUE;
+	}
+	memcpy(buf, m->input->str + m->pos, n);
+	m->pos += n;
+	if (m->chunk && (m->in_chunk += n) == m->chunk) {
+		m->in_chunk = 0;
+		m->pause = TRUE;
+	}
+
+	return n;
+}
+
+static int mock_read_complete(void *priv)
+{
+	struct mock *m;
+
+	m = priv;
+
+	if (m->lines)
+		return m->line_done;
+
+	return m->pos == m->input->len;
+}
+
+/* Reports a pause once, like a socket that has no data yet. */
+static int mock_read_ready(void *priv)
+{
+	struct mock *m;
+
+	m = priv;
+	if (m->pause) {
+		m->pause = FALSE;
+		return FALSE;
+	}
+
+	return m->pos < m->input->len;
+}
+
+static int mock_close(struct sr_scpi_dev_inst *scpi)
+{
+	(void)scpi;
+
+	return SR_OK;
+}
+
+static void setup(void)
+{
+	mock.input = g_string_new(NULL);
+	mock.sent = g_string_new(NULL);
+	scpi = g_malloc0(sizeof(*scpi));
+	scpi->name = "mock";
+	scpi->open = mock_open;
+	scpi->send = mock_send;
+	scpi->read_begin = mock_read_begin;
+	scpi->read_data = mock_read_data;
+	scpi->read_complete = mock_read_complete;
+	scpi->close = mock_close;
+	scpi->read_timeout_us = 1000 * 1000;
+	scpi->priv = &mock;
+	sr_scpi_open(scpi);
+}
+
+static void teardown(void)
+{
+	sr_scpi_close(scpi);
+	g_free(scpi);
+	g_string_free(mock.input, TRUE);
+	g_string_free(mock.sent, TRUE);
+}
+
+/* Play back the given response, chunk bytes at a time. */
+static void mock_input(const char *data, size_t len, size_t chunk)
+{
+	g_string_truncate(mock.input, 0);
+	g_string_append_len(mock.input, data, len);
+	mock.pos = 0;
+	mock.chunk = chunk;
+	mock.in_chunk = 0;
+	mock.pause = FALSE;
+	mock.empty_reads = 0;
+	mock.blocking_reads = 0;
+	g_string_truncate(mock.sent, 0);
+	mock.send_error = FALSE;
+	mock.lines = FALSE;
+}
+
+/* Read a block to the end, returns the last sr_scpi_block_read() result. */
+static int block_read_all(struct sr_scpi_block *block, unsigned int *calls)
+{
+	int ret;
+
+	*calls = 0;
+	do {
+		ret = sr_scpi_block_read(scpi, block);
+		(*calls)++;
+	} while (ret == 0 && *calls < 1000);
+
+	return ret;
+}
+
+#define DATA "0123#\n45\r\n6789#2"
+#define DATA_LEN (sizeof(DATA) - 1)
+#define BLOCK "#216" DATA "\n"
+
+/*
+ * Check that a block is read completely however the response is split
+ * up, also in the middle of the header, and that a read only returns
+ * 0 while no data is available.
+ */
+START_TEST(test_scpi_block_split)
+{
+	struct sr_scpi_block block;
+	uint8_t buf[32];
+	unsigned int calls;
+	size_t chunk;
+	int ret, user;
+
+	for (user = 0; user < 2; user++) {
+		for (chunk = 1; chunk <= sizeof(BLOCK); chunk++) {
+			mock_input(BLOCK, sizeof(BLOCK) - 1, chunk);
+			ret = sr_scpi_block_begin(scpi, NULL, &block,
+				user ? buf : NULL, user ? DATA_LEN : 0, NULL);
+			fail_unless(ret == SR_OK);
+			ret = block_read_all(&block, &calls);
+			fail_unless(ret == 1, "Chunks of %zu: returned %d.",
+				chunk, ret);
+			/* One call per chunk, and one for the trailer. */
+			fail_unless(calls <= (sizeof(BLOCK) - 1) / chunk + 2,
+				"Chunks of %zu: %u calls.", chunk, calls);
+			fail_unless(block.size == DATA_LEN);
+			fail_unless(!memcmp(block.data, DATA, DATA_LEN),
+				"Chunks of %zu: wrong data.", chunk);
+			fail_unless(!user || block.data == buf);
+			fail_unless(mock.pos == mock.input->len,
+				"Chunks of %zu: trailer left.", chunk);
+			sr_scpi_block_free(&block);
+		}
+	}
+}
+END_TEST
+
+/* Check that a zero-length block is complete right after its header. */
+START_TEST(test_scpi_block_empty)
+{
+	struct sr_scpi_block block;
+	GByteArray *response;
+	unsigned int calls;
+
+	mock_input("#10\n", 4, 0);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(block_read_all(&block, &calls) == 1);
+	fail_unless(block.size == 0);
+	fail_unless(mock.pos == 4);
+	sr_scpi_block_free(&block);
+
+	/* The header split, and no trailer. */
+	mock_input("#3000", 5, 2);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(block_read_all(&block, &calls) == 1);
+	fail_unless(block.size == 0);
+	fail_unless(mock.empty_reads == 0);
+	sr_scpi_block_free(&block);
+
+	mock_input("#10\n", 4, 0);
+	fail_unless(sr_scpi_get_block(scpi, "DATA?", &response) == SR_OK);
+	fail_unless(response->len == 0);
+	fail_unless(!strcmp(mock.sent->str, "DATA?\n"));
+	g_byte_array_free(response, TRUE);
+}
+END_TEST
+
+/*
+ * Check that a trailing newline is consumed, but nothing beyond, and
+ * that a missing one isn't waited for.
+ */
+START_TEST(test_scpi_block_trailer)
+{
+	struct sr_scpi_block block;
+	unsigned int calls;
+	char *response;
+
+	/* The response to the next query follows. */
+	mock_input("#13abc\nOK\n", 10, 0);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(block_read_all(&block, &calls) == 1);
+	fail_unless(!memcmp(block.data, "abc", 3));
+	fail_unless(mock.pos == 7);
+	sr_scpi_block_free(&block);
+	fail_unless(sr_scpi_get_string(scpi, NULL, &response) == SR_OK);
+	fail_unless(!strcmp(response, "OK"));
+	g_free(response);
+
+	/* The newline comes late. */
+	mock_input("#13abc\nOK\n", 10, 6);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(block_read_all(&block, &calls) == 1);
+	fail_unless(calls == 2);
+	fail_unless(mock.pos == 7);
+	sr_scpi_block_free(&block);
+
+	mock_input("#13abc", 6, 0);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(block_read_all(&block, &calls) == 1);
+	fail_unless(!memcmp(block.data, "abc", 3));
+	fail_unless(mock.empty_reads == 0);
+	sr_scpi_block_free(&block);
+}
+END_TEST
+
+/* Check that malformed blocks fail, and release the device. */
+START_TEST(test_scpi_block_errors)
+{
+	const char *bad[] = { "X13abc\n", "#03abc\n", "#A3abc\n", "#2-1abc\n" };
+	struct sr_scpi_block block;
+	uint8_t buf[2];
+	unsigned int calls, i;
+
+	for (i = 0; i < G_N_ELEMENTS(bad); i++) {
+		mock_input(bad[i], strlen(bad[i]), 1);
+		fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0,
+			NULL) == SR_OK);
+		fail_unless(block_read_all(&block, &calls) == SR_ERR_DATA,
+			"'%s' was accepted.", bad[i]);
+		sr_scpi_block_free(&block);
+		fail_unless(sr_scpi_send(scpi, "*CLS") == SR_OK);
+	}
+
+	/* Larger than the caller's buffer. */
+	mock_input("#13abc\n", 7, 0);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, buf, sizeof(buf),
+		NULL) == SR_OK);
+	fail_unless(block_read_all(&block, &calls) == SR_ERR_DATA);
+	sr_scpi_block_free(&block);
+
+	/* The data stops coming. */
+	scpi->read_timeout_us = 10 * 1000;
+	mock_input("#15ab", 5, 0);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	while (sr_scpi_block_read(scpi, &block) == 0)
+		g_usleep(1000);
+	fail_unless(sr_scpi_block_read(scpi, &block) == SR_ERR_ARG);
+	sr_scpi_block_free(&block);
+	fail_unless(sr_scpi_send(scpi, "*CLS") == SR_OK);
+}
+END_TEST
+
+/*
+ * Check that with a transport which can tell when data is available,
+ * nothing is read while there is none. On a socket, that read would
+ * block until the next data arrives.
+ */
+START_TEST(test_scpi_block_ready)
+{
+	struct sr_scpi_block block;
+	unsigned int calls;
+	size_t chunk;
+
+	scpi->read_ready = mock_read_ready;
+
+	for (chunk = 1; chunk <= sizeof(BLOCK); chunk++) {
+		mock_input(BLOCK, sizeof(BLOCK) - 1, chunk);
+		fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0,
+			NULL) == SR_OK);
+		fail_unless(block_read_all(&block, &calls) == 1);
+		fail_unless(mock.blocking_reads == 0,
+			"Chunks of %zu: %u blocking reads.", chunk,
+			mock.blocking_reads);
+		fail_unless(block.size == DATA_LEN);
+		fail_unless(!memcmp(block.data, DATA, DATA_LEN));
+		sr_scpi_block_free(&block);
+	}
+
+	/* The newline comes late. */
+	mock_input("#13abc\nOK\n", 10, 6);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(sr_scpi_block_read(scpi, &block) == 0);
+	fail_unless(sr_scpi_block_read(scpi, &block) == 1);
+	fail_unless(mock.pos == 7);
+	fail_unless(mock.blocking_reads == 0);
+	sr_scpi_block_free(&block);
+}
+END_TEST
+
+static gpointer send_thread(gpointer data)
+{
+	int *ret;
+
+	ret = data;
+	*ret = sr_scpi_send(scpi, "NEXT");
+
+	return NULL;
+}
+
+/*
+ * Check that other requests can't get between the reads of a block:
+ * they fail in the thread reading the block, and wait in others.
+ */
+START_TEST(test_scpi_block_busy)
+{
+	struct sr_scpi_block block, other;
+	GByteArray *data;
+	GThread *thread;
+	char *response, buf[4];
+	unsigned int calls;
+	gint64 start;
+	int ret;
+
+	mock_input("#14abcd\n", 8, 3);
+	fail_unless(sr_scpi_block_begin(scpi, "DATA?", &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(sr_scpi_block_read(scpi, &block) == 0);
+	fail_unless(block.state == SCPI_BLOCK_DATA);
+
+	fail_unless(sr_scpi_send(scpi, "*OPC?") == SR_ERR_BUSY);
+	fail_unless(sr_scpi_get_string(scpi, "*OPC?", &response) != SR_OK);
+	fail_unless(sr_scpi_read_data(scpi, buf, sizeof(buf)) == SR_ERR_BUSY);
+	fail_unless(sr_scpi_get_block(scpi, NULL, &data) == SR_ERR_BUSY);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &other, NULL, 0, NULL)
+		== SR_ERR_BUSY);
+	fail_unless(!strcmp(mock.sent->str, "DATA?\n"));
+	fail_unless(mock.pos == 3);
+
+	ret = 1;
+	thread = g_thread_new("scpi-test", send_thread, &ret);
+	g_usleep(50 * 1000);
+	fail_unless(!strcmp(mock.sent->str, "DATA?\n"));
+	fail_unless(block_read_all(&block, &calls) == 1);
+	/* Woken up right away, not by its timeout. */
+	start = g_get_monotonic_time();
+	g_thread_join(thread);
+	fail_unless(g_get_monotonic_time() - start < scpi->read_timeout_us / 2);
+	fail_unless(ret == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "DATA?\nNEXT\n"));
+	fail_unless(!memcmp(block.data, "abcd", 4));
+	sr_scpi_block_free(&block);
+}
+END_TEST
+
+/* Check that releasing or closing aborts a block read in progress. */
+START_TEST(test_scpi_block_abort)
+{
+	struct sr_scpi_block block;
+
+	mock_input("#14abcd\n", 8, 3);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(sr_scpi_block_read(scpi, &block) == 0);
+	sr_scpi_block_free(&block);
+	fail_unless(sr_scpi_send(scpi, "*CLS") == SR_OK);
+	fail_unless(sr_scpi_block_read(scpi, &block) == SR_ERR_ARG);
+
+	mock_input("#14abcd\n", 8, 3);
+	fail_unless(sr_scpi_block_begin(scpi, NULL, &block, NULL, 0, NULL)
+		== SR_OK);
+	fail_unless(sr_scpi_block_read(scpi, &block) == 0);
+	sr_scpi_close(scpi);
+	sr_scpi_open(scpi);
+	fail_unless(sr_scpi_send(scpi, "*CLS") == SR_OK);
+	sr_scpi_block_free(&block);
+}
+END_TEST
+
+/*
+ * Check that queries are sent ahead up to the depth of the pipeline, in
+ * order, the next one as soon as a response was read, and that each
+ * response belongs to its query.
+ */
+START_TEST(test_scpi_pipeline_order)
+{
+	const char *sent[] = {
+		"Q1\nQ2\nQ3\n", "Q1\nQ2\nQ3\nQ4\n", "Q1\nQ2\nQ3\nQ4\nQ5\n",
+	};
+	struct sr_scpi_pipeline pipeline;
+	char *response, expected[4];
+	unsigned int i;
+
+	mock_input("R1\nR2\nR3\nR4\nR5\n", 15, 0);
+	mock.lines = TRUE;
+	sr_scpi_pipeline_init(&pipeline, 3);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q1") == SR_OK);
+	fail_unless(pipeline.in_flight == 1);
+	fail_unless(!strcmp(mock.sent->str, "Q1\n"));
+	for (i = 2; i <= 5; i++) {
+		g_snprintf(expected, sizeof(expected), "Q%u", i);
+		fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, expected)
+			== SR_OK);
+	}
+	fail_unless(pipeline.in_flight == 3);
+	fail_unless(g_queue_get_length(&pipeline.queue) == 2);
+	fail_unless(!strcmp(mock.sent->str, sent[0]));
+
+	for (i = 1; i <= 5; i++) {
+		fail_unless(sr_scpi_get_string(scpi, NULL, &response) == SR_OK);
+		g_snprintf(expected, sizeof(expected), "R%u", i);
+		fail_unless(!strcmp(response, expected),
+			"Response %u is '%s'.", i, response);
+		g_free(response);
+		fail_unless(sr_scpi_pipeline_done(scpi, &pipeline) == SR_OK);
+		fail_unless(!strcmp(mock.sent->str, sent[MIN(i, 2)]),
+			"After response %u, sent '%s'.", i, mock.sent->str);
+		fail_unless(pipeline.in_flight == MIN(3, 5 - i));
+	}
+	fail_unless(g_queue_is_empty(&pipeline.queue));
+
+	/* Done with nothing in flight doesn't underflow. */
+	fail_unless(sr_scpi_pipeline_done(scpi, &pipeline) == SR_OK);
+	fail_unless(pipeline.in_flight == 0);
+
+	/* A depth of 0 sends one query at a time. */
+	mock_input("R1\nR2\n", 6, 0);
+	sr_scpi_pipeline_init(&pipeline, 0);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q1") == SR_OK);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q2") == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "Q1\n"));
+	fail_unless(sr_scpi_pipeline_done(scpi, &pipeline) == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "Q1\nQ2\n"));
+	sr_scpi_pipeline_clear(&pipeline);
+}
+END_TEST
+
+/*
+ * Check that a failed send is reported and the query is not counted,
+ * and that after clearing on an error, no stale query is sent and the
+ * next one goes out right away.
+ */
+START_TEST(test_scpi_pipeline_clear)
+{
+	struct sr_scpi_pipeline pipeline;
+	char *response;
+
+	mock_input("R1\n", 3, 0);
+	mock.lines = TRUE;
+	sr_scpi_pipeline_init(&pipeline, 2);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q1") == SR_OK);
+	mock.send_error = TRUE;
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q2") != SR_OK);
+	fail_unless(pipeline.in_flight == 1);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q3") != SR_OK);
+	mock.send_error = FALSE;
+	fail_unless(!strcmp(mock.sent->str, "Q1\n"));
+
+	sr_scpi_pipeline_clear(&pipeline);
+	fail_unless(pipeline.in_flight == 0);
+	fail_unless(g_queue_is_empty(&pipeline.queue));
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q4") == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "Q1\nQ4\n"));
+	fail_unless(pipeline.in_flight == 1);
+
+	/* A response which never comes, with queries waiting. */
+	scpi->read_timeout_us = 10 * 1000;
+	mock_input("", 0, 0);
+	mock.lines = TRUE;
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q5") == SR_OK);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q6") == SR_OK);
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q7") == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "Q5\n"));
+	fail_unless(sr_scpi_get_string(scpi, NULL, &response) != SR_OK);
+	sr_scpi_pipeline_clear(&pipeline);
+	fail_unless(sr_scpi_pipeline_done(scpi, &pipeline) == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "Q5\n"));
+
+	mock_input("R8\n", 3, 0);
+	mock.lines = TRUE;
+	fail_unless(sr_scpi_pipeline_query(scpi, &pipeline, "Q8") == SR_OK);
+	fail_unless(!strcmp(mock.sent->str, "Q8\n"));
+	fail_unless(sr_scpi_get_string(scpi, NULL, &response) == SR_OK);
+	fail_unless(!strcmp(response, "R8"));
+	g_free(response);
+	sr_scpi_pipeline_clear(&pipeline);
+}
+END_TEST
+
+/* Check the frame counter and the times of the frame rate measurement. */
+START_TEST(test_scpi_frame_stats)
+{
+	struct sr_scpi_frame_stats stats;
+	gint64 before, last;
+	unsigned int i;
+
+	before = g_get_monotonic_time();
+	sr_scpi_frame_stats_start(&stats);
+	fail_unless(stats.frames == 0);
+	fail_unless(stats.start >= before);
+	fail_unless(stats.last == stats.start);
+	/* Nothing to report yet. */
+	sr_scpi_frame_stats_report(&stats, NULL);
+
+	last = stats.last;
+	for (i = 1; i <= 3; i++) {
+		g_usleep(1000);
+		sr_scpi_frame_stats_frame(&stats);
+		fail_unless(stats.frames == i);
+		fail_unless(stats.last > last);
+		last = stats.last;
+	}
+	fail_unless(stats.start >= before && stats.start < stats.last);
+	sr_scpi_frame_stats_report(&stats, "Model");
+
+	/* Starting over resets the count. */
+	sr_scpi_frame_stats_start(&stats);
+	fail_unless(stats.frames == 0);
+	fail_unless(stats.start >= last);
+}
+END_TEST
+
+Suite *suite_scpi(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("scpi");
+
+	tc = tcase_create("block");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_scpi_block_split);
+	tcase_add_test(tc, test_scpi_block_empty);
+	tcase_add_test(tc, test_scpi_block_trailer);
+	tcase_add_test(tc, test_scpi_block_errors);
+	tcase_add_test(tc, test_scpi_block_ready);
+	tcase_add_test(tc, test_scpi_block_busy);
+	tcase_add_test(tc, test_scpi_block_abort);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("pipeline");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_scpi_pipeline_order);
+	tcase_add_test(tc, test_scpi_pipeline_clear);
+	tcase_add_test(tc, test_scpi_frame_stats);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
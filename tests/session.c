@@ -19,6 +19,10 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <zip.h>
+#include <glib/gstdio.h>
 #include <check.h>
 #include <libsigrok/libsigrok.h>
 #include "lib.h"
@@ -185,6 +189,619 @@ START_TEST(test_session_trigger_get_null)
 }
 END_TEST
 
+static const char test_metadata[] =
+	"[device 1]\n"
+	"capturefile=logic-1\n"
+	"total probes=8\n"
+	"samplerate=1 MHz\n"
+	"total analog=1\n"
+	"probe1=D0\n"
+	"analog9=A0\n"
+	"unitsize=1\n";
+
+static uint8_t test_logic[351];
+static float test_analog[20];
+
+static void add_entry(struct zip *archive, const char *name,
+		const void *buf, size_t len)
+{
+	struct zip_source *src;
+
+	src = zip_source_buffer(archive, buf, len, 0);
+	fail_unless(src != NULL);
+	fail_unless(zip_add(archive, name, src) >= 0);
+}
+
+/*
+ * Write a session file with logic chunks of 100, 1 and 250 samples and
+ * analog chunks of 8 and 12 samples. Every sample holds its own index.
+ */
+static char *session_file_create(void)
+{
+	struct zip *archive;
+	char *filename;
+	unsigned int i;
+
+	for (i = 0; i < G_N_ELEMENTS(test_logic); i++)
+		test_logic[i] = i;
+	for (i = 0; i < G_N_ELEMENTS(test_analog); i++)
+		test_analog[i] = i;
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-session.sr", NULL);
+	archive = zip_open(filename, ZIP_CREATE | ZIP_TRUNCATE, NULL);
+	fail_unless(archive != NULL);
+	add_entry(archive, "version", "2", 1);
+	add_entry(archive, "metadata", test_metadata, strlen(test_metadata));
+	/* Not in chunk order, the index has to sort them. */
+	add_entry(archive, "logic-1-3", test_logic + 101, 250);
+	add_entry(archive, "logic-1-1", test_logic, 100);
+	add_entry(archive, "logic-1-2", test_logic + 100, 1);
+	add_entry(archive, "analog-1-9-2", test_analog + 8, 12 * sizeof(float));
+	add_entry(archive, "analog-1-9-1", test_analog, 8 * sizeof(float));
+	fail_unless(zip_close(archive) == 0);
+
+	return filename;
+}
+
+/* Check reading sample ranges across chunk boundaries. */
+START_TEST(test_session_file_read)
+{
+	int ret;
+	unsigned int unitsize, i;
+	uint64_t num_samples;
+	uint8_t logic[351];
+	float analog[20];
+	char *filename;
+	struct sr_session_file *sfile;
+	const uint64_t ranges[][2] = {
+		{ 0, 351 }, { 99, 102 }, { 100, 101 }, { 350, 351 },
+		{ 200, 200 }, { 5, 300 },
+	};
+
+	filename = session_file_create();
+	ret = sr_session_file_open(filename, &sfile);
+	fail_unless(ret == SR_OK, "sr_session_file_open() failed: %d.", ret);
+
+	ret = sr_session_file_logic_info(sfile, &num_samples, &unitsize);
+	fail_unless(ret == SR_OK);
+	fail_unless(num_samples == 351 && unitsize == 1);
+
+	for (i = 0; i < G_N_ELEMENTS(ranges); i++) {
+		memset(logic, 0xff, sizeof(logic));
+		ret = sr_session_file_read_logic(sfile, ranges[i][0],
+			ranges[i][1], logic);
+		fail_unless(ret == SR_OK, "Read failed: %d.", ret);
+		fail_unless(!memcmp(logic, test_logic + ranges[i][0],
+			ranges[i][1] - ranges[i][0]), "Range %d mismatch.", i);
+	}
+	ret = sr_session_file_read_logic(sfile, 300, 352, logic);
+	fail_unless(ret == SR_ERR_ARG);
+
+	ret = sr_session_file_analog_info(sfile, 8, &num_samples);
+	fail_unless(ret == SR_OK && num_samples == 20);
+	ret = sr_session_file_read_analog(sfile, 8, 5, 13, analog);
+	fail_unless(ret == SR_OK);
+	fail_unless(!memcmp(analog, test_analog + 5, 8 * sizeof(float)));
+	ret = sr_session_file_analog_info(sfile, 0, &num_samples);
+	fail_unless(ret == SR_ERR_NA);
+
+	sr_session_file_close(sfile);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+#define SRZIP_LOGIC 50000
+#define SRZIP_ANALOG 6000
+
+static uint8_t srzip_logic[SRZIP_LOGIC + 100];
+static float srzip_analog[SRZIP_ANALOG];
+
+static void srzip_send(const struct sr_output *o, int type,
+		const void *payload)
+{
+	struct sr_datafeed_packet packet;
+	GString *out;
+	int ret;
+
+	packet.type = type;
+	packet.payload = payload;
+	out = NULL;
+	ret = sr_output_send(o, &packet, &out);
+	fail_unless(ret == SR_OK, "sr_output_send() failed: %d.", ret);
+	if (out)
+		g_string_free(out, TRUE);
+}
+
+static void srzip_send_logic(const struct sr_output *o,
+		uint64_t start, uint64_t end)
+{
+	struct sr_datafeed_logic logic;
+
+	logic.length = end - start;
+	logic.unitsize = 1;
+	logic.data = srzip_logic + start;
+	srzip_send(o, SR_DF_LOGIC, &logic);
+}
+
+static void srzip_send_analog(const struct sr_output *o,
+		struct sr_channel *ch, uint64_t start, uint64_t end)
+{
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+
+	memset(&encoding, 0, sizeof(encoding));
+	memset(&meaning, 0, sizeof(meaning));
+	memset(&spec, 0, sizeof(spec));
+	encoding.unitsize = sizeof(float);
+	encoding.is_signed = TRUE;
+	encoding.is_float = TRUE;
+#ifdef WORDS_BIGENDIAN
+	encoding.is_bigendian = TRUE;
+#endif
+	encoding.digits = 3;
+	encoding.is_digits_decimal = TRUE;
+	encoding.scale.p = encoding.scale.q = 1;
+	encoding.offset.q = 1;
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	meaning.channels = g_slist_append(NULL, ch);
+	spec.spec_digits = 3;
+	analog.data = srzip_analog + start;
+	analog.num_samples = end - start;
+	analog.encoding = &encoding;
+	analog.meaning = &meaning;
+	analog.spec = &spec;
+	srzip_send(o, SR_DF_ANALOG, &analog);
+	g_slist_free(meaning.channels);
+}
+
+/*
+ * Write SRZIP_LOGIC logic and SRZIP_ANALOG analog samples with the srzip
+ * output module, in packets of various sizes, and end the acquisition.
+ * The data has runs of constant samples, so the summaries are sparse.
+ */
+static const struct sr_output *srzip_write(const char *filename,
+		GHashTable *options)
+{
+	const struct sr_output *o;
+	struct sr_dev_inst *sdi;
+	struct sr_channel *ch;
+	struct sr_datafeed_meta meta;
+	struct sr_config src;
+	uint64_t i, n, a;
+	char name[8];
+
+	for (i = 0; i < G_N_ELEMENTS(srzip_logic); i++)
+		srzip_logic[i] = (i / 300) ^ ((i % 1700) < 3 ? 0x80 : 0);
+	for (i = 0; i < G_N_ELEMENTS(srzip_analog); i++)
+		srzip_analog[i] = i * 0.25f - 100;
+
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < 8; i++) {
+		g_snprintf(name, sizeof(name), "D%u", (unsigned int)i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_dev_inst_channel_add(sdi, 8, SR_CHANNEL_ANALOG, "A0");
+	ch = g_slist_last(sr_dev_inst_channels_get(sdi))->data;
+
+	o = sr_output_new(sr_output_find("srzip"), options, sdi, filename);
+	fail_unless(o != NULL, "Failed to create srzip output.");
+
+	src.key = SR_CONF_SAMPLERATE;
+	src.data = g_variant_new_uint64(1000000);
+	meta.config = g_slist_append(NULL, &src);
+	srzip_send(o, SR_DF_META, &meta);
+	g_slist_free(meta.config);
+	g_variant_unref(g_variant_ref_sink(src.data));
+
+	for (i = a = 0, n = 1; i < SRZIP_LOGIC; i += n, n = n * 3 + 1) {
+		n = MIN(n % 7919, SRZIP_LOGIC - i);
+		srzip_send_logic(o, i, i + n);
+		if (a < SRZIP_ANALOG) {
+			srzip_send_analog(o, ch, a, MIN(a + n, SRZIP_ANALOG));
+			a = MIN(a + n, SRZIP_ANALOG);
+		}
+	}
+	fail_unless(a == SRZIP_ANALOG);
+	srzip_send(o, SR_DF_END, NULL);
+
+	return o;
+}
+
+static GHashTable *srzip_options(gboolean summary, guint32 workers)
+{
+	GHashTable *options;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "streaming",
+		g_variant_ref_sink(g_variant_new_boolean(TRUE)));
+	g_hash_table_insert(options, "chunksize",
+		g_variant_ref_sink(g_variant_new_uint64(4096)));
+	g_hash_table_insert(options, "summary",
+		g_variant_ref_sink(g_variant_new_boolean(summary)));
+	g_hash_table_insert(options, "workers",
+		g_variant_ref_sink(g_variant_new_uint32(workers)));
+
+	return options;
+}
+
+/*
+ * Check that a file written by the srzip output module in streaming mode
+ * reads back, and that data sent after SR_DF_END still gets appended.
+ */
+START_TEST(test_session_file_srzip_streaming)
+{
+	int ret;
+	uint64_t num_samples;
+	unsigned int unitsize;
+	uint8_t *logic;
+	float *analog;
+	char *filename, *spillname;
+	const struct sr_output *o;
+	struct sr_session_file *sfile;
+	GHashTable *options;
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-srzip.sr", NULL);
+	spillname = g_strconcat(filename, ".tmp", NULL);
+	options = srzip_options(FALSE, 1);
+	o = srzip_write(filename, options);
+	fail_unless(!g_file_test(spillname, G_FILE_TEST_EXISTS),
+		"Spill file was not removed.");
+	srzip_send_logic(o, SRZIP_LOGIC, SRZIP_LOGIC + 100);
+	sr_output_free(o);
+	g_hash_table_destroy(options);
+
+	ret = sr_session_file_open(filename, &sfile);
+	fail_unless(ret == SR_OK, "sr_session_file_open() failed: %d.", ret);
+
+	ret = sr_session_file_logic_info(sfile, &num_samples, &unitsize);
+	fail_unless(ret == SR_OK);
+	fail_unless(num_samples == SRZIP_LOGIC + 100 && unitsize == 1);
+	logic = g_malloc(num_samples);
+	ret = sr_session_file_read_logic(sfile, 0, num_samples, logic);
+	fail_unless(ret == SR_OK, "Read failed: %d.", ret);
+	fail_unless(!memcmp(logic, srzip_logic, num_samples));
+	g_free(logic);
+
+	ret = sr_session_file_analog_info(sfile, 8, &num_samples);
+	fail_unless(ret == SR_OK && num_samples == SRZIP_ANALOG);
+	analog = g_malloc(SRZIP_ANALOG * sizeof(float));
+	ret = sr_session_file_read_analog(sfile, 8, 0, SRZIP_ANALOG, analog);
+	fail_unless(ret == SR_OK, "Read failed: %d.", ret);
+	fail_unless(!memcmp(analog, srzip_analog, SRZIP_ANALOG * sizeof(float)));
+	g_free(analog);
+
+	sr_session_file_close(sfile);
+	g_unlink(filename);
+	g_free(spillname);
+	g_free(filename);
+}
+END_TEST
+
+/* The next sample at or after start that differs in a masked bit. */
+static uint64_t srzip_next_transition(uint64_t start, uint8_t mask)
+{
+	uint64_t i;
+
+	for (i = MAX(start, 1); i < SRZIP_LOGIC; i++) {
+		if ((srzip_logic[i] ^ srzip_logic[i - 1]) & mask)
+			break;
+	}
+
+	return i;
+}
+
+/*
+ * Check the chunks and summaries of a file written by several srzip
+ * worker threads against the raw data.
+ */
+START_TEST(test_session_file_srzip_summary)
+{
+	int ret;
+	uint64_t blocksize, num_blocks, num_samples, i, j, sample;
+	unsigned int unitsize, m, level;
+	uint8_t *masks, expected;
+	float *min, *max, emin, emax;
+	char *filename, name[32];
+	const struct sr_output *o;
+	struct sr_session_file *sfile;
+	struct zip *archive;
+	struct zip_stat zs;
+	GHashTable *options;
+	const uint8_t test_masks[] = { 0xff, 0x01, 0x80, 0x40 };
+
+	filename = g_build_filename(g_get_tmp_dir(), "sr-test-srzip.sr", NULL);
+	options = srzip_options(TRUE, 4);
+	o = srzip_write(filename, options);
+	sr_output_free(o);
+	g_hash_table_destroy(options);
+
+	/* Full chunks in order, only the last one is short. */
+	archive = zip_open(filename, 0, NULL);
+	fail_unless(archive != NULL);
+	for (i = 0; i * 4096 < SRZIP_LOGIC; i++) {
+		g_snprintf(name, sizeof(name), "logic-1-%" PRIu64, i + 1);
+		fail_unless(zip_stat(archive, name, 0, &zs) == 0,
+			"Chunk '%s' is missing.", name);
+		fail_unless(zs.size == MIN(4096, SRZIP_LOGIC - i * 4096));
+	}
+	g_snprintf(name, sizeof(name), "logic-1-%" PRIu64, i + 1);
+	fail_unless(zip_stat(archive, name, 0, &zs) < 0);
+	zip_discard(archive);
+
+	ret = sr_session_file_open(filename, &sfile);
+	fail_unless(ret == SR_OK, "sr_session_file_open() failed: %d.", ret);
+
+	ret = sr_session_file_logic_info(sfile, &num_samples, &unitsize);
+	fail_unless(ret == SR_OK && num_samples == SRZIP_LOGIC);
+	fail_unless(unitsize == 1);
+	masks = g_malloc(SRZIP_LOGIC);
+	ret = sr_session_file_read_logic(sfile, 0, SRZIP_LOGIC, masks);
+	fail_unless(ret == SR_OK);
+	fail_unless(!memcmp(masks, srzip_logic, SRZIP_LOGIC));
+
+	ret = sr_session_file_summary_blocksize(sfile, &blocksize);
+	fail_unless(ret == SR_OK && blocksize > 0);
+
+	/* Every level against the changes in its blocks of raw data. */
+	for (level = 0; (blocksize << level) < 2 * SRZIP_LOGIC; level++) {
+		num_blocks = (SRZIP_LOGIC + (blocksize << level) - 1) /
+			(blocksize << level);
+		ret = sr_session_file_logic_summary(sfile, level, 0,
+			num_blocks, masks);
+		fail_unless(ret == SR_OK, "Level %u failed: %d.", level, ret);
+		for (i = 0; i < num_blocks; i++) {
+			expected = 0;
+			for (j = MAX(i * (blocksize << level), 1);
+			     j < MIN((i + 1) * (blocksize << level), SRZIP_LOGIC); j++)
+				expected |= srzip_logic[j] ^ srzip_logic[j - 1];
+			fail_unless(masks[i] == expected,
+				"Level %u block %" PRIu64 " mismatch.", level, i);
+		}
+		if (num_blocks == 1)
+			break;
+	}
+	ret = sr_session_file_logic_summary(sfile, 0, 0,
+		(SRZIP_LOGIC + blocksize - 1) / blocksize + 1, masks);
+	fail_unless(ret == SR_ERR_ARG);
+	g_free(masks);
+
+	num_blocks = (SRZIP_ANALOG + blocksize - 1) / blocksize;
+	min = g_malloc(num_blocks * sizeof(float));
+	max = g_malloc(num_blocks * sizeof(float));
+	ret = sr_session_file_analog_summary(sfile, 8, 0, 0, num_blocks,
+		min, max);
+	fail_unless(ret == SR_OK);
+	for (i = 0; i < num_blocks; i++) {
+		emin = emax = srzip_analog[i * blocksize];
+		for (j = i * blocksize; j < MIN((i + 1) * blocksize, SRZIP_ANALOG); j++) {
+			emin = MIN(emin, srzip_analog[j]);
+			emax = MAX(emax, srzip_analog[j]);
+		}
+		fail_unless(min[i] == emin && max[i] == emax);
+	}
+	g_free(min);
+	g_free(max);
+
+	/* Walk all transitions, from every start in the first blocks. */
+	for (m = 0; m < G_N_ELEMENTS(test_masks); m++) {
+		for (i = 0; i < SRZIP_LOGIC; ) {
+			ret = sr_session_file_logic_next_transition(sfile, i,
+				&test_masks[m], &sample);
+			fail_unless(ret == SR_OK);
+			fail_unless(sample == srzip_next_transition(i, test_masks[m]),
+				"Mask 0x%02x from %" PRIu64 ": got %" PRIu64 ".",
+				test_masks[m], i, sample);
+			i = (i < 3 * blocksize) ? i + 1 : sample + 1;
+		}
+	}
+	ret = sr_session_file_logic_next_transition(sfile, 0, NULL, &sample);
+	fail_unless(ret == SR_OK && sample == srzip_next_transition(0, 0xff));
+
+	sr_session_file_close(sfile);
+	g_unlink(filename);
+	g_free(filename);
+}
+END_TEST
+
+static GString *threaded_data;
+static gboolean threaded_end;
+
+static void datafeed_threaded(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	fail_unless(!threaded_end, "Packet received after SR_DF_END.");
+	if (packet->type == SR_DF_LOGIC) {
+		logic = packet->payload;
+		/* Be slower than the sender, so that the queue fills up. */
+		g_usleep(100);
+		g_string_append_len(threaded_data, logic->data, logic->length);
+	} else if (packet->type == SR_DF_END) {
+		threaded_end = TRUE;
+	}
+}
+
+/*
+ * Check that a callback on a worker thread gets all packets in order,
+ * and that sending SR_DF_END waits for it.
+ */
+START_TEST(test_session_datafeed_threaded)
+{
+	int ret;
+	unsigned int i;
+	char buf[7];
+	const struct sr_input_module *imod;
+	struct sr_input *in;
+	struct sr_session *session;
+	GString *sent, *gbuf;
+
+	threaded_data = g_string_new(NULL);
+	threaded_end = FALSE;
+	sent = g_string_new(NULL);
+
+	imod = sr_input_find("binary");
+	fail_unless(imod != NULL, "Failed to find input module.");
+	in = sr_input_new(imod, NULL);
+	fail_unless(in != NULL, "Failed to create input instance.");
+
+	sr_session_new(srtest_ctx, &session);
+	ret = sr_session_datafeed_callback_add_threaded(session,
+		datafeed_threaded, NULL, 2, SR_DATAFEED_BLOCK);
+	fail_unless(ret == SR_OK, "Failed to add threaded callback: %d.", ret);
+	ret = sr_session_datafeed_callback_add_threaded(session,
+		datafeed_threaded, NULL, 0, SR_DATAFEED_BLOCK);
+	fail_unless(ret == SR_ERR_ARG);
+	sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+	for (i = 0; i < 200; i++) {
+		memset(buf, i, sizeof(buf));
+		gbuf = g_string_new_len(buf, sizeof(buf));
+		ret = sr_input_send(in, gbuf);
+		fail_unless(ret == SR_OK, "sr_input_send() error: %d", ret);
+		g_string_free(gbuf, TRUE);
+		g_string_append_len(sent, buf, sizeof(buf));
+	}
+	ret = sr_input_end(in);
+	fail_unless(ret == SR_OK, "sr_input_end() error: %d", ret);
+
+	fail_unless(threaded_end, "SR_DF_END not processed.");
+	fail_unless(threaded_data->len == sent->len);
+	fail_unless(!memcmp(threaded_data->str, sent->str, sent->len));
+
+	sr_input_free(in);
+	sr_session_destroy(session);
+	g_string_free(threaded_data, TRUE);
+	g_string_free(sent, TRUE);
+}
+END_TEST
+
+static GSList *retained;
+
+static void datafeed_retain(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	struct sr_datafeed_packet *ref;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type != SR_DF_LOGIC)
+		return;
+	ref = sr_packet_ref(packet);
+	fail_unless(ref != NULL, "sr_packet_ref() failed.");
+	/* Retaining a retained packet must not copy it again. */
+	fail_unless(sr_packet_ref(ref) == ref);
+	sr_packet_unref(ref);
+	retained = g_slist_append(retained, ref);
+}
+
+/*
+ * Check that packets retained by a callback outlive sr_session_send(),
+ * also on a worker thread.
+ */
+START_TEST(test_session_packet_ref)
+{
+	unsigned int i, threaded;
+	char buf[5];
+	const struct sr_input_module *imod;
+	const struct sr_datafeed_logic *logic;
+	struct sr_input *in;
+	struct sr_session *session;
+	GString *gbuf, *received;
+	GSList *l;
+
+	for (threaded = 0; threaded < 2; threaded++) {
+		retained = NULL;
+
+		imod = sr_input_find("binary");
+		fail_unless(imod != NULL, "Failed to find input module.");
+		in = sr_input_new(imod, NULL);
+		fail_unless(in != NULL, "Failed to create input instance.");
+
+		sr_session_new(srtest_ctx, &session);
+		if (threaded)
+			sr_session_datafeed_callback_add_threaded(session,
+				datafeed_retain, NULL, 4, SR_DATAFEED_BLOCK);
+		else
+			sr_session_datafeed_callback_add(session,
+				datafeed_retain, NULL);
+		sr_session_dev_add(session, sr_input_dev_inst_get(in));
+
+		for (i = 0; i < 10; i++) {
+			memset(buf, i, sizeof(buf));
+			gbuf = g_string_new_len(buf, sizeof(buf));
+			sr_input_send(in, gbuf);
+			/* Scribble over the data the packet pointed to. */
+			memset(gbuf->str, 0xff, gbuf->len);
+			g_string_free(gbuf, TRUE);
+		}
+		sr_input_end(in);
+
+		received = g_string_new(NULL);
+		for (l = retained; l; l = l->next) {
+			logic = ((struct sr_datafeed_packet *)l->data)->payload;
+			g_string_append_len(received, logic->data,
+				logic->length);
+		}
+		fail_unless(received->len == 10 * sizeof(buf));
+		for (i = 0; i < received->len; i++)
+			fail_unless(received->str[i] == (char)(i / sizeof(buf)));
+		g_string_free(received, TRUE);
+
+		g_slist_free_full(retained, (GDestroyNotify)sr_packet_unref);
+		sr_input_free(in);
+		sr_session_destroy(session);
+	}
+}
+END_TEST
+
+/*
+ * Check that packets allocated by the caller, like the bindings do, are
+ * told apart from the packets of libsigrok.
+ */
+START_TEST(test_session_packet_foreign)
+{
+	struct sr_datafeed_packet *packet, *copy;
+	struct sr_datafeed_logic *logic;
+	uint8_t data[4] = { 1, 2, 3, 4 };
+
+	/* Nothing past the packet itself may be read. */
+	logic = g_new0(struct sr_datafeed_logic, 1);
+	logic->length = sizeof(data);
+	logic->unitsize = 1;
+	logic->data = data;
+	packet = g_new(struct sr_datafeed_packet, 1);
+	packet->type = SR_DF_LOGIC;
+	packet->payload = logic;
+
+	fail_unless(sr_packet_ref(packet) == NULL);
+	/* Must not free it. */
+	sr_packet_unref(packet);
+	sr_packet_free(packet);
+
+	fail_unless(sr_packet_copy(packet, &copy) == SR_OK);
+	fail_unless(copy != packet);
+	logic = (struct sr_datafeed_logic *)copy->payload;
+	fail_unless(logic->length == sizeof(data));
+	fail_unless(!memcmp(logic->data, data, sizeof(data)));
+	fail_unless(sr_packet_ref(copy) == copy);
+	sr_packet_unref(copy);
+	sr_packet_free(copy);
+
+	g_free((void *)packet->payload);
+	g_free(packet);
+}
+END_TEST
+
 Suite *suite_session(void)
 {
 	Suite *s;
@@ -209,5 +826,19 @@ Suite *suite_session(void)
 	tcase_add_test(tc, test_session_trigger_get_null);
 	suite_add_tcase(s, tc);
 
+	tc = tcase_create("session_file");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_file_read);
+	tcase_add_test(tc, test_session_file_srzip_streaming);
+	tcase_add_test(tc, test_session_file_srzip_summary);
+	suite_add_tcase(s, tc);
+
+	tc = tcase_create("datafeed");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_session_datafeed_threaded);
+	tcase_add_test(tc, test_session_packet_ref);
+	tcase_add_test(tc, test_session_packet_foreign);
+	suite_add_tcase(s, tc);
+
 	return s;
 }
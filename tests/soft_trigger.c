@@ -0,0 +1,548 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define MAX_UNITSIZE 9
+
+static struct sr_session *session;
+static struct sr_dev_inst *sdi;
+static struct sr_trigger *trigger;
+
+/* Logic data sent by the soft trigger, and where SR_DF_TRIGGER came. */
+static GString *sent;
+static int trigger_pos;
+
+static void datafeed_collect(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+
+	(void)sdi;
+	(void)cb_data;
+
+	if (packet->type == SR_DF_LOGIC) {
+		fail_unless(trigger_pos < 0, "Logic data after the trigger.");
+		logic = packet->payload;
+		g_string_append_len(sent, logic->data, logic->length);
+	} else if (packet->type == SR_DF_TRIGGER) {
+		fail_unless(trigger_pos < 0, "Second trigger.");
+		trigger_pos = sent->len;
+	}
+}
+
+/* Set up a device with unitsize bytes worth of logic channels. */
+static void setup(int unitsize)
+{
+	char name[8];
+	int i;
+
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_collect, NULL);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < unitsize * 8; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	sr_session_dev_add(session, sdi);
+	trigger = sr_trigger_new(NULL);
+	sent = g_string_new(NULL);
+	trigger_pos = -1;
+}
+
+static void collect_reset(void)
+{
+	g_string_truncate(sent, 0);
+	trigger_pos = -1;
+}
+
+static void teardown(void)
+{
+	sr_session_destroy(session);
+	sr_dev_inst_free(sdi);
+	sr_trigger_free(trigger);
+	g_string_free(sent, TRUE);
+}
+
+static void match_add(struct sr_trigger_stage *stage, int index, int match)
+{
+	struct sr_channel *ch;
+
+	ch = g_slist_nth_data(sdi->channels, index);
+	fail_unless(sr_trigger_match_add(stage, ch, match, 0) == SR_OK);
+}
+
+/* A trigger with one stage per character, '0' or '1' on channel index. */
+static void trigger_levels(int index, const char *levels)
+{
+	struct sr_trigger_stage *stage;
+
+	for (; *levels; levels++) {
+		stage = sr_trigger_stage_add(trigger);
+		match_add(stage, index, *levels == '1' ?
+			SR_TRIGGER_ONE : SR_TRIGGER_ZERO);
+	}
+}
+
+/* Set bit index of every sample to the given characters. */
+static void samples_set(uint8_t *buf, int unitsize, int index,
+		const char *levels)
+{
+	for (; *levels; levels++, buf += unitsize) {
+		if (*levels == '1')
+			buf[index / 8] |= 1 << (index % 8);
+		else
+			buf[index / 8] &= ~(1 << (index % 8));
+	}
+}
+
+/* Check a single buffer for the trigger, expecting the given offset. */
+static void check_single(int unitsize, int index, const char *levels,
+		int expected)
+{
+	struct soft_trigger_logic *stl;
+	uint8_t buf[64 * MAX_UNITSIZE];
+	int len, offset;
+
+	memset(buf, 0, sizeof(buf));
+	samples_set(buf, unitsize, index, levels);
+	len = strlen(levels) * unitsize;
+	collect_reset();
+	stl = soft_trigger_logic_new(sdi, trigger, 0);
+	fail_unless(stl != NULL);
+	offset = soft_trigger_logic_check(stl, buf, len, NULL);
+	fail_unless(offset == expected, "'%s' (unitsize %d, channel %d): "
+		"offset %d, expected %d.", levels, unitsize, index, offset,
+		expected);
+	soft_trigger_logic_free(stl);
+}
+
+/*
+ * Check multi-stage triggers which need to restart the match at the
+ * sample after an earlier partial match, for all unit sizes and for
+ * channels in the highest byte of a sample.
+ */
+START_TEST(test_soft_trigger_stages)
+{
+	const int unitsizes[] = { 1, 2, 3, 4, 9 };
+	unsigned int i;
+	int unitsize, index;
+
+	for (i = 0; i < G_N_ELEMENTS(unitsizes); i++) {
+		unitsize = unitsizes[i];
+		for (index = 0; index < unitsize * 8; index += unitsize * 8 - 1) {
+			setup(unitsize);
+			trigger_levels(index, "0001");
+			check_single(unitsize, index, "00001", 4);
+			check_single(unitsize, index, "0001", 3);
+			check_single(unitsize, index, "0010001", 6);
+			check_single(unitsize, index, "0000", -1);
+			check_single(unitsize, index,
+				"1111111111111111111111111110001", 30);
+			teardown();
+
+			setup(unitsize);
+			trigger_levels(index, "110");
+			check_single(unitsize, index, "1110", 3);
+			check_single(unitsize, index, "101011110", 8);
+			check_single(unitsize, index, "11", -1);
+			teardown();
+
+			setup(unitsize);
+			trigger_levels(index, "1010");
+			check_single(unitsize, index, "1011010", 6);
+			check_single(unitsize, index, "10101", 3);
+			teardown();
+		}
+	}
+}
+END_TEST
+
+/*
+ * Check edge matches on the first sample of a buffer, which need the
+ * last sample of the previous buffer, and that the very first sample
+ * of an acquisition is never an edge.
+ */
+START_TEST(test_soft_trigger_edge_across_buffers)
+{
+	const int unitsizes[] = { 1, 2, 3, 4, 9 };
+	const int matches[] = { SR_TRIGGER_RISING, SR_TRIGGER_FALLING,
+		SR_TRIGGER_EDGE };
+	struct soft_trigger_logic *stl;
+	struct sr_trigger_stage *stage;
+	uint8_t buf[8 * MAX_UNITSIZE];
+	unsigned int i, m;
+	int unitsize, index, offset;
+
+	for (i = 0; i < G_N_ELEMENTS(unitsizes); i++) {
+		unitsize = unitsizes[i];
+		index = unitsize * 8 - 1;
+		for (m = 0; m < G_N_ELEMENTS(matches); m++) {
+			setup(unitsize);
+			stage = sr_trigger_stage_add(trigger);
+			match_add(stage, index, matches[m]);
+			stl = soft_trigger_logic_new(sdi, trigger, 0);
+			collect_reset();
+
+			/* Starting at the new level is not an edge. */
+			memset(buf, 0, sizeof(buf));
+			samples_set(buf, unitsize, index,
+				matches[m] == SR_TRIGGER_FALLING ? "11" : "00");
+			offset = soft_trigger_logic_check(stl, buf,
+				2 * unitsize, NULL);
+			fail_unless(offset == -1);
+
+			/* The edge is between the buffers. */
+			samples_set(buf, unitsize, index,
+				matches[m] == SR_TRIGGER_FALLING ? "00" : "11");
+			offset = soft_trigger_logic_check(stl, buf,
+				2 * unitsize, NULL);
+			fail_unless(offset == 0, "Edge %d (unitsize %d): "
+				"offset %d.", matches[m], unitsize, offset);
+			soft_trigger_logic_free(stl);
+
+			/* A one sample buffer still remembers its sample. */
+			stl = soft_trigger_logic_new(sdi, trigger, 0);
+			collect_reset();
+			samples_set(buf, unitsize, index,
+				matches[m] == SR_TRIGGER_FALLING ? "1" : "0");
+			fail_unless(soft_trigger_logic_check(stl, buf,
+				unitsize, NULL) == -1);
+			fail_unless(soft_trigger_logic_check(stl, buf,
+				unitsize, NULL) == -1);
+			samples_set(buf, unitsize, index,
+				matches[m] == SR_TRIGGER_FALLING ? "0" : "1");
+			fail_unless(soft_trigger_logic_check(stl, buf,
+				unitsize, NULL) == 0);
+			soft_trigger_logic_free(stl);
+			teardown();
+		}
+	}
+}
+END_TEST
+
+/*
+ * Reference implementation: check one sample against a stage of the
+ * trigger, bit by bit. Edges need a previous sample.
+ */
+static gboolean ref_match(const struct sr_trigger_stage *stage,
+		const uint8_t *sample, const uint8_t *prev)
+{
+	const struct sr_trigger_match *match;
+	const GSList *l;
+	int index, c, p;
+
+	for (l = stage->matches; l; l = l->next) {
+		match = l->data;
+		index = match->channel->index;
+		c = (sample[index / 8] >> (index % 8)) & 1;
+		if (match->match == SR_TRIGGER_ZERO && c)
+			return FALSE;
+		if (match->match == SR_TRIGGER_ONE && !c)
+			return FALSE;
+		if (match->match == SR_TRIGGER_ZERO ||
+		    match->match == SR_TRIGGER_ONE)
+			continue;
+		if (!prev)
+			return FALSE;
+		p = (prev[index / 8] >> (index % 8)) & 1;
+		if (match->match == SR_TRIGGER_RISING && !(c && !p))
+			return FALSE;
+		if (match->match == SR_TRIGGER_FALLING && !(!c && p))
+			return FALSE;
+		if (match->match == SR_TRIGGER_EDGE && c == p)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/*
+ * Reference implementation of the stage matching over a buffer. After
+ * a partial match fails, the match restarts at the sample after the one
+ * where it started, but never before the start of the buffer.
+ */
+static int ref_check(int *cur_stage, const uint8_t **prev_sample,
+		const uint8_t *buf, int num_samples, int unitsize)
+{
+	const uint8_t *prev;
+	int i, num_stages;
+
+	num_stages = g_slist_length(trigger->stages);
+	i = 0;
+	while (i < num_samples) {
+		prev = i > 0 ? buf + (i - 1) * unitsize : *prev_sample;
+		if (ref_match(g_slist_nth_data(trigger->stages, *cur_stage),
+				buf + i * unitsize, prev)) {
+			if (++(*cur_stage) == num_stages)
+				return i;
+			i++;
+		} else if (*cur_stage > 0) {
+			i = MAX(i - *cur_stage + 1, 0);
+			*cur_stage = 0;
+		} else {
+			i++;
+		}
+	}
+	if (num_samples > 0)
+		*prev_sample = buf + (num_samples - 1) * unitsize;
+
+	return -1;
+}
+
+/*
+ * Compare random multi-stage triggers on random data, split into random
+ * buffers, against the reference implementation. Also check that the
+ * pre-trigger data sent is the right amount of the newest samples.
+ */
+START_TEST(test_soft_trigger_random)
+{
+	const int unitsizes[] = { 1, 2, 3, 4, 9 };
+	const int match_types[] = { SR_TRIGGER_ZERO, SR_TRIGGER_ONE,
+		SR_TRIGGER_RISING, SR_TRIGGER_FALLING, SR_TRIGGER_EDGE };
+	struct soft_trigger_logic *stl;
+	struct sr_trigger_stage *stage;
+	const uint8_t *prev_sample;
+	uint8_t *data;
+	GRand *rand;
+	unsigned int i, iter, triggered;
+	int unitsize, num_samples, num_stages, pre, s, m, j, k, index;
+	int pos, n, offset, expected, ref_stage, pre_samples;
+
+	rand = g_rand_new_with_seed(4711);
+	num_samples = 3000;
+	data = g_malloc(num_samples * MAX_UNITSIZE);
+	triggered = 0;
+
+	for (i = 0; i < G_N_ELEMENTS(unitsizes); i++) {
+		unitsize = unitsizes[i];
+		for (iter = 0; iter < 200; iter++) {
+			setup(unitsize);
+
+			/* Mostly channels in the highest byte. */
+			num_stages = g_rand_int_range(rand, 1, 5);
+			for (s = 0; s < num_stages; s++) {
+				stage = sr_trigger_stage_add(trigger);
+				m = g_rand_int_range(rand, 1, 4);
+				for (j = 0; j < m; j++) {
+					if (g_rand_int_range(rand, 0, 4))
+						index = (unitsize - 1) * 8 +
+							g_rand_int_range(rand, 0, 8);
+					else
+						index = g_rand_int_range(rand,
+							0, unitsize * 8);
+					match_add(stage, index, match_types[
+						g_rand_int_range(rand, 0, 5)]);
+				}
+			}
+
+			/* Every bit flips with a probability of 1/8. */
+			for (k = 0; k < unitsize; k++)
+				data[k] = g_rand_int(rand);
+			for (j = 1; j < num_samples; j++) {
+				for (k = 0; k < unitsize; k++)
+					data[j * unitsize + k] =
+						data[(j - 1) * unitsize + k] ^
+						(g_rand_int(rand) &
+						 g_rand_int(rand) &
+						 g_rand_int(rand));
+			}
+
+			pre = g_rand_int_range(rand, 0, 100);
+			stl = soft_trigger_logic_new(sdi, trigger, pre);
+			fail_unless(stl != NULL);
+			ref_stage = 0;
+			prev_sample = NULL;
+			offset = expected = -1;
+			for (pos = 0; pos < num_samples; pos += n) {
+				n = MIN(g_rand_int_range(rand, 0, 70),
+					num_samples - pos);
+				expected = ref_check(&ref_stage, &prev_sample,
+					data + pos * unitsize, n, unitsize);
+				pre_samples = -1;
+				offset = soft_trigger_logic_check(stl,
+					data + pos * unitsize, n * unitsize,
+					&pre_samples);
+				fail_unless(offset == expected, "Unitsize %d, "
+					"iteration %u, sample %d: offset %d, "
+					"expected %d.", unitsize, iter, pos,
+					offset, expected);
+				if (offset >= 0)
+					break;
+			}
+			soft_trigger_logic_free(stl);
+
+			if (offset >= 0) {
+				triggered++;
+				k = MIN(pre, pos + offset);
+				fail_unless(pre_samples == k, "%d pre-trigger "
+					"samples, expected %d.", pre_samples, k);
+				fail_unless(trigger_pos == k * unitsize);
+				fail_unless(!memcmp(sent->str, data +
+					(pos + offset - k) * unitsize,
+					k * unitsize));
+			} else {
+				fail_unless(trigger_pos == -1);
+			}
+			teardown();
+		}
+	}
+	/* Make sure the data actually exercises the trigger. */
+	fail_unless(triggered > G_N_ELEMENTS(unitsizes) * 200 / 4);
+
+	g_free(data);
+	g_rand_free(rand);
+}
+END_TEST
+
+/*
+ * Feed data with a single high sample at trigger to a swap mode soft
+ * trigger, in buffers of the given lengths (repeating the last one).
+ * Check the buffers handed back, and the pre-trigger data sent when the
+ * trigger fires.
+ */
+static void check_swap(int unitsize, int pre, int trigger_at,
+		const int *lens, int num_lens)
+{
+	struct soft_trigger_logic *stl;
+	uint8_t data[256 * MAX_UNITSIZE], *buf, *old;
+	/* Model of the retained buffers, oldest first. */
+	uint8_t *retained[256];
+	int retained_lens[256], head, tail, retained_len, spares;
+	GSList *given;
+	size_t bufsize;
+	int pos, n, i, j, offset, pre_samples, expected;
+
+	setup(unitsize);
+	trigger_levels(unitsize * 8 - 1, "1");
+	memset(data, 0x55, sizeof(data));
+	for (i = 0; i < 256; i++)
+		data[i * unitsize + unitsize - 1] = i == trigger_at ? 0x80 : 0x7f;
+
+	stl = soft_trigger_logic_new_swap(sdi, trigger, pre);
+	fail_unless(stl != NULL);
+	bufsize = 64 * unitsize;
+	buf = g_malloc(bufsize);
+	given = NULL;
+	head = tail = retained_len = spares = 0;
+	offset = pre_samples = -1;
+	for (pos = i = 0; pos < 256; pos += n, i = MIN(i + 1, num_lens - 1)) {
+		n = MIN(lens[i], 256 - pos);
+		memcpy(buf, data + pos * unitsize, n * unitsize);
+		old = buf;
+		offset = soft_trigger_logic_check_swap(stl, &buf, bufsize,
+			n * unitsize, &pre_samples);
+		if (offset >= 0) {
+			fail_unless(buf == old);
+			break;
+		}
+		fail_unless(offset == -1 && buf != NULL);
+
+		/* The buffer just passed in may come back if it's not needed. */
+		given = g_slist_prepend(given, old);
+		retained[tail] = old;
+		retained_lens[tail++] = n;
+		retained_len += n;
+		while (head < tail && retained_len - retained_lens[head] >= pre) {
+			retained_len -= retained_lens[head++];
+			spares++;
+		}
+		for (j = head; j < tail; j++)
+			fail_unless(buf != retained[j],
+				"Got back a buffer which is still retained.");
+		/* Buffers that left the window come back before new ones. */
+		if (spares) {
+			fail_unless(g_slist_find(given, buf) != NULL,
+				"Spare buffer not handed back.");
+			spares--;
+		}
+	}
+
+	fail_unless(offset >= 0 && pos + offset == trigger_at);
+	expected = MIN(pre, trigger_at);
+	fail_unless(pre_samples == expected, "%d pre-trigger samples, "
+		"expected %d.", pre_samples, expected);
+	fail_unless(trigger_pos == expected * unitsize);
+	fail_unless(!memcmp(sent->str, data + (trigger_at - expected) * unitsize,
+		expected * unitsize));
+
+	soft_trigger_logic_free(stl);
+	g_free(buf);
+	g_slist_free(given);
+	teardown();
+}
+
+/*
+ * Check swap mode: which parts of the retained buffers get sent, that
+ * buffers leaving the pre-trigger window are handed back, and triggers
+ * in the first and the last buffer.
+ */
+START_TEST(test_soft_trigger_swap)
+{
+	const int unitsizes[] = { 1, 3 };
+	const int even[] = { 16 };
+	const int uneven[] = { 5, 1, 30, 7, 64, 3, 11 };
+	unsigned int i;
+	int unitsize;
+
+	for (i = 0; i < G_N_ELEMENTS(unitsizes); i++) {
+		unitsize = unitsizes[i];
+		/* In the first buffer, with and without enough data. */
+		check_swap(unitsize, 10, 12, even, 1);
+		check_swap(unitsize, 20, 12, even, 1);
+		check_swap(unitsize, 0, 0, even, 1);
+		/* At the start of a buffer, nothing of it gets sent. */
+		check_swap(unitsize, 20, 48, even, 1);
+		check_swap(unitsize, 16, 48, even, 1);
+		check_swap(unitsize, 32, 48, even, 1);
+		/* Skipping into the middle of a retained buffer. */
+		check_swap(unitsize, 21, 50, even, 1);
+		check_swap(unitsize, 100, 200, uneven, G_N_ELEMENTS(uneven));
+		check_swap(unitsize, 37, 131, uneven, G_N_ELEMENTS(uneven));
+		/* No pre-trigger window, every buffer is handed back. */
+		check_swap(unitsize, 0, 131, uneven, G_N_ELEMENTS(uneven));
+		/* In the last buffer, on its last sample. */
+		check_swap(unitsize, 64, 255, even, 1);
+		check_swap(unitsize, 255, 255, uneven, G_N_ELEMENTS(uneven));
+		check_swap(unitsize, 1000, 255, uneven, G_N_ELEMENTS(uneven));
+	}
+}
+END_TEST
+
+Suite *suite_soft_trigger(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("soft-trigger");
+
+	tc = tcase_create("check");
+	tcase_add_checked_fixture(tc, srtest_setup, srtest_teardown);
+	tcase_add_test(tc, test_soft_trigger_stages);
+	tcase_add_test(tc, test_soft_trigger_edge_across_buffers);
+	tcase_add_test(tc, test_soft_trigger_random);
+	tcase_add_test(tc, test_soft_trigger_swap);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -96,6 +96,22 @@ START_TEST(test_transform_options)
 }
 END_TEST
 
+/* Check whether the subset, window and decimate modules have options. */
+START_TEST(test_transform_options_builtin)
+{
+	const char *ids[] = { "subset", "window", "decimate", NULL };
+	const struct sr_option **opt;
+	int i;
+
+	for (i = 0; ids[i]; i++) {
+		opt = sr_transform_options_get(sr_transform_find(ids[i]));
+		fail_unless(opt != NULL && opt[0] != NULL,
+			"Transform module '%s' has no options.", ids[i]);
+		sr_transform_options_free(opt);
+	}
+}
+END_TEST
+
 Suite *suite_transform_all(void)
 {
 	Suite *s;
@@ -110,6 +126,7 @@ Suite *suite_transform_all(void)
 	tcase_add_test(tc, test_transform_desc);
 	tcase_add_test(tc, test_transform_find);
 	tcase_add_test(tc, test_transform_options);
+	tcase_add_test(tc, test_transform_options_builtin);
 	suite_add_tcase(s, tc);
 
 	return s;
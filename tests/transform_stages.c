@@ -0,0 +1,824 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define NUM_LOGIC 24
+#define NUM_ANALOG 2
+
+static struct sr_session *session;
+static struct sr_dev_inst *sdi;
+static GSList *transforms;
+
+/* What came out of the transform chain. */
+static GString *logic_out;
+static GArray *analog_out[NUM_ANALOG];
+static unsigned int analog_packets[NUM_ANALOG];
+/* The keys and values of the last SR_DF_META packet. */
+static uint32_t meta_keys[4];
+static uint64_t meta_values[4];
+static unsigned int num_meta;
+
+static void datafeed_collect(const struct sr_dev_inst *sdi,
+		const struct sr_datafeed_packet *packet, void *cb_data)
+{
+	const struct sr_datafeed_logic *logic;
+	const struct sr_datafeed_analog *analog;
+	const struct sr_datafeed_meta *meta;
+	struct sr_config *src;
+	struct sr_channel *ch;
+	GSList *l;
+	unsigned int num_channels, c, i;
+
+	(void)sdi;
+	(void)cb_data;
+
+	switch (packet->type) {
+	case SR_DF_META:
+		meta = packet->payload;
+		num_meta = 0;
+		for (l = meta->config; l && num_meta < 4; l = l->next) {
+			src = l->data;
+			meta_keys[num_meta] = src->key;
+			meta_values[num_meta++] = g_variant_get_uint64(src->data);
+		}
+		break;
+	case SR_DF_LOGIC:
+		logic = packet->payload;
+		g_string_append_len(logic_out, logic->data, logic->length);
+		break;
+	case SR_DF_ANALOG:
+		/* The samples of several channels are interleaved. */
+		analog = packet->payload;
+		num_channels = g_slist_length(analog->meaning->channels);
+		for (l = analog->meaning->channels, c = 0; l; l = l->next, c++) {
+			ch = l->data;
+			analog_packets[ch->index - NUM_LOGIC]++;
+			for (i = 0; i < analog->num_samples; i++) {
+				g_array_append_val(analog_out[ch->index - NUM_LOGIC],
+					((float *)analog->data)[i * num_channels + c]);
+			}
+		}
+		break;
+	}
+}
+
+/* A device with channels D0 to D23, A0 and A1. */
+static void setup(void)
+{
+	char name[8];
+	int i;
+
+	srtest_setup();
+	sr_session_new(srtest_ctx, &session);
+	sr_session_datafeed_callback_add(session, datafeed_collect, NULL);
+	sdi = sr_dev_inst_user_new("Vendor", "Model", "Version");
+	for (i = 0; i < NUM_LOGIC; i++) {
+		g_snprintf(name, sizeof(name), "D%d", i);
+		sr_dev_inst_channel_add(sdi, i, SR_CHANNEL_LOGIC, name);
+	}
+	for (i = 0; i < NUM_ANALOG; i++) {
+		g_snprintf(name, sizeof(name), "A%d", i);
+		sr_dev_inst_channel_add(sdi, NUM_LOGIC + i,
+			SR_CHANNEL_ANALOG, name);
+	}
+	sr_session_dev_add(session, sdi);
+	logic_out = g_string_new(NULL);
+	for (i = 0; i < NUM_ANALOG; i++) {
+		analog_out[i] = g_array_new(FALSE, FALSE, sizeof(float));
+		analog_packets[i] = 0;
+	}
+	num_meta = 0;
+	transforms = NULL;
+}
+
+static void transforms_free(void)
+{
+	GSList *l;
+
+	for (l = transforms; l; l = l->next)
+		sr_transform_free(l->data);
+	g_slist_free(transforms);
+	transforms = NULL;
+}
+
+static void collect_reset(void)
+{
+	int i;
+
+	g_string_truncate(logic_out, 0);
+	for (i = 0; i < NUM_ANALOG; i++) {
+		g_array_set_size(analog_out[i], 0);
+		analog_packets[i] = 0;
+	}
+}
+
+static void teardown(void)
+{
+	int i;
+
+	transforms_free();
+	sr_session_destroy(session);
+	sr_dev_inst_free(sdi);
+	g_string_free(logic_out, TRUE);
+	for (i = 0; i < NUM_ANALOG; i++)
+		g_array_free(analog_out[i], TRUE);
+	srtest_teardown();
+}
+
+/* Append a transform, with one option of the given type, or none. */
+static void transform_add(const char *id, const char *key, GVariant *value)
+{
+	const struct sr_transform *t;
+	GHashTable *options;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	if (key)
+		g_hash_table_insert(options, (char *)key,
+			g_variant_ref_sink(value));
+	t = sr_transform_new(sr_transform_find(id), options, sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Failed to create transform '%s'.", id);
+	transforms = g_slist_append(transforms, (void *)t);
+}
+
+static void window_add(uint64_t start, uint64_t length)
+{
+	const struct sr_transform *t;
+	GHashTable *options;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "start",
+		g_variant_ref_sink(g_variant_new_uint64(start)));
+	g_hash_table_insert(options, "length",
+		g_variant_ref_sink(g_variant_new_uint64(length)));
+	t = sr_transform_new(sr_transform_find("window"), options, sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Failed to create window transform.");
+	transforms = g_slist_append(transforms, (void *)t);
+}
+
+static void decimate_add(uint64_t factor, const char *logic,
+		const char *analog)
+{
+	const struct sr_transform *t;
+	GHashTable *options;
+
+	options = g_hash_table_new_full(g_str_hash, g_str_equal, NULL,
+		(GDestroyNotify)g_variant_unref);
+	g_hash_table_insert(options, "factor",
+		g_variant_ref_sink(g_variant_new_uint64(factor)));
+	g_hash_table_insert(options, "logic",
+		g_variant_ref_sink(g_variant_new_string(logic)));
+	g_hash_table_insert(options, "analog",
+		g_variant_ref_sink(g_variant_new_string(analog)));
+	t = sr_transform_new(sr_transform_find("decimate"), options, sdi);
+	g_hash_table_destroy(options);
+	fail_unless(t != NULL, "Failed to create decimate transform.");
+	transforms = g_slist_append(transforms, (void *)t);
+}
+
+static void send_header(void)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_header header;
+
+	header.feed_version = 1;
+	header.starttime.tv_sec = 0;
+	header.starttime.tv_usec = 0;
+	packet.type = SR_DF_HEADER;
+	packet.payload = &header;
+	fail_unless(sr_session_send(sdi, &packet) == SR_OK);
+}
+
+/* In-place transforms modify the data, so a copy of it is sent. */
+static void send_logic(const uint8_t *data, size_t length,
+		unsigned int unitsize)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_logic logic;
+	uint8_t *copy;
+
+	copy = g_memdup(data, length);
+	logic.length = length;
+	logic.unitsize = unitsize;
+	logic.data = copy;
+	packet.type = SR_DF_LOGIC;
+	packet.payload = &logic;
+	fail_unless(sr_session_send(sdi, &packet) == SR_OK);
+	g_free(copy);
+}
+
+/* Send analog samples of the given analog channels. */
+static void send_analog(const int *channels, int num_channels,
+		const float *data, int num_samples)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_analog analog;
+	struct sr_analog_encoding encoding;
+	struct sr_analog_meaning meaning;
+	struct sr_analog_spec spec;
+	int i;
+
+	sr_analog_init(&analog, &encoding, &meaning, &spec, 3);
+	for (i = 0; i < num_channels; i++) {
+		meaning.channels = g_slist_append(meaning.channels,
+			g_slist_nth_data(sdi->channels,
+				NUM_LOGIC + channels[i]));
+	}
+	meaning.mq = SR_MQ_VOLTAGE;
+	meaning.unit = SR_UNIT_VOLT;
+	analog.num_samples = num_samples;
+	analog.data = (void *)data;
+	packet.type = SR_DF_ANALOG;
+	packet.payload = &analog;
+	fail_unless(sr_session_send(sdi, &packet) == SR_OK);
+	g_slist_free(meaning.channels);
+}
+
+/* Send the data in packets of varying sizes. */
+static void send_logic_split(const uint8_t *data, size_t length,
+		unsigned int unitsize, GRand *rand, unsigned int max_samples)
+{
+	size_t pos, n;
+
+	for (pos = 0; pos < length; pos += n) {
+		n = g_rand_int_range(rand, 0, max_samples + 1) * unitsize;
+		n = MIN(n, length - pos);
+		send_logic(data + pos, n, unitsize);
+	}
+}
+
+/*
+ * Check that invert and subset produce the same data when their logic
+ * kernels are fused into one stage, and when they run one after the
+ * other, with packets larger than a block and unit sizes which don't
+ * divide the block size.
+ */
+START_TEST(test_transform_invert_subset_fused)
+{
+	const char *orders[][3] = {
+		{ "invert", "subset", NULL },
+		{ "invert", "nop", "subset" },
+		{ "subset", "invert", NULL },
+		{ "subset", "nop", "invert" },
+	};
+	GString *results[G_N_ELEMENTS(orders)];
+	uint8_t *data, mask[3] = { 0x02, 0x04, 0x10 }, expected;
+	unsigned int unitsize, o, i, seed;
+	size_t length, n;
+	GRand *rand;
+
+	length = 3 * 40000;
+	data = g_malloc(length);
+
+	for (unitsize = 1; unitsize <= 3; unitsize++) {
+		seed = 42 + unitsize;
+		rand = g_rand_new_with_seed(seed);
+		for (i = 0; i < length; i++)
+			data[i] = g_rand_int(rand);
+		g_rand_free(rand);
+
+		for (o = 0; o < G_N_ELEMENTS(orders); o++) {
+			for (i = 0; i < 3 && orders[o][i]; i++) {
+				if (!strcmp(orders[o][i], "subset"))
+					transform_add("subset", "channels",
+						g_variant_new_string("D1,D10,D20"));
+				else
+					transform_add(orders[o][i], NULL, NULL);
+			}
+			/* Fusable transforms in a row share one stage. */
+			fail_unless(g_slist_length(session->transform_stages)
+				== (orders[o][2] ? 3 : 1));
+
+			collect_reset();
+			rand = g_rand_new_with_seed(seed);
+			/* A whole packet, and small ones. */
+			n = length - length % unitsize;
+			send_logic(data, n, unitsize);
+			send_logic_split(data, n, unitsize, rand, 20000);
+			g_rand_free(rand);
+			results[o] = g_string_new_len(logic_out->str,
+				logic_out->len);
+			transforms_free();
+
+			fail_unless(results[o]->len == 2 * n);
+			for (i = 0; i < 2 * n; i++) {
+				if (o < 2)
+					expected = ~data[i % n];
+				else
+					expected = data[i % n];
+				expected &= i % unitsize < 3 ?
+					mask[i % unitsize] : 0;
+				if (o >= 2)
+					expected = ~expected;
+				fail_unless((uint8_t)results[o]->str[i] == expected,
+					"Unitsize %u, %s+%s: byte %u is 0x%02x, "
+					"expected 0x%02x.", unitsize,
+					orders[o][0], orders[o][1], i,
+					(uint8_t)results[o]->str[i], expected);
+			}
+		}
+		/* Fused and sequential runs agree. */
+		fail_unless(!memcmp(results[0]->str, results[1]->str,
+			results[0]->len));
+		fail_unless(!memcmp(results[2]->str, results[3]->str,
+			results[2]->len));
+		for (o = 0; o < G_N_ELEMENTS(orders); o++)
+			g_string_free(results[o], TRUE);
+	}
+
+	g_free(data);
+}
+END_TEST
+
+/*
+ * Check that the window passes on exactly the samples in it, with the
+ * window's edges falling into packets, onto packet boundaries, or past
+ * the end of the data.
+ */
+START_TEST(test_transform_window_logic)
+{
+	const uint64_t windows[][2] = {
+		{ 0, 0 }, { 0, 1 }, { 100, 0 }, { 100, 50 }, { 999, 1 },
+		{ 500, 1000 }, { 1000, 10 }, { 123, 456 },
+	};
+	uint16_t data[1000];
+	unsigned int w, i, run;
+	uint64_t start, end;
+	GRand *rand;
+
+	for (i = 0; i < G_N_ELEMENTS(data); i++)
+		data[i] = i;
+
+	rand = g_rand_new_with_seed(7);
+	for (w = 0; w < G_N_ELEMENTS(windows); w++) {
+		start = windows[w][0];
+		end = windows[w][1] ? start + windows[w][1] : G_N_ELEMENTS(data);
+		end = MIN(end, G_N_ELEMENTS(data));
+		window_add(windows[w][0], windows[w][1]);
+
+		/* SR_DF_HEADER starts over. */
+		for (run = 0; run < 2; run++) {
+			collect_reset();
+			send_header();
+			send_logic_split((uint8_t *)data, sizeof(data),
+				sizeof(uint16_t), rand, 64);
+			if (start >= end) {
+				fail_unless(logic_out->len == 0);
+				continue;
+			}
+			fail_unless(logic_out->len == (end - start) * 2,
+				"Window %u: %zu bytes passed on.", w,
+				logic_out->len);
+			fail_unless(!memcmp(logic_out->str, data + start,
+				logic_out->len), "Window %u: wrong samples.", w);
+		}
+		transforms_free();
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+/* Check that the window is applied to each analog channel on its own. */
+START_TEST(test_transform_window_analog)
+{
+	float data[NUM_ANALOG][300];
+	unsigned int pos[NUM_ANALOG], n, i;
+	int ch;
+	GRand *rand;
+
+	for (ch = 0; ch < NUM_ANALOG; ch++) {
+		for (i = 0; i < G_N_ELEMENTS(data[ch]); i++)
+			data[ch][i] = 1000 * ch + i;
+		pos[ch] = 0;
+	}
+
+	window_add(50, 200);
+	send_header();
+	rand = g_rand_new_with_seed(8);
+	while (pos[0] < G_N_ELEMENTS(data[0])
+			|| pos[1] < G_N_ELEMENTS(data[1])) {
+		/* Packets of either channel, in any order and size. */
+		ch = g_rand_int_range(rand, 0, NUM_ANALOG);
+		n = g_rand_int_range(rand, 1, 40);
+		n = MIN(n, G_N_ELEMENTS(data[ch]) - pos[ch]);
+		if (!n)
+			continue;
+		send_analog(&ch, 1, data[ch] + pos[ch], n);
+		pos[ch] += n;
+	}
+	g_rand_free(rand);
+
+	for (ch = 0; ch < NUM_ANALOG; ch++) {
+		fail_unless(analog_out[ch]->len == 200,
+			"Channel %d: %u samples passed on.", ch,
+			analog_out[ch]->len);
+		fail_unless(!memcmp(analog_out[ch]->data, data[ch] + 50,
+			200 * sizeof(float)));
+	}
+}
+END_TEST
+
+/*
+ * Check that subset drops the analog packets of other channels, and
+ * clears the other logic channels.
+ */
+START_TEST(test_transform_subset_analog)
+{
+	const int a0 = 0, a1 = 1, both[] = { 0, 1 };
+	const float samples[4] = { 1, 2, 3, 4 };
+	const uint8_t logic[3] = { 0xff, 0xff, 0xff };
+
+	transform_add("subset", "channels", g_variant_new_string("D0,A1"));
+
+	send_analog(&a0, 1, samples, 4);
+	fail_unless(analog_packets[0] == 0 && analog_packets[1] == 0);
+	send_analog(&a1, 1, samples, 4);
+	fail_unless(analog_packets[0] == 0 && analog_packets[1] == 1);
+	fail_unless(analog_out[1]->len == 4);
+	/* A packet of a selected and an other channel is passed on. */
+	send_analog(both, 2, samples, 2);
+	fail_unless(analog_packets[0] == 1 && analog_packets[1] == 2);
+
+	send_logic(logic, sizeof(logic), 3);
+	fail_unless(logic_out->len == 3);
+	fail_unless(!memcmp(logic_out->str, "\x01\x00\x00", 3));
+}
+END_TEST
+
+/*
+ * Check the logic modes of decimate against a reference, with windows
+ * spanning several packets, with a unit size that divides a 64-bit word
+ * and one that doesn't, and that SR_DF_HEADER drops the partial window
+ * and the previous sample of an earlier acquisition.
+ */
+START_TEST(test_transform_decimate_logic)
+{
+	const char *modes[] = { "or", "and", "edge" };
+	const uint64_t factors[] = { 1, 3, 7, 64 };
+	uint8_t data[3 * 1000], expected[3 * 1000], acc[3];
+	unsigned int unitsize, m, f, run, i, j, n, num_out;
+	uint64_t factor, k;
+	GRand *rand;
+
+	rand = g_rand_new_with_seed(9);
+	for (unitsize = 2; unitsize <= 3; unitsize++) {
+		/* Few changes per sample, so all modes have both levels. */
+		n = sizeof(data) / unitsize;
+		for (i = 0; i < n * unitsize; i++) {
+			data[i] = i < unitsize ? g_rand_int(rand) : data[i - unitsize];
+			for (j = 0; j < 8; j++) {
+				if (!g_rand_int_range(rand, 0, 16))
+					data[i] ^= 1 << j;
+			}
+		}
+
+		for (m = 0; m < G_N_ELEMENTS(modes); m++) {
+			for (f = 0; f < G_N_ELEMENTS(factors); f++) {
+				factor = factors[f];
+				num_out = n / factor;
+				for (k = 0; k < num_out; k++) {
+					for (j = 0; j < unitsize; j++) {
+						acc[j] = m == 1 ? 0xff : 0x00;
+						for (i = k * factor; i < (k + 1) * factor; i++) {
+							if (m == 0)
+								acc[j] |= data[unitsize * i + j];
+							else if (m == 1)
+								acc[j] &= data[unitsize * i + j];
+							else if (i > 0)
+								acc[j] |= data[unitsize * i + j]
+									^ data[unitsize * (i - 1) + j];
+						}
+						expected[unitsize * k + j] = acc[j];
+					}
+				}
+
+				decimate_add(factor, modes[m], "minmax");
+				for (run = 0; run < 2; run++) {
+					collect_reset();
+					send_header();
+					/* A partial window, and an edge to drop. */
+					if (run && factor > 1)
+						send_logic((const uint8_t *)"\x55\xaa\x55",
+							unitsize, unitsize);
+					send_header();
+					send_logic_split(data, n * unitsize, unitsize,
+						rand, 2 * factor);
+					fail_unless(logic_out->len == unitsize * num_out,
+						"Unitsize %u, mode %s, factor %" PRIu64
+						": %zu bytes passed on.", unitsize,
+						modes[m], factor, logic_out->len);
+					for (i = 0; i < unitsize * num_out; i++) {
+						fail_unless((uint8_t)logic_out->str[i] == expected[i],
+							"Unitsize %u, mode %s, factor %" PRIu64
+							": byte %u is 0x%02x, expected 0x%02x.",
+							unitsize, modes[m], factor, i,
+							(uint8_t)logic_out->str[i],
+							expected[i]);
+					}
+				}
+				transforms_free();
+			}
+		}
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+/* Send samples of one analog channel in packets of varying sizes. */
+static void send_analog_split(int ch, const float *data,
+		unsigned int num_samples, GRand *rand, unsigned int max_samples)
+{
+	unsigned int pos, n;
+
+	for (pos = 0; pos < num_samples; pos += n) {
+		n = g_rand_int_range(rand, 1, max_samples + 1);
+		n = MIN(n, num_samples - pos);
+		send_analog(&ch, 1, data + pos, n);
+	}
+}
+
+/*
+ * Check that minmax emits the minimum and maximum of each window in the
+ * order they occurred, and the first of equal values.
+ */
+START_TEST(test_transform_decimate_minmax)
+{
+	const float fixed[] = {
+		1, 5, 3, 2,	/* min first */
+		5, 1, 3, 2,	/* max first */
+		2, 9, 0, 9,	/* max before min, repeated */
+		4, 4, 4, 4,	/* constant */
+		7, 7,		/* partial, dropped */
+	};
+	const float fixed_out[] = { 1, 5, 5, 1, 9, 0, 4, 4 };
+	float data[1000], expected[1000], min, max;
+	unsigned int i, k, min_pos, max_pos, num_out;
+	const int a0 = 0;
+	GRand *rand;
+
+	decimate_add(2, "or", "minmax");
+	send_header();
+	rand = g_rand_new_with_seed(10);
+	send_analog_split(a0, fixed, G_N_ELEMENTS(fixed), rand, 3);
+	fail_unless(analog_out[0]->len == G_N_ELEMENTS(fixed_out),
+		"%u samples passed on.", analog_out[0]->len);
+	fail_unless(!memcmp(analog_out[0]->data, fixed_out,
+		sizeof(fixed_out)));
+	transforms_free();
+
+	for (i = 0; i < G_N_ELEMENTS(data); i++)
+		data[i] = g_rand_int_range(rand, -50, 50);
+	/* Windows of 2 * 7 samples. */
+	num_out = 0;
+	for (k = 0; (k + 1) * 14 <= G_N_ELEMENTS(data); k++) {
+		min = max = data[k * 14];
+		min_pos = max_pos = 0;
+		for (i = 1; i < 14; i++) {
+			if (data[k * 14 + i] < min) {
+				min = data[k * 14 + i];
+				min_pos = i;
+			}
+			if (data[k * 14 + i] > max) {
+				max = data[k * 14 + i];
+				max_pos = i;
+			}
+		}
+		expected[num_out++] = min_pos <= max_pos ? min : max;
+		expected[num_out++] = min_pos <= max_pos ? max : min;
+	}
+
+	collect_reset();
+	decimate_add(7, "or", "minmax");
+	send_header();
+	send_analog_split(a0, data, G_N_ELEMENTS(data), rand, 20);
+	g_rand_free(rand);
+	fail_unless(analog_out[0]->len == num_out,
+		"%u samples passed on, expected %u.", analog_out[0]->len,
+		num_out);
+	for (i = 0; i < num_out; i++) {
+		fail_unless(g_array_index(analog_out[0], float, i) == expected[i],
+			"Sample %u is %g, expected %g.", i,
+			g_array_index(analog_out[0], float, i), expected[i]);
+	}
+}
+END_TEST
+
+/*
+ * Check the mean and peak modes against a reference, with the packets
+ * of two channels interleaved, so each keeps its own window.
+ */
+START_TEST(test_transform_decimate_mean_peak)
+{
+	const char *modes[] = { "mean", "peak" };
+	float data[NUM_ANALOG][500], expected[500], peak;
+	unsigned int m, pos[NUM_ANALOG], i, k, n, num_out;
+	double sum;
+	int ch;
+	GRand *rand;
+
+	rand = g_rand_new_with_seed(11);
+	/* Integers, so the sums are exact in any order. */
+	for (ch = 0; ch < NUM_ANALOG; ch++) {
+		for (i = 0; i < G_N_ELEMENTS(data[ch]); i++)
+			data[ch][i] = g_rand_int_range(rand, -1000, 1000);
+	}
+
+	for (m = 0; m < G_N_ELEMENTS(modes); m++) {
+		collect_reset();
+		decimate_add(6, "or", modes[m]);
+		send_header();
+		pos[0] = pos[1] = 0;
+		while (pos[0] < G_N_ELEMENTS(data[0])
+				|| pos[1] < G_N_ELEMENTS(data[1])) {
+			ch = g_rand_int_range(rand, 0, NUM_ANALOG);
+			n = g_rand_int_range(rand, 1, 15);
+			n = MIN(n, G_N_ELEMENTS(data[ch]) - pos[ch]);
+			if (!n)
+				continue;
+			send_analog(&ch, 1, data[ch] + pos[ch], n);
+			pos[ch] += n;
+		}
+		transforms_free();
+
+		for (ch = 0; ch < NUM_ANALOG; ch++) {
+			num_out = G_N_ELEMENTS(data[ch]) / 6;
+			for (k = 0; k < num_out; k++) {
+				sum = 0;
+				peak = 0;
+				for (i = k * 6; i < (k + 1) * 6; i++) {
+					sum += data[ch][i];
+					if (fabsf(data[ch][i]) > fabsf(peak))
+						peak = data[ch][i];
+				}
+				expected[k] = m == 0 ? (float)(sum / 6) : peak;
+			}
+			fail_unless(analog_out[ch]->len == num_out,
+				"Mode %s, channel %d: %u samples passed on.",
+				modes[m], ch, analog_out[ch]->len);
+			for (k = 0; k < num_out; k++) {
+				fail_unless(g_array_index(analog_out[ch], float, k)
+					== expected[k], "Mode %s, channel %d: "
+					"sample %u is %g, expected %g.", modes[m],
+					ch, k, g_array_index(analog_out[ch], float, k),
+					expected[k]);
+			}
+		}
+	}
+	g_rand_free(rand);
+}
+END_TEST
+
+/*
+ * Check that the channels of a multi-channel packet are decimated each
+ * in their own window, in step, and that a channel which was sent on its
+ * own in between drops the partial windows.
+ */
+START_TEST(test_transform_decimate_multi)
+{
+	const int a0 = 0, both[] = { 0, 1 };
+	float data[2 * 40], mean[2];
+	unsigned int i, k, c;
+	GRand *rand;
+
+	rand = g_rand_new_with_seed(12);
+	/* Integers, so the sums are exact in any order. */
+	for (i = 0; i < G_N_ELEMENTS(data); i++)
+		data[i] = g_rand_int_range(rand, -1000, 1000);
+	g_rand_free(rand);
+
+	decimate_add(4, "or", "mean");
+	send_header();
+	/* 40 samples per channel, in packets of 3, 10 and 27. */
+	send_analog(both, 2, data, 3);
+	send_analog(both, 2, data + 2 * 3, 10);
+	send_analog(both, 2, data + 2 * 13, 27);
+	fail_unless(analog_packets[0] == analog_packets[1]);
+	for (c = 0; c < 2; c++) {
+		fail_unless(analog_out[c]->len == 10,
+			"Channel %u: %u samples passed on.", c,
+			analog_out[c]->len);
+		for (k = 0; k < 10; k++) {
+			mean[c] = 0;
+			for (i = k * 4; i < (k + 1) * 4; i++)
+				mean[c] += data[2 * i + c];
+			mean[c] /= 4;
+			fail_unless(g_array_index(analog_out[c], float, k) == mean[c],
+				"Channel %u: sample %u is %g, expected %g.", c, k,
+				g_array_index(analog_out[c], float, k), mean[c]);
+		}
+	}
+
+	/* A0 gets ahead of A1, the next packet of both starts afresh. */
+	collect_reset();
+	send_analog(&a0, 1, data, 1);
+	send_analog(both, 2, data, 5);
+	fail_unless(analog_out[0]->len == 1 && analog_out[1]->len == 1);
+	for (c = 0; c < 2; c++) {
+		mean[c] = (data[c] + data[2 + c] + data[4 + c] + data[6 + c]) / 4;
+		fail_unless(g_array_index(analog_out[c], float, 0) == mean[c]);
+	}
+}
+END_TEST
+
+static void send_meta(GSList *config)
+{
+	struct sr_datafeed_packet packet;
+	struct sr_datafeed_meta meta;
+
+	meta.config = config;
+	packet.type = SR_DF_META;
+	packet.payload = &meta;
+	fail_unless(sr_session_send(sdi, &packet) == SR_OK);
+}
+
+/*
+ * Check that the samplerate in SR_DF_META is divided by the factor, in
+ * the same place, without touching the sender's config or other keys.
+ */
+START_TEST(test_transform_decimate_meta)
+{
+	struct sr_config *rate, *limit;
+	GSList *config;
+
+	decimate_add(8, "or", "minmax");
+	limit = sr_config_new(SR_CONF_LIMIT_SAMPLES, g_variant_new_uint64(5000));
+	rate = sr_config_new(SR_CONF_SAMPLERATE, g_variant_new_uint64(1000000));
+
+	/* No samplerate, passed on as is. */
+	config = g_slist_append(NULL, limit);
+	send_meta(config);
+	fail_unless(num_meta == 1);
+	fail_unless(meta_keys[0] == SR_CONF_LIMIT_SAMPLES);
+	fail_unless(meta_values[0] == 5000);
+
+	config = g_slist_append(config, rate);
+	send_meta(config);
+	fail_unless(num_meta == 2);
+	fail_unless(meta_keys[0] == SR_CONF_LIMIT_SAMPLES);
+	fail_unless(meta_values[0] == 5000);
+	fail_unless(meta_keys[1] == SR_CONF_SAMPLERATE);
+	fail_unless(meta_values[1] == 125000,
+		"Samplerate %" PRIu64 " passed on.", meta_values[1]);
+	fail_unless(g_variant_get_uint64(rate->data) == 1000000);
+
+	/* A later samplerate change replaces the earlier one. */
+	sr_config_free(rate);
+	rate = sr_config_new(SR_CONF_SAMPLERATE, g_variant_new_uint64(80));
+	config->next->data = rate;
+	send_meta(config);
+	fail_unless(num_meta == 2);
+	fail_unless(meta_values[1] == 10);
+
+	g_slist_free(config);
+	sr_config_free(limit);
+	sr_config_free(rate);
+}
+END_TEST
+
+Suite *suite_transform_stages(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("transform-stages");
+
+	tc = tcase_create("chain");
+	tcase_add_checked_fixture(tc, setup, teardown);
+	tcase_add_test(tc, test_transform_invert_subset_fused);
+	tcase_add_test(tc, test_transform_window_logic);
+	tcase_add_test(tc, test_transform_window_analog);
+	tcase_add_test(tc, test_transform_subset_analog);
+	tcase_add_test(tc, test_transform_decimate_logic);
+	tcase_add_test(tc, test_transform_decimate_minmax);
+	tcase_add_test(tc, test_transform_decimate_mean_peak);
+	tcase_add_test(tc, test_transform_decimate_multi);
+	tcase_add_test(tc, test_transform_decimate_meta);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
@@ -0,0 +1,126 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#define NUM_BLOCKS 16
+
+/* Reference: move one bit at a time. */
+static void transpose_naive(uint16_t channel_mask, gboolean msb_first,
+		const uint64_t *src, uint16_t *dst)
+{
+	unsigned int i, ch, n, bit;
+
+	for (i = 0; i < 64; i++) {
+		dst[i] = 0;
+		bit = msb_first ? 63 - i : i;
+		for (ch = 0, n = 0; ch < 16; ch++) {
+			if (!(channel_mask & (1 << ch)))
+				continue;
+			if ((src[n] >> bit) & 1)
+				dst[i] |= 1 << ch;
+			n++;
+		}
+	}
+}
+
+static void check_mask(GRand *rand, uint16_t channel_mask)
+{
+	struct sr_transpose t;
+	uint64_t src[16];
+	uint16_t dst[64], expected[64];
+	unsigned int block, i, msb_first, generic;
+
+	for (msb_first = 0; msb_first < 2; msb_first++) {
+		sr_transpose_init(&t, channel_mask, msb_first);
+		for (generic = 0; generic < 2; generic++) {
+			/* Also run the portable kernel on SIMD builds. */
+			t.generic = generic;
+			for (block = 0; block < NUM_BLOCKS; block++) {
+				for (i = 0; i < G_N_ELEMENTS(src); i++) {
+					src[i] = g_rand_int(rand);
+					src[i] = (src[i] << 32) | g_rand_int(rand);
+				}
+				/* Words past the enabled channels are ignored. */
+				transpose_naive(channel_mask, msb_first, src,
+					expected);
+				memset(dst, 0xa5, sizeof(dst));
+				sr_transpose_64(&t, src, dst);
+				for (i = 0; i < 64; i++) {
+					fail_unless(dst[i] == expected[i],
+						"Mask 0x%04x, %s first, %s kernel: "
+						"sample %u is 0x%04x, expected "
+						"0x%04x.", channel_mask,
+						msb_first ? "MSB" : "LSB",
+						generic ? "portable" : "default",
+						i, dst[i], expected[i]);
+				}
+			}
+		}
+	}
+}
+
+/* Check the transposition of the dense channel masks. */
+START_TEST(test_transpose_dense)
+{
+	GRand *rand;
+	unsigned int n;
+
+	rand = g_rand_new_with_seed(13);
+	for (n = 0; n <= 16; n++)
+		check_mask(rand, (1 << n) - 1);
+	g_rand_free(rand);
+}
+END_TEST
+
+/* Check the transposition of random sparse channel masks. */
+START_TEST(test_transpose_sparse)
+{
+	GRand *rand;
+	unsigned int i;
+
+	rand = g_rand_new_with_seed(14);
+	check_mask(rand, 0x8000);
+	check_mask(rand, 0xff00);
+	check_mask(rand, 0xaaaa);
+	check_mask(rand, 0x5555);
+	for (i = 0; i < 200; i++)
+		check_mask(rand, g_rand_int(rand));
+	g_rand_free(rand);
+}
+END_TEST
+
+Suite *suite_transpose(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("transpose");
+
+	tc = tcase_create("transpose_64");
+	tcase_add_test(tc, test_transpose_dense);
+	tcase_add_test(tc, test_transpose_sparse);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
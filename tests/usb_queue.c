@@ -0,0 +1,159 @@
+/*
+ * This file is part of the libsigrok project.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <check.h>
+#include <libsigrok/libsigrok.h>
+#include "libsigrok-internal.h"
+#include "lib.h"
+
+#ifdef HAVE_LIBUSB_1_0
+
+/* Items are small integers, as NULL means "empty" to sr_usb_queue_pop(). */
+#define ITEM(n) GUINT_TO_POINTER((n) + 1)
+
+#define NUM_THREADED 1000000
+
+/* Check that the capacity is rounded up to a power of two. */
+START_TEST(test_usb_queue_capacity)
+{
+	struct sr_usb_queue *queue;
+	unsigned int capacity, size, i;
+
+	for (capacity = 1; capacity <= 33; capacity++) {
+		queue = sr_usb_queue_new(capacity);
+		size = 1;
+		while (size < capacity)
+			size <<= 1;
+		for (i = 0; i < size; i++)
+			fail_unless(sr_usb_queue_push(queue, ITEM(i)),
+				"Capacity %u: push %u failed.", capacity, i);
+		fail_unless(!sr_usb_queue_push(queue, ITEM(i)),
+			"Capacity %u: push past %u items worked.",
+			capacity, size);
+		sr_usb_queue_free(queue);
+	}
+
+	/* Freeing nothing is fine. */
+	sr_usb_queue_free(NULL);
+}
+END_TEST
+
+/*
+ * Check the order of the items and the empty and full states, with
+ * the head and tail wrapping around many times.
+ */
+START_TEST(test_usb_queue_fifo)
+{
+	struct sr_usb_queue *queue;
+	unsigned int pushed, popped, n, i, round;
+	void *item;
+
+	queue = sr_usb_queue_new(8);
+	fail_unless(sr_usb_queue_is_empty(queue));
+	fail_unless(sr_usb_queue_pop(queue) == NULL);
+
+	pushed = popped = 0;
+	for (round = 0; round < 100; round++) {
+		/* Fill by 1 to 8 items, then drain by a different amount. */
+		n = 1 + round % 8;
+		for (i = 0; i < n && pushed - popped < 8; i++) {
+			fail_unless(sr_usb_queue_push(queue, ITEM(pushed)));
+			pushed++;
+			fail_unless(!sr_usb_queue_is_empty(queue));
+		}
+		if (pushed - popped == 8)
+			fail_unless(!sr_usb_queue_push(queue, ITEM(pushed)));
+		n = 1 + (round * 5) % 8;
+		for (i = 0; i < n && popped < pushed; i++) {
+			item = sr_usb_queue_pop(queue);
+			fail_unless(item == ITEM(popped),
+				"Round %u: popped %p, expected %p.",
+				round, item, ITEM(popped));
+			popped++;
+		}
+		fail_unless(sr_usb_queue_is_empty(queue) == (popped == pushed));
+	}
+	while (popped < pushed) {
+		fail_unless(sr_usb_queue_pop(queue) == ITEM(popped));
+		popped++;
+	}
+	fail_unless(sr_usb_queue_is_empty(queue));
+	fail_unless(sr_usb_queue_pop(queue) == NULL);
+
+	sr_usb_queue_free(queue);
+}
+END_TEST
+
+static gpointer producer(gpointer data)
+{
+	struct sr_usb_queue *queue;
+	unsigned int i;
+
+	queue = data;
+	for (i = 0; i < NUM_THREADED; i++) {
+		while (!sr_usb_queue_push(queue, ITEM(i)))
+			g_thread_yield();
+	}
+
+	return NULL;
+}
+
+/* Check that items cross between threads intact and in order. */
+START_TEST(test_usb_queue_threads)
+{
+	struct sr_usb_queue *queue;
+	GThread *thread;
+	unsigned int i;
+	void *item;
+
+	queue = sr_usb_queue_new(16);
+	thread = g_thread_new("usb-queue-test", producer, queue);
+
+	for (i = 0; i < NUM_THREADED; i++) {
+		while (!(item = sr_usb_queue_pop(queue)))
+			g_thread_yield();
+		fail_unless(item == ITEM(i), "Popped %p, expected %p.",
+			item, ITEM(i));
+	}
+	g_thread_join(thread);
+	fail_unless(sr_usb_queue_is_empty(queue));
+
+	sr_usb_queue_free(queue);
+}
+END_TEST
+
+#endif
+
+Suite *suite_usb_queue(void)
+{
+	Suite *s;
+	TCase *tc;
+
+	s = suite_create("usb-queue");
+
+	tc = tcase_create("spsc");
+#ifdef HAVE_LIBUSB_1_0
+	tcase_add_test(tc, test_usb_queue_capacity);
+	tcase_add_test(tc, test_usb_queue_fifo);
+	tcase_add_test(tc, test_usb_queue_threads);
+#endif
+	suite_add_tcase(s, tc);
+
+	return s;
+}